@@ -0,0 +1,133 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "monitoring/statistics.h"
+#include "rocksdb/rocksdb_namespace.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// A count-min sketch estimating how often a key hash was recorded recently.
+// Every hash maps to one small saturating counter in each of kDepth rows, and
+// its estimate is the minimum of its counters. Once the number of recorded
+// hashes reaches ten times the width of a row, all the counters are halved,
+// so that the estimates follow changes of the access pattern.
+//
+// The counters are updated with relaxed loads and stores. Concurrent updates
+// of a counter may be lost, which only makes the estimates a little lower.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(size_t expected_entries) : additions_(0) {
+    size_t width = kMinWidth;
+    while (width < expected_entries && width < kMaxWidth) {
+      width <<= 1;
+    }
+    mask_ = width - 1;
+    sample_size_ = static_cast<uint32_t>(10 * width);
+    counters_.reset(new std::atomic<uint8_t>[kDepth * width]);
+    for (size_t i = 0; i < kDepth * width; i++) {
+      counters_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Records an access to hash. Only the counters equal to the current
+  // estimate are incremented, which keeps the estimates of hashes sharing
+  // some of their counters closer to their actual frequency.
+  void Increment(uint32_t hash) {
+    size_t idx[kDepth];
+    uint8_t min_count = kMaxCount;
+    for (int row = 0; row < kDepth; row++) {
+      idx[row] = Index(hash, row);
+      min_count = std::min(
+          min_count, counters_[idx[row]].load(std::memory_order_relaxed));
+    }
+    if (min_count == kMaxCount) {
+      return;
+    }
+    for (int row = 0; row < kDepth; row++) {
+      if (counters_[idx[row]].load(std::memory_order_relaxed) == min_count) {
+        counters_[idx[row]].store(static_cast<uint8_t>(min_count + 1),
+                                  std::memory_order_relaxed);
+      }
+    }
+    if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+        sample_size_) {
+      Age();
+    }
+  }
+
+  uint32_t Estimate(uint32_t hash) const {
+    uint8_t min_count = kMaxCount;
+    for (int row = 0; row < kDepth; row++) {
+      min_count = std::min(
+          min_count,
+          counters_[Index(hash, row)].load(std::memory_order_relaxed));
+    }
+    return min_count;
+  }
+
+ private:
+  static const int kDepth = 4;
+  static const uint8_t kMaxCount = 15;
+  static const size_t kMinWidth = 1024;
+  static const size_t kMaxWidth = size_t{1} << 22;
+
+  size_t Index(uint32_t hash, int row) const {
+    static const uint64_t kSeeds[kDepth] = {
+        0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+        0xD6E8FEB86659FD93ull};
+    uint64_t h = (static_cast<uint64_t>(hash) + row) * kSeeds[row];
+    return static_cast<size_t>(row) * (mask_ + 1) +
+           (static_cast<size_t>(h >> 32) & mask_);
+  }
+
+  // Halves all the counters. Only called by the thread whose increment
+  // reached the sample size.
+  void Age() {
+    for (size_t i = 0; i < kDepth * (mask_ + 1); i++) {
+      counters_[i].store(counters_[i].load(std::memory_order_relaxed) >> 1,
+                         std::memory_order_relaxed);
+    }
+    additions_.fetch_sub(sample_size_ / 2, std::memory_order_relaxed);
+  }
+
+  size_t mask_;
+  uint32_t sample_size_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::atomic<uint32_t> additions_;
+};
+
+// The TinyLFU admission filter of a cache shard. The shard records every
+// lookup with RecordAccess(), and when an insertion has to evict entries,
+// only admits the new entry if Admit() finds it was looked up more often
+// recently than the first entry it would evict. Entries read once, e.g. by
+// a scan, then can't push out the entries that are used repeatedly.
+class CacheAdmissionFilter {
+ public:
+  CacheAdmissionFilter(size_t expected_entries, Statistics* statistics)
+      : sketch_(expected_entries), statistics_(statistics) {}
+
+  void RecordAccess(uint32_t hash) { sketch_.Increment(hash); }
+
+  bool Admit(uint32_t candidate_hash, uint32_t victim_hash) {
+    bool admit =
+        sketch_.Estimate(candidate_hash) > sketch_.Estimate(victim_hash);
+    RecordTick(statistics_,
+               admit ? CACHE_ADMISSION_ADMITTED : CACHE_ADMISSION_REJECTED);
+    return admit;
+  }
+
+ private:
+  FrequencySketch sketch_;
+  Statistics* statistics_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -345,6 +345,7 @@ class CacheBench {
     printf("RocksDB version     : %d.%d\n", kMajorVersion, kMinorVersion);
     printf("Number of threads   : %u\n", FLAGS_threads);
     printf("Ops per thread      : %" PRIu64 "\n", FLAGS_ops_per_thread);
+    printf("Cache type          : %s\n", cache_->Name());
     printf("Cache size          : %" PRIu64 "\n", FLAGS_cache_size);
     printf("Num shard bits      : %u\n", FLAGS_num_shard_bits);
     printf("Max key             : %" PRIu64 "\n", max_key_);
@@ -152,6 +152,7 @@ class CacheTest : public testing::TestWithParam<std::string> {
 CacheTest* CacheTest::current_;
 
 class LRUCacheTest : public CacheTest {};
+class ClockCacheTest : public CacheTest {};
 
 TEST_P(CacheTest, UsageTest) {
   // cache is std::shared_ptr and will be automatically cleaned up.
@@ -757,11 +758,36 @@ TEST_P(CacheTest, GetCharge) {
   cache_->Release(h1);
 }
 
+TEST_P(ClockCacheTest, HighPriorityEntries) {
+  const int kCapacity = 10;
+  std::shared_ptr<Cache> cache = NewCache(kCapacity, 0, false);
+  ASSERT_OK(cache->Insert(EncodeKey(100), EncodeValue(101), 1,
+                          &CacheTest::Deleter, nullptr,
+                          Cache::Priority::HIGH));
+  Insert(cache, 200, 201);
+
+  // A scan of new entries evicts the low priority entry, but not the high
+  // priority one, even though neither of them is looked up.
+  for (int i = 0; i < kCapacity; i++) {
+    Insert(cache, 1000 + i, 2000 + i);
+  }
+  ASSERT_EQ(-1, Lookup(cache, 200));
+  ASSERT_EQ(101, Lookup(cache, 100));
+
+  // Without further lookups it is evicted by longer scans.
+  for (int i = 0; i < 4 * kCapacity; i++) {
+    Insert(cache, 3000 + i, 4000 + i);
+  }
+  ASSERT_EQ(-1, Lookup(cache, 100));
+}
+
 #ifdef SUPPORT_CLOCK_CACHE
 std::shared_ptr<Cache> (*new_clock_cache_func)(
     size_t, int, bool, CacheMetadataChargePolicy) = NewClockCache;
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest,
                         testing::Values(kLRU, kClock));
+INSTANTIATE_TEST_CASE_P(CacheTestInstance, ClockCacheTest,
+                        testing::Values(kClock));
 #else
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest, testing::Values(kLRU));
 #endif  // SUPPORT_CLOCK_CACHE
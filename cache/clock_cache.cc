@@ -27,13 +27,8 @@ std::shared_ptr<Cache> NewClockCache(
 #include <assert.h>
 #include <atomic>
 #include <deque>
-
-// "tbb/concurrent_hash_map.h" requires RTTI if exception is enabled.
-// Disable it so users can chooose to disable RTTI.
-#ifndef ROCKSDB_USE_RTTI
-#define TBB_USE_EXCEPTIONS 0
-#endif
-#include "tbb/concurrent_hash_map.h"
+#include <memory>
+#include <vector>
 
 #include "cache/sharded_cache.h"
 #include "port/malloc.h"
@@ -61,9 +56,9 @@ namespace {
 // to be re-use. This is to avoid memory dealocation, which is hard to deal
 // with in concurrent environment.
 //
-// The cache also maintains a concurrent hash map for lookup. Any concurrent
-// hash map implementation should do the work. We currently use
-// tbb::concurrent_hash_map because it supports concurrent erase.
+// The cache also maintains a hash map for lookup, an open addressing table
+// of (hash, handle) slots with linear probing, see HandleTable. Lookups probe
+// it without locking.
 //
 // Each cache handle has the following flags and counters, which are squeeze
 // in an atomic interger, to make sure the handle always be in a consistent
@@ -71,16 +66,17 @@ namespace {
 //
 //   * In-cache bit: whether the entry is reference by the cache itself. If
 //     an entry is in cache, its key would also be available in the hash map.
-//   * Usage bit: whether the entry has been access by user since last
-//     examine for eviction. Can be reset by eviction.
+//   * Usage count: how many more times the entry survives being examined for
+//     eviction. It is raised by accesses and decremented by eviction. High
+//     priority entries start with, and are raised to, a higher count.
 //   * Reference count: reference count by user.
 //
 // An entry can be reference only when it's in cache. An entry can be evicted
-// only when it is in cache, has no usage since last examine, and reference
-// count is zero.
+// only when it is in cache, has a usage count of zero, and reference count is
+// zero.
 //
 // The follow figure shows a possible layout of the cache. Boxes represents
-// cache handles and numbers in each box being in-cache bit, usage bit and
+// cache handles and numbers in each box being in-cache bit, usage count and
 // reference count respectively.
 //
 //    hash map:
@@ -107,11 +103,11 @@ namespace {
 //
 // Suppose we try to insert "baz" into the cache at this point and the cache is
 // full. The cache will first look for entries to evict, starting from where
-// head points to (the second entry). It resets usage bit of the second entry,
-// skips the third and fourth entry since they are not in cache, and finally
-// evict the fifth entry ("foo"). It looks at recycle bin for available handle,
-// grabs handle 3, and insert the key into the handle. The following figure
-// shows the resulting layout.
+// head points to (the second entry). It decrements the usage count of the
+// second entry, skips the third and fourth entry since they are not in cache,
+// and finally evict the fifth entry ("foo"). It looks at recycle bin for
+// available handle, grabs handle 3, and insert the key into the handle. The
+// following figure shows the resulting layout.
 //
 //    hash map:
 //      +-------+--------+
@@ -141,8 +137,9 @@ namespace {
 // hold the mutex. Lookup() only access the hash map and the flags associated
 // with each handle, and don't require explicit locking. Release() has to
 // acquire the mutex only when it releases the last reference to the entry and
-// the entry has been erased from cache explicitly. A future improvement could
-// be to remove the mutex completely.
+// the entry has been erased from cache explicitly. As handles are never
+// freed, a lookup that races with the eviction of an entry at worst misses
+// it, or finds its handle reused and rejects it after taking a reference.
 //
 // Benchmark:
 // We run readrandom db_bench on a test DB of size 13GB, with size of each
@@ -173,23 +170,24 @@ namespace {
 //     16  64GB       yes               391.9  99.9%           353.3   99.9%
 //     16  64GB       no                433.8  99.8%           419.4   99.8%
 
-// Cache entry meta data.
+// Cache entry meta data. The fields read by lookups come first, and the
+// handle fits in a cache line.
 struct CacheHandle {
-  Slice key;
-  uint32_t hash;
-  void* value;
-  size_t charge;
-  void (*deleter)(const Slice&, void* value);
-
   // Flags and counters associated with the cache handle:
   //   lowest bit: in-cache bit
-  //   second lowest bit: usage bit
+  //   next two bits: usage count
   //   the rest bits: reference count
   // The handle is unused when flags equals to 0. The thread decreases the count
   // to 0 is responsible to put the handle back to recycle_ and cleanup memory.
   std::atomic<uint32_t> flags;
+  uint32_t hash;
+  Slice key;
+  void* value;
+  size_t charge;
+  void (*deleter)(const Slice&, void* value);
+  bool high_pri;
 
-  CacheHandle() = default;
+  CacheHandle() : flags(0), hash(0), high_pri(false) {}
 
   CacheHandle(const CacheHandle& a) { *this = a; }
 
@@ -227,25 +225,163 @@ struct CacheHandle {
   }
 };
 
-// Key of hash map. We store hash value with the key for convenience.
-struct CacheKey {
-  Slice key;
-  uint32_t hash_value;
+static_assert(sizeof(CacheHandle) <= CACHE_LINE_SIZE,
+              "CacheHandle should fit in a cache line");
+
+// Hash map from keys to the handles of the entries in cache: an open
+// addressing table of (hash, handle) slots, four to a cache line, with linear
+// probing. Lookup() may be called concurrently with the other methods, which
+// must be serialized by the caller.
+//
+// Removals shift the following slots of the probe sequence back instead of
+// leaving tombstones, and the table is replaced by one twice as large when it
+// gets half full. A concurrent Lookup() may therefore miss an entry that is
+// being moved, which for a cache only costs a miss. Replaced tables are kept
+// until the table is destroyed, as lookups may still be probing them; they
+// take less memory than the current one.
+class HandleTable {
+ public:
+  HandleTable() : count_(0) { Resize(kInitialLengthBits); }
+
+  // Returns the first handle of a slot with the given hash for which
+  // match(handle) returns true, or nullptr. Without synchronization with the
+  // writers, a handle may have been reused for another entry, which match
+  // has to check.
+  template <typename MatchFn>
+  CacheHandle* Lookup(uint32_t hash, const MatchFn& match) const {
+    const Array* array = array_.load(std::memory_order_acquire);
+    const size_t mask = array->mask;
+    size_t i = hash & mask;
+    for (size_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+      const Slot& slot = array->slots[i];
+      CacheHandle* handle = slot.handle.load(std::memory_order_acquire);
+      if (handle == nullptr) {
+        break;
+      }
+      if (slot.hash.load(std::memory_order_relaxed) == hash && match(handle)) {
+        return handle;
+      }
+    }
+    return nullptr;
+  }
 
-  CacheKey() = default;
+  // Inserts the handle of a key that is not in the table yet.
+  void Insert(CacheHandle* handle) {
+    if ((count_ + 1) * 2 > Current()->mask + 1) {
+      Resize(length_bits_ + 1);
+    }
+    Array* array = Current();
+    Slot* slot = &array->slots[handle->hash & array->mask];
+    while (slot->handle.load(std::memory_order_relaxed) != nullptr) {
+      slot = Next(array, slot);
+    }
+    slot->hash.store(handle->hash, std::memory_order_relaxed);
+    slot->handle.store(handle, std::memory_order_release);
+    count_++;
+  }
+
+  // Replaces the handle of a slot with another one of the same key.
+  void Replace(CacheHandle* old_handle, CacheHandle* new_handle) {
+    assert(old_handle->hash == new_handle->hash);
+    FindSlot(old_handle)->handle.store(new_handle, std::memory_order_release);
+  }
+
+  void Remove(CacheHandle* handle) {
+    Array* array = Current();
+    const size_t mask = array->mask;
+    size_t hole = static_cast<size_t>(FindSlot(handle) - array->slots.get());
+    // Moves back the entries after the hole whose probe sequence starts at
+    // or before it
+    for (size_t i = (hole + 1) & mask;; i = (i + 1) & mask) {
+      Slot& slot = array->slots[i];
+      CacheHandle* moved = slot.handle.load(std::memory_order_relaxed);
+      if (moved == nullptr) {
+        break;
+      }
+      size_t home = slot.hash.load(std::memory_order_relaxed) & mask;
+      bool stays = (hole <= i) ? (hole < home && home <= i)
+                               : (hole < home || home <= i);
+      if (!stays) {
+        array->slots[hole].hash.store(slot.hash.load(std::memory_order_relaxed),
+                                      std::memory_order_relaxed);
+        array->slots[hole].handle.store(moved, std::memory_order_release);
+        hole = i;
+      }
+    }
+    array->slots[hole].handle.store(nullptr, std::memory_order_release);
+    count_--;
+  }
 
-  CacheKey(const Slice& k, uint32_t h) {
-    key = k;
-    hash_value = h;
+  void Clear() {
+    Array* array = Current();
+    for (size_t i = 0; i <= array->mask; i++) {
+      array->slots[i].handle.store(nullptr, std::memory_order_release);
+    }
+    count_ = 0;
   }
 
-  static bool equal(const CacheKey& a, const CacheKey& b) {
-    return a.hash_value == b.hash_value && a.key == b.key;
+ private:
+  static const int kInitialLengthBits = 4;
+
+  struct Slot {
+    std::atomic<uint32_t> hash;
+    std::atomic<CacheHandle*> handle;
+
+    Slot() : hash(0), handle(nullptr) {}
+  };
+
+  struct Array {
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  Array* Current() const { return array_.load(std::memory_order_relaxed); }
+
+  static Slot* Next(Array* array, Slot* slot) {
+    size_t i = static_cast<size_t>(slot - array->slots.get());
+    return &array->slots[(i + 1) & array->mask];
   }
 
-  static size_t hash(const CacheKey& a) {
-    return static_cast<size_t>(a.hash_value);
+  Slot* FindSlot(CacheHandle* handle) const {
+    Array* array = Current();
+    Slot* slot = &array->slots[handle->hash & array->mask];
+    while (slot->handle.load(std::memory_order_relaxed) != handle) {
+      assert(slot->handle.load(std::memory_order_relaxed) != nullptr);
+      slot = Next(array, slot);
+    }
+    return slot;
+  }
+
+  void Resize(int length_bits) {
+    std::unique_ptr<Array> array(new Array());
+    array->mask = (size_t{1} << length_bits) - 1;
+    array->slots.reset(new Slot[array->mask + 1]);
+    Array* old_array = arrays_.empty() ? nullptr : arrays_.back().get();
+    if (old_array != nullptr) {
+      for (size_t i = 0; i <= old_array->mask; i++) {
+        CacheHandle* handle =
+            old_array->slots[i].handle.load(std::memory_order_relaxed);
+        if (handle == nullptr) {
+          continue;
+        }
+        Slot* slot = &array->slots[handle->hash & array->mask];
+        while (slot->handle.load(std::memory_order_relaxed) != nullptr) {
+          slot = Next(array.get(), slot);
+        }
+        slot->hash.store(handle->hash, std::memory_order_relaxed);
+        slot->handle.store(handle, std::memory_order_relaxed);
+      }
+    }
+    length_bits_ = length_bits;
+    array_.store(array.get(), std::memory_order_release);
+    arrays_.push_back(std::move(array));
   }
+
+  std::atomic<Array*> array_;
+  // The current array and the ones it replaced
+  std::vector<std::unique_ptr<Array>> arrays_;
+  int length_bits_;
+  size_t count_;
 };
 
 struct CleanupContext {
@@ -259,9 +395,6 @@ struct CleanupContext {
 // A cache shard which maintains its own CLOCK cache.
 class ClockCacheShard final : public CacheShard {
  public:
-  // Hash map type.
-  typedef tbb::concurrent_hash_map<CacheKey, CacheHandle*, CacheKey> HashTable;
-
   ClockCacheShard();
   ~ClockCacheShard() override;
 
@@ -271,7 +404,22 @@ class ClockCacheShard final : public CacheShard {
   Status Insert(const Slice& key, uint32_t hash, void* value, size_t charge,
                 void (*deleter)(const Slice& key, void* value),
                 Cache::Handle** handle, Cache::Priority priority) override;
+  Status Insert(const Slice& key, uint32_t hash, void* value,
+                const Cache::CacheItemHelper* helper, size_t charge,
+                Cache::Handle** handle, Cache::Priority priority) override {
+    return Insert(key, hash, value, charge, helper->del_cb, handle, priority);
+  }
   Cache::Handle* Lookup(const Slice& key, uint32_t hash) override;
+  // The clock cache has no secondary cache.
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                        const Cache::CacheItemHelper* /*helper*/,
+                        const Cache::CreateCallback& /*create_cb*/,
+                        Cache::Priority /*priority*/, bool /*wait*/,
+                        Statistics* /*stats*/) override {
+    return Lookup(key, hash);
+  }
+  bool IsReady(Cache::Handle* /*handle*/) override { return true; }
+  void Wait(Cache::Handle* /*handle*/) override {}
   // If the entry in in cache, increase reference count and return true.
   // Return false otherwise.
   //
@@ -289,15 +437,36 @@ class ClockCacheShard final : public CacheShard {
 
  private:
   static const uint32_t kInCacheBit = 1;
-  static const uint32_t kUsageBit = 2;
-  static const uint32_t kRefsOffset = 2;
+  static const uint32_t kUsageOffset = 1;
+  static const uint32_t kOneUsage = 1 << kUsageOffset;
+  static const uint32_t kUsageMask = 3 << kUsageOffset;
+  static const uint32_t kRefsOffset = 3;
   static const uint32_t kOneRef = 1 << kRefsOffset;
 
+  // Usage counts set by an access to a low and a high priority entry, and on
+  // insertion of a high priority one. Low priority entries only ever have a
+  // count of 0 or 1, so an access only sets bits and takes a single atomic
+  // operation.
+  static const uint32_t kLowPriUsage = kOneUsage;
+  static const uint32_t kHighPriUsage = 3 << kUsageOffset;
+
   // Helper functions to extract cache handle flags and counters.
   static bool InCache(uint32_t flags) { return flags & kInCacheBit; }
-  static bool HasUsage(uint32_t flags) { return flags & kUsageBit; }
+  static uint32_t CountUsage(uint32_t flags) {
+    return (flags & kUsageMask) >> kUsageOffset;
+  }
   static uint32_t CountRefs(uint32_t flags) { return flags >> kRefsOffset; }
 
+  // Returns the handle of key if it is in cache.
+  //
+  // Has to hold mutex_ before being called.
+  CacheHandle* FindInCache(const Slice& key, uint32_t hash) {
+    mutex_.AssertHeld();
+    return table_.Lookup(hash, [&](CacheHandle* handle) {
+      return handle->hash == hash && handle->key == key;
+    });
+  }
+
   // Decrease reference count of the entry. If this decreases the count to 0,
   // recycle the entry. If set_usage is true, also set the usage bit.
   //
@@ -324,9 +493,9 @@ class ClockCacheShard final : public CacheShard {
   // holding mutex, as destructors can be expensive.
   void Cleanup(const CleanupContext& context);
 
-  // Examine the handle for eviction. If the handle is in cache, usage bit is
-  // not set, and referece count is 0, evict it from cache. Otherwise unset
-  // the usage bit.
+  // Examine the handle for eviction. If the handle is in cache, usage count
+  // is 0, and referece count is 0, evict it from cache. Otherwise decrement
+  // the usage count.
   //
   // Has to hold mutex_ before being called.
   bool TryEvict(CacheHandle* value, CleanupContext* context);
@@ -341,8 +510,8 @@ class ClockCacheShard final : public CacheShard {
   CacheHandle* Insert(const Slice& key, uint32_t hash, void* value,
                       size_t change,
                       void (*deleter)(const Slice& key, void* value),
-                      bool hold_reference, CleanupContext* context,
-                      bool* overwritten);
+                      Cache::Priority priority, bool hold_reference,
+                      CleanupContext* context, bool* overwritten);
 
   // Guards list_, head_, and recycle_. In addition, updating table_ also has
   // to hold the mutex, to avoid the cache being in inconsistent state.
@@ -377,8 +546,8 @@ class ClockCacheShard final : public CacheShard {
   // Whether allow insert into cache if cache is full.
   std::atomic<bool> strict_capacity_limit_;
 
-  // Hash table (tbb::concurrent_hash_map) for lookup.
-  HashTable table_;
+  // Hash table for lookup. Modified under mutex_.
+  HandleTable table_;
 };
 
 ClockCacheShard::ClockCacheShard()
@@ -471,7 +640,8 @@ bool ClockCacheShard::Ref(Cache::Handle* h) {
 bool ClockCacheShard::Unref(CacheHandle* handle, bool set_usage,
                             CleanupContext* context) {
   if (set_usage) {
-    handle->flags.fetch_or(kUsageBit, std::memory_order_relaxed);
+    handle->flags.fetch_or(handle->high_pri ? kHighPriUsage : kLowPriUsage,
+                           std::memory_order_relaxed);
   }
   // Use acquire-release semantics as previous operations on the cache entry
   // has to be order before reference count is decreased, and potential cleanup
@@ -511,13 +681,15 @@ bool ClockCacheShard::TryEvict(CacheHandle* handle, CleanupContext* context) {
   uint32_t flags = kInCacheBit;
   if (handle->flags.compare_exchange_strong(flags, 0, std::memory_order_acquire,
                                             std::memory_order_relaxed)) {
-    bool erased __attribute__((__unused__)) =
-        table_.erase(CacheKey(handle->key, handle->hash));
-    assert(erased);
+    table_.Remove(handle);
     RecycleHandle(handle, context);
     return true;
   }
-  handle->flags.fetch_and(~kUsageBit, std::memory_order_relaxed);
+  // Accesses only raise the usage count, and only the mutex holder lowers
+  // it, so it cannot underflow.
+  if (InCache(flags) && CountUsage(flags) > 0) {
+    handle->flags.fetch_sub(kOneUsage, std::memory_order_relaxed);
+  }
   return false;
 }
 
@@ -528,19 +700,17 @@ bool ClockCacheShard::EvictFromCache(size_t charge, CleanupContext* context) {
     return charge <= capacity;
   }
   size_t new_head = head_;
-  bool second_iteration = false;
+  // Every pass over the list lowers the usage counts, so an unreferenced entry
+  // is evicted in at most one more pass than its maximum count.
+  uint32_t passes = 0;
   while (usage + charge > capacity) {
     assert(new_head < list_.size());
     if (TryEvict(&list_[new_head], context)) {
       usage = usage_.load(std::memory_order_relaxed);
     }
     new_head = (new_head + 1 >= list_.size()) ? 0 : new_head + 1;
-    if (new_head == head_) {
-      if (second_iteration) {
-        return false;
-      } else {
-        second_iteration = true;
-      }
+    if (new_head == head_ && ++passes > CountUsage(kUsageMask)) {
+      return false;
     }
   }
   head_ = new_head;
@@ -564,8 +734,8 @@ void ClockCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
 
 CacheHandle* ClockCacheShard::Insert(
     const Slice& key, uint32_t hash, void* value, size_t charge,
-    void (*deleter)(const Slice& key, void* value), bool hold_reference,
-    CleanupContext* context, bool* overwritten) {
+    void (*deleter)(const Slice& key, void* value), Cache::Priority priority,
+    bool hold_reference, CleanupContext* context, bool* overwritten) {
   assert(overwritten != nullptr && *overwritten == false);
   size_t total_charge =
       CacheHandle::CalcTotalCharge(key, charge, metadata_charge_policy_);
@@ -595,16 +765,21 @@ CacheHandle* ClockCacheShard::Insert(
   handle->value = value;
   handle->charge = charge;
   handle->deleter = deleter;
+  handle->high_pri = priority == Cache::Priority::HIGH;
   uint32_t flags = hold_reference ? kInCacheBit + kOneRef : kInCacheBit;
-  handle->flags.store(flags, std::memory_order_relaxed);
-  HashTable::accessor accessor;
-  if (table_.find(accessor, CacheKey(key, hash))) {
+  if (handle->high_pri) {
+    flags |= kHighPriUsage;
+  }
+  // Lookups may find the handle as soon as it is published in table_
+  handle->flags.store(flags, std::memory_order_release);
+  CacheHandle* existing_handle = FindInCache(key, hash);
+  if (existing_handle != nullptr) {
     *overwritten = true;
-    CacheHandle* existing_handle = accessor->second;
-    table_.erase(accessor);
+    table_.Replace(existing_handle, handle);
     UnsetInCache(existing_handle, context);
+  } else {
+    table_.Insert(handle);
   }
-  table_.insert(HashTable::value_type(CacheKey(key, hash), handle));
   if (hold_reference) {
     pinned_usage_.fetch_add(total_charge, std::memory_order_relaxed);
   }
@@ -616,15 +791,15 @@ Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
                                size_t charge,
                                void (*deleter)(const Slice& key, void* value),
                                Cache::Handle** out_handle,
-                               Cache::Priority /*priority*/) {
+                               Cache::Priority priority) {
   CleanupContext context;
-  HashTable::accessor accessor;
   char* key_data = new char[key.size()];
   memcpy(key_data, key.data(), key.size());
   Slice key_copy(key_data, key.size());
   bool overwritten = false;
-  CacheHandle* handle = Insert(key_copy, hash, value, charge, deleter,
-                               out_handle != nullptr, &context, &overwritten);
+  CacheHandle* handle =
+      Insert(key_copy, hash, value, charge, deleter, priority,
+             out_handle != nullptr, &context, &overwritten);
   Status s;
   if (out_handle != nullptr) {
     if (handle == nullptr) {
@@ -642,27 +817,24 @@ Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
 }
 
 Cache::Handle* ClockCacheShard::Lookup(const Slice& key, uint32_t hash) {
-  HashTable::const_accessor accessor;
-  if (!table_.find(accessor, CacheKey(key, hash))) {
-    return nullptr;
-  }
-  CacheHandle* handle = accessor->second;
-  accessor.release();
-  // Ref() could fail if another thread sneak in and evict/erase the cache
-  // entry before we are able to hold reference.
-  if (!Ref(reinterpret_cast<Cache::Handle*>(handle))) {
-    return nullptr;
-  }
-  // Double check the key since the handle may now representing another key
-  // if other threads sneak in, evict/erase the entry and re-used the handle
-  // for another cache entry.
-  if (hash != handle->hash || key != handle->key) {
-    CleanupContext context;
-    Unref(handle, false, &context);
-    // It is possible Unref() delete the entry, so we need to cleanup.
-    Cleanup(context);
-    return nullptr;
-  }
+  CacheHandle* handle = table_.Lookup(hash, [&](CacheHandle* h) {
+    // Ref() could fail if another thread sneak in and evict/erase the cache
+    // entry before we are able to hold reference.
+    if (!Ref(reinterpret_cast<Cache::Handle*>(h))) {
+      return false;
+    }
+    // Double check the key since the handle may now representing another key
+    // if other threads sneak in, evict/erase the entry and re-used the handle
+    // for another cache entry.
+    if (hash != h->hash || key != h->key) {
+      CleanupContext context;
+      Unref(h, false, &context);
+      // It is possible Unref() delete the entry, so we need to cleanup.
+      Cleanup(context);
+      return false;
+    }
+    return true;
+  });
   return reinterpret_cast<Cache::Handle*>(handle);
 }
 
@@ -686,11 +858,10 @@ void ClockCacheShard::Erase(const Slice& key, uint32_t hash) {
 bool ClockCacheShard::EraseAndConfirm(const Slice& key, uint32_t hash,
                                       CleanupContext* context) {
   MutexLock l(&mutex_);
-  HashTable::accessor accessor;
   bool erased = false;
-  if (table_.find(accessor, CacheKey(key, hash))) {
-    CacheHandle* handle = accessor->second;
-    table_.erase(accessor);
+  CacheHandle* handle = FindInCache(key, hash);
+  if (handle != nullptr) {
+    table_.Remove(handle);
     erased = UnsetInCache(handle, context);
   }
   return erased;
@@ -700,7 +871,7 @@ void ClockCacheShard::EraseUnRefEntries() {
   CleanupContext context;
   {
     MutexLock l(&mutex_);
-    table_.clear();
+    table_.Clear();
     for (auto& handle : list_) {
       UnsetInCache(&handle, &context);
     }
@@ -0,0 +1,175 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <memory>
+#include <string>
+
+#include "cache/cache_helpers.h"
+#include "memory/memory_allocator.h"
+#include "rocksdb/secondary_cache.h"
+#include "util/compression.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+class CompressedSecondaryCacheResultHandle : public SecondaryCacheResultHandle {
+ public:
+  CompressedSecondaryCacheResultHandle(void* value, size_t size)
+      : value_(value), size_(size) {}
+
+  bool IsReady() override { return true; }
+  void Wait() override {}
+  void* Value() override { return value_; }
+  size_t Size() override { return size_; }
+
+ private:
+  void* value_;
+  size_t size_;
+};
+
+// A secondary cache that keeps the serialized values in an LRU cache of its
+// own, compressed if that saves at least an eighth of their size.
+class CompressedSecondaryCache : public SecondaryCache {
+ public:
+  CompressedSecondaryCache(const CompressedSecondaryCacheOptions& options,
+                           std::shared_ptr<Cache> cache)
+      : options_(options), cache_(std::move(cache)) {}
+
+  const char* Name() const override { return "CompressedSecondaryCache"; }
+
+  Status Insert(const Slice& key, void* value,
+                const Cache::CacheItemHelper* helper) override;
+
+  std::unique_ptr<SecondaryCacheResultHandle> Lookup(
+      const Slice& key, const Cache::CreateCallback& create_cb,
+      bool wait) override;
+
+  void Erase(const Slice& key) override { cache_->Erase(key); }
+
+  void WaitAll(std::vector<SecondaryCacheResultHandle*> /*handles*/) override {
+    // Lookups are synchronous
+  }
+
+  std::string GetPrintableOptions() const override;
+
+ private:
+  // Value of the entries of cache_
+  struct Entry {
+    std::string data;
+    CompressionType compression_type;
+  };
+
+  const CompressedSecondaryCacheOptions options_;
+  std::shared_ptr<Cache> cache_;
+};
+
+Status CompressedSecondaryCache::Insert(const Slice& key, void* value,
+                                        const Cache::CacheItemHelper* helper) {
+  // A promoted value is demoted again when the primary cache evicts it, and
+  // only needs to be saved if cache_ evicted it meanwhile
+  Cache::Handle* handle = cache_->Lookup(key);
+  if (handle != nullptr) {
+    cache_->Release(handle);
+    return Status::OK();
+  }
+  size_t size = (*helper->size_cb)(value);
+  std::string raw(size, '\0');
+  Status s = (*helper->saveto_cb)(value, 0, size, &raw[0]);
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::unique_ptr<Entry> entry(new Entry());
+  entry->compression_type = kNoCompression;
+  const CompressionType type = options_.compression_type;
+  if (type != kNoCompression && CompressionTypeSupported(type)) {
+    CompressionOptions compression_opts;
+    CompressionContext context(type);
+    CompressionInfo info(compression_opts, context,
+                         CompressionDict::GetEmptyDict(), type,
+                         0 /* sample_for_compression */);
+    if (CompressData(raw, info, options_.compress_format_version,
+                     &entry->data) &&
+        entry->data.size() < size - size / 8) {
+      entry->compression_type = type;
+    }
+  }
+  if (entry->compression_type == kNoCompression) {
+    entry->data = std::move(raw);
+  }
+
+  size_t charge = sizeof(Entry) + entry->data.size();
+  s = cache_->Insert(key, entry.get(), charge, &DeleteCacheEntry<Entry>);
+  if (s.ok()) {
+    entry.release();
+  }
+  return s;
+}
+
+std::unique_ptr<SecondaryCacheResultHandle> CompressedSecondaryCache::Lookup(
+    const Slice& key, const Cache::CreateCallback& create_cb, bool /*wait*/) {
+  Cache::Handle* handle = cache_->Lookup(key);
+  if (handle == nullptr) {
+    return nullptr;
+  }
+  Entry* entry = GetFromCacheHandle<Entry>(cache_.get(), handle);
+
+  Status s;
+  void* value = nullptr;
+  size_t charge = 0;
+  if (entry->compression_type == kNoCompression) {
+    s = create_cb(&entry->data[0], entry->data.size(), &value, &charge);
+  } else {
+    UncompressionContext context(entry->compression_type);
+    UncompressionInfo info(context, UncompressionDict::GetEmptyDict(),
+                           entry->compression_type);
+    size_t uncompressed_size = 0;
+    CacheAllocationPtr uncompressed = UncompressData(
+        info, entry->data.data(), entry->data.size(), &uncompressed_size,
+        options_.compress_format_version, options_.memory_allocator.get());
+    if (!uncompressed) {
+      s = Status::Corruption("Failed to uncompress a secondary cache entry");
+    } else {
+      s = create_cb(uncompressed.get(), uncompressed_size, &value, &charge);
+    }
+  }
+  cache_->Release(handle);
+
+  if (!s.ok()) {
+    return nullptr;
+  }
+  return std::unique_ptr<SecondaryCacheResultHandle>(
+      new CompressedSecondaryCacheResultHandle(value, charge));
+}
+
+std::string CompressedSecondaryCache::GetPrintableOptions() const {
+  std::string ret;
+  ret.append("    name : CompressedSecondaryCache\n");
+  ret.append("    compression_type : " +
+             CompressionTypeToString(options_.compression_type) + "\n");
+  ret.append("    compress_format_version : " +
+             ToString(options_.compress_format_version) + "\n");
+  ret.append(cache_->GetPrintableOptions());
+  return ret;
+}
+
+}  // namespace
+
+std::shared_ptr<SecondaryCache> NewCompressedSecondaryCache(
+    const CompressedSecondaryCacheOptions& options) {
+  std::shared_ptr<Cache> cache = NewLRUCache(
+      options.capacity, options.num_shard_bits,
+      false /* strict_capacity_limit */, 0.0 /* high_pri_pool_ratio */,
+      nullptr /* memory_allocator */, kDefaultToAdaptiveMutex,
+      kDontChargeCacheMetadata);
+  if (cache == nullptr) {
+    return nullptr;
+  }
+  return std::make_shared<CompressedSecondaryCache>(options, std::move(cache));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
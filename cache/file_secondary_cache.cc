@@ -0,0 +1,464 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/secondary_cache.h"
+#include "rocksdb/threadpool.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+const char* kCacheFileSuffix = ".cache";
+
+// Every value is stored as a record
+//   size: fixed32, crc32c of data: fixed32, data: char[size]
+const size_t kRecordHeaderSize = 8;
+
+class FileSecondaryCacheResultHandle : public SecondaryCacheResultHandle {
+ public:
+  FileSecondaryCacheResultHandle() : ready_(false), value_(nullptr), size_(0) {}
+
+  bool IsReady() override {
+    std::lock_guard<std::mutex> l(mutex_);
+    return ready_;
+  }
+
+  void Wait() override {
+    std::unique_lock<std::mutex> l(mutex_);
+    cv_.wait(l, [this] { return ready_; });
+  }
+
+  void* Value() override { return value_; }
+  size_t Size() override { return size_; }
+
+  void SetResult(void* value, size_t size) {
+    std::lock_guard<std::mutex> l(mutex_);
+    value_ = value;
+    size_ = size;
+    ready_ = true;
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool ready_;
+  void* value_;
+  size_t size_;
+};
+
+// A cache file. The segment being filled only lives in buffer. When full, it
+// is written to its file by the background thread, and served from buffer
+// until the file is reopened for reads. buffer is not modified while it is
+// written, and file is not modified once the segment is sealed, so a lookup
+// holding a reference to the segment can read it without the mutex, even
+// after it was evicted.
+struct Segment {
+  uint64_t number = 0;
+  std::string fname;
+  bool sealed = false;
+  // Dropped by EvictSegments() before its file was written
+  bool evicted = false;
+  uint64_t file_size = 0;
+  std::string buffer;
+  std::unique_ptr<FSRandomAccessFile> file;
+  // Keys of the records of the segment
+  std::vector<std::string> keys;
+};
+
+// A secondary cache that appends the saved values to log structured files,
+// and evicts them a whole file at a time, oldest first.
+class FileSecondaryCache : public SecondaryCache {
+ public:
+  FileSecondaryCache(const FileSecondaryCacheOptions& options,
+                     std::shared_ptr<FileSystem> fs)
+      : options_(options),
+        fs_(std::move(fs)),
+        next_file_number_(1),
+        total_size_(0) {
+    if (options_.lookup_threads > 0) {
+      lookup_pool_.reset(NewThreadPool(options_.lookup_threads));
+    }
+    // A single thread writes the full segments in order
+    write_pool_.reset(NewThreadPool(1));
+  }
+
+  ~FileSecondaryCache() override {
+    if (lookup_pool_) {
+      lookup_pool_->WaitForJobsAndJoinAllThreads();
+    }
+    write_pool_->WaitForJobsAndJoinAllThreads();
+    for (auto& segment : segments_) {
+      DeleteSegmentFile(segment.get());
+    }
+  }
+
+  Status Open();
+
+  const char* Name() const override { return "FileSecondaryCache"; }
+
+  Status Insert(const Slice& key, void* value,
+                const Cache::CacheItemHelper* helper) override;
+
+  std::unique_ptr<SecondaryCacheResultHandle> Lookup(
+      const Slice& key, const Cache::CreateCallback& create_cb,
+      bool wait) override;
+
+  void Erase(const Slice& key) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    index_.erase(key.ToString());
+  }
+
+  void WaitAll(std::vector<SecondaryCacheResultHandle*> handles) override {
+    for (SecondaryCacheResultHandle* handle : handles) {
+      handle->Wait();
+    }
+  }
+
+  std::string GetPrintableOptions() const override;
+
+ private:
+  struct Location {
+    std::shared_ptr<Segment> segment;
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  std::string SegmentFileName(uint64_t number) const {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/%06" PRIu64, number);
+    return options_.path + buf + kCacheFileSuffix;
+  }
+
+  // Reads the value of key and rebuilds it with create_cb. *value is nullptr
+  // if the key is not found or its record is corrupted.
+  void ReadValue(const std::string& key, const Cache::CreateCallback& create_cb,
+                 void** value, size_t* charge);
+
+  // Starts a new active segment and returns the full one, which must then be
+  // passed to WriteSegment(). REQUIRES: mutex_ held.
+  std::shared_ptr<Segment> SealActiveSegment();
+
+  // Writes a sealed segment to its file and reopens it for reads, or drops
+  // its values on error. Runs on write_pool_, without mutex_.
+  void WriteSegment(const std::shared_ptr<Segment>& segment);
+
+  // Drops the oldest segments until total_size_ fits the capacity. REQUIRES:
+  // mutex_ held.
+  void EvictSegments();
+
+  void DeleteSegmentFile(Segment* segment) {
+    if (segment->sealed) {
+      fs_->DeleteFile(segment->fname, IOOptions(), nullptr)
+          .PermitUncheckedError();
+    }
+  }
+
+  const FileSecondaryCacheOptions options_;
+  std::shared_ptr<FileSystem> fs_;
+  std::unique_ptr<ThreadPool> lookup_pool_;
+  std::unique_ptr<ThreadPool> write_pool_;
+
+  std::mutex mutex_;
+  uint64_t next_file_number_;
+  // Size of the sealed segments and of the active segment buffer
+  uint64_t total_size_;
+  // Oldest first, the last one is active
+  std::deque<std::shared_ptr<Segment>> segments_;
+  std::unordered_map<std::string, Location> index_;
+};
+
+Status FileSecondaryCache::Open() {
+  IOStatus s = fs_->CreateDirIfMissing(options_.path, IOOptions(), nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<std::string> children;
+  s = fs_->GetChildren(options_.path, IOOptions(), &children, nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& child : children) {
+    if (EndsWith(child, kCacheFileSuffix)) {
+      s = fs_->DeleteFile(options_.path + "/" + child, IOOptions(), nullptr);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+  segment->number = next_file_number_++;
+  segment->fname = SegmentFileName(segment->number);
+  segment->buffer.reserve(options_.file_size);
+  segments_.push_back(std::move(segment));
+  return Status::OK();
+}
+
+Status FileSecondaryCache::Insert(const Slice& key, void* value,
+                                  const Cache::CacheItemHelper* helper) {
+  {
+    // A promoted value is demoted again when the primary cache evicts it,
+    // and only needs to be saved if its segment was dropped meanwhile
+    std::lock_guard<std::mutex> l(mutex_);
+    if (index_.find(key.ToString()) != index_.end()) {
+      return Status::OK();
+    }
+  }
+  size_t size = (*helper->size_cb)(value);
+  if (kRecordHeaderSize + size > options_.file_size) {
+    return Status::InvalidArgument("Value larger than the cache file size");
+  }
+  std::string record;
+  record.resize(kRecordHeaderSize + size);
+  Status s = (*helper->saveto_cb)(value, 0, size, &record[kRecordHeaderSize]);
+  if (!s.ok()) {
+    return s;
+  }
+  EncodeFixed32(&record[0], static_cast<uint32_t>(size));
+  EncodeFixed32(&record[4],
+                crc32c::Value(record.data() + kRecordHeaderSize, size));
+
+  std::shared_ptr<Segment> full;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (segments_.back()->buffer.size() + record.size() > options_.file_size) {
+      full = SealActiveSegment();
+    }
+    const std::shared_ptr<Segment>& active = segments_.back();
+    Location& location = index_[key.ToString()];
+    location.segment = active;
+    location.offset = static_cast<uint32_t>(active->buffer.size());
+    location.size = static_cast<uint32_t>(record.size());
+    active->buffer.append(record);
+    active->keys.push_back(key.ToString());
+    total_size_ += record.size();
+    EvictSegments();
+  }
+  if (full != nullptr) {
+    // Insert() runs when the primary cache evicts, so the file I/O is left to
+    // the background thread
+    write_pool_->SubmitJob([this, full]() { WriteSegment(full); });
+  }
+  return Status::OK();
+}
+
+std::shared_ptr<Segment> FileSecondaryCache::SealActiveSegment() {
+  std::shared_ptr<Segment> full = segments_.back();
+  // The file size is the size of the buffer, which total_size_ already counts
+  full->file_size = full->buffer.size();
+
+  std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+  segment->number = next_file_number_++;
+  segment->fname = SegmentFileName(segment->number);
+  segment->buffer.reserve(options_.file_size);
+  segments_.push_back(std::move(segment));
+  return full;
+}
+
+void FileSecondaryCache::WriteSegment(const std::shared_ptr<Segment>& segment) {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (segment->evicted) {
+      return;
+    }
+  }
+  std::unique_ptr<FSWritableFile> writer;
+  IOStatus s =
+      fs_->NewWritableFile(segment->fname, FileOptions(), &writer, nullptr);
+  if (s.ok()) {
+    s = writer->Append(segment->buffer, IOOptions(), nullptr);
+  }
+  if (s.ok()) {
+    s = writer->Close(IOOptions(), nullptr);
+  }
+  std::unique_ptr<FSRandomAccessFile> file;
+  if (s.ok()) {
+    FileOptions file_opts;
+    file_opts.use_mmap_reads = options_.use_mmap_reads;
+    s = fs_->NewRandomAccessFile(segment->fname, file_opts, &file, nullptr);
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  if (s.ok() && !segment->evicted) {
+    segment->file = std::move(file);
+    segment->sealed = true;
+    std::string().swap(segment->buffer);
+    return;
+  }
+  if (!segment->evicted) {
+    // Drop the values of the segment
+    for (const auto& key : segment->keys) {
+      auto it = index_.find(key);
+      if (it != index_.end() && it->second.segment == segment) {
+        index_.erase(it);
+      }
+    }
+    total_size_ -= segment->file_size;
+    for (auto it = segments_.begin(); it != segments_.end(); ++it) {
+      if (*it == segment) {
+        segments_.erase(it);
+        break;
+      }
+    }
+  }
+  // The segment was evicted while it was written, or the write failed
+  fs_->DeleteFile(segment->fname, IOOptions(), nullptr)
+      .PermitUncheckedError();
+}
+
+void FileSecondaryCache::EvictSegments() {
+  while (total_size_ > options_.capacity && segments_.size() > 1) {
+    std::shared_ptr<Segment> oldest = segments_.front();
+    segments_.pop_front();
+    for (const auto& key : oldest->keys) {
+      auto it = index_.find(key);
+      if (it != index_.end() && it->second.segment == oldest) {
+        index_.erase(it);
+      }
+    }
+    total_size_ -= oldest->file_size;
+    // Lookups reading the segment keep it alive, and their open file can
+    // still be read after the unlink. A segment still being written is
+    // deleted by WriteSegment().
+    oldest->evicted = true;
+    DeleteSegmentFile(oldest.get());
+  }
+}
+
+void FileSecondaryCache::ReadValue(const std::string& key,
+                                   const Cache::CreateCallback& create_cb,
+                                   void** value, size_t* charge) {
+  *value = nullptr;
+  *charge = 0;
+  Location location;
+  bool sealed = false;
+  std::string record;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return;
+    }
+    location = it->second;
+    sealed = location.segment->sealed;
+    if (!sealed) {
+      record.assign(location.segment->buffer, location.offset, location.size);
+    }
+  }
+
+  Slice data;
+  std::unique_ptr<char[]> scratch;
+  if (!sealed) {
+    data = record;
+  } else {
+    // With mmap reads data points into the mapping and scratch is unused
+    scratch.reset(new char[location.size]);
+    IOStatus s = location.segment->file->Read(location.offset, location.size,
+                                              IOOptions(), &data,
+                                              scratch.get(), nullptr);
+    if (!s.ok() || data.size() != location.size) {
+      return;
+    }
+  }
+  uint32_t size = DecodeFixed32(data.data());
+  uint32_t crc = DecodeFixed32(data.data() + 4);
+  if (kRecordHeaderSize + size != location.size ||
+      crc32c::Value(data.data() + kRecordHeaderSize, size) != crc) {
+    return;
+  }
+  // create_cb doesn't modify the buffer, which may be a read-only mapping
+  Status s = create_cb(const_cast<char*>(data.data()) + kRecordHeaderSize,
+                       size, value, charge);
+  if (!s.ok()) {
+    *value = nullptr;
+    *charge = 0;
+  }
+}
+
+std::unique_ptr<SecondaryCacheResultHandle> FileSecondaryCache::Lookup(
+    const Slice& key, const Cache::CreateCallback& create_cb, bool wait) {
+  std::string key_str = key.ToString();
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (index_.find(key_str) == index_.end()) {
+      return nullptr;
+    }
+  }
+  std::unique_ptr<FileSecondaryCacheResultHandle> handle(
+      new FileSecondaryCacheResultHandle());
+  if (wait || lookup_pool_ == nullptr) {
+    void* value = nullptr;
+    size_t charge = 0;
+    ReadValue(key_str, create_cb, &value, &charge);
+    if (value == nullptr) {
+      return nullptr;
+    }
+    handle->SetResult(value, charge);
+  } else {
+    // The caller waits for the handle before destroying it
+    FileSecondaryCacheResultHandle* h = handle.get();
+    lookup_pool_->SubmitJob([this, key_str, create_cb, h]() {
+      void* value = nullptr;
+      size_t charge = 0;
+      ReadValue(key_str, create_cb, &value, &charge);
+      h->SetResult(value, charge);
+    });
+  }
+  return std::unique_ptr<SecondaryCacheResultHandle>(handle.release());
+}
+
+std::string FileSecondaryCache::GetPrintableOptions() const {
+  std::string ret;
+  ret.append("    name : FileSecondaryCache\n");
+  ret.append("    path : " + options_.path + "\n");
+  ret.append("    capacity : " + ToString(options_.capacity) + "\n");
+  ret.append("    file_size : " + ToString(options_.file_size) + "\n");
+  ret.append("    use_mmap_reads : " +
+             std::string(options_.use_mmap_reads ? "true" : "false") + "\n");
+  ret.append("    lookup_threads : " + ToString(options_.lookup_threads) +
+             "\n");
+  return ret;
+}
+
+}  // namespace
+
+Status NewFileSecondaryCache(const FileSecondaryCacheOptions& options,
+                             std::shared_ptr<SecondaryCache>* result) {
+  if (options.path.empty()) {
+    return Status::InvalidArgument("FileSecondaryCacheOptions::path is empty");
+  }
+  if (options.file_size <= kRecordHeaderSize ||
+      options.file_size > port::kMaxUint32) {
+    return Status::InvalidArgument(
+        "FileSecondaryCacheOptions::file_size is out of range");
+  }
+  std::shared_ptr<FileSystem> fs =
+      options.fs != nullptr ? options.fs : FileSystem::Default();
+  std::unique_ptr<FileSecondaryCache> cache(
+      new FileSecondaryCache(options, std::move(fs)));
+  Status s = cache->Open();
+  if (!s.ok()) {
+    return s;
+  }
+  result->reset(cache.release());
+  return Status::OK();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
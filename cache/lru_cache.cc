@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <string>
 
+#include "monitoring/statistics.h"
 #include "util/mutexlock.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -97,7 +98,8 @@ void LRUHandleTable::Resize() {
 LRUCacheShard::LRUCacheShard(size_t capacity, bool strict_capacity_limit,
                              double high_pri_pool_ratio,
                              bool use_adaptive_mutex,
-                             CacheMetadataChargePolicy metadata_charge_policy)
+                             CacheMetadataChargePolicy metadata_charge_policy,
+                             SecondaryCache* secondary_cache)
     : capacity_(0),
       high_pri_pool_usage_(0),
       strict_capacity_limit_(strict_capacity_limit),
@@ -105,7 +107,8 @@ LRUCacheShard::LRUCacheShard(size_t capacity, bool strict_capacity_limit,
       high_pri_pool_capacity_(0),
       usage_(0),
       lru_usage_(0),
-      mutex_(use_adaptive_mutex) {
+      mutex_(use_adaptive_mutex),
+      secondary_cache_(secondary_cache) {
   set_metadata_charge_policy(metadata_charge_policy);
   // Make empty circular linked list
   lru_.next = &lru_;
@@ -247,6 +250,18 @@ void LRUCacheShard::EvictFromLRU(size_t charge,
   }
 }
 
+void LRUCacheShard::FreeEvicted(const autovector<LRUHandle*>& evicted) {
+  for (auto entry : evicted) {
+    // Promoted entries are demoted too, the secondary cache may have dropped
+    // its copy since
+    if (secondary_cache_ != nullptr && entry->IsSecondaryCacheCompatible()) {
+      secondary_cache_->Insert(entry->key(), entry->value, entry->helper)
+          .PermitUncheckedError();
+    }
+    entry->Free();
+  }
+}
+
 void LRUCacheShard::SetCapacity(size_t capacity) {
   autovector<LRUHandle*> last_reference_list;
   {
@@ -257,9 +272,7 @@ void LRUCacheShard::SetCapacity(size_t capacity) {
   }
 
   // Free the entries outside of mutex for performance reasons
-  for (auto entry : last_reference_list) {
-    entry->Free();
-  }
+  FreeEvicted(last_reference_list);
 }
 
 void LRUCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
@@ -268,7 +281,7 @@ void LRUCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
 }
 
 Cache::Handle* LRUCacheShard::Lookup(const Slice& key, uint32_t hash) {
-  MutexLock l(&mutex_);
+  CountingMutexLock l(&mutex_, lock_waits_counter());
   LRUHandle* e = table_.Lookup(key, hash);
   if (e != nullptr) {
     assert(e->InCache());
@@ -282,9 +295,92 @@ Cache::Handle* LRUCacheShard::Lookup(const Slice& key, uint32_t hash) {
   return reinterpret_cast<Cache::Handle*>(e);
 }
 
+Cache::Handle* LRUCacheShard::Lookup(const Slice& key, uint32_t hash,
+                                     const Cache::CacheItemHelper* helper,
+                                     const Cache::CreateCallback& create_cb,
+                                     Cache::Priority priority, bool wait,
+                                     Statistics* stats) {
+  Cache::Handle* handle = Lookup(key, hash);
+  if (handle != nullptr || secondary_cache_ == nullptr || helper == nullptr ||
+      helper->saveto_cb == nullptr) {
+    return handle;
+  }
+  std::unique_ptr<SecondaryCacheResultHandle> sec_handle =
+      secondary_cache_->Lookup(key, create_cb, wait);
+  if (sec_handle == nullptr) {
+    return nullptr;
+  }
+  LRUHandle* e = NewHandle(key, hash, sec_handle.release(), 0, priority);
+  e->helper = helper;
+  e->SetSecondaryCacheCompatible(true);
+  e->SetInCache(false);
+  e->SetPending(true);
+  e->Ref();
+  if (!wait) {
+    return reinterpret_cast<Cache::Handle*>(e);
+  }
+  Promote(e);
+  if (e->value == nullptr) {
+    // The secondary cache failed to rebuild the value
+    Release(reinterpret_cast<Cache::Handle*>(e));
+    return nullptr;
+  }
+  RecordTick(stats, SECONDARY_CACHE_HITS);
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+bool LRUCacheShard::IsReady(Cache::Handle* handle) {
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  // Only the caller of the lookup references a pending handle, so it can't
+  // change concurrently
+  return !e->IsPending() ||
+         reinterpret_cast<SecondaryCacheResultHandle*>(e->value)->IsReady();
+}
+
+void LRUCacheShard::Wait(Cache::Handle* handle) {
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  if (e->IsPending()) {
+    Promote(e);
+  }
+}
+
+void LRUCacheShard::Promote(LRUHandle* e) {
+  assert(e->IsPending() && !e->InCache() && e->refs == 1);
+  std::unique_ptr<SecondaryCacheResultHandle> sec_handle(
+      reinterpret_cast<SecondaryCacheResultHandle*>(e->value));
+  sec_handle->Wait();
+  e->value = sec_handle->Value();
+  e->charge = sec_handle->Size();
+  e->SetPending(false);
+  e->SetPromoted(true);
+  if (e->value == nullptr) {
+    // The lookup failed, see Release()
+    e->charge = 0;
+    return;
+  }
+  size_t total_charge = e->CalcTotalCharge(metadata_charge_policy_);
+  autovector<LRUHandle*> last_reference_list;
+  {
+    CountingMutexLock l(&mutex_, lock_waits_counter());
+    EvictFromLRU(total_charge, &last_reference_list);
+    usage_ += total_charge;
+    if ((usage_ > capacity_ && strict_capacity_limit_) ||
+        table_.Lookup(e->key(), e->hash) != nullptr) {
+      // Not inserted, like an entry that was erased while referenced. The
+      // key may also have been inserted by another thread meanwhile.
+    } else {
+      LRUHandle* old = table_.Insert(e);
+      assert(old == nullptr);
+      (void)old;
+      e->SetInCache(true);
+    }
+  }
+  FreeEvicted(last_reference_list);
+}
+
 bool LRUCacheShard::Ref(Cache::Handle* h) {
   LRUHandle* e = reinterpret_cast<LRUHandle*>(h);
-  MutexLock l(&mutex_);
+  CountingMutexLock l(&mutex_, lock_waits_counter());
   // To create another reference - entry must be already externally referenced
   assert(e->HasRefs());
   e->Ref();
@@ -303,9 +399,17 @@ bool LRUCacheShard::Release(Cache::Handle* handle, bool force_erase) {
     return false;
   }
   LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  if (e->IsPending() || (e->value == nullptr && e->IsPromoted())) {
+    // A handle whose secondary cache lookup is pending or failed is neither
+    // in cache nor counted in usage, and has no other reference
+    bool last_reference = e->Unref();
+    assert(last_reference);
+    e->Free();
+    return last_reference;
+  }
   bool last_reference = false;
   {
-    MutexLock l(&mutex_);
+    CountingMutexLock l(&mutex_, lock_waits_counter());
     last_reference = e->Unref();
     if (last_reference && e->InCache()) {
       // The item is still in cache, and nobody else holds a reference to it
@@ -335,20 +439,13 @@ bool LRUCacheShard::Release(Cache::Handle* handle, bool force_erase) {
   return last_reference;
 }
 
-Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
-                             size_t charge,
-                             void (*deleter)(const Slice& key, void* value),
-                             Cache::Handle** handle, Cache::Priority priority) {
-  // Allocate the memory here outside of the mutex
-  // If the cache is full, we'll have to release it
-  // It shouldn't happen very often though.
+LRUHandle* LRUCacheShard::NewHandle(const Slice& key, uint32_t hash,
+                                    void* value, size_t charge,
+                                    Cache::Priority priority) {
   LRUHandle* e = reinterpret_cast<LRUHandle*>(
       new char[sizeof(LRUHandle) - 1 + key.size()]);
-  Status s = Status::OK();
-  autovector<LRUHandle*> last_reference_list;
-
   e->value = value;
-  e->deleter = deleter;
+  e->deleter = nullptr;
   e->charge = charge;
   e->key_length = key.size();
   e->flags = 0;
@@ -358,17 +455,69 @@ Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
   e->SetInCache(true);
   e->SetPriority(priority);
   memcpy(e->key_data, key.data(), key.size());
+  return e;
+}
+
+Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
+                             size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Cache::Handle** handle, Cache::Priority priority) {
+  // Allocate the memory here outside of the mutex
+  // If the cache is full, we'll have to release it
+  // It shouldn't happen very often though.
+  LRUHandle* e = NewHandle(key, hash, value, charge, priority);
+  e->deleter = deleter;
+  return InsertItem(e, handle);
+}
+
+Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
+                             const Cache::CacheItemHelper* helper,
+                             size_t charge, Cache::Handle** handle,
+                             Cache::Priority priority) {
+  LRUHandle* e = NewHandle(key, hash, value, charge, priority);
+  e->helper = helper;
+  e->SetSecondaryCacheCompatible(true);
+  return InsertItem(e, handle);
+}
+
+Status LRUCacheShard::InsertItem(LRUHandle* e, Cache::Handle** handle) {
+  Status s = Status::OK();
+  autovector<LRUHandle*> last_reference_list;
+  // An overwritten entry is stale, so it is freed without being demoted
+  LRUHandle* overwritten = nullptr;
+  // Neither is an entry rejected by the admission filter
+  LRUHandle* rejected = nullptr;
   size_t total_charge = e->CalcTotalCharge(metadata_charge_policy_);
 
   {
-    MutexLock l(&mutex_);
+    CountingMutexLock l(&mutex_, lock_waits_counter());
+
+    // Without room for e, the admission filter compares it with the entry it
+    // would evict first
+    bool admitted =
+        admission_filter_ == nullptr || (usage_ + total_charge) <= capacity_ ||
+        lru_.next == &lru_ || (handle != nullptr && strict_capacity_limit_) ||
+        table_.Lookup(e->key(), e->hash) != nullptr ||
+        admission_filter_->Admit(e->hash, lru_.next->hash);
 
     // Free the space following strict LRU policy until enough space
     // is freed or the lru list is empty
-    EvictFromLRU(total_charge, &last_reference_list);
+    if (admitted) {
+      EvictFromLRU(total_charge, &last_reference_list);
+    }
 
-    if ((usage_ + total_charge) > capacity_ &&
-        (strict_capacity_limit_ || handle == nullptr)) {
+    if (!admitted) {
+      e->SetInCache(false);
+      if (handle == nullptr) {
+        rejected = e;
+      } else {
+        // Like an entry erased while referenced, e is freed when released
+        usage_ += total_charge;
+        e->Ref();
+        *handle = reinterpret_cast<Cache::Handle*>(e);
+      }
+    } else if ((usage_ + total_charge) > capacity_ &&
+               (strict_capacity_limit_ || handle == nullptr)) {
       if (handle == nullptr) {
         // Don't insert the entry but still return ok, as if the entry inserted
         // into cache and get evicted immediately.
@@ -395,7 +544,7 @@ Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
               old->CalcTotalCharge(metadata_charge_policy_);
           assert(usage_ >= old_total_charge);
           usage_ -= old_total_charge;
-          last_reference_list.push_back(old);
+          overwritten = old;
         }
       }
       if (handle == nullptr) {
@@ -408,8 +557,12 @@ Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
   }
 
   // Free the entries here outside of mutex for performance reasons
-  for (auto entry : last_reference_list) {
-    entry->Free();
+  FreeEvicted(last_reference_list);
+  if (overwritten != nullptr) {
+    overwritten->Free();
+  }
+  if (rejected != nullptr) {
+    rejected->Free();
   }
 
   return s;
@@ -419,7 +572,7 @@ void LRUCacheShard::Erase(const Slice& key, uint32_t hash) {
   LRUHandle* e;
   bool last_reference = false;
   {
-    MutexLock l(&mutex_);
+    CountingMutexLock l(&mutex_, lock_waits_counter());
     e = table_.Remove(key, hash);
     if (e != nullptr) {
       assert(e->InCache());
@@ -440,6 +593,9 @@ void LRUCacheShard::Erase(const Slice& key, uint32_t hash) {
   if (last_reference) {
     e->Free();
   }
+  if (secondary_cache_ != nullptr) {
+    secondary_cache_->Erase(key);
+  }
 }
 
 size_t LRUCacheShard::GetUsage() const {
@@ -468,9 +624,11 @@ LRUCache::LRUCache(size_t capacity, int num_shard_bits,
                    bool strict_capacity_limit, double high_pri_pool_ratio,
                    std::shared_ptr<MemoryAllocator> allocator,
                    bool use_adaptive_mutex,
-                   CacheMetadataChargePolicy metadata_charge_policy)
+                   CacheMetadataChargePolicy metadata_charge_policy,
+                   const std::shared_ptr<SecondaryCache>& secondary_cache)
     : ShardedCache(capacity, num_shard_bits, strict_capacity_limit,
-                   std::move(allocator)) {
+                   std::move(allocator)),
+      secondary_cache_(secondary_cache) {
   num_shards_ = 1 << num_shard_bits;
   shards_ = reinterpret_cast<LRUCacheShard*>(
       port::cacheline_aligned_alloc(sizeof(LRUCacheShard) * num_shards_));
@@ -478,7 +636,8 @@ LRUCache::LRUCache(size_t capacity, int num_shard_bits,
   for (int i = 0; i < num_shards_; i++) {
     new (&shards_[i])
         LRUCacheShard(per_shard, strict_capacity_limit, high_pri_pool_ratio,
-                      use_adaptive_mutex, metadata_charge_policy);
+                      use_adaptive_mutex, metadata_charge_policy,
+                      secondary_cache_.get());
   }
 }
 
@@ -527,6 +686,36 @@ void LRUCache::DisownData() {
 #endif  // __clang__
 }
 
+void LRUCache::WaitAll(std::vector<Handle*>& handles) {
+  if (secondary_cache_ != nullptr) {
+    // Let the secondary cache wait for all the pending lookups at once
+    std::vector<SecondaryCacheResultHandle*> sec_handles;
+    sec_handles.reserve(handles.size());
+    for (Handle* handle : handles) {
+      LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+      if (e != nullptr && e->IsPending()) {
+        sec_handles.push_back(
+            reinterpret_cast<SecondaryCacheResultHandle*>(e->value));
+      }
+    }
+    secondary_cache_->WaitAll(sec_handles);
+  }
+  for (Handle* handle : handles) {
+    if (handle != nullptr) {
+      Wait(handle);
+    }
+  }
+}
+
+std::string LRUCache::GetPrintableOptions() const {
+  std::string ret = ShardedCache::GetPrintableOptions();
+  if (secondary_cache_ != nullptr) {
+    ret.append("  secondary_cache:\n");
+    ret.append(secondary_cache_->GetPrintableOptions());
+  }
+  return ret;
+}
+
 size_t LRUCache::TEST_GetLRUSize() {
   size_t lru_size_of_all_shards = 0;
   for (int i = 0; i < num_shards_; i++) {
@@ -544,18 +733,34 @@ double LRUCache::GetHighPriPoolRatio() {
 }
 
 std::shared_ptr<Cache> NewLRUCache(const LRUCacheOptions& cache_opts) {
-  return NewLRUCache(cache_opts.capacity, cache_opts.num_shard_bits,
-                     cache_opts.strict_capacity_limit,
-                     cache_opts.high_pri_pool_ratio,
-                     cache_opts.memory_allocator, cache_opts.use_adaptive_mutex,
-                     cache_opts.metadata_charge_policy);
+  int num_shard_bits = cache_opts.num_shard_bits;
+  if (num_shard_bits < 0 && cache_opts.shard_bits_from_cores) {
+    num_shard_bits = GetCacheShardBitsFromCores(cache_opts.capacity);
+  }
+  std::shared_ptr<Cache> cache = NewLRUCache(
+      cache_opts.capacity, num_shard_bits,
+      cache_opts.strict_capacity_limit, cache_opts.high_pri_pool_ratio,
+      cache_opts.memory_allocator, cache_opts.use_adaptive_mutex,
+      cache_opts.metadata_charge_policy, cache_opts.secondary_cache);
+  if (cache != nullptr && cache_opts.use_admission_filter) {
+    static_cast<LRUCache*>(cache.get())
+        ->EnableAdmissionFilter(cache_opts.admission_statistics);
+  }
+  if (cache != nullptr && cache_opts.adaptive_shard_capacity) {
+    static_cast<LRUCache*>(cache.get())->EnableAdaptiveShardCapacity();
+  }
+  if (cache != nullptr && cache_opts.track_shard_stats) {
+    static_cast<LRUCache*>(cache.get())->EnableShardStats();
+  }
+  return cache;
 }
 
 std::shared_ptr<Cache> NewLRUCache(
     size_t capacity, int num_shard_bits, bool strict_capacity_limit,
     double high_pri_pool_ratio,
     std::shared_ptr<MemoryAllocator> memory_allocator, bool use_adaptive_mutex,
-    CacheMetadataChargePolicy metadata_charge_policy) {
+    CacheMetadataChargePolicy metadata_charge_policy,
+    const std::shared_ptr<SecondaryCache>& secondary_cache) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
@@ -568,7 +773,8 @@ std::shared_ptr<Cache> NewLRUCache(
   }
   return std::make_shared<LRUCache>(
       capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio,
-      std::move(memory_allocator), use_adaptive_mutex, metadata_charge_policy);
+      std::move(memory_allocator), use_adaptive_mutex, metadata_charge_policy,
+      secondary_cache);
 }
 
 }  // namespace ROCKSDB_NAMESPACE
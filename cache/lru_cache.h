@@ -14,6 +14,7 @@
 
 #include "port/malloc.h"
 #include "port/port.h"
+#include "rocksdb/secondary_cache.h"
 #include "util/autovector.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -46,10 +47,19 @@ namespace ROCKSDB_NAMESPACE {
 // that any successful LRUCacheShard::Lookup/LRUCacheShard::Insert have a
 // matching LRUCache::Release (to move into state 2) or LRUCacheShard::Erase
 // (to move into state 3).
+//
+// A lookup that goes on to the secondary cache without waiting for it returns
+// a handle that is pending and referenced by the caller only, neither in the
+// hash table nor counted in usage. LRUCacheShard::Wait promotes it to state 1
+// or, if the cache is full and strict_capacity_limit is set, to state 3.
 
 struct LRUHandle {
   void* value;
-  void (*deleter)(const Slice&, void* value);
+  union {
+    void (*deleter)(const Slice&, void* value);
+    // Replaces deleter if the entry is secondary cache compatible
+    const Cache::CacheItemHelper* helper;
+  };
   LRUHandle* next_hash;
   LRUHandle* next;
   LRUHandle* prev;
@@ -69,6 +79,14 @@ struct LRUHandle {
     IN_HIGH_PRI_POOL = (1 << 2),
     // Whether this entry has had any lookups (hits).
     HAS_HIT = (1 << 3),
+    // Whether this entry was inserted with a CacheItemHelper, and can be
+    // demoted into the secondary cache.
+    IS_SECONDARY_CACHE_COMPATIBLE = (1 << 4),
+    // Whether this entry was promoted from the secondary cache.
+    IS_PROMOTED = (1 << 5),
+    // Whether the secondary cache lookup of this entry is in flight. value is
+    // then the SecondaryCacheResultHandle of the lookup.
+    IS_PENDING = (1 << 6),
   };
 
   uint8_t flags;
@@ -95,6 +113,11 @@ struct LRUHandle {
   bool IsHighPri() const { return flags & IS_HIGH_PRI; }
   bool InHighPriPool() const { return flags & IN_HIGH_PRI_POOL; }
   bool HasHit() const { return flags & HAS_HIT; }
+  bool IsSecondaryCacheCompatible() const {
+    return flags & IS_SECONDARY_CACHE_COMPATIBLE;
+  }
+  bool IsPromoted() const { return flags & IS_PROMOTED; }
+  bool IsPending() const { return flags & IS_PENDING; }
 
   void SetInCache(bool in_cache) {
     if (in_cache) {
@@ -122,9 +145,45 @@ struct LRUHandle {
 
   void SetHit() { flags |= HAS_HIT; }
 
+  void SetSecondaryCacheCompatible(bool compat) {
+    if (compat) {
+      flags |= IS_SECONDARY_CACHE_COMPATIBLE;
+    } else {
+      flags &= ~IS_SECONDARY_CACHE_COMPATIBLE;
+    }
+  }
+
+  void SetPromoted(bool promoted) {
+    if (promoted) {
+      flags |= IS_PROMOTED;
+    } else {
+      flags &= ~IS_PROMOTED;
+    }
+  }
+
+  void SetPending(bool pending) {
+    if (pending) {
+      flags |= IS_PENDING;
+    } else {
+      flags &= ~IS_PENDING;
+    }
+  }
+
   void Free() {
     assert(refs == 0);
-    if (deleter) {
+    if (IsPending()) {
+      // The lookup may still deliver a value, which is ours to delete
+      auto sec_handle = reinterpret_cast<SecondaryCacheResultHandle*>(value);
+      sec_handle->Wait();
+      value = sec_handle->Value();
+      delete sec_handle;
+      SetPending(false);
+    }
+    if (IsSecondaryCacheCompatible()) {
+      if (value != nullptr && helper->del_cb) {
+        (*helper->del_cb)(key(), value);
+      }
+    } else if (deleter) {
       (*deleter)(key(), value);
     }
     delete[] reinterpret_cast<char*>(this);
@@ -193,7 +252,8 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
  public:
   LRUCacheShard(size_t capacity, bool strict_capacity_limit,
                 double high_pri_pool_ratio, bool use_adaptive_mutex,
-                CacheMetadataChargePolicy metadata_charge_policy);
+                CacheMetadataChargePolicy metadata_charge_policy,
+                SecondaryCache* secondary_cache);
   virtual ~LRUCacheShard() override = default;
 
   // Separate from constructor so caller can easily make an array of LRUCache
@@ -213,7 +273,18 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
                         void (*deleter)(const Slice& key, void* value),
                         Cache::Handle** handle,
                         Cache::Priority priority) override;
+  virtual Status Insert(const Slice& key, uint32_t hash, void* value,
+                        const Cache::CacheItemHelper* helper, size_t charge,
+                        Cache::Handle** handle,
+                        Cache::Priority priority) override;
   virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash) override;
+  virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                                const Cache::CacheItemHelper* helper,
+                                const Cache::CreateCallback& create_cb,
+                                Cache::Priority priority, bool wait,
+                                Statistics* stats) override;
+  virtual bool IsReady(Cache::Handle* handle) override;
+  virtual void Wait(Cache::Handle* handle) override;
   virtual bool Ref(Cache::Handle* handle) override;
   virtual bool Release(Cache::Handle* handle,
                        bool force_erase = false) override;
@@ -243,6 +314,23 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
   double GetHighPriPoolRatio();
 
  private:
+  // Allocates a handle of key, in cache but without references.
+  static LRUHandle* NewHandle(const Slice& key, uint32_t hash, void* value,
+                              size_t charge, Cache::Priority priority);
+
+  // Inserts a new handle e built by NewHandle(), see Insert().
+  Status InsertItem(LRUHandle* e, Cache::Handle** handle);
+
+  // Inserts the value looked up by the secondary cache lookup of the pending
+  // handle e, which holds the only reference to it. If strict_capacity_limit
+  // is set and the cache is full, e is only accounted for in usage, like an
+  // erased entry that is still referenced.
+  void Promote(LRUHandle* e);
+
+  // Demotes the entries evicted from the cache into the secondary cache,
+  // if any, and frees them. Must be called without holding mutex_.
+  void FreeEvicted(const autovector<LRUHandle*>& evicted);
+
   void LRU_Remove(LRUHandle* e);
   void LRU_Insert(LRUHandle* e);
 
@@ -303,6 +391,9 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
   // We don't count mutex_ as the cache's internal state so semantically we
   // don't mind mutex_ invoking the non-const actions.
   mutable port::Mutex mutex_;
+
+  // Owned by the LRUCache, may be nullptr
+  SecondaryCache* secondary_cache_;
 };
 
 class LRUCache
@@ -316,7 +407,8 @@ class LRUCache
            std::shared_ptr<MemoryAllocator> memory_allocator = nullptr,
            bool use_adaptive_mutex = kDefaultToAdaptiveMutex,
            CacheMetadataChargePolicy metadata_charge_policy =
-               kDontChargeCacheMetadata);
+               kDontChargeCacheMetadata,
+           const std::shared_ptr<SecondaryCache>& secondary_cache = nullptr);
   virtual ~LRUCache();
   virtual const char* Name() const override { return "LRUCache"; }
   virtual CacheShard* GetShard(int shard) override;
@@ -325,6 +417,8 @@ class LRUCache
   virtual size_t GetCharge(Handle* handle) const override;
   virtual uint32_t GetHash(Handle* handle) const override;
   virtual void DisownData() override;
+  virtual void WaitAll(std::vector<Handle*>& handles) override;
+  virtual std::string GetPrintableOptions() const override;
 
   //  Retrieves number of elements in LRU, for unit test purpose only
   size_t TEST_GetLRUSize();
@@ -334,6 +428,7 @@ class LRUCache
  private:
   LRUCacheShard* shards_ = nullptr;
   int num_shards_ = 0;
+  std::shared_ptr<SecondaryCache> secondary_cache_;
 };
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -8,7 +8,9 @@
 #include <string>
 #include <vector>
 #include "port/port.h"
+#include "rocksdb/secondary_cache.h"
 #include "test_util/testharness.h"
+#include "util/string_util.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -32,7 +34,8 @@ class LRUCacheTest : public testing::Test {
         port::cacheline_aligned_alloc(sizeof(LRUCacheShard)));
     new (cache_) LRUCacheShard(capacity, false /*strict_capcity_limit*/,
                                high_pri_pool_ratio, use_adaptive_mutex,
-                               kDontChargeCacheMetadata);
+                               kDontChargeCacheMetadata,
+                               nullptr /*secondary_cache*/);
   }
 
   void Insert(const std::string& key,
@@ -191,6 +194,363 @@ TEST_F(LRUCacheTest, EntriesWithPriority) {
   ValidateLRUList({"e", "f", "g", "Z", "d"}, 2);
 }
 
+TEST(LRUCacheAdmissionFilterTest, ScanDoesNotEvictFrequentEntries) {
+  LRUCacheOptions opts(10 /* capacity */, 0 /* num_shard_bits */,
+                       false /* strict_capacity_limit */,
+                       0.0 /* high_pri_pool_ratio */,
+                       nullptr /* memory_allocator */, kDefaultToAdaptiveMutex,
+                       kDontChargeCacheMetadata);
+  opts.use_admission_filter = true;
+  opts.admission_statistics = CreateDBStatistics();
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  auto lookup = [&](const std::string& key) {
+    Cache::Handle* handle = cache->Lookup(key);
+    if (handle != nullptr) {
+      cache->Release(handle);
+    }
+    return handle != nullptr;
+  };
+
+  // Entries are admitted freely while the cache has room
+  for (int i = 0; i < 10; i++) {
+    std::string key = "hot" + ToString(i);
+    ASSERT_FALSE(lookup(key));
+    ASSERT_OK(cache->Insert(key, nullptr, 1, nullptr));
+  }
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(lookup("hot" + ToString(i)));
+    }
+  }
+
+  // Keys read once don't replace the frequently read ones
+  for (int i = 0; i < 100; i++) {
+    std::string key = "scan" + ToString(i);
+    ASSERT_FALSE(lookup(key));
+    ASSERT_OK(cache->Insert(key, nullptr, 1, nullptr));
+  }
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(lookup("hot" + ToString(i)));
+  }
+  ASSERT_EQ(100, opts.admission_statistics->getTickerCount(
+                     CACHE_ADMISSION_REJECTED));
+  ASSERT_EQ(0, opts.admission_statistics->getTickerCount(
+                   CACHE_ADMISSION_ADMITTED));
+
+  // A rejected entry inserted with a handle lives until released
+  Cache::Handle* handle = nullptr;
+  ASSERT_FALSE(lookup("pinned"));
+  ASSERT_OK(cache->Insert("pinned", nullptr, 1, nullptr, &handle));
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(11, cache->GetUsage());
+  cache->Release(handle);
+  ASSERT_EQ(10, cache->GetUsage());
+  ASSERT_FALSE(lookup("pinned"));
+
+  // A key read more often than the least recently used entry is admitted
+  for (int i = 0; i < 10; i++) {
+    ASSERT_FALSE(lookup("new"));
+  }
+  ASSERT_OK(cache->Insert("new", nullptr, 1, nullptr));
+  ASSERT_TRUE(lookup("new"));
+  ASSERT_EQ(1, opts.admission_statistics->getTickerCount(
+                   CACHE_ADMISSION_ADMITTED));
+}
+
+TEST(LRUCacheShardStatsTest, AdaptiveShardCapacity) {
+  const size_t kEvenShare = 1 << 20;
+  LRUCacheOptions opts(4 * kEvenShare, 2 /* num_shard_bits */,
+                       false /* strict_capacity_limit */,
+                       0.0 /* high_pri_pool_ratio */);
+  opts.adaptive_shard_capacity = true;
+  opts.track_shard_stats = true;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  std::vector<CacheShardStats> stats;
+  cache->GetShardStats(&stats);
+  ASSERT_EQ(4, stats.size());
+  for (const CacheShardStats& s : stats) {
+    ASSERT_EQ(kEvenShare, s.capacity);
+    ASSERT_EQ(0, s.hits + s.misses);
+  }
+
+  // Hits and misses are counted in the shard of the key
+  ASSERT_OK(cache->Insert("key", nullptr, 1, nullptr));
+  Cache::Handle* handle = cache->Lookup("key");
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  ASSERT_EQ(nullptr, cache->Lookup("missing"));
+  cache->GetShardStats(&stats);
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  size_t usage = 0;
+  for (const CacheShardStats& s : stats) {
+    hits += s.hits;
+    misses += s.misses;
+    usage += s.usage;
+  }
+  ASSERT_EQ(1, hits);
+  ASSERT_EQ(1, misses);
+  ASSERT_EQ(cache->GetUsage(), usage);
+
+  // Find keys of one shard
+  std::vector<std::string> hot_keys;
+  int hot_shard = -1;
+  for (int i = 0; i < 1000; i++) {
+    std::vector<CacheShardStats> before;
+    cache->GetShardStats(&before);
+    std::string key = "k" + ToString(i);
+    ASSERT_EQ(nullptr, cache->Lookup(key));
+    cache->GetShardStats(&stats);
+    for (int s = 0; s < 4; s++) {
+      if (stats[s].misses != before[s].misses &&
+          (hot_shard < 0 || hot_shard == s)) {
+        hot_shard = s;
+        hot_keys.push_back(key);
+      }
+    }
+  }
+  ASSERT_GE(hot_keys.size(), 100);
+
+  // Missing only in that shard moves capacity to it, within the bounds
+  for (uint64_t i = 0; i < 8 * ShardedCache::kRebalanceMisses; i++) {
+    ASSERT_EQ(nullptr, cache->Lookup(hot_keys[i % hot_keys.size()]));
+  }
+  cache->GetShardStats(&stats);
+  size_t total_capacity = 0;
+  for (int s = 0; s < 4; s++) {
+    total_capacity += stats[s].capacity;
+    if (s == hot_shard) {
+      ASSERT_GT(stats[s].capacity, kEvenShare);
+      ASSERT_LE(stats[s].capacity, 4 * kEvenShare);
+    } else {
+      ASSERT_LE(stats[s].capacity, kEvenShare);
+      ASSERT_GE(stats[s].capacity, kEvenShare / 4);
+    }
+  }
+  ASSERT_EQ(4 * kEvenShare, total_capacity);
+
+  // SetCapacity() restores the even split
+  cache->SetCapacity(4 * kEvenShare);
+  cache->GetShardStats(&stats);
+  for (const CacheShardStats& s : stats) {
+    ASSERT_EQ(kEvenShare, s.capacity);
+  }
+}
+
+TEST(LRUCacheShardStatsTest, CountersAreOptIn) {
+  LRUCacheOptions opts(1 << 20, 2 /* num_shard_bits */,
+                       false /* strict_capacity_limit */,
+                       0.0 /* high_pri_pool_ratio */, nullptr,
+                       kDefaultToAdaptiveMutex, kDontChargeCacheMetadata);
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  ASSERT_OK(cache->Insert("key", nullptr, 1, nullptr));
+  Cache::Handle* handle = cache->Lookup("key");
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  ASSERT_EQ(nullptr, cache->Lookup("missing"));
+
+  std::vector<CacheShardStats> stats;
+  cache->GetShardStats(&stats);
+  ASSERT_EQ(4, stats.size());
+  size_t usage = 0;
+  for (const CacheShardStats& s : stats) {
+    ASSERT_EQ(0, s.hits + s.misses + s.lock_waits);
+    usage += s.usage;
+  }
+  ASSERT_EQ(1, usage);
+}
+
+class LRUSecondaryCacheTest : public testing::Test {
+ public:
+  class TestItem {
+   public:
+    TestItem(const char* buf, size_t size) : buf_(buf, size) {}
+    const std::string& buf() const { return buf_; }
+
+   private:
+    std::string buf_;
+  };
+
+  static size_t SizeCallback(void* obj) {
+    return reinterpret_cast<TestItem*>(obj)->buf().size();
+  }
+
+  static Status SaveToCallback(void* from_obj, size_t from_offset,
+                               size_t length, void* out) {
+    TestItem* item = reinterpret_cast<TestItem*>(from_obj);
+    memcpy(out, item->buf().data() + from_offset, length);
+    return Status::OK();
+  }
+
+  static void DeletionCallback(const Slice& /*key*/, void* obj) {
+    delete reinterpret_cast<TestItem*>(obj);
+  }
+
+  static Cache::CacheItemHelper helper_;
+
+  Cache::CreateCallback test_item_creator = [](void* buf, size_t size,
+                                               void** out_obj,
+                                               size_t* charge) -> Status {
+    *out_obj = new TestItem(reinterpret_cast<char*>(buf), size);
+    *charge = size;
+    return Status::OK();
+  };
+
+  // Inserts two items of 1000 bytes in a cache of 1024 bytes, so the first
+  // one is demoted into the secondary cache, and checks it is promoted back
+  // by a lookup.
+  void DemoteAndPromote(const std::shared_ptr<SecondaryCache>& secondary_cache,
+                        bool wait) {
+    LRUCacheOptions opts(1024, 0, false, 0.5, nullptr, kDefaultToAdaptiveMutex,
+                         kDontChargeCacheMetadata);
+    opts.secondary_cache = secondary_cache;
+    std::shared_ptr<Cache> cache = NewLRUCache(opts);
+    std::shared_ptr<Statistics> stats = CreateDBStatistics();
+
+    std::string str1(1000, 'a');
+    std::string str2(1000, 'b');
+    ASSERT_OK(cache->Insert("k1", new TestItem(str1.data(), str1.size()),
+                            &helper_, str1.size()));
+    ASSERT_OK(cache->Insert("k2", new TestItem(str2.data(), str2.size()),
+                            &helper_, str2.size()));
+
+    Cache::Handle* handle =
+        cache->Lookup("k2", &helper_, test_item_creator, Cache::Priority::LOW,
+                      true, stats.get());
+    ASSERT_NE(handle, nullptr);
+    cache->Release(handle);
+
+    // k1 was demoted when k2 was inserted
+    handle = cache->Lookup("k1", &helper_, test_item_creator,
+                           Cache::Priority::LOW, wait, stats.get());
+    ASSERT_NE(handle, nullptr);
+    if (!wait) {
+      std::vector<Cache::Handle*> handles = {handle};
+      cache->WaitAll(handles);
+      ASSERT_TRUE(cache->IsReady(handle));
+    } else {
+      ASSERT_EQ(1u, stats->getTickerCount(SECONDARY_CACHE_HITS));
+    }
+    TestItem* item = reinterpret_cast<TestItem*>(cache->Value(handle));
+    ASSERT_NE(item, nullptr);
+    ASSERT_EQ(str1, item->buf());
+    cache->Release(handle);
+
+    // The promoted k1 evicted k2, which a plain lookup doesn't bring back
+    ASSERT_EQ(nullptr, cache->Lookup("k2"));
+    handle = cache->Lookup("k1");
+    ASSERT_NE(handle, nullptr);
+    cache->Release(handle);
+
+    ASSERT_EQ(nullptr, cache->Lookup("k3", &helper_, test_item_creator,
+                                     Cache::Priority::LOW, true, stats.get()));
+    cache.reset();
+  }
+};
+
+Cache::CacheItemHelper LRUSecondaryCacheTest::helper_(
+    LRUSecondaryCacheTest::SizeCallback, LRUSecondaryCacheTest::SaveToCallback,
+    LRUSecondaryCacheTest::DeletionCallback);
+
+TEST_F(LRUSecondaryCacheTest, CompressedSecondaryCache) {
+  CompressedSecondaryCacheOptions opts;
+  opts.capacity = 4096;
+  opts.num_shard_bits = 0;
+  std::shared_ptr<SecondaryCache> secondary_cache =
+      NewCompressedSecondaryCache(opts);
+  ASSERT_NE(secondary_cache, nullptr);
+  DemoteAndPromote(secondary_cache, true /* wait */);
+  DemoteAndPromote(secondary_cache, false /* wait */);
+}
+
+TEST_F(LRUSecondaryCacheTest, FileSecondaryCache) {
+  FileSecondaryCacheOptions opts;
+  opts.path = test::PerThreadDBPath("file_secondary_cache");
+  opts.capacity = 4 * 4096;
+  opts.file_size = 4096;
+  for (int lookup_threads : {0, 2}) {
+    opts.lookup_threads = lookup_threads;
+    std::shared_ptr<SecondaryCache> secondary_cache;
+    ASSERT_OK(NewFileSecondaryCache(opts, &secondary_cache));
+    DemoteAndPromote(secondary_cache, true /* wait */);
+    DemoteAndPromote(secondary_cache, false /* wait */);
+
+    // The oldest cache files are dropped once the capacity is exceeded
+    for (int i = 0; i < 40; i++) {
+      std::string str(1000, static_cast<char>('a' + i % 26));
+      TestItem item(str.data(), str.size());
+      ASSERT_OK(secondary_cache->Insert("key" + ToString(i), &item, &helper_));
+    }
+    ASSERT_EQ(nullptr,
+              secondary_cache->Lookup("key0", test_item_creator, true));
+    std::unique_ptr<SecondaryCacheResultHandle> sealed_handle =
+        secondary_cache->Lookup("key33", test_item_creator, true);
+    ASSERT_NE(sealed_handle, nullptr);
+    delete reinterpret_cast<TestItem*>(sealed_handle->Value());
+    std::unique_ptr<SecondaryCacheResultHandle> handle =
+        secondary_cache->Lookup("key39", test_item_creator, false);
+    ASSERT_NE(handle, nullptr);
+    handle->Wait();
+    TestItem* item = reinterpret_cast<TestItem*>(handle->Value());
+    ASSERT_NE(item, nullptr);
+    ASSERT_EQ(std::string(1000, 'a' + 39 % 26), item->buf());
+    delete item;
+
+    // Values larger than a cache file are rejected
+    std::string str(4096, 'x');
+    TestItem large(str.data(), str.size());
+    ASSERT_NOK(secondary_cache->Insert("large", &large, &helper_));
+  }
+}
+
+TEST_F(LRUSecondaryCacheTest, FileSecondaryCacheRedemoteAndErase) {
+  FileSecondaryCacheOptions sec_opts;
+  sec_opts.path = test::PerThreadDBPath("file_secondary_cache_redemote");
+  sec_opts.capacity = 4 * 4096;
+  sec_opts.file_size = 4096;
+  std::shared_ptr<SecondaryCache> secondary_cache;
+  ASSERT_OK(NewFileSecondaryCache(sec_opts, &secondary_cache));
+  LRUCacheOptions opts(1024, 0, false, 0.5, nullptr, kDefaultToAdaptiveMutex,
+                       kDontChargeCacheMetadata);
+  opts.secondary_cache = secondary_cache;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+
+  std::string str1(1000, 'a');
+  std::string str2(1000, 'b');
+  ASSERT_OK(cache->Insert("k1", new TestItem(str1.data(), str1.size()),
+                          &helper_, str1.size()));
+  ASSERT_OK(cache->Insert("k2", new TestItem(str2.data(), str2.size()),
+                          &helper_, str2.size()));
+  // Promotes k1, which demotes k2
+  Cache::Handle* handle = cache->Lookup("k1", &helper_, test_item_creator,
+                                        Cache::Priority::LOW, true);
+  ASSERT_NE(handle, nullptr);
+  cache->Release(handle);
+
+  // The cache file of k1 and k2 is dropped
+  for (int i = 0; i < 40; i++) {
+    std::string str(1000, static_cast<char>('a' + i % 26));
+    TestItem item(str.data(), str.size());
+    ASSERT_OK(secondary_cache->Insert("key" + ToString(i), &item, &helper_));
+  }
+  ASSERT_EQ(nullptr, secondary_cache->Lookup("k1", test_item_creator, true));
+
+  // Evicting the promoted k1 demotes it again
+  ASSERT_OK(cache->Insert("k2", new TestItem(str2.data(), str2.size()),
+                          &helper_, str2.size()));
+  handle = cache->Lookup("k1", &helper_, test_item_creator,
+                         Cache::Priority::LOW, true);
+  ASSERT_NE(handle, nullptr);
+  ASSERT_EQ(str1, reinterpret_cast<TestItem*>(cache->Value(handle))->buf());
+  cache->Release(handle);
+
+  // Erase drops the secondary cache copy too
+  cache->Erase("k2");
+  ASSERT_EQ(nullptr, cache->Lookup("k2", &helper_, test_item_creator,
+                                   Cache::Priority::LOW, true));
+  ASSERT_EQ(nullptr, secondary_cache->Lookup("k2", test_item_creator, true));
+}
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -9,7 +9,9 @@
 
 #include "cache/sharded_cache.h"
 
+#include <algorithm>
 #include <string>
+#include <thread>
 
 #include "util/mutexlock.h"
 
@@ -21,8 +23,16 @@ ShardedCache::ShardedCache(size_t capacity, int num_shard_bits,
     : Cache(std::move(allocator)),
       num_shard_bits_(num_shard_bits),
       capacity_(capacity),
+      adaptive_capacity_(false),
+      track_shard_stats_(false),
+      misses_(0),
       strict_capacity_limit_(strict_capacity_limit),
-      last_id_(1) {}
+      last_id_(1) {
+  int num_shards = 1 << num_shard_bits_;
+  shard_capacities_.assign(num_shards,
+                           (capacity + (num_shards - 1)) / num_shards);
+  last_misses_.assign(num_shards, 0);
+}
 
 void ShardedCache::SetCapacity(size_t capacity) {
   int num_shards = 1 << num_shard_bits_;
@@ -30,6 +40,7 @@ void ShardedCache::SetCapacity(size_t capacity) {
   MutexLock l(&capacity_mutex_);
   for (int s = 0; s < num_shards; s++) {
     GetShard(s)->SetCapacity(per_shard);
+    shard_capacities_[s] = per_shard;
   }
   capacity_ = capacity;
 }
@@ -51,9 +62,113 @@ Status ShardedCache::Insert(const Slice& key, void* value, size_t charge,
       ->Insert(key, hash, value, charge, deleter, handle, priority);
 }
 
+Status ShardedCache::Insert(const Slice& key, void* value,
+                            const CacheItemHelper* helper, size_t charge,
+                            Handle** handle, Priority priority) {
+  if (!helper) {
+    return Status::InvalidArgument();
+  }
+  uint32_t hash = HashSlice(key);
+  return GetShard(Shard(hash))
+      ->Insert(key, hash, value, helper, charge, handle, priority);
+}
+
 Cache::Handle* ShardedCache::Lookup(const Slice& key, Statistics* /*stats*/) {
   uint32_t hash = HashSlice(key);
-  return GetShard(Shard(hash))->Lookup(key, hash);
+  uint32_t shard = Shard(hash);
+  if (!admission_filters_.empty()) {
+    admission_filters_[shard]->RecordAccess(hash);
+  }
+  Handle* handle = GetShard(shard)->Lookup(key, hash);
+  RecordLookup(shard, handle != nullptr);
+  return handle;
+}
+
+Cache::Handle* ShardedCache::Lookup(const Slice& key,
+                                    const CacheItemHelper* helper,
+                                    const CreateCallback& create_cb,
+                                    Priority priority, bool wait,
+                                    Statistics* stats) {
+  uint32_t hash = HashSlice(key);
+  uint32_t shard = Shard(hash);
+  if (!admission_filters_.empty()) {
+    admission_filters_[shard]->RecordAccess(hash);
+  }
+  Handle* handle = GetShard(shard)->Lookup(key, hash, helper, create_cb,
+                                           priority, wait, stats);
+  RecordLookup(shard, handle != nullptr);
+  return handle;
+}
+
+void ShardedCache::RecordLookup(uint32_t shard, bool hit) {
+  // Hits would otherwise write a shared counter on every lookup, which the
+  // lookups of a lock-free shard avoid. Misses go to the next tier anyway.
+  if (track_shard_stats_ || (!hit && adaptive_capacity_)) {
+    GetShard(shard)->RecordLookup(hit);
+  }
+  if (!hit && adaptive_capacity_ &&
+      (misses_.fetch_add(1, std::memory_order_relaxed) + 1) %
+              kRebalanceMisses ==
+          0) {
+    RebalanceShardCapacity();
+  }
+}
+
+void ShardedCache::RebalanceShardCapacity() {
+  int num_shards = 1 << num_shard_bits_;
+  if (num_shards < 2 || !capacity_mutex_.TryLock()) {
+    return;
+  }
+  // The misses of every shard since the last rebalancing approximate how
+  // much a shard would gain from more capacity
+  std::vector<uint64_t> misses(num_shards);
+  for (int s = 0; s < num_shards; s++) {
+    uint64_t total = GetShard(s)->misses();
+    misses[s] = total - last_misses_[s];
+    last_misses_[s] = total;
+  }
+  const size_t even_share = (capacity_ + (num_shards - 1)) / num_shards;
+  const size_t step = std::max(even_share / 32, size_t{1});
+  int hot = -1;
+  int cold = -1;
+  for (int s = 0; s < num_shards; s++) {
+    if (shard_capacities_[s] + step <= even_share * 4 &&
+        (hot < 0 || misses[s] > misses[hot])) {
+      hot = s;
+    }
+    if (shard_capacities_[s] >= even_share / 4 + step &&
+        (cold < 0 || misses[s] < misses[cold])) {
+      cold = s;
+    }
+  }
+  // Only move capacity when the miss counts clearly differ, not to follow
+  // noise in a uniform workload
+  const uint64_t kMinMissDifference = 64;
+  if (hot >= 0 && cold >= 0 && hot != cold &&
+      misses[hot] > 2 * misses[cold] + kMinMissDifference) {
+    // Shrink first, so the total capacity is never exceeded
+    shard_capacities_[cold] -= step;
+    GetShard(cold)->SetCapacity(shard_capacities_[cold]);
+    shard_capacities_[hot] += step;
+    GetShard(hot)->SetCapacity(shard_capacities_[hot]);
+  }
+  capacity_mutex_.Unlock();
+}
+
+bool ShardedCache::IsReady(Handle* handle) {
+  uint32_t hash = GetHash(handle);
+  return GetShard(Shard(hash))->IsReady(handle);
+}
+
+void ShardedCache::Wait(Handle* handle) {
+  uint32_t hash = GetHash(handle);
+  GetShard(Shard(hash))->Wait(handle);
+}
+
+void ShardedCache::WaitAll(std::vector<Handle*>& handles) {
+  for (Handle* handle : handles) {
+    Wait(handle);
+  }
 }
 
 bool ShardedCache::Ref(Handle* handle) {
@@ -143,9 +258,60 @@ std::string ShardedCache::GetPrintableOptions() const {
   snprintf(buffer, kBufferSize, "    memory_allocator : %s\n",
            memory_allocator() ? memory_allocator()->Name() : "None");
   ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    admission_filter : %d\n",
+           !admission_filters_.empty());
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    adaptive_shard_capacity : %d\n",
+           adaptive_capacity_);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    track_shard_stats : %d\n",
+           track_shard_stats_);
+  ret.append(buffer);
   ret.append(GetShard(0)->GetPrintableOptions());
   return ret;
 }
+
+void ShardedCache::EnableShardStats() {
+  track_shard_stats_ = true;
+  int num_shards = 1 << num_shard_bits_;
+  for (int s = 0; s < num_shards; s++) {
+    GetShard(s)->set_track_lock_waits(true);
+  }
+}
+
+void ShardedCache::GetShardStats(std::vector<CacheShardStats>* stats) const {
+  int num_shards = 1 << num_shard_bits_;
+  stats->assign(num_shards, CacheShardStats());
+  {
+    MutexLock l(&capacity_mutex_);
+    for (int s = 0; s < num_shards; s++) {
+      (*stats)[s].capacity = shard_capacities_[s];
+    }
+  }
+  for (int s = 0; s < num_shards; s++) {
+    const CacheShard* shard = GetShard(s);
+    (*stats)[s].usage = shard->GetUsage();
+    (*stats)[s].hits = shard->hits();
+    (*stats)[s].misses = shard->misses();
+    (*stats)[s].lock_waits = shard->lock_waits();
+  }
+}
+
+void ShardedCache::EnableAdmissionFilter(
+    const std::shared_ptr<Statistics>& statistics) {
+  // Sized for blocks of about 4KB
+  const size_t kExpectedEntryCharge = 4096;
+  int num_shards = 1 << num_shard_bits_;
+  size_t per_shard = (GetCapacity() + (num_shards - 1)) / num_shards;
+  admission_statistics_ = statistics;
+  admission_filters_.clear();
+  for (int s = 0; s < num_shards; s++) {
+    admission_filters_.emplace_back(new CacheAdmissionFilter(
+        per_shard / kExpectedEntryCharge, admission_statistics_.get()));
+    GetShard(s)->set_admission_filter(admission_filters_.back().get());
+  }
+}
+
 int GetDefaultCacheShardBits(size_t capacity) {
   int num_shard_bits = 0;
   size_t min_shard_size = 512L * 1024L;  // Every shard is at least 512KB.
@@ -159,4 +325,18 @@ int GetDefaultCacheShardBits(size_t capacity) {
   return num_shard_bits;
 }
 
+int GetCacheShardBitsFromCores(size_t capacity) {
+  const int kMaxShardBits = 10;
+  size_t min_shard_size = 512L * 1024L;  // Every shard is at least 512KB.
+  size_t max_shards = capacity / min_shard_size;
+  size_t target_shards = 2 * std::max(std::thread::hardware_concurrency(), 1u);
+  int num_shard_bits = 0;
+  while (num_shard_bits < kMaxShardBits &&
+         (size_t{1} << num_shard_bits) < target_shards &&
+         (size_t{2} << num_shard_bits) <= max_shards) {
+    num_shard_bits++;
+  }
+  return num_shard_bits;
+}
+
 }  // namespace ROCKSDB_NAMESPACE
@@ -10,14 +10,39 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "cache/admission_filter.h"
 #include "port/port.h"
 #include "rocksdb/cache.h"
 #include "util/hash.h"
 
 namespace ROCKSDB_NAMESPACE {
 
+// Like MutexLock, but counts into *waits the acquisitions that found the
+// mutex held by another thread. A plain MutexLock if waits is nullptr.
+class CountingMutexLock {
+ public:
+  CountingMutexLock(port::Mutex* mu, std::atomic<uint64_t>* waits) : mu_(mu) {
+    if (waits == nullptr) {
+      mu_->Lock();
+    } else if (!mu_->TryLock()) {
+      waits->fetch_add(1, std::memory_order_relaxed);
+      mu_->Lock();
+    }
+  }
+  // No copying allowed
+  CountingMutexLock(const CountingMutexLock&) = delete;
+  void operator=(const CountingMutexLock&) = delete;
+
+  ~CountingMutexLock() { mu_->Unlock(); }
+
+ private:
+  port::Mutex* const mu_;
+};
+
 // Single cache shard interface.
 class CacheShard {
  public:
@@ -28,7 +53,17 @@ class CacheShard {
                         size_t charge,
                         void (*deleter)(const Slice& key, void* value),
                         Cache::Handle** handle, Cache::Priority priority) = 0;
+  virtual Status Insert(const Slice& key, uint32_t hash, void* value,
+                        const Cache::CacheItemHelper* helper, size_t charge,
+                        Cache::Handle** handle, Cache::Priority priority) = 0;
   virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash) = 0;
+  virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                                const Cache::CacheItemHelper* helper,
+                                const Cache::CreateCallback& create_cb,
+                                Cache::Priority priority, bool wait,
+                                Statistics* stats) = 0;
+  virtual bool IsReady(Cache::Handle* handle) = 0;
+  virtual void Wait(Cache::Handle* handle) = 0;
   virtual bool Ref(Cache::Handle* handle) = 0;
   virtual bool Release(Cache::Handle* handle, bool force_erase = false) = 0;
   virtual void Erase(const Slice& key, uint32_t hash) = 0;
@@ -44,9 +79,43 @@ class CacheShard {
       CacheMetadataChargePolicy metadata_charge_policy) {
     metadata_charge_policy_ = metadata_charge_policy;
   }
+  // Insertions that have to evict entries ask the filter whether to admit
+  // the new entry, in shards that support it.
+  void set_admission_filter(CacheAdmissionFilter* admission_filter) {
+    admission_filter_ = admission_filter;
+  }
+
+  // Makes the shard count the acquisitions of its mutex that had to wait, in
+  // shards that support it. Must be called before the shard is used.
+  void set_track_lock_waits(bool track_lock_waits) {
+    track_lock_waits_ = track_lock_waits;
+  }
+
+  // Lookups of the shard that found, or didn't find, their key. Counted by
+  // ShardedCache if it tracks them.
+  void RecordLookup(bool hit) {
+    (hit ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+  }
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+  // Acquisitions of the shard mutex that had to wait for another thread, in
+  // shards that count them
+  uint64_t lock_waits() const {
+    return lock_waits_.load(std::memory_order_relaxed);
+  }
 
  protected:
+  // The counter to pass to CountingMutexLock
+  std::atomic<uint64_t>* lock_waits_counter() {
+    return track_lock_waits_ ? &lock_waits_ : nullptr;
+  }
+
   CacheMetadataChargePolicy metadata_charge_policy_ = kDontChargeCacheMetadata;
+  CacheAdmissionFilter* admission_filter_ = nullptr;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> lock_waits_{0};
+  bool track_lock_waits_ = false;
 };
 
 // Generic cache interface which shards cache by hash of keys. 2^num_shard_bits
@@ -72,7 +141,17 @@ class ShardedCache : public Cache {
   virtual Status Insert(const Slice& key, void* value, size_t charge,
                         void (*deleter)(const Slice& key, void* value),
                         Handle** handle, Priority priority) override;
+  virtual Status Insert(const Slice& key, void* value,
+                        const CacheItemHelper* helper, size_t charge,
+                        Handle** handle = nullptr,
+                        Priority priority = Priority::LOW) override;
   virtual Handle* Lookup(const Slice& key, Statistics* stats) override;
+  virtual Handle* Lookup(const Slice& key, const CacheItemHelper* helper,
+                         const CreateCallback& create_cb, Priority priority,
+                         bool wait, Statistics* stats = nullptr) override;
+  virtual bool IsReady(Handle* handle) override;
+  virtual void Wait(Handle* handle) override;
+  virtual void WaitAll(std::vector<Handle*>& handles) override;
   virtual bool Ref(Handle* handle) override;
   virtual bool Release(Handle* handle, bool force_erase = false) override;
   virtual void Erase(const Slice& key) override;
@@ -86,10 +165,39 @@ class ShardedCache : public Cache {
                                       bool thread_safe) override;
   virtual void EraseUnRefEntries() override;
   virtual std::string GetPrintableOptions() const override;
+  virtual void GetShardStats(
+      std::vector<CacheShardStats>* stats) const override;
 
   int GetNumShardBits() const { return num_shard_bits_; }
 
+  // Gives every shard a TinyLFU admission filter, which records the lookups
+  // of the shard and the admission tickers into statistics. Must be called
+  // before the cache is used.
+  void EnableAdmissionFilter(const std::shared_ptr<Statistics>& statistics);
+
+  // Makes the cache move capacity towards the shards that miss the most
+  // lookups, see LRUCacheOptions::adaptive_shard_capacity. Must be called
+  // before the cache is used.
+  void EnableAdaptiveShardCapacity() { adaptive_capacity_ = true; }
+
+  // Makes every shard count its lookup hits and misses and its contended
+  // lock acquisitions, see LRUCacheOptions::track_shard_stats. Must be
+  // called before the cache is used.
+  void EnableShardStats();
+
+  // The cache rebalances its shards after this many misses
+  static const uint64_t kRebalanceMisses = 4096;
+
  private:
+  // Records the result of a lookup in shard, if shard stats are tracked or,
+  // for a miss, if adaptive_capacity_ is set. Rebalances the shards every
+  // kRebalanceMisses misses if adaptive_capacity_ is set.
+  void RecordLookup(uint32_t shard, bool hit);
+  // Moves a step of capacity from the shard with the fewest misses since the
+  // last call to the shard with the most. Does nothing if another thread is
+  // already rebalancing or changing the capacity.
+  void RebalanceShardCapacity();
+
   static inline uint32_t HashSlice(const Slice& s) {
     return static_cast<uint32_t>(GetSliceNPHash64(s));
   }
@@ -102,10 +210,25 @@ class ShardedCache : public Cache {
   int num_shard_bits_;
   mutable port::Mutex capacity_mutex_;
   size_t capacity_;
+  // Current capacity of every shard, protected by capacity_mutex_
+  std::vector<size_t> shard_capacities_;
+  // Misses of every shard at the last rebalancing, protected by
+  // capacity_mutex_
+  std::vector<uint64_t> last_misses_;
+  bool adaptive_capacity_;
+  bool track_shard_stats_;
+  std::atomic<uint64_t> misses_;
   bool strict_capacity_limit_;
   std::atomic<uint64_t> last_id_;
+  std::shared_ptr<Statistics> admission_statistics_;
+  // One per shard if the admission filter is enabled
+  std::vector<std::unique_ptr<CacheAdmissionFilter>> admission_filters_;
 };
 
 extern int GetDefaultCacheShardBits(size_t capacity);
 
+// Number of shard bits giving about two shards per core, with every shard at
+// least 512KB.
+extern int GetCacheShardBitsFromCores(size_t capacity);
+
 }  // namespace ROCKSDB_NAMESPACE
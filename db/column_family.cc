@@ -36,6 +36,7 @@
 #include "rocksdb/convenience.h"
 #include "rocksdb/table.h"
 #include "table/merging_iterator.h"
+#include "test_util/sync_point.h"
 #include "util/autovector.h"
 #include "util/cast_util.h"
 #include "util/compression.h"
@@ -196,6 +197,11 @@ Status CheckCFPathsSupported(const DBOptions& db_options,
           "universal and level compaction styles. ");
     }
   }
+  if (cf_options.first_path_max_level >= 0 &&
+      cf_options.compaction_style != kCompactionStyleLevel) {
+    return Status::NotSupported(
+        "first_path_max_level is only supported in level compaction style.");
+  }
   return Status::OK();
 }
 
@@ -419,6 +425,34 @@ ColumnFamilyOptions SanitizeOptions(const ImmutableDBOptions& db_options,
   return result;
 }
 
+SuperVersionEpoch::SuperVersionEpoch() : epoch_(0) {
+  readers_[0].store(0);
+  readers_[1].store(0);
+}
+
+size_t SuperVersionEpoch::Enter() {
+  while (true) {
+    uint64_t epoch = epoch_.load();
+    size_t parity = static_cast<size_t>(epoch & 1);
+    readers_[parity].fetch_add(1);
+    if (epoch_.load() == epoch) {
+      return parity;
+    }
+    // the epoch moved on before we were counted, TryAdvance() may not have
+    // seen us
+    readers_[parity].fetch_sub(1);
+  }
+}
+
+uint64_t SuperVersionEpoch::TryAdvance() {
+  uint64_t epoch = epoch_.load();
+  // the readers of the previous epoch share the parity of the next one
+  if (readers_[(epoch + 1) & 1].load() == 0) {
+    epoch_.store(++epoch);
+  }
+  return epoch;
+}
+
 int SuperVersion::dummy = 0;
 void* const SuperVersion::kSVInUse = &SuperVersion::dummy;
 void* const SuperVersion::kSVObsolete = nullptr;
@@ -434,6 +468,17 @@ SuperVersion* SuperVersion::Ref() {
   return this;
 }
 
+bool SuperVersion::TryRef() {
+  uint32_t current_refs = refs.load(std::memory_order_relaxed);
+  while (current_refs > 0) {
+    if (refs.compare_exchange_weak(current_refs, current_refs + 1,
+                                   std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool SuperVersion::Unref() {
   // fetch_sub returns the previous value of ref
   uint32_t previous_refs = refs.fetch_sub(1);
@@ -522,6 +567,7 @@ ColumnFamilyData::ColumnFamilyData(
            ioptions_.max_write_buffer_number_to_maintain,
            ioptions_.max_write_buffer_size_to_maintain),
       super_version_(nullptr),
+      published_super_version_(nullptr),
       super_version_number_(0),
       local_sv_(new ThreadLocalPtr(&SuperVersionUnrefHandle)),
       next_(nullptr),
@@ -608,6 +654,8 @@ ColumnFamilyData::ColumnFamilyData(
 // DB mutex held
 ColumnFamilyData::~ColumnFamilyData() {
   assert(refs_.load(std::memory_order_relaxed) == 0);
+  // they hold references on me
+  assert(retired_super_versions_.empty());
   // remove from linked list
   auto prev = prev_;
   auto next = next_;
@@ -639,6 +687,13 @@ ColumnFamilyData::~ColumnFamilyData() {
     assert(deleted);
   }
 
+  if (dropped_) {
+    if (mem_ != nullptr && mem_->IsPersistent()) {
+      mem_->MarkImmutable();
+      mem_->MarkFlushed();
+    }
+    imm_.MarkDropped();
+  }
   if (mem_ != nullptr) {
     delete mem_->Unref();
   }
@@ -674,23 +729,37 @@ bool ColumnFamilyData::UnrefAndTryDelete(SuperVersion* sv_under_cleanup) {
   // If called under SuperVersion::Cleanup, we should not re-enter Cleanup on
   // the same SuperVersion. (But while installing a new SuperVersion, this
   // cfd could be referenced only by two SuperVersions.)
-  if (old_refs == 2 && super_version_ != nullptr &&
-      super_version_ != sv_under_cleanup) {
-    // Only the super_version_ holds me
-    SuperVersion* sv = super_version_;
+  if (old_refs == 2 + static_cast<int>(retired_super_versions_.size()) &&
+      super_version_ != nullptr && super_version_ != sv_under_cleanup) {
+    // Only the super_version_ and the retired SuperVersions hold me. Nobody
+    // can read published_super_version_ anymore, so all of them can go.
+    autovector<SuperVersion*> svs;
+    for (const auto& retired : retired_super_versions_) {
+      svs.push_back(retired.first);
+    }
+    retired_super_versions_.clear();
+    svs.push_back(super_version_);
+    InstrumentedMutex* db_mutex = super_version_->db_mutex;
     super_version_ = nullptr;
+    published_super_version_.store(nullptr);
     // Release SuperVersion reference kept in ThreadLocalPtr.
     // This must be done outside of mutex_ since unref handler can lock mutex.
-    sv->db_mutex->Unlock();
+    db_mutex->Unlock();
     local_sv_.reset();
-    sv->db_mutex->Lock();
-
-    if (sv->Unref()) {
-      // May delete this ColumnFamilyData after calling Cleanup()
-      sv->Cleanup();
-      delete sv;
-      return true;
+    db_mutex->Lock();
+
+    // Each SuperVersion holds one reference on me, so I am deleted by the
+    // Cleanup() of the last one if all of them are released here
+    bool deleted = true;
+    for (SuperVersion* sv : svs) {
+      if (sv->Unref()) {
+        sv->Cleanup();
+        delete sv;
+      } else {
+        deleted = false;
+      }
     }
+    return deleted;
   }
   return false;
 }
@@ -869,6 +938,57 @@ ColumnFamilyData::GetWriteStallConditionAndCause(
   return {WriteStallCondition::kNormal, WriteStallCause::kNone};
 }
 
+void ColumnFamilyData::UpdateWriteRateController(
+    WriteStallCondition write_stall_condition,
+    const MutableCFOptions& mutable_cf_options) {
+  auto* vstorage = current_->storage_info();
+  uint64_t compaction_needed_bytes =
+      vstorage->estimated_compaction_needed_bytes();
+  // The largest ratio of a stall metric to the trigger slowing writes down,
+  // for the triggers GetWriteStallConditionAndCause() checks.
+  double pressure = 0;
+  if (mutable_cf_options.max_write_buffer_number > 3) {
+    pressure = std::max(
+        pressure, static_cast<double>(imm()->NumNotFlushed()) /
+                      (mutable_cf_options.max_write_buffer_number - 1));
+  }
+  if (!mutable_cf_options.disable_auto_compactions) {
+    if (mutable_cf_options.level0_slowdown_writes_trigger > 0) {
+      pressure = std::max(
+          pressure, static_cast<double>(vstorage->l0_delay_trigger_count()) /
+                        mutable_cf_options.level0_slowdown_writes_trigger);
+    }
+    if (mutable_cf_options.soft_pending_compaction_bytes_limit > 0) {
+      pressure = std::max(
+          pressure,
+          static_cast<double>(compaction_needed_bytes) /
+              static_cast<double>(
+                  mutable_cf_options.soft_pending_compaction_bytes_limit));
+    }
+  }
+  auto write_controller = column_family_set_->write_controller_;
+  write_rate_controller_.Update(
+      ioptions_.clock->NowMicros(), pressure, compaction_needed_bytes,
+      internal_stats_->GetBytesWritten(),
+      write_stall_condition == WriteStallCondition::kStopped,
+      write_controller->max_delayed_write_rate());
+}
+
+std::unique_ptr<WriteControllerToken>
+ColumnFamilyData::GetAdaptiveDelayToken() {
+  // The write controller enforces a single rate for all the writes to the
+  // DB, so it is the rate of the column family furthest behind.
+  uint64_t write_rate = write_rate_controller_.write_rate();
+  for (auto cfd : *column_family_set_) {
+    if (cfd != this && !cfd->IsDropped() &&
+        cfd->write_rate_controller_.engaged()) {
+      write_rate =
+          std::min(write_rate, cfd->write_rate_controller_.write_rate());
+    }
+  }
+  return column_family_set_->write_controller_->GetDelayToken(write_rate);
+}
+
 WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
       const MutableCFOptions& mutable_cf_options) {
   auto write_stall_condition = WriteStallCondition::kNormal;
@@ -888,6 +1008,10 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
     bool was_stopped = write_controller->IsStopped();
     bool needed_delay = write_controller->NeedsDelay();
 
+    if (ioptions_.adaptive_write_stall) {
+      UpdateWriteRateController(write_stall_condition, mutable_cf_options);
+    }
+
     if (write_stall_condition == WriteStallCondition::kStopped &&
         write_stall_cause == WriteStallCause::kMemtableLimit) {
       write_controller_token_ = write_controller->GetStopToken();
@@ -922,9 +1046,11 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
     } else if (write_stall_condition == WriteStallCondition::kDelayed &&
                write_stall_cause == WriteStallCause::kMemtableLimit) {
       write_controller_token_ =
-          SetupDelay(write_controller, compaction_needed_bytes,
-                     prev_compaction_needed_bytes_, was_stopped,
-                     mutable_cf_options.disable_auto_compactions);
+          ioptions_.adaptive_write_stall
+              ? GetAdaptiveDelayToken()
+              : SetupDelay(write_controller, compaction_needed_bytes,
+                           prev_compaction_needed_bytes_, was_stopped,
+                           mutable_cf_options.disable_auto_compactions);
       internal_stats_->AddCFStats(InternalStats::MEMTABLE_LIMIT_SLOWDOWNS, 1);
       ROCKS_LOG_WARN(
           ioptions_.info_log,
@@ -940,9 +1066,12 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
       bool near_stop = vstorage->l0_delay_trigger_count() >=
                        mutable_cf_options.level0_stop_writes_trigger - 2;
       write_controller_token_ =
-          SetupDelay(write_controller, compaction_needed_bytes,
-                     prev_compaction_needed_bytes_, was_stopped || near_stop,
-                     mutable_cf_options.disable_auto_compactions);
+          ioptions_.adaptive_write_stall
+              ? GetAdaptiveDelayToken()
+              : SetupDelay(write_controller, compaction_needed_bytes,
+                           prev_compaction_needed_bytes_,
+                           was_stopped || near_stop,
+                           mutable_cf_options.disable_auto_compactions);
       internal_stats_->AddCFStats(InternalStats::L0_FILE_COUNT_LIMIT_SLOWDOWNS,
                                   1);
       if (compaction_picker_->IsLevel0CompactionInProgress()) {
@@ -968,9 +1097,12 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
                   4;
 
       write_controller_token_ =
-          SetupDelay(write_controller, compaction_needed_bytes,
-                     prev_compaction_needed_bytes_, was_stopped || near_stop,
-                     mutable_cf_options.disable_auto_compactions);
+          ioptions_.adaptive_write_stall
+              ? GetAdaptiveDelayToken()
+              : SetupDelay(write_controller, compaction_needed_bytes,
+                           prev_compaction_needed_bytes_,
+                           was_stopped || near_stop,
+                           mutable_cf_options.disable_auto_compactions);
       internal_stats_->AddCFStats(
           InternalStats::PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS, 1);
       ROCKS_LOG_WARN(
@@ -981,7 +1113,16 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
           write_controller->delayed_write_rate());
     } else {
       assert(write_stall_condition == WriteStallCondition::kNormal);
-      if (vstorage->l0_delay_trigger_count() >=
+      if (ioptions_.adaptive_write_stall &&
+          write_rate_controller_.engaged()) {
+        // Writes are throttled before they reach a slowdown trigger.
+        write_controller_token_ = GetAdaptiveDelayToken();
+        ROCKS_LOG_INFO(ioptions_.info_log,
+                       "[%s] Throttling writes at write pressure %.2f "
+                       "rate %" PRIu64,
+                       name_.c_str(), write_rate_controller_.pressure(),
+                       write_controller->delayed_write_rate());
+      } else if (vstorage->l0_delay_trigger_count() >=
           GetL0ThresholdSpeedupCompaction(
               mutable_cf_options.level0_file_num_compaction_trigger,
               mutable_cf_options.level0_slowdown_writes_trigger)) {
@@ -1016,8 +1157,10 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
       // increase signal.
       if (needed_delay) {
         uint64_t write_rate = write_controller->delayed_write_rate();
-        write_controller->set_delayed_write_rate(static_cast<uint64_t>(
-            static_cast<double>(write_rate) * kDelayRecoverSlowdownRatio));
+        if (!ioptions_.adaptive_write_stall) {
+          write_controller->set_delayed_write_rate(static_cast<uint64_t>(
+              static_cast<double>(write_rate) * kDelayRecoverSlowdownRatio));
+        }
         // Set the low pri limit to be 1/4 the delayed write rate.
         // Note we don't reset this value even after delay condition is relased.
         // Low-pri rate will continue to apply if there is a compaction
@@ -1204,25 +1347,36 @@ SuperVersion* ColumnFamilyData::GetThreadLocalSuperVersion(DBImpl* db) {
   if (sv == SuperVersion::kSVObsolete ||
       sv->version_number != super_version_number_.load()) {
     RecordTick(ioptions_.statistics, NUMBER_SUPERVERSION_ACQUIRES);
+    SuperVersion* sv_to_cleanup = nullptr;
     SuperVersion* sv_to_delete = nullptr;
 
     if (sv && sv->Unref()) {
-      RecordTick(ioptions_.statistics, NUMBER_SUPERVERSION_CLEANUPS);
+      sv_to_cleanup = sv;
+    }
+    sv = nullptr;
+    if (sv_to_cleanup == nullptr) {
+      sv = TryRefSuperVersion(&sv_to_cleanup);
+    }
+    if (sv == nullptr) {
+      // The cleanup needs the mutex, or the SuperVersion was replaced while
+      // we took a reference
+      RecordTick(ioptions_.statistics, NUMBER_SUPERVERSION_ACQUIRES_LOCKED);
       db->mutex()->Lock();
-      // NOTE: underlying resources held by superversion (sst files) might
-      // not be released until the next background job.
-      sv->Cleanup();
-      if (db->immutable_db_options().avoid_unnecessary_blocking_io) {
-        db->AddSuperVersionsToFreeQueue(sv);
-        db->SchedulePurge();
-      } else {
-        sv_to_delete = sv;
+      if (sv_to_cleanup != nullptr) {
+        RecordTick(ioptions_.statistics, NUMBER_SUPERVERSION_CLEANUPS);
+        // NOTE: underlying resources held by superversion (sst files) might
+        // not be released until the next background job.
+        sv_to_cleanup->Cleanup();
+        if (db->immutable_db_options().avoid_unnecessary_blocking_io) {
+          db->AddSuperVersionsToFreeQueue(sv_to_cleanup);
+          db->SchedulePurge();
+        } else {
+          sv_to_delete = sv_to_cleanup;
+        }
       }
-    } else {
-      db->mutex()->Lock();
+      sv = super_version_->Ref();
+      db->mutex()->Unlock();
     }
-    sv = super_version_->Ref();
-    db->mutex()->Unlock();
 
     delete sv_to_delete;
   }
@@ -1230,6 +1384,28 @@ SuperVersion* ColumnFamilyData::GetThreadLocalSuperVersion(DBImpl* db) {
   return sv;
 }
 
+SuperVersion* ColumnFamilyData::TryRefSuperVersion(SuperVersion** last_ref) {
+  // Sequentially consistent with InstallSuperVersion(): either it sees us
+  // in the epoch, or we load the SuperVersion it published
+  size_t parity = super_version_epoch_.Enter();
+  SuperVersion* sv = published_super_version_.load();
+  bool referenced = sv != nullptr && sv->TryRef();
+  TEST_SYNC_POINT("ColumnFamilyData::TryRefSuperVersion:InEpoch");
+  super_version_epoch_.Exit(parity);
+  if (!referenced) {
+    return nullptr;
+  }
+  if (published_super_version_.load() != sv) {
+    // a reader must not go back to an older SuperVersion than the one it
+    // may have seen the writes of
+    if (sv->Unref()) {
+      *last_ref = sv;
+    }
+    return nullptr;
+  }
+  return sv;
+}
+
 bool ColumnFamilyData::ReturnThreadLocalSuperVersion(SuperVersion* sv) {
   assert(sv != nullptr);
   // Put the SuperVersion back
@@ -1267,6 +1443,7 @@ void ColumnFamilyData::InstallSuperVersion(
   super_version_->version_number = super_version_number_;
   super_version_->write_stall_condition =
       RecalculateWriteStallConditions(mutable_cf_options);
+  published_super_version_.store(new_superversion);
 
   if (old_superversion != nullptr) {
     // Reset SuperVersions cached in thread local storage.
@@ -1285,9 +1462,41 @@ void ColumnFamilyData::InstallSuperVersion(
           old_superversion->write_stall_condition,
           new_superversion->write_stall_condition, GetName(), ioptions());
     }
-    if (old_superversion->Unref()) {
-      old_superversion->Cleanup();
-      sv_context->superversions_to_free.push_back(old_superversion);
+    // Readers may still be about to reference old_superversion, which they
+    // loaded from published_super_version_. The reference super_version_
+    // held on it is released once they are gone.
+    retired_super_versions_.emplace_back(old_superversion,
+                                         super_version_epoch_.Current());
+    ReclaimSuperVersions(sv_context);
+  }
+}
+
+void ColumnFamilyData::ReclaimSuperVersions(SuperVersionContext* sv_context) {
+  // Without readers in the middle of TryRefSuperVersion(), which is a few
+  // instructions long, the epoch moves on by two and everything is released
+  // right away. Otherwise the rest waits for the next SuperVersion.
+  uint64_t epoch = super_version_epoch_.Current();
+  for (int i = 0; i < 2 && !retired_super_versions_.empty() &&
+                  retired_super_versions_.front().second + 2 > epoch;
+       i++) {
+    epoch = super_version_epoch_.TryAdvance();
+  }
+  size_t num_reclaimed = 0;
+  while (num_reclaimed < retired_super_versions_.size() &&
+         retired_super_versions_[num_reclaimed].second + 2 <= epoch) {
+    num_reclaimed++;
+  }
+  autovector<SuperVersion*> reclaimed;
+  for (size_t i = 0; i < num_reclaimed; i++) {
+    reclaimed.push_back(retired_super_versions_[i].first);
+  }
+  retired_super_versions_.erase(
+      retired_super_versions_.begin(),
+      retired_super_versions_.begin() + num_reclaimed);
+  for (SuperVersion* sv : reclaimed) {
+    if (sv->Unref()) {
+      sv->Cleanup();
+      sv_context->superversions_to_free.push_back(sv);
     }
   }
 }
@@ -1322,6 +1531,11 @@ Status ColumnFamilyData::ValidateOptions(
     s = Status::InvalidArgument(
         "max_successive_merges > 0 is incompatible with unordered_write");
   }
+  if (s.ok() && db_options.unordered_write &&
+      cf_options.memtable_hot_key_slots != 0) {
+    s = Status::InvalidArgument(
+        "memtable_hot_key_slots > 0 is incompatible with unordered_write");
+  }
   if (s.ok()) {
     s = CheckCFPathsSupported(db_options, cf_options);
   }
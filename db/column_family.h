@@ -214,6 +214,10 @@ struct SuperVersion {
   SuperVersion() = default;
   ~SuperVersion();
   SuperVersion* Ref();
+  // Like Ref(), but fails if the count has already dropped to zero. For
+  // readers that reach the SuperVersion without holding a reference, see
+  // ColumnFamilyData::TryRefSuperVersion().
+  bool TryRef();
   // If Unref() returns true, Cleanup() should be called with mutex held
   // before deleting this SuperVersion.
   bool Unref();
@@ -263,6 +267,31 @@ extern void GetIntTblPropCollectorFactory(
 
 class ColumnFamilySet;
 
+// Lets readers dereference the SuperVersion published by a column family
+// without the db mutex. A reader is counted in the counter of the current
+// epoch's parity while it may do so. The epoch only advances once the
+// readers of the previous epoch have left, so no reader can reach a
+// SuperVersion that was unpublished in epoch e once the epoch is e + 2.
+class SuperVersionEpoch {
+ public:
+  SuperVersionEpoch();
+
+  // Returns the parity to pass to Exit()
+  size_t Enter();
+  void Exit(size_t parity) { readers_[parity].fetch_sub(1); }
+
+  uint64_t Current() const { return epoch_.load(); }
+
+  // Moves to the next epoch, unless readers of the previous one are still
+  // in. Returns the current epoch. Never blocks.
+  // REQUIRES: calls are serialized, e.g. by the db mutex
+  uint64_t TryAdvance();
+
+ private:
+  std::atomic<uint64_t> epoch_;
+  std::atomic<uint64_t> readers_[2];
+};
+
 // This class keeps all the data that a column family needs.
 // Most methods require DB mutex held, unless otherwise noted
 class ColumnFamilyData {
@@ -446,6 +475,12 @@ class ColumnFamilyData {
   // contains anything other than SuperVersion::kSVInUse flag.
   bool ReturnThreadLocalSuperVersion(SuperVersion* sv);
   // thread-safe
+  // Returns a reference to the current SuperVersion without taking the db
+  // mutex, or nullptr if it was replaced in the meantime. If the reference
+  // taken to a replaced SuperVersion was its last, the SuperVersion is
+  // returned in *last_ref to be cleaned up.
+  SuperVersion* TryRefSuperVersion(SuperVersion** last_ref);
+  // thread-safe
   uint64_t GetSuperVersionNumber() const {
     return super_version_number_.load();
   }
@@ -489,6 +524,12 @@ class ColumnFamilyData {
   WriteStallCondition RecalculateWriteStallConditions(
       const MutableCFOptions& mutable_cf_options);
 
+  // Only updated with ImmutableCFOptions::adaptive_write_stall.
+  // REQUIRES: DB mutex held
+  const WriteRateController& write_rate_controller() const {
+    return write_rate_controller_;
+  }
+
   void set_initialized() { initialized_.store(true); }
 
   bool initialized() const { return initialized_.load(); }
@@ -524,6 +565,20 @@ class ColumnFamilyData {
   ThreadLocalPtr* TEST_GetLocalSV() { return local_sv_.get(); }
 
  private:
+  // Feeds the current write pressure of the column family to
+  // write_rate_controller_.
+  void UpdateWriteRateController(WriteStallCondition write_stall_condition,
+                                 const MutableCFOptions& mutable_cf_options);
+
+  // Returns a delay token at the lowest rate admitted by the write rate
+  // controllers of the column families that throttle writes.
+  std::unique_ptr<WriteControllerToken> GetAdaptiveDelayToken();
+
+  // Releases the references held by retired_super_versions_ on the
+  // SuperVersions that no reader can reach anymore.
+  // REQUIRES: DB mutex held
+  void ReclaimSuperVersions(SuperVersionContext* sv_context);
+
   friend class ColumnFamilySet;
   static const uint32_t kDummyColumnFamilyDataId;
   ColumnFamilyData(uint32_t id, const std::string& name,
@@ -567,6 +622,15 @@ class ColumnFamilyData {
   MemTable* mem_;
   MemTableList imm_;
   SuperVersion* super_version_;
+  // super_version_ for readers without the db mutex, see
+  // TryRefSuperVersion()
+  std::atomic<SuperVersion*> published_super_version_;
+  SuperVersionEpoch super_version_epoch_;
+  // The SuperVersions that super_version_ pointed to before, each with the
+  // reference super_version_ held on it and the epoch it was unpublished in.
+  // The reference keeps a SuperVersion alive until no reader can have
+  // loaded it from published_super_version_ anymore.
+  std::vector<std::pair<SuperVersion*, uint64_t>> retired_super_versions_;
 
   // An ordinal representing the current SuperVersion. Updated by
   // InstallSuperVersion(), i.e. incremented every time super_version_
@@ -607,6 +671,8 @@ class ColumnFamilyData {
 
   uint64_t prev_compaction_needed_bytes_;
 
+  WriteRateController write_rate_controller_;
+
   // if the database was opened with 2pc enabled
   bool allow_2pc_;
 
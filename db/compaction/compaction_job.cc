@@ -778,6 +778,12 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
 
   cfd->internal_stats()->AddCompactionStats(
       compact_->compaction->output_level(), thread_pri_, compaction_stats_);
+  for (const auto& sub_compact : compact_->sub_compact_states) {
+    for (const auto& out : sub_compact.outputs) {
+      cfd->internal_stats()->AddPathStats(out.meta.fd.GetPathId(),
+                                          out.meta.fd.GetFileSize());
+    }
+  }
 
   if (status.ok()) {
     status = InstallCompactionResults(mutable_cf_options);
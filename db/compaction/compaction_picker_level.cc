@@ -362,9 +362,6 @@ uint32_t LevelCompactionBuilder::GetPathId(
   uint32_t p = 0;
   assert(!ioptions.cf_paths.empty());
 
-  // size remaining in the most recent path
-  uint64_t current_path_size = ioptions.cf_paths[0].target_size;
-
   uint64_t level_size;
   int cur_level = 0;
 
@@ -372,6 +369,40 @@ uint32_t LevelCompactionBuilder::GetPathId(
   // We estimate L0 size to be the same as L1.
   level_size = mutable_cf_options.max_bytes_for_level_base;
 
+  auto next_level_size = [&]() {
+    if (cur_level > 0) {
+      if (ioptions.level_compaction_dynamic_level_bytes) {
+        // Currently, level_compaction_dynamic_level_bytes is ignored when
+        // multiple db paths are specified. https://github.com/facebook/
+        // rocksdb/blob/master/db/column_family.cc.
+        // Still, adding this check to avoid accidentally using
+        // max_bytes_for_level_multiplier_additional
+        level_size = static_cast<uint64_t>(
+            level_size * mutable_cf_options.max_bytes_for_level_multiplier);
+      } else {
+        level_size = static_cast<uint64_t>(
+            level_size * mutable_cf_options.max_bytes_for_level_multiplier *
+            mutable_cf_options.MaxBytesMultiplerAdditional(cur_level));
+      }
+    }
+    cur_level++;
+  };
+
+  if (ioptions.first_path_max_level >= 0 && ioptions.cf_paths.size() > 1) {
+    // The upper levels have the first path to themselves, and the remaining
+    // levels are spread over the other paths starting from the second one.
+    if (level <= ioptions.first_path_max_level) {
+      return 0;
+    }
+    while (cur_level <= ioptions.first_path_max_level) {
+      next_level_size();
+    }
+    p = 1;
+  }
+
+  // size remaining in the most recent path
+  uint64_t current_path_size = ioptions.cf_paths[p].target_size;
+
   // Last path is the fallback
   while (p < ioptions.cf_paths.size() - 1) {
     if (level_size <= current_path_size) {
@@ -380,22 +411,7 @@ uint32_t LevelCompactionBuilder::GetPathId(
         return p;
       } else {
         current_path_size -= level_size;
-        if (cur_level > 0) {
-          if (ioptions.level_compaction_dynamic_level_bytes) {
-            // Currently, level_compaction_dynamic_level_bytes is ignored when
-            // multiple db paths are specified. https://github.com/facebook/
-            // rocksdb/blob/master/db/column_family.cc.
-            // Still, adding this check to avoid accidentally using
-            // max_bytes_for_level_multiplier_additional
-            level_size = static_cast<uint64_t>(
-                level_size * mutable_cf_options.max_bytes_for_level_multiplier);
-          } else {
-            level_size = static_cast<uint64_t>(
-                level_size * mutable_cf_options.max_bytes_for_level_multiplier *
-                mutable_cf_options.MaxBytesMultiplerAdditional(cur_level));
-          }
-        }
-        cur_level++;
+        next_level_size();
         continue;
       }
     }
@@ -9,6 +9,7 @@
 
 #include <cstring>
 #include <regex>
+#include <thread>
 
 #include "db/db_test_util.h"
 #include "port/stack_trace.h"
@@ -1365,6 +1366,91 @@ TEST_P(DBMultiGetTestWithParam, MultiGetMultiCFSnapshot) {
 INSTANTIATE_TEST_CASE_P(DBMultiGetTestWithParam, DBMultiGetTestWithParam,
                         testing::Bool());
 
+TEST_F(DBBasicTest, RefreshSuperVersionWithoutMutex) {
+  Options options = CurrentOptions();
+  options.statistics = CreateDBStatistics();
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Put("key" + ToString(i), ToString(i)));
+    ASSERT_OK(Flush());
+    ASSERT_EQ(ToString(i), Get("key" + ToString(i)));
+  }
+  // every Get after a flush refreshed the thread local SuperVersion
+  ASSERT_GE(TestGetTickerCount(options, NUMBER_SUPERVERSION_ACQUIRES), 10);
+  ASSERT_EQ(0,
+            TestGetTickerCount(options, NUMBER_SUPERVERSION_ACQUIRES_LOCKED));
+
+  // Readers racing with flushes see the latest writes
+  std::atomic<bool> stop{false};
+  std::atomic<int> last_written{-1};
+  std::vector<port::Thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        int i = last_written.load();
+        if (i >= 0) {
+          std::string value;
+          ASSERT_OK(db_->Get(ReadOptions(), "racing" + ToString(i), &value));
+          ASSERT_EQ(ToString(i), value);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put("racing" + ToString(i), ToString(i)));
+    last_written = i;
+    ASSERT_OK(Flush());
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+}
+
+TEST_F(DBBasicTest, InstallSuperVersionWithReaderInEpoch) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  ASSERT_OK(Put("key", "v1"));
+  ASSERT_OK(Flush());
+
+  // The reader stops after it referenced the current SuperVersion without
+  // the mutex
+  std::atomic<bool> in_epoch{false};
+  std::atomic<bool> resume{false};
+  SyncPoint::GetInstance()->SetCallBack(
+      "ColumnFamilyData::TryRefSuperVersion:InEpoch", [&](void* /*arg*/) {
+        if (!in_epoch.exchange(true)) {
+          while (!resume.load()) {
+            std::this_thread::yield();
+          }
+        }
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+  std::string value;
+  port::Thread reader(
+      [&] { ASSERT_OK(db_->Get(ReadOptions(), "key", &value)); });
+  while (!in_epoch.load()) {
+    std::this_thread::yield();
+  }
+
+  // The SuperVersion it loaded is replaced without waiting for it
+  ASSERT_OK(Put("key", "v2"));
+  ASSERT_OK(Flush());
+  resume = true;
+  reader.join();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  // it saw the SuperVersion replaced and took the current one
+  ASSERT_EQ("v2", value);
+
+  // the replaced SuperVersion is released by a later one
+  ASSERT_OK(Put("key", "v3"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v3", Get("key"));
+}
+
 TEST_F(DBBasicTest, MultiGetBatchedSimpleUnsorted) {
   do {
     CreateAndReopenWithCF({"pikachu"}, CurrentOptions());
@@ -2820,6 +2906,7 @@ class DBBasicTestMultiGet : public DBTestBase {
 
     const char* Name() const override { return "MyBlockCache"; }
 
+    using CacheWrapper::Insert;
     Status Insert(const Slice& key, void* value, size_t charge,
                   void (*deleter)(const Slice& key, void* value),
                   Handle** handle = nullptr,
@@ -2828,6 +2915,7 @@ class DBBasicTestMultiGet : public DBTestBase {
       return target_->Insert(key, value, charge, deleter, handle, priority);
     }
 
+    using CacheWrapper::Lookup;
     Handle* Lookup(const Slice& key, Statistics* stats = nullptr) override {
       num_lookups_++;
       Handle* handle = target_->Lookup(key, stats);
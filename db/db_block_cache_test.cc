@@ -11,6 +11,7 @@
 #include "cache/lru_cache.h"
 #include "db/db_test_util.h"
 #include "port/stack_trace.h"
+#include "rocksdb/secondary_cache.h"
 #include "util/compression.h"
 #include "util/random.h"
 
@@ -456,6 +457,17 @@ class MockCache : public LRUCache {
     }
     return LRUCache::Insert(key, value, charge, deleter, handle, priority);
   }
+
+  // Used by the block based table reader
+  Status Insert(const Slice& key, void* value, const CacheItemHelper* helper,
+                size_t charge, Handle** handle, Priority priority) override {
+    if (priority == Priority::LOW) {
+      low_pri_insert_count++;
+    } else {
+      high_pri_insert_count++;
+    }
+    return LRUCache::Insert(key, value, helper, charge, handle, priority);
+  }
 };
 
 uint32_t MockCache::high_pri_insert_count = 0;
@@ -520,6 +532,107 @@ TEST_F(DBBlockCacheTest, IndexAndFilterBlocksCachePriority) {
   }
 }
 
+TEST_F(DBBlockCacheTest, SecondaryCacheHits) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  CompressedSecondaryCacheOptions secondary_cache_opts;
+  secondary_cache_opts.capacity = 4 << 20;
+  secondary_cache_opts.num_shard_bits = 0;
+  // Only fits about one data block
+  LRUCacheOptions cache_opts(6 << 10, 0 /* num_shard_bits */,
+                             false /* strict_capacity_limit */,
+                             0.0 /* high_pri_pool_ratio */,
+                             nullptr /* memory_allocator */,
+                             kDefaultToAdaptiveMutex, kDontChargeCacheMetadata);
+  cache_opts.secondary_cache = NewCompressedSecondaryCache(secondary_cache_opts);
+  ASSERT_NE(cache_opts.secondary_cache, nullptr);
+  BlockBasedTableOptions table_options;
+  table_options.block_cache = NewLRUCache(cache_opts);
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 40; i++) {
+    values.push_back(rnd.RandomString(1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_OK(Flush());
+
+  // The blocks evicted by the first pass are demoted to the secondary cache,
+  // which serves the second pass instead of the table file
+  for (int i = 0; i < 40; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  ASSERT_EQ(0, TestGetTickerCount(options, SECONDARY_CACHE_HITS));
+  uint64_t data_misses = TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS);
+  for (int i = 0; i < 40; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  ASSERT_GT(TestGetTickerCount(options, SECONDARY_CACHE_HITS), 0);
+  // A secondary cache hit is a block cache hit
+  ASSERT_EQ(data_misses, TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS));
+}
+
+TEST_F(DBBlockCacheTest, DecodedIndexBlocks) {
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 200; i++) {
+    values.push_back(rnd.RandomString(100));
+  }
+  uint64_t index_bytes_insert[2];
+  for (bool decode : {false, true}) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+    BlockBasedTableOptions table_options;
+    table_options.cache_index_and_filter_blocks = true;
+    table_options.index_type = BlockBasedTableOptions::kTwoLevelIndexSearch;
+    table_options.partition_filters = true;
+    table_options.filter_policy.reset(NewBloomFilterPolicy(10, false));
+    // Many small index and filter partitions
+    table_options.block_size = 256;
+    table_options.metadata_block_size = 128;
+    table_options.decode_index_blocks = decode;
+    table_options.block_cache = NewLRUCache(1 << 20);
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    DestroyAndReopen(options);
+
+    for (int i = 0; i < 200; i += 2) {
+      ASSERT_OK(Put(Key(i), values[i]));
+    }
+    ASSERT_OK(Flush());
+
+    for (int i = 0; i < 200; i++) {
+      ASSERT_EQ(i % 2 == 0 ? values[i] : "NOT_FOUND", Get(Key(i)));
+    }
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    for (int i = 1; i < 200; i += 2) {
+      iter->Seek(Key(i));
+      if (i + 1 < 200) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(Key(i + 1), iter->key().ToString());
+        ASSERT_EQ(values[i + 1], iter->value().ToString());
+      } else {
+        ASSERT_FALSE(iter->Valid());
+      }
+    }
+    int count = 0;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      count++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(100, count);
+    iter.reset();
+
+    index_bytes_insert[decode] =
+        TestGetTickerCount(options, BLOCK_CACHE_INDEX_BYTES_INSERT);
+  }
+  // The decoded partitions are charged to the cache
+  ASSERT_GT(index_bytes_insert[1], index_bytes_insert[0]);
+}
+
 namespace {
 
 // An LRUCache wrapper that can falsely report "not found" on Lookup.
@@ -533,6 +646,7 @@ class LookupLiarCache : public CacheWrapper {
   explicit LookupLiarCache(std::shared_ptr<Cache> target)
       : CacheWrapper(std::move(target)) {}
 
+  using CacheWrapper::Lookup;
   Handle* Lookup(const Slice& key, Statistics* stats) override {
     if (nth_lookup_not_found_ == 1) {
       nth_lookup_not_found_ = 0;
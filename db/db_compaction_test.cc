@@ -7,6 +7,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <sstream>
 #include <tuple>
 
 #include "db/blob/blob_index.h"
@@ -2303,6 +2304,80 @@ TEST_P(DBCompactionTestWithParam, LevelCompactionPathUse) {
   Destroy(options);
 }
 
+TEST_P(DBCompactionTestWithParam, LevelCompactionFirstPathMaxLevel) {
+  Options options = CurrentOptions();
+  // too small for any level without first_path_max_level
+  options.db_paths.emplace_back(dbname_, 10 * 1024);
+  options.db_paths.emplace_back(dbname_ + "_2", 1024 * 1024 * 1024);
+  options.first_path_max_level = 1;
+  options.memtable_factory.reset(
+      new SpecialSkipListFactory(KNumKeysByGenerateNewFile - 1));
+  options.compaction_style = kCompactionStyleLevel;
+  options.write_buffer_size = 110 << 10;  // 110KB
+  options.arena_block_size = 4 << 10;
+  options.level0_file_num_compaction_trigger = 2;
+  options.num_levels = 4;
+  options.max_bytes_for_level_base = 150 * 1024;
+  options.max_subcompactions = max_subcompactions_;
+
+  DestroyAndReopen(options);
+
+  Random rnd(301);
+  int key_idx = 0;
+  for (int num = 0; num < 8; num++) {
+    GenerateNewFile(&rnd, &key_idx);
+  }
+  ASSERT_OK(Put(Key(key_idx), "last"));
+  ASSERT_OK(Flush());
+
+  // L0 and L1 files stay on the first path, and deeper levels are moved to
+  // the second one by compaction
+  std::vector<LiveFileMetaData> files;
+  db_->GetLiveFilesMetaData(&files);
+  int num_upper_files = 0;
+  int num_lower_files = 0;
+  for (const auto& file : files) {
+    if (file.level <= 1) {
+      ASSERT_EQ(dbname_, file.db_path);
+      num_upper_files++;
+    } else {
+      ASSERT_EQ(dbname_ + "_2", file.db_path);
+      num_lower_files++;
+    }
+  }
+  ASSERT_GT(num_upper_files, 0);
+  ASSERT_GT(num_lower_files, 0);
+
+  std::string path_stats;
+  ASSERT_TRUE(db_->GetProperty(DB::Properties::kPathStats, &path_stats));
+  std::istringstream lines(path_stats);
+  std::string line;
+  // skip the header
+  std::getline(lines, line);
+  std::getline(lines, line);
+  for (uint32_t path_id = 0; path_id < 2; path_id++) {
+    ASSERT_TRUE(std::getline(lines, line));
+    unsigned int id;
+    int num_files;
+    double size_mb, written_mb;
+    uint64_t files_written;
+    ASSERT_EQ(5, sscanf(line.c_str(), "%u %d %lf %lf %" SCNu64, &id,
+                        &num_files, &size_mb, &written_mb, &files_written));
+    ASSERT_EQ(path_id, id);
+    ASSERT_EQ(path_id == 0 ? num_upper_files : num_lower_files, num_files);
+    ASSERT_GE(files_written, static_cast<uint64_t>(num_files));
+  }
+
+  Reopen(options);
+  for (int i = 0; i < key_idx; i++) {
+    auto v = Get(Key(i));
+    ASSERT_TRUE(v.size() == 1 || v.size() == 990);
+  }
+  ASSERT_EQ("last", Get(Key(key_idx)));
+
+  Destroy(options);
+}
+
 TEST_P(DBCompactionTestWithParam, LevelCompactionCFPathUse) {
   Options options = CurrentOptions();
   options.db_paths.emplace_back(dbname_, 500 * 1024);
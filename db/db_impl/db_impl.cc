@@ -177,7 +177,12 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
       total_log_size_(0),
       is_snapshot_supported_(true),
       write_buffer_manager_(immutable_db_options_.write_buffer_manager.get()),
+      write_buffer_manager_client_(this),
+      write_buffer_manager_client_registered_(false),
       write_thread_(immutable_db_options_),
+      async_write_leader_(nullptr),
+      pending_async_writes_(0),
+      async_write_shutdown_(false),
       nonmem_write_thread_(immutable_db_options_),
       write_controller_(mutable_db_options_.delayed_write_rate),
       last_batch_group_size_(0),
@@ -250,6 +255,13 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
   co.num_shard_bits = immutable_db_options_.table_cache_numshardbits;
   co.metadata_charge_policy = kDontChargeCacheMetadata;
   table_cache_ = NewLRUCache(co);
+  write_thread_.SetAsyncLeaderHandler(
+      [this](WriteThread::AsyncWriter* w) { ScheduleAsyncWriteLeader(w); });
+  if (immutable_db_options_.allow_concurrent_memtable_write &&
+      immutable_db_options_.batch_insert_threads > 1) {
+    batch_insert_pool_.reset(
+        NewThreadPool(immutable_db_options_.batch_insert_threads - 1));
+  }
 
   versions_.reset(new VersionSet(dbname_, &immutable_db_options_, file_options_,
                                  table_cache_.get(), write_buffer_manager_,
@@ -503,6 +515,17 @@ void DBImpl::CancelAllBackgroundWork(bool wait) {
 }
 
 Status DBImpl::CloseHelper() {
+  WaitForAsyncWrites();
+  if (batch_insert_pool_ != nullptr) {
+    // only helpers that found no range left to insert can still be running
+    batch_insert_pool_->WaitForJobsAndJoinAllThreads();
+  }
+
+  if (write_buffer_manager_client_registered_) {
+    write_buffer_manager_->UnregisterClient(&write_buffer_manager_client_);
+    write_buffer_manager_client_registered_ = false;
+  }
+
   // Guarantee that there is no background error recovery in progress before
   // continuing with the shutdown
   mutex_.Lock();
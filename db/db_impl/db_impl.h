@@ -50,6 +50,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/status.h"
+#include "rocksdb/threadpool.h"
 #include "rocksdb/trace_reader_writer.h"
 #include "rocksdb/transaction_log.h"
 #include "rocksdb/write_buffer_manager.h"
@@ -160,6 +161,8 @@ class DBImpl : public DB {
   using DB::Write;
   virtual Status Write(const WriteOptions& options,
                        WriteBatch* updates) override;
+  virtual void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                          std::function<void(Status)> callback) override;
 
   using DB::Get;
   virtual Status Get(const ReadOptions& options,
@@ -1182,6 +1185,35 @@ class DBImpl : public DB {
                    size_t batch_cnt = 0,
                    PreReleaseCallback* pre_release_callback = nullptr);
 
+  // Leads the write group of w once it is STATE_GROUP_LEADER, the rest of
+  // WriteImpl
+  Status WriteGroupAsLeader(WriteThread::Writer* w,
+                            const WriteOptions& write_options,
+                            uint64_t* log_used, uint64_t* seq_used);
+
+  // Leads the write group of an async writer and completes it
+  void LeadAsyncWrite(WriteThread::AsyncWriter* w);
+
+  // Passes an async writer that was handed leadership to
+  // AsyncWriteLeaderThread
+  void ScheduleAsyncWriteLeader(WriteThread::AsyncWriter* w);
+
+  void AsyncWriteLeaderThread();
+
+  // Waits for the pending async writes and stops AsyncWriteLeaderThread
+  void WaitForAsyncWrites();
+
+  // Whether the batch of w is large enough to be inserted into the memtables
+  // by InsertBatchInRanges
+  bool ShouldInsertBatchInRanges(const WriteThread::Writer& w) const;
+
+  // Inserts the batch of w, a parallel memtable writer, into the memtables.
+  // If ShouldInsertBatchInRanges(*w), the batch is split into ranges of
+  // entries that are inserted concurrently by this thread and the threads of
+  // batch_insert_pool_.
+  Status ParallelMemTableInsert(WriteThread::Writer* w,
+                                const WriteOptions& write_options);
+
   Status PipelinedWriteImpl(const WriteOptions& options, WriteBatch* updates,
                             WriteCallback* callback = nullptr,
                             uint64_t* log_used = nullptr, uint64_t log_ref = 0,
@@ -1493,6 +1525,13 @@ class DBImpl : public DB {
       const autovector<BGFlushArg>& bg_flush_args, bool* made_progress,
       JobContext* job_context, LogBuffer* log_buffer, Env::Priority thread_pri);
 
+  // Inserts a WriteBatch read from WAL wal_number during recovery into the
+  // memtables, using up to wal_recovery_threads threads for large batches
+  // that write several column families.
+  Status InsertLogRecordForRecovery(const Slice& contents, uint64_t wal_number,
+                                    SequenceNumber* next_sequence,
+                                    bool* has_valid_writes);
+
   // REQUIRES: log_numbers are sorted in ascending order
   // corrupted_log_found is set to true if we recover from a corrupted log file.
   Status RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
@@ -1598,6 +1637,29 @@ class DBImpl : public DB {
   // REQUIRES: mutex locked and in write thread.
   Status HandleWriteBufferFull(WriteContext* write_context);
 
+  // Switches the memtables of `cfds` and schedules their flushes, on behalf
+  // of write_buffer_manager_.
+  // REQUIRES: mutex locked and in write thread.
+  Status SwitchMemtablesForWriteBuffer(
+      const autovector<ColumnFamilyData*>& cfds, WriteContext* write_context);
+
+  // Stalls writes while write_buffer_manager_ is over its limit and this DB
+  // uses more than its share of it.
+  // REQUIRES: mutex locked and in write thread.
+  Status WriteBufferManagerStallWrites(const WriteOptions& write_options,
+                                       WriteContext* write_context);
+
+  // Memory of all the memtables of this DB, mutable or not.
+  // REQUIRES: mutex locked.
+  size_t GetWriteBufferMemoryUsage();
+
+  void GetWriteBufferFlushCandidates(
+      bool level0_overlap, std::vector<WriteBufferFlushCandidate>* candidates);
+
+  // Flushes the column family, which the flush policy of
+  // write_buffer_manager_ picked for another DB, without waiting.
+  void WriteBufferManagerFlush(uint32_t column_family_id);
+
   // REQUIRES: mutex locked
   Status PreprocessWrite(const WriteOptions& write_options, bool* need_log_sync,
                          WriteContext* write_context);
@@ -1609,11 +1671,19 @@ class DBImpl : public DB {
   IOStatus WriteToWAL(const WriteBatch& merged_batch, log::Writer* log_writer,
                       uint64_t* log_used, uint64_t* log_size);
 
-  IOStatus WriteToWAL(const WriteThread::WriteGroup& write_group,
+  IOStatus WriteToWAL(WriteThread::WriteGroup& write_group,
                       log::Writer* log_writer, uint64_t* log_used,
                       bool need_log_sync, bool need_log_dir_sync,
                       SequenceNumber sequence);
 
+  // Writes one WAL record per batch of write_group, letting the writers of
+  // large batches write their own record in parallel. Returns NotSupported,
+  // without writing anything, if the WAL file cannot be written in place.
+  IOStatus ParallelWriteToWAL(WriteThread::WriteGroup& write_group,
+                              log::Writer* log_writer, SequenceNumber sequence,
+                              uint64_t* log_size, size_t* write_with_wal,
+                              WriteBatch** to_be_cached_state);
+
   IOStatus ConcurrentWriteToWAL(const WriteThread::WriteGroup& write_group,
                                 uint64_t* log_used,
                                 SequenceNumber* last_sequence, size_t seq_inc);
@@ -1986,7 +2056,45 @@ class DBImpl : public DB {
 
   WriteBufferManager* write_buffer_manager_;
 
+  // Offers the memtables of this DB to the flush policy of
+  // write_buffer_manager_.
+  class WriteBufferManagerClient : public WriteBufferManager::Client {
+   public:
+    explicit WriteBufferManagerClient(DBImpl* db) : db_(db) {}
+
+    void GetFlushCandidates(
+        bool level0_overlap,
+        std::vector<WriteBufferFlushCandidate>* candidates) override {
+      db_->GetWriteBufferFlushCandidates(level0_overlap, candidates);
+    }
+
+    void Flush(uint32_t column_family_id) override {
+      db_->WriteBufferManagerFlush(column_family_id);
+    }
+
+   private:
+    DBImpl* db_;
+  };
+
+  WriteBufferManagerClient write_buffer_manager_client_;
+  bool write_buffer_manager_client_registered_;
+
   WriteThread write_thread_;
+
+  // State of the async writes. async_write_thread_ leads the groups of the
+  // async writers that are handed leadership, one at a time through
+  // async_write_leader_.
+  std::mutex async_write_mutex_;
+  std::condition_variable async_write_cv_;
+  port::Thread async_write_thread_;
+  WriteThread::AsyncWriter* async_write_leader_;
+  uint64_t pending_async_writes_;
+  bool async_write_shutdown_;
+
+  // Helper threads that insert the ranges of large batches, if
+  // batch_insert_threads > 1
+  std::unique_ptr<ThreadPool> batch_insert_pool_;
+
   WriteBatch tmp_batch_;
   // The write thread when the writers have no memtable write. This will be used
   // in 2PC to batch the prepares separately from the serial commit.
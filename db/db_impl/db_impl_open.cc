@@ -21,6 +21,7 @@
 #include "rocksdb/table.h"
 #include "rocksdb/wal_filter.h"
 #include "test_util/sync_point.h"
+#include "util/defer.h"
 #include "util/rate_limiter.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -521,6 +522,33 @@ Status DBImpl::Recover(
                                     mutable_cf_options->max_write_buffer_number;
     }
 
+    // Persistent memtables recover the writes of the memtables that were not
+    // flushed, which may have been made without WAL and be newer than
+    // anything in the MANIFEST or WALs
+    MemTableRep::RecoveredState memtable_state;
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      memtable_state.column_families.push_back(cfd->GetID());
+    }
+    SequenceNumber largest_memtable_seq = 0;
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (!cfd->mem()->IsPersistent()) {
+        continue;
+      }
+      const VersionStorageInfo* vstorage = cfd->current()->storage_info();
+      memtable_state.is_live_table_file = [vstorage](uint64_t file_number) {
+        return vstorage->GetFileLocation(file_number).IsValid();
+      };
+      cfd->mem()->Recover(memtable_state);
+      largest_memtable_seq =
+          std::max(largest_memtable_seq,
+                   cfd->mem()->GetLargestRecoveredSequenceNumber());
+    }
+    if (largest_memtable_seq > versions_->LastSequence()) {
+      versions_->SetLastAllocatedSequence(largest_memtable_seq);
+      versions_->SetLastPublishedSequence(largest_memtable_seq);
+      versions_->SetLastSequence(largest_memtable_seq);
+    }
+
     SequenceNumber next_sequence(kMaxSequenceNumber);
     default_cf_handle_ = new ColumnFamilyHandleImpl(
         versions_->GetColumnFamilySet()->GetDefault(), this, &mutex_);
@@ -771,6 +799,66 @@ Status DBImpl::InitPersistStatsColumnFamily() {
 }
 
 // REQUIRES: wal_numbers are sorted in ascending order
+Status DBImpl::InsertLogRecordForRecovery(const Slice& contents,
+                                          uint64_t wal_number,
+                                          SequenceNumber* next_sequence,
+                                          bool* has_valid_writes) {
+  // Spreading a batch over threads only pays off for large batches that
+  // write several column families
+  static const uint32_t kMinParallelInsertCount = 1024;
+  std::vector<uint32_t> cfs;
+  size_t num_threads = 1;
+  if (immutable_db_options_.wal_recovery_threads > 1 &&
+      DecodeFixed32(contents.data() + 8) >= kMinParallelInsertCount &&
+      versions_->GetColumnFamilySet()->NumberOfColumnFamilies() > 1 &&
+      WriteBatchInternal::GetColumnFamilies(contents, &cfs).ok()) {
+    num_threads = std::min(
+        cfs.size(),
+        static_cast<size_t>(immutable_db_options_.wal_recovery_threads));
+  }
+  if (num_threads <= 1) {
+    return WriteBatchInternal::InsertInto(
+        contents, column_family_memtables_.get(), &flush_scheduler_,
+        &trim_history_scheduler_, true, wal_number, this, next_sequence,
+        has_valid_writes, seq_per_batch_, batch_per_txn_);
+  }
+
+  // Every thread walks the whole batch but only inserts into its own column
+  // families, so each memtable still has a single writer.
+  std::vector<std::vector<uint32_t>> partitions(num_threads);
+  for (size_t i = 0; i < cfs.size(); i++) {
+    partitions[i % num_threads].push_back(cfs[i]);
+  }
+  std::vector<Status> statuses(num_threads);
+  std::vector<SequenceNumber> next_seqs(num_threads);
+  std::unique_ptr<bool[]> valid_writes(new bool[num_threads]());
+  auto insert = [&](size_t i) {
+    ColumnFamilyMemTablesImpl memtables(versions_->GetColumnFamilySet());
+    statuses[i] = WriteBatchInternal::InsertInto(
+        contents, &memtables, &flush_scheduler_, &trim_history_scheduler_,
+        true, wal_number, this, &next_seqs[i], &valid_writes[i],
+        seq_per_batch_, batch_per_txn_, &partitions[i]);
+  };
+  std::vector<port::Thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(insert, i);
+  }
+  insert(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < num_threads; i++) {
+    if (!statuses[i].ok()) {
+      return statuses[i];
+    }
+    assert(next_seqs[i] == next_seqs[0]);
+    *has_valid_writes = *has_valid_writes || valid_writes[i];
+  }
+  *next_sequence = next_seqs[0];
+  return Status::OK();
+}
+
 Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
                                SequenceNumber* next_sequence, bool read_only,
                                bool* corrupted_wal_found) {
@@ -829,6 +917,26 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
   bool stop_replay_by_wal_filter = false;
   bool stop_replay_for_corruption = false;
   bool flushed = false;
+  // Persistent memtables flushed during recovery are kept until the flush
+  // result is in the MANIFEST, so that their entries are not dropped if the
+  // recovery fails.
+  autovector<MemTable*> flushed_persistent_mems;
+  bool flush_results_applied = false;
+  Defer release_flushed_mems([&]() {
+    for (MemTable* m : flushed_persistent_mems) {
+      if (flush_results_applied) {
+        m->MarkImmutable();
+        m->MarkFlushed();
+      }
+      delete m->Unref();
+    }
+  });
+  auto keep_if_persistent = [&](MemTable* m) {
+    if (m->IsPersistent()) {
+      m->Ref();
+      flushed_persistent_mems.push_back(m);
+    }
+  };
   uint64_t corrupted_wal_number = kMaxSequenceNumber;
   uint64_t min_wal_number = MinLogNumberToKeep();
   for (auto wal_number : wal_numbers) {
@@ -920,11 +1028,11 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
         continue;
       }
 
-      status = WriteBatchInternal::SetContents(&batch, record);
-      if (!status.ok()) {
-        return status;
-      }
-      SequenceNumber sequence = WriteBatchInternal::Sequence(&batch);
+      // The record is inserted in place unless a WAL filter needs it as a
+      // WriteBatch. For a WAL that is read through a mapping, e.g. on pmem,
+      // records that fit in one block are then never copied.
+      Slice contents = record;
+      SequenceNumber sequence = DecodeFixed64(record.data());
 
       if (immutable_db_options_.wal_recovery_mode ==
           WALRecoveryMode::kPointInTimeRecovery) {
@@ -943,6 +1051,10 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
 
 #ifndef ROCKSDB_LITE
       if (immutable_db_options_.wal_filter != nullptr) {
+        status = WriteBatchInternal::SetContents(&batch, record);
+        if (!status.ok()) {
+          return status;
+        }
         WriteBatch new_batch;
         bool batch_changed = false;
 
@@ -1016,6 +1128,7 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
                                           WriteBatchInternal::Sequence(&batch));
           batch = new_batch;
         }
+        contents = WriteBatchInternal::Contents(&batch);
       }
 #endif  // ROCKSDB_LITE
 
@@ -1025,11 +1138,8 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
       // we just ignore the update.
       // That's why we set ignore missing column families to true
       bool has_valid_writes = false;
-      status = WriteBatchInternal::InsertInto(
-          &batch, column_family_memtables_.get(), &flush_scheduler_,
-          &trim_history_scheduler_, true, wal_number, this,
-          false /* concurrent_memtable_writes */, next_sequence,
-          &has_valid_writes, seq_per_batch_, batch_per_txn_);
+      status = InsertLogRecordForRecovery(contents, wal_number, next_sequence,
+                                          &has_valid_writes);
       MaybeIgnoreError(&status);
       if (!status.ok()) {
         // We are treating this as a failure while reading since we read valid
@@ -1059,8 +1169,12 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
           }
           flushed = true;
 
+          keep_if_persistent(cfd->mem());
+          SequenceNumber recovered_seq =
+              cfd->mem()->GetLargestRecoveredSequenceNumber();
           cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
                                  *next_sequence);
+          cfd->mem()->SetLargestRecoveredSequenceNumber(recovered_seq);
         }
       }
     }
@@ -1157,8 +1271,10 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
         // Column family cfd has already flushed the data
         // from all wals. Memtable has to be empty because
         // we filter the updates based on wal_number
-        // (in WriteBatch::InsertInto)
-        assert(cfd->mem()->GetFirstSequenceNumber() == 0);
+        // (in WriteBatch::InsertInto), unless it is a persistent memtable
+        // that kept writes made without WAL
+        assert(cfd->mem()->GetFirstSequenceNumber() == 0 ||
+               cfd->mem()->IsPersistent());
         assert(edit->NumEntries() == 0);
         continue;
       }
@@ -1179,6 +1295,7 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
           }
           flushed = true;
 
+          keep_if_persistent(cfd->mem());
           cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
                                  versions_->LastSequence());
         }
@@ -1226,6 +1343,7 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
       status = versions_->LogAndApply(cfds, cf_opts, edit_lists, &mutex_,
                                       directories_.GetDbDir(),
                                       /*new_descriptor_log=*/true);
+      flush_results_applied = status.ok();
     }
   }
 
@@ -1397,6 +1515,9 @@ Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
     for (const auto& blob : blob_file_additions) {
       edit->AddBlobFile(blob);
     }
+    // Recovery does not write to the memtable anymore
+    mem->MarkImmutable();
+    mem->MarkFlushPending(meta.fd.GetNumber());
   }
 
   InternalStats::CompactionStats stats(CompactionReason::kFlush, 1);
@@ -1415,6 +1536,10 @@ Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
   stats.num_output_files_blob = static_cast<int>(blobs.size());
 
   cfd->internal_stats()->AddCompactionStats(level, Env::Priority::USER, stats);
+  if (has_output) {
+    cfd->internal_stats()->AddPathStats(meta.fd.GetPathId(),
+                                        meta.fd.GetFileSize());
+  }
   cfd->internal_stats()->AddCFStats(
       InternalStats::BYTES_FLUSHED,
       stats.bytes_written + stats.bytes_written_blob);
@@ -1704,6 +1829,13 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   }
   impl->mutex_.Unlock();
 
+  if (s.ok() && (impl->write_buffer_manager_->flush_policy() != nullptr ||
+                 impl->write_buffer_manager_->allow_stall())) {
+    impl->write_buffer_manager_->RegisterClient(
+        &impl->write_buffer_manager_client_);
+    impl->write_buffer_manager_client_registered_ = true;
+  }
+
 #ifndef ROCKSDB_LITE
   auto sfm = static_cast<SstFileManagerImpl*>(
       impl->immutable_db_options_.sst_file_manager.get());
@@ -53,6 +53,200 @@ Status DBImpl::Write(const WriteOptions& write_options, WriteBatch* my_batch) {
   return WriteImpl(write_options, my_batch, nullptr, nullptr);
 }
 
+void DBImpl::WriteAsync(const WriteOptions& write_options,
+                        WriteBatch* my_batch,
+                        std::function<void(Status)> callback) {
+  // An async writer is left in the write queue with no thread waiting on it,
+  // so it can only take the steps that the leader of its group takes on its
+  // behalf.
+  if (my_batch == nullptr || write_options.no_slowdown ||
+      write_options.low_pri ||
+      (write_options.sync && write_options.disableWAL) ||
+      immutable_db_options_.enable_pipelined_write ||
+      immutable_db_options_.unordered_write || two_write_queues_ ||
+      seq_per_batch_) {
+    callback(WriteImpl(write_options, my_batch));
+    return;
+  }
+  if (tracer_) {
+    InstrumentedMutexLock lock(&trace_mutex_);
+    if (tracer_) {
+      tracer_->Write(my_batch).PermitUncheckedError();
+    }
+  }
+  if (!write_options.disableWAL) {
+    RecordTick(stats_, WRITE_WITH_WAL);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(async_write_mutex_);
+    pending_async_writes_++;
+  }
+  auto* w = new WriteThread::AsyncWriter(
+      write_options, my_batch,
+      [this, callback](const Status& status) {
+        callback(status);
+        std::lock_guard<std::mutex> lock(async_write_mutex_);
+        if (--pending_async_writes_ == 0) {
+          async_write_cv_.notify_all();
+        }
+      });
+  if (write_thread_.JoinBatchGroupAsync(w)) {
+    LeadAsyncWrite(w);
+  }
+}
+
+void DBImpl::LeadAsyncWrite(WriteThread::AsyncWriter* w) {
+  Status status =
+      WriteGroupAsLeader(w, w->write_options, nullptr /*log_used*/,
+                         nullptr /*seq_used*/);
+  w->done(status);
+  delete w;
+}
+
+void DBImpl::ScheduleAsyncWriteLeader(WriteThread::AsyncWriter* w) {
+  std::lock_guard<std::mutex> lock(async_write_mutex_);
+  // there is a single leader at a time
+  assert(async_write_leader_ == nullptr);
+  async_write_leader_ = w;
+  if (!async_write_thread_.joinable()) {
+    async_write_thread_ = port::Thread(&DBImpl::AsyncWriteLeaderThread, this);
+  }
+  async_write_cv_.notify_all();
+}
+
+void DBImpl::AsyncWriteLeaderThread() {
+  std::unique_lock<std::mutex> lock(async_write_mutex_);
+  while (true) {
+    async_write_cv_.wait(lock, [this] {
+      return async_write_leader_ != nullptr || async_write_shutdown_;
+    });
+    if (async_write_leader_ == nullptr) {
+      break;
+    }
+    WriteThread::AsyncWriter* w = async_write_leader_;
+    async_write_leader_ = nullptr;
+    lock.unlock();
+    LeadAsyncWrite(w);
+    lock.lock();
+  }
+}
+
+void DBImpl::WaitForAsyncWrites() {
+  {
+    std::unique_lock<std::mutex> lock(async_write_mutex_);
+    async_write_cv_.wait(lock, [this] { return pending_async_writes_ == 0; });
+    async_write_shutdown_ = true;
+    async_write_cv_.notify_all();
+  }
+  if (async_write_thread_.joinable()) {
+    async_write_thread_.join();
+  }
+}
+
+namespace {
+// Batches are split into ranges of at least this many entries
+const size_t kMinBatchInsertRangeEntries = 1024;
+
+// The entry ranges of a batch being inserted by several threads. A helper
+// that starts after the last range was claimed has nothing left to do, so
+// the helpers share the ownership of it with the writer, which only waits
+// for the ranges to be inserted.
+struct BatchInsertRanges {
+  WriteThread::Writer* writer = nullptr;
+  bool ignore_missing_column_families = false;
+  bool hint_per_batch = false;
+  std::vector<WriteBatchInternal::EntryRange> ranges;
+  std::atomic<size_t> next_range{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+  // guarded by mutex
+  size_t inserted_ranges = 0;
+  Status status;
+};
+}  // namespace
+
+bool DBImpl::ShouldInsertBatchInRanges(const WriteThread::Writer& w) const {
+  // The ranges of a batch are inserted with the sequence numbers of their
+  // entries, which a transaction marker or seq_per_batch_ do not advance
+  if (batch_insert_pool_ == nullptr || seq_per_batch_ || !batch_per_txn_ ||
+      w.batch == nullptr || w.disable_memtable ||
+      WriteBatchInternal::Count(w.batch) < 2 * kMinBatchInsertRangeEntries) {
+    return false;
+  }
+  return !w.batch->HasMerge() && !w.batch->HasBeginPrepare() &&
+         !w.batch->HasEndPrepare() && !w.batch->HasCommit() &&
+         !w.batch->HasRollback();
+}
+
+Status DBImpl::ParallelMemTableInsert(WriteThread::Writer* w,
+                                      const WriteOptions& write_options) {
+  if (!ShouldInsertBatchInRanges(*w)) {
+    ColumnFamilyMemTablesImpl column_family_memtables(
+        versions_->GetColumnFamilySet());
+    return WriteBatchInternal::InsertInto(
+        w, w->sequence, &column_family_memtables, &flush_scheduler_,
+        &trim_history_scheduler_, write_options.ignore_missing_column_families,
+        0 /*log_number*/, this, true /*concurrent_memtable_writes*/,
+        seq_per_batch_, w->batch_cnt, batch_per_txn_,
+        write_options.memtable_insert_hint_per_batch);
+  }
+
+  const size_t num_threads =
+      static_cast<size_t>(immutable_db_options_.batch_insert_threads);
+  const size_t count = WriteBatchInternal::Count(w->batch);
+  auto insert = std::make_shared<BatchInsertRanges>();
+  insert->writer = w;
+  insert->ignore_missing_column_families =
+      write_options.ignore_missing_column_families;
+  insert->hint_per_batch = write_options.memtable_insert_hint_per_batch;
+  // a few ranges per thread even out their insert times
+  WriteBatchInternal::SetSequence(w->batch, w->sequence);
+  Status s = WriteBatchInternal::SplitIntoRanges(
+      w->batch,
+      std::max(kMinBatchInsertRangeEntries, count / (4 * num_threads) + 1),
+      &insert->ranges);
+  if (!s.ok()) {
+    return s;
+  }
+
+  auto insert_ranges = [this, insert]() {
+    std::unique_ptr<ColumnFamilyMemTablesImpl> column_family_memtables;
+    size_t i;
+    while ((i = insert->next_range.fetch_add(1, std::memory_order_relaxed)) <
+           insert->ranges.size()) {
+      TEST_SYNC_POINT("DBImpl::ParallelMemTableInsert:InsertRange");
+      if (column_family_memtables == nullptr) {
+        column_family_memtables.reset(
+            new ColumnFamilyMemTablesImpl(versions_->GetColumnFamilySet()));
+      }
+      Status range_status = WriteBatchInternal::InsertInto(
+          insert->writer, insert->ranges[i], column_family_memtables.get(),
+          &flush_scheduler_, &trim_history_scheduler_,
+          insert->ignore_missing_column_families, this,
+          insert->hint_per_batch);
+      std::lock_guard<std::mutex> lock(insert->mutex);
+      if (!range_status.ok() && insert->status.ok()) {
+        insert->status = range_status;
+      }
+      if (++insert->inserted_ranges == insert->ranges.size()) {
+        insert->cv.notify_all();
+      }
+    }
+  };
+  size_t num_helpers = std::min(num_threads, insert->ranges.size()) - 1;
+  for (size_t i = 0; i < num_helpers; i++) {
+    batch_insert_pool_->SubmitJob(insert_ranges);
+  }
+  insert_ranges();
+
+  std::unique_lock<std::mutex> lock(insert->mutex);
+  insert->cv.wait(lock, [&insert] {
+    return insert->inserted_ranges == insert->ranges.size();
+  });
+  return insert->status;
+}
+
 #ifndef ROCKSDB_LITE
 Status DBImpl::WriteWithCallback(const WriteOptions& write_options,
                                  WriteBatch* my_batch,
@@ -84,6 +278,18 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (write_options.sync && write_options.disableWAL) {
     return Status::InvalidArgument("Sync writes has to enable WAL.");
   }
+  if (write_options.disableWAL && !disable_memtable &&
+      my_batch->HasDeleteRange()) {
+    // Persistent memtables don't keep range deletions, which only the WAL
+    // brings back after a crash
+    InstrumentedMutexLock l(&mutex_);
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (!cfd->IsDropped() && cfd->mem()->IsPersistent()) {
+        return Status::NotSupported(
+            "Range deletions with a persistent memtable need the WAL");
+      }
+    }
+  }
   if (two_write_queues_ && immutable_db_options_.enable_pipelined_write) {
     return Status::NotSupported(
         "pipelined_writes is not compatible with concurrent prepares");
@@ -164,6 +370,19 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
                      immutable_db_options_.statistics.get(), DB_WRITE);
 
   write_thread_.JoinBatchGroup(&w);
+  if (w.state == WriteThread::STATE_PARALLEL_WAL_WRITER) {
+    // we are a non-leader writing its own WAL record, the leader reserved
+    // room for it and set the sequence number of the batch
+    PERF_TIMER_STOP(write_pre_and_post_process_time);
+    {
+      PERF_TIMER_GUARD(write_wal_time);
+      w.write_group->log_writer->WriteReservedRecord(
+          w.write_group->wal_buf, w.wal_record,
+          WriteBatchInternal::Contents(w.batch));
+    }
+    PERF_TIMER_START(write_pre_and_post_process_time);
+    write_thread_.CompleteParallelWALWriter(&w);
+  }
   if (w.state == WriteThread::STATE_PARALLEL_MEMTABLE_WRITER) {
     // we are a non-leader in a parallel group
 
@@ -171,14 +390,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       PERF_TIMER_STOP(write_pre_and_post_process_time);
       PERF_TIMER_GUARD(write_memtable_time);
 
-      ColumnFamilyMemTablesImpl column_family_memtables(
-          versions_->GetColumnFamilySet());
-      w.status = WriteBatchInternal::InsertInto(
-          &w, w.sequence, &column_family_memtables, &flush_scheduler_,
-          &trim_history_scheduler_,
-          write_options.ignore_missing_column_families, 0 /*log_number*/, this,
-          true /*concurrent_memtable_writes*/, seq_per_batch_, w.batch_cnt,
-          batch_per_txn_, write_options.memtable_insert_hint_per_batch);
+      w.status = ParallelMemTableInsert(&w, write_options);
 
       PERF_TIMER_START(write_pre_and_post_process_time);
     }
@@ -206,6 +418,18 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   }
   // else we are the leader of the write batch group
   assert(w.state == WriteThread::STATE_GROUP_LEADER);
+  // WriteGroupAsLeader does its own perf timing.
+  PERF_TIMER_STOP(write_pre_and_post_process_time);
+  return WriteGroupAsLeader(&w, write_options, log_used, seq_used);
+}
+
+// Leads the write batch group of w, which is STATE_GROUP_LEADER, on the
+// current thread.
+Status DBImpl::WriteGroupAsLeader(WriteThread::Writer* w,
+                                  const WriteOptions& write_options,
+                                  uint64_t* log_used, uint64_t* seq_used) {
+  PERF_TIMER_GUARD(write_pre_and_post_process_time);
+  const bool disable_memtable = w->disable_memtable;
   Status status;
   // Once reaches this point, the current writer "w" will try to do its write
   // job.  It may also pick up some of the remaining writers in the "writers_"
@@ -242,13 +466,13 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   mutex_.Unlock();
 
   // Add to log and apply to memtable.  We can release the lock
-  // during this phase since &w is currently responsible for logging
+  // during this phase since w is currently responsible for logging
   // and protects against concurrent loggers and concurrent writes
   // into memtables
 
   TEST_SYNC_POINT("DBImpl::WriteImpl:BeforeLeaderEnters");
   last_batch_group_size_ =
-      write_thread_.EnterAsBatchGroupLeader(&w, &write_group);
+      write_thread_.EnterAsBatchGroupLeader(w, &write_group);
 
   IOStatus io_s;
   if (status.ok()) {
@@ -263,13 +487,18 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     // assumed to be true.  Rule 3 is checked for each batch.  We could
     // relax rules 2 if we could prevent write batches from referring
     // more than once to a particular key.
+    //
+    // A group of one writer only takes the parallel path to insert a large
+    // batch in ranges, see ParallelMemTableInsert.
     bool parallel = immutable_db_options_.allow_concurrent_memtable_write &&
-                    write_group.size > 1;
+                    (write_group.size > 1 || ShouldInsertBatchInRanges(*w));
     size_t total_count = 0;
     size_t valid_batches = 0;
     size_t total_byte_size = 0;
     size_t pre_release_callback_cnt = 0;
     for (auto* writer : write_group) {
+      // no thread waits on an async writer to do its part
+      parallel = parallel && !writer->async;
       if (writer->CheckCallback(this)) {
         valid_batches += writer->batch_cnt;
         if (writer->ShouldWriteToMemtable()) {
@@ -378,8 +607,8 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       PERF_TIMER_GUARD(write_memtable_time);
 
       if (!parallel) {
-        // w.sequence will be set inside InsertInto
-        w.status = WriteBatchInternal::InsertInto(
+        // w->sequence will be set inside InsertInto
+        w->status = WriteBatchInternal::InsertInto(
             write_group, current_sequence, column_family_memtables_.get(),
             &flush_scheduler_, &trim_history_scheduler_,
             write_options.ignore_missing_column_families,
@@ -392,27 +621,19 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
 
         // Each parallel follower is doing each own writes. The leader should
         // also do its own.
-        if (w.ShouldWriteToMemtable()) {
-          ColumnFamilyMemTablesImpl column_family_memtables(
-              versions_->GetColumnFamilySet());
-          assert(w.sequence == current_sequence);
-          w.status = WriteBatchInternal::InsertInto(
-              &w, w.sequence, &column_family_memtables, &flush_scheduler_,
-              &trim_history_scheduler_,
-              write_options.ignore_missing_column_families, 0 /*log_number*/,
-              this, true /*concurrent_memtable_writes*/, seq_per_batch_,
-              w.batch_cnt, batch_per_txn_,
-              write_options.memtable_insert_hint_per_batch);
+        if (w->ShouldWriteToMemtable()) {
+          assert(w->sequence == current_sequence);
+          w->status = ParallelMemTableInsert(w, write_options);
         }
       }
       if (seq_used != nullptr) {
-        *seq_used = w.sequence;
+        *seq_used = w->sequence;
       }
     }
   }
   PERF_TIMER_START(write_pre_and_post_process_time);
 
-  if (!w.CallbackFailed()) {
+  if (!w->CallbackFailed()) {
     if (!io_s.ok()) {
       IOStatusCheck(io_s);
     } else {
@@ -443,7 +664,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (in_parallel_group) {
     // CompleteParallelWorker returns true if this thread should
     // handle exit, false means somebody else did
-    should_exit_batch_group = write_thread_.CompleteParallelMemTableWriter(&w);
+    should_exit_batch_group = write_thread_.CompleteParallelMemTableWriter(w);
   }
   if (should_exit_batch_group) {
     if (status.ok()) {
@@ -451,12 +672,12 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       // we reacts to non-OK statuses here.
       versions_->SetLastSequence(last_sequence);
     }
-    MemTableInsertStatusCheck(w.status);
+    MemTableInsertStatusCheck(w->status);
     write_thread_.ExitAsBatchGroupLeader(write_group, status);
   }
 
   if (status.ok()) {
-    status = w.FinalStatus();
+    status = w->FinalStatus();
   }
   return status;
 }
@@ -952,6 +1173,13 @@ Status DBImpl::PreprocessWrite(const WriteOptions& write_options,
   PERF_TIMER_STOP(write_scheduling_flushes_compactions_time);
   PERF_TIMER_GUARD(write_pre_and_post_process_time);
 
+  if (UNLIKELY(status.ok() && write_buffer_manager_->ShouldStall())) {
+    PERF_TIMER_STOP(write_pre_and_post_process_time);
+    PERF_TIMER_GUARD(write_delay_time);
+    status = WriteBufferManagerStallWrites(write_options, write_context);
+    PERF_TIMER_START(write_pre_and_post_process_time);
+  }
+
   if (UNLIKELY(status.ok() && (write_controller_.IsStopped() ||
                                write_controller_.NeedsDelay()))) {
     PERF_TIMER_STOP(write_pre_and_post_process_time);
@@ -1068,7 +1296,7 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
   return io_s;
 }
 
-IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
+IOStatus DBImpl::WriteToWAL(WriteThread::WriteGroup& write_group,
                             log::Writer* log_writer, uint64_t* log_used,
                             bool need_log_sync, bool need_log_dir_sync,
                             SequenceNumber sequence) {
@@ -1077,20 +1305,46 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   // Same holds for all in the batch group
   size_t write_with_wal = 0;
   WriteBatch* to_be_cached_state = nullptr;
-  WriteBatch* merged_batch = MergeBatch(write_group, &tmp_batch_,
-                                        &write_with_wal, &to_be_cached_state);
-  if (merged_batch == write_group.leader->batch) {
-    write_group.leader->log_used = logfile_number_;
-  } else if (write_with_wal > 1) {
-    for (auto writer : write_group) {
-      writer->log_used = logfile_number_;
+  WriteBatch* merged_batch = nullptr;
+  uint64_t log_size;
+
+  // With pipelined write the followers wait for other states, and the
+  // sequence numbers of the batches are only known here if each valid batch
+  // consumes one per key.
+  bool parallel = immutable_db_options_.enable_parallel_wal_write &&
+                  !immutable_db_options_.enable_pipelined_write &&
+                  !manual_wal_flush_ && !seq_per_batch_ &&
+                  write_group.size > 1;
+  for (auto writer : write_group) {
+    parallel = parallel && !writer->disable_memtable &&
+               writer->batch->GetWalTerminationPoint().is_cleared();
+  }
+  if (parallel) {
+    io_s = ParallelWriteToWAL(write_group, log_writer, sequence, &log_size,
+                              &write_with_wal, &to_be_cached_state);
+    if (io_s.IsNotSupported()) {
+      io_s = IOStatus::OK();
+      parallel = false;
+    } else if (log_used != nullptr) {
+      *log_used = logfile_number_;
+    }
+  }
+
+  if (!parallel) {
+    merged_batch = MergeBatch(write_group, &tmp_batch_, &write_with_wal,
+                              &to_be_cached_state);
+    if (merged_batch == write_group.leader->batch) {
+      write_group.leader->log_used = logfile_number_;
+    } else if (write_with_wal > 1) {
+      for (auto writer : write_group) {
+        writer->log_used = logfile_number_;
+      }
     }
-  }
 
-  WriteBatchInternal::SetSequence(merged_batch, sequence);
+    WriteBatchInternal::SetSequence(merged_batch, sequence);
 
-  uint64_t log_size;
-  io_s = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+    io_s = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+  }
   if (to_be_cached_state) {
     cached_recoverable_state_ = *to_be_cached_state;
     cached_recoverable_state_empty_ = false;
@@ -1137,6 +1391,74 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   return io_s;
 }
 
+// Batches smaller than this are written to the WAL by the group leader, as
+// handing them to their own writer costs more than the copy.
+static const size_t kMinParallelWALWriteSize = 16 << 10;
+
+IOStatus DBImpl::ParallelWriteToWAL(WriteThread::WriteGroup& write_group,
+                                    log::Writer* log_writer,
+                                    SequenceNumber sequence,
+                                    uint64_t* log_size, size_t* write_with_wal,
+                                    WriteBatch** to_be_cached_state) {
+  // Reserve room for the records in sequence order, so that recovery sees
+  // the same sequence numbers as a merged group record would give. Each
+  // record only needs its own offset, the copies are independent.
+  log_writer->BeginReservation();
+  uint64_t size = 0;
+  bool launch = false;
+  for (auto writer : write_group) {
+    if (writer->CallbackFailed()) {
+      continue;
+    }
+    WriteBatchInternal::SetSequence(writer->batch, sequence);
+    sequence += WriteBatchInternal::Count(writer->batch);
+    size_t batch_size = WriteBatchInternal::ByteSize(writer->batch);
+    writer->wal_record = log_writer->ReserveRecord(batch_size);
+    writer->parallel_wal_write = writer != write_group.leader &&
+                                 !writer->async &&
+                                 batch_size >= kMinParallelWALWriteSize;
+    launch = launch || writer->parallel_wal_write;
+    size += batch_size;
+  }
+  char* buf = nullptr;
+  IOStatus io_s = log_writer->MapReservation(&buf);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+
+  write_group.log_writer = log_writer;
+  write_group.wal_buf = buf;
+  if (launch) {
+    write_thread_.LaunchParallelWALWriters(&write_group);
+  }
+  for (auto writer : write_group) {
+    if (!writer->CallbackFailed() && !writer->parallel_wal_write) {
+      log_writer->WriteReservedRecord(
+          buf, writer->wal_record, WriteBatchInternal::Contents(writer->batch));
+    }
+  }
+  if (launch) {
+    write_thread_.CompleteParallelWALWriter(write_group.leader);
+  }
+  io_s = log_writer->CommitReservation(buf);
+
+  *write_with_wal = 0;
+  for (auto writer : write_group) {
+    if (!writer->CallbackFailed()) {
+      writer->log_used = logfile_number_;
+      if (WriteBatchInternal::IsLatestPersistentState(writer->batch)) {
+        *to_be_cached_state = writer->batch;
+      }
+      (*write_with_wal)++;
+    }
+  }
+  *log_size = size;
+  total_log_size_ += size;
+  alive_log_files_.back().AddSize(size);
+  log_empty_ = false;
+  return io_s;
+}
+
 IOStatus DBImpl::ConcurrentWriteToWAL(
     const WriteThread::WriteGroup& write_group, uint64_t* log_used,
     SequenceNumber* last_sequence, size_t seq_inc) {
@@ -1364,48 +1686,84 @@ Status DBImpl::SwitchWAL(WriteContext* write_context) {
 Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
   mutex_.AssertHeld();
   assert(write_context != nullptr);
-  Status status;
 
   // Before a new memtable is added in SwitchMemtable(),
   // write_buffer_manager_->ShouldFlush() will keep returning true. If another
   // thread is writing to another DB with the same write buffer, they may also
   // be flushed. We may end up with flushing much more DBs than needed. It's
   // suboptimal but still correct.
-  ROCKS_LOG_INFO(
-      immutable_db_options_.info_log,
-      "Flushing column family with oldest memtable entry. Write buffer is "
-      "using %" ROCKSDB_PRIszt " bytes out of a total of %" ROCKSDB_PRIszt ".",
-      write_buffer_manager_->memory_usage(),
-      write_buffer_manager_->buffer_size());
   // no need to refcount because drop is happening in write thread, so can't
   // happen while we're in the write thread
   autovector<ColumnFamilyData*> cfds;
-  if (immutable_db_options_.atomic_flush) {
-    SelectColumnFamiliesForAtomicFlush(&cfds);
+  const auto& flush_policy = write_buffer_manager_->flush_policy();
+  if (flush_policy != nullptr && write_buffer_manager_client_registered_) {
+    ROCKS_LOG_INFO(
+        immutable_db_options_.info_log,
+        "Flushing memtable picked by %s. Write buffer is using "
+        "%" ROCKSDB_PRIszt " bytes out of a total of %" ROCKSDB_PRIszt ".",
+        flush_policy->Name(), write_buffer_manager_->memory_usage(),
+        write_buffer_manager_->buffer_size());
+    // The policy looks at the memtables of all the DBs sharing the write
+    // buffer manager, under their mutexes. A memtable of another DB is
+    // flushed by a thread of the write buffer manager.
+    uint32_t column_family_id = 0;
+    mutex_.Unlock();
+    bool picked = write_buffer_manager_->PickFlushVictim(
+        &write_buffer_manager_client_, &column_family_id);
+    mutex_.Lock();
+    ColumnFamilyData* cfd_picked =
+        picked ? versions_->GetColumnFamilySet()->GetColumnFamily(
+                     column_family_id)
+               : nullptr;
+    if (cfd_picked != nullptr && !cfd_picked->IsDropped()) {
+      if (immutable_db_options_.atomic_flush) {
+        SelectColumnFamiliesForAtomicFlush(&cfds);
+      } else {
+        cfds.push_back(cfd_picked);
+        MaybeFlushStatsCF(&cfds);
+      }
+    }
   } else {
-    ColumnFamilyData* cfd_picked = nullptr;
-    SequenceNumber seq_num_for_cf_picked = kMaxSequenceNumber;
+    ROCKS_LOG_INFO(
+        immutable_db_options_.info_log,
+        "Flushing column family with oldest memtable entry. Write buffer is "
+        "using %" ROCKSDB_PRIszt " bytes out of a total of %" ROCKSDB_PRIszt
+        ".",
+        write_buffer_manager_->memory_usage(),
+        write_buffer_manager_->buffer_size());
+    if (immutable_db_options_.atomic_flush) {
+      SelectColumnFamiliesForAtomicFlush(&cfds);
+    } else {
+      ColumnFamilyData* cfd_picked = nullptr;
+      SequenceNumber seq_num_for_cf_picked = kMaxSequenceNumber;
 
-    for (auto cfd : *versions_->GetColumnFamilySet()) {
-      if (cfd->IsDropped()) {
-        continue;
-      }
-      if (!cfd->mem()->IsEmpty()) {
-        // We only consider active mem table, hoping immutable memtable is
-        // already in the process of flushing.
-        uint64_t seq = cfd->mem()->GetCreationSeq();
-        if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
-          cfd_picked = cfd;
-          seq_num_for_cf_picked = seq;
+      for (auto cfd : *versions_->GetColumnFamilySet()) {
+        if (cfd->IsDropped()) {
+          continue;
+        }
+        if (!cfd->mem()->IsEmpty()) {
+          // We only consider active mem table, hoping immutable memtable is
+          // already in the process of flushing.
+          uint64_t seq = cfd->mem()->GetCreationSeq();
+          if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
+            cfd_picked = cfd;
+            seq_num_for_cf_picked = seq;
+          }
         }
       }
+      if (cfd_picked != nullptr) {
+        cfds.push_back(cfd_picked);
+      }
+      MaybeFlushStatsCF(&cfds);
     }
-    if (cfd_picked != nullptr) {
-      cfds.push_back(cfd_picked);
-    }
-    MaybeFlushStatsCF(&cfds);
   }
+  return SwitchMemtablesForWriteBuffer(cfds, write_context);
+}
 
+Status DBImpl::SwitchMemtablesForWriteBuffer(
+    const autovector<ColumnFamilyData*>& cfds, WriteContext* write_context) {
+  mutex_.AssertHeld();
+  Status status;
   WriteThread::Writer nonmem_w;
   if (two_write_queues_) {
     nonmem_write_thread_.EnterUnbatched(&nonmem_w, &mutex_);
@@ -1447,6 +1805,178 @@ Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
   return status;
 }
 
+// REQUIRES: mutex_ is held
+// REQUIRES: this thread is currently at the front of the writer queue
+Status DBImpl::WriteBufferManagerStallWrites(const WriteOptions& write_options,
+                                             WriteContext* write_context) {
+  mutex_.AssertHeld();
+  Status s;
+  uint64_t time_delayed = 0;
+  bool delayed = false;
+  {
+    StopWatch sw(immutable_db_options_.clock, stats_, WRITE_STALL,
+                 &time_delayed);
+    // We check for a change every 1ms, in case the notification of freed
+    // memory comes before the wait.
+    const uint64_t kStallInterval = 1000;
+    while (write_buffer_manager_->ShouldStall() &&
+           write_buffer_manager_->IsStallTarget(GetWriteBufferMemoryUsage())) {
+      if (write_options.no_slowdown) {
+        s = Status::Incomplete("Write stall");
+        break;
+      }
+      // Don't wait on flushes that may never succeed, or while shutting down.
+      if (!error_handler_.GetBGError().ok() ||
+          shutting_down_.load(std::memory_order_acquire)) {
+        break;
+      }
+
+      // The writes to this DB cannot switch its memtables while they stall,
+      // so make sure it frees some memory unless it is already flushing.
+      ColumnFamilyData* cfd_largest = nullptr;
+      bool flushing = false;
+      for (auto cfd : *versions_->GetColumnFamilySet()) {
+        if (cfd->IsDropped()) {
+          continue;
+        }
+        if (cfd->imm()->NumNotFlushed() > 0) {
+          flushing = true;
+          break;
+        }
+        if (!cfd->mem()->IsEmpty() &&
+            (cfd_largest == nullptr ||
+             cfd->mem()->ApproximateMemoryUsageFast() >
+                 cfd_largest->mem()->ApproximateMemoryUsageFast())) {
+          cfd_largest = cfd;
+        }
+      }
+      if (!flushing && cfd_largest != nullptr) {
+        autovector<ColumnFamilyData*> cfds;
+        if (immutable_db_options_.atomic_flush) {
+          SelectColumnFamiliesForAtomicFlush(&cfds);
+        } else {
+          cfds.push_back(cfd_largest);
+          MaybeFlushStatsCF(&cfds);
+        }
+        WaitForPendingWrites();
+        s = SwitchMemtablesForWriteBuffer(cfds, write_context);
+        if (!s.ok()) {
+          break;
+        }
+      }
+
+      delayed = true;
+      TEST_SYNC_POINT("DBImpl::WriteBufferManagerStallWrites:Wait");
+      // Notify write_thread_ about the stall so it can setup a barrier and
+      // fail any pending writers with no_slowdown
+      write_thread_.BeginWriteStall();
+      mutex_.Unlock();
+      write_buffer_manager_->WaitForStallChange(kStallInterval);
+      mutex_.Lock();
+      write_thread_.EndWriteStall();
+    }
+  }
+  if (delayed) {
+    default_cf_internal_stats_->AddDBStats(
+        InternalStats::kIntStatsWriteStallMicros, time_delayed);
+    RecordTick(stats_, STALL_MICROS, time_delayed);
+  }
+  return s;
+}
+
+size_t DBImpl::GetWriteBufferMemoryUsage() {
+  mutex_.AssertHeld();
+  size_t usage = 0;
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    usage += cfd->mem()->ApproximateMemoryUsageFast() +
+             cfd->imm()->ApproximateMemoryUsage();
+  }
+  return usage;
+}
+
+void DBImpl::GetWriteBufferFlushCandidates(
+    bool level0_overlap, std::vector<WriteBufferFlushCandidate>* candidates) {
+  InstrumentedMutexLock l(&mutex_);
+  if (shutting_down_.load(std::memory_order_acquire)) {
+    return;
+  }
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    if (cfd->IsDropped() || cfd->mem()->IsEmpty()) {
+      continue;
+    }
+    MemTable* mem = cfd->mem();
+    const VersionStorageInfo* vstorage = cfd->current()->storage_info();
+    WriteBufferFlushCandidate candidate;
+    candidate.db_name = dbname_;
+    candidate.column_family_id = cfd->GetID();
+    candidate.column_family_name = cfd->GetName();
+    candidate.memory_usage = mem->ApproximateMemoryUsageFast();
+    candidate.num_entries = mem->num_entries();
+    candidate.num_deletes = mem->num_deletes();
+    candidate.oldest_key_time = mem->ApproximateOldestKeyTime();
+    candidate.num_level0_files = vstorage->NumLevelFiles(0);
+    if (level0_overlap && candidate.num_level0_files > 0) {
+      // Range tombstones may widen the range of the flushed file a little;
+      // the point keys are a good enough estimate.
+      ReadOptions ro;
+      ro.total_order_seek = true;
+      Arena arena;
+      ScopedArenaIterator iter(mem->NewIterator(ro, &arena));
+      iter->SeekToFirst();
+      if (iter->Valid()) {
+        std::string smallest = ExtractUserKey(iter->key()).ToString();
+        iter->SeekToLast();
+        assert(iter->Valid());
+        Slice largest = ExtractUserKey(iter->key());
+        const Comparator* ucmp = cfd->user_comparator();
+        for (FileMetaData* f : vstorage->LevelFiles(0)) {
+          if (ucmp->Compare(f->largest.user_key(), smallest) >= 0 &&
+              ucmp->Compare(f->smallest.user_key(), largest) <= 0) {
+            candidate.num_level0_overlapping_files++;
+          }
+        }
+      }
+    }
+    candidates->push_back(std::move(candidate));
+  }
+}
+
+void DBImpl::WriteBufferManagerFlush(uint32_t column_family_id) {
+  ColumnFamilyData* cfd = nullptr;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    if (shutting_down_.load(std::memory_order_acquire)) {
+      return;
+    }
+    cfd = versions_->GetColumnFamilySet()->GetColumnFamily(column_family_id);
+    if (cfd == nullptr || cfd->IsDropped()) {
+      return;
+    }
+    cfd->Ref();
+  }
+  ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                 "[%s] Flushing memtable picked by %s for the write buffer.",
+                 cfd->GetName().c_str(),
+                 write_buffer_manager_->flush_policy()->Name());
+  FlushOptions flush_options;
+  flush_options.wait = false;
+  flush_options.allow_write_stall = true;
+  Status s;
+  if (immutable_db_options_.atomic_flush) {
+    s = AtomicFlushMemTables({cfd}, flush_options,
+                             FlushReason::kWriteBufferFull);
+  } else {
+    s = FlushMemTable(cfd, flush_options, FlushReason::kWriteBufferFull);
+  }
+  if (!s.ok()) {
+    ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                   "[%s] Flush for the write buffer failed: %s",
+                   cfd->GetName().c_str(), s.ToString().c_str());
+  }
+  InstrumentedMutexLock l(&mutex_);
+  cfd->UnrefAndTryDelete();
+}
+
 uint64_t DBImpl::GetMaxTotalWalSize() const {
   mutex_.AssertHeld();
   return mutable_db_options_.max_total_wal_size == 0
@@ -169,6 +169,31 @@ TEST_F(DBTestInPlaceUpdate, InPlaceUpdateCallbackNoAction) {
     ASSERT_EQ(Get(1, "key"), "NOT_FOUND");
   } while (ChangeCompactOptions());
 }
+
+TEST_F(DBTestInPlaceUpdate, InPlaceUpdateAfterDeleteInBatch) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.inplace_update_support = true;
+  options.env = env_;
+  options.allow_concurrent_memtable_write = false;
+  Reopen(options);
+
+  ASSERT_OK(Put("key", "v1"));
+  // The delete must reach the memtable before the put updates it in place
+  WriteBatch batch;
+  ASSERT_OK(batch.Delete("key"));
+  ASSERT_OK(batch.Put("key", "v2"));
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ("v2", Get("key"));
+
+  batch.Clear();
+  ASSERT_OK(batch.Put("other", "v"));
+  ASSERT_OK(batch.Delete("key"));
+  ASSERT_OK(batch.Put("key", "v3"));
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ("v3", Get("key"));
+  ASSERT_EQ("v", Get("other"));
+}
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
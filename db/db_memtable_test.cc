@@ -276,6 +276,368 @@ TEST_F(DBMemTableTest, ConcurrentMergeWrite) {
   delete mem;
 }
 
+#ifndef ROCKSDB_LITE
+TEST_F(DBMemTableTest, PartitionedSkipList) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(NewPartitionedSkipListRepFactory(4));
+  // The memtable switched below is not flushed, which must not stall the
+  // manual flush at the end
+  options.max_write_buffer_number = 4;
+  Reopen(options);
+
+  std::atomic<size_t> num_partitions(0);
+  SyncPoint::GetInstance()->SetCallBack(
+      "PartitionedSkipListRep:NumPartitions", [&](void* arg) {
+        num_partitions.store(*static_cast<size_t*>(arg));
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  // Enough keys for the first memtable to sample a few per partition
+  const int kNumKeys = 20000;
+  auto key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    return std::string(buf);
+  };
+  // The second memtable is created while the first one is still active and
+  // takes its boundaries from the keys the first one sampled. It is then
+  // written by several threads at once.
+  for (int i = 0; i < kNumKeys; i += 2) {
+    ASSERT_OK(Put(key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(dbfull()->TEST_SwitchMemtable());
+  ASSERT_GT(num_partitions.load(), 1U);
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 1 + 2 * t; i < kNumKeys; i += 8) {
+        ASSERT_OK(Put(key(i), "v" + ToString(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(Put(key(10), "new"));
+
+  ASSERT_EQ("v0", Get(key(0)));
+  ASSERT_EQ("new", Get(key(10)));
+  ASSERT_EQ("v1001", Get(key(1001)));
+  ASSERT_EQ("v19999", Get(key(kNumKeys - 1)));
+  ASSERT_EQ("NOT_FOUND", Get(key(kNumKeys)));
+
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(key(i), iter->key().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(kNumKeys, i);
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    ASSERT_EQ(key(--i), iter->key().ToString());
+  }
+  ASSERT_EQ(0, i);
+  iter->Seek(key(2500) + "a");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(key(2501), iter->key().ToString());
+  iter->SeekForPrev(key(2500) + "a");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(key(2500), iter->key().ToString());
+  iter.reset();
+
+  ASSERT_OK(Flush());
+  ASSERT_EQ("new", Get(key(10)));
+  ASSERT_EQ("v2001", Get(key(2001)));
+}
+
+TEST_F(DBMemTableTest, HashVectorLargeBucket) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  // All the keys share one bucket, which ends with many runs of the largest
+  // merged size
+  options.memtable_factory.reset(NewHashVectorRepFactory(1, 8));
+  Reopen(options);
+
+  const int kNumKeys = 3000;
+  auto key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    return std::string(buf);
+  };
+  // out of order, so that every run spans the key space
+  for (int i = 0; i < kNumKeys; i++) {
+    int k = (i * 7) % kNumKeys;
+    ASSERT_OK(Put(key(k), "v" + ToString(k)));
+  }
+  ASSERT_OK(Put(key(10), "new"));
+
+  ASSERT_EQ("v0", Get(key(0)));
+  ASSERT_EQ("new", Get(key(10)));
+  ASSERT_EQ("v1001", Get(key(1001)));
+  ASSERT_EQ("v2999", Get(key(kNumKeys - 1)));
+  ASSERT_EQ("NOT_FOUND", Get(key(kNumKeys)));
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(key(i), iter->key().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(kNumKeys, i);
+  iter.reset();
+
+  ASSERT_OK(Flush());
+  ASSERT_EQ("new", Get(key(10)));
+  ASSERT_EQ("v2001", Get(key(2001)));
+}
+
+TEST_F(DBMemTableTest, HashVector) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  // prefixes of 100 keys each, with small runs so that they get merged
+  options.prefix_extractor.reset(NewFixedPrefixTransform(7));
+  options.memtable_factory.reset(NewHashVectorRepFactory(16, 8));
+  Reopen(options);
+
+  const int kNumKeys = 4000;
+  auto key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    return std::string(buf);
+  };
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = t; i < kNumKeys; i += 4) {
+        ASSERT_OK(Put(key(i), "v" + ToString(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(Put(key(10), "new"));
+  ASSERT_OK(Delete(key(11)));
+
+  for (int round = 0; round < 2; round++) {
+    ASSERT_EQ("v0", Get(key(0)));
+    ASSERT_EQ("new", Get(key(10)));
+    ASSERT_EQ("NOT_FOUND", Get(key(11)));
+    ASSERT_EQ("v1001", Get(key(1001)));
+    ASSERT_EQ("v3999", Get(key(kNumKeys - 1)));
+    ASSERT_EQ("NOT_FOUND", Get(key(kNumKeys)));
+
+    ReadOptions total_order;
+    total_order.total_order_seek = true;
+    std::unique_ptr<Iterator> iter(db_->NewIterator(total_order));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      if (i == 11) {
+        i++;
+      }
+      ASSERT_EQ(key(i), iter->key().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(kNumKeys, i);
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      if (--i == 11) {
+        i--;
+      }
+      ASSERT_EQ(key(i), iter->key().ToString());
+    }
+    ASSERT_EQ(0, i);
+
+    // a prefix iterator sees the keys of the sought prefix only
+    iter.reset(db_->NewIterator(ReadOptions()));
+    iter->Seek(key(2500) + "a");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(key(2501), iter->key().ToString());
+    iter->SeekForPrev(key(2500) + "a");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(key(2500), iter->key().ToString());
+    int count = 0;
+    for (iter->Seek(key(2500)); iter->Valid() && iter->key().starts_with(
+                                                     key(2500).substr(0, 7));
+         iter->Next()) {
+      count++;
+    }
+    ASSERT_EQ(100, count);
+    iter.reset();
+
+    // the second round reads the flushed keys
+    ASSERT_OK(Flush());
+  }
+}
+#endif  // ROCKSDB_LITE
+
+TEST_F(DBMemTableTest, SortedRunInsert) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  Reopen(options);
+
+  auto key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    return std::string(buf);
+  };
+  // One sorted run into an empty memtable
+  WriteBatch batch;
+  for (int i = 0; i < 1000; i += 2) {
+    ASSERT_OK(batch.Put(key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+
+  // Runs between the existing keys, broken by a key that does not increase,
+  // a merge and a range deletion
+  batch.Clear();
+  for (int i = 1; i < 500; i += 2) {
+    ASSERT_OK(batch.Put(key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(batch.Delete(key(100)));
+  ASSERT_OK(batch.SingleDelete(key(102)));
+  ASSERT_OK(batch.Merge(key(104), "m"));
+  ASSERT_OK(batch.Put(key(3), "new"));
+  ASSERT_OK(batch.DeleteRange(key(200), key(300)));
+  for (int i = 501; i < 1000; i += 2) {
+    ASSERT_OK(batch.Put(key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(batch.Put(key(1000), "v1000"));
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+
+  uint64_t num_entries = 0;
+  ASSERT_TRUE(dbfull()->GetIntProperty(
+      DB::Properties::kNumEntriesActiveMemTable, &num_entries));
+  ASSERT_EQ(500 + 250 + 5 + 250 + 1, num_entries);
+  uint64_t num_deletes = 0;
+  ASSERT_TRUE(dbfull()->GetIntProperty(
+      DB::Properties::kNumDeletesActiveMemTable, &num_deletes));
+  ASSERT_EQ(1, num_deletes);
+
+  // The same contents are read back from the memtable, after recovering it
+  // from the WAL and after a flush
+  for (int round = 0; round < 3; round++) {
+    ASSERT_EQ("v0", Get(key(0)));
+    ASSERT_EQ("new", Get(key(3)));
+    ASSERT_EQ("NOT_FOUND", Get(key(100)));
+    ASSERT_EQ("NOT_FOUND", Get(key(102)));
+    ASSERT_EQ("v104,m", Get(key(104)));
+    ASSERT_EQ("NOT_FOUND", Get(key(250)));
+    ASSERT_EQ("v999", Get(key(999)));
+    ASSERT_EQ("v1000", Get(key(1000)));
+
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int count = 0;
+    std::string prev;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+      ASSERT_LT(prev, iter->key().ToString());
+      prev = iter->key().ToString();
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(1001 - 2 - 100, count);
+    iter.reset();
+
+    if (round == 0) {
+      Reopen(options);
+    } else if (round == 1) {
+      ASSERT_OK(Flush());
+    }
+  }
+}
+
+TEST_F(DBMemTableTest, HotKeyCoalescing) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.memtable_hot_key_slots = 1024;
+  options.avoid_flush_during_recovery = true;
+  options.statistics = CreateDBStatistics();
+  Reopen(options);
+
+  auto num_entries = [&]() {
+    uint64_t n = 0;
+    EXPECT_TRUE(dbfull()->GetIntProperty(
+        DB::Properties::kNumEntriesActiveMemTable, &n));
+    return n;
+  };
+  auto value = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "value%04d", i);
+    return std::string(buf);
+  };
+
+  // Overwrites of a key by one batch take a single entry
+  WriteBatch batch;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(batch.Put("hot", value(i)));
+    ASSERT_OK(batch.Put("other", value(i)));
+  }
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ(2, num_entries());
+  ASSERT_EQ(198, TestGetTickerCount(options, NUMBER_KEYS_UPDATED));
+  ASSERT_EQ(value(99), Get("hot"));
+
+  // A version of an earlier write is kept for the snapshot that sees it
+  const Snapshot* snapshot = db_->GetSnapshot();
+  batch.Clear();
+  for (int i = 100; i < 200; i++) {
+    ASSERT_OK(batch.Put("hot", value(i)));
+  }
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ(3, num_entries());
+  ASSERT_EQ(value(199), Get("hot"));
+  ASSERT_EQ(value(99), Get("hot", snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Puts are not coalesced across a deletion or a range deletion, or with a
+  // larger value
+  batch.Clear();
+  ASSERT_OK(batch.Put("hot", "a"));
+  ASSERT_OK(batch.Delete("hot"));
+  ASSERT_OK(batch.Put("hot", "b"));
+  ASSERT_OK(batch.Put("hot", "c"));
+  ASSERT_OK(batch.DeleteRange("hot", "hot0"));
+  ASSERT_OK(batch.Put("hot", "d"));
+  ASSERT_OK(batch.Put("other", value(0)));
+  ASSERT_OK(batch.Put("other", value(0) + "longer"));
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  ASSERT_EQ(3 + 7, num_entries());
+  ASSERT_EQ("d", Get("hot"));
+  ASSERT_EQ(value(0) + "longer", Get("other"));
+
+  // Recovery coalesces the same puts
+  Reopen(options);
+  ASSERT_EQ(10, num_entries());
+  ASSERT_EQ("d", Get("hot"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("d", Get("hot"));
+  ASSERT_EQ(value(0) + "longer", Get("other"));
+
+  // Concurrent writers coalesce the puts of their own batches
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      for (int round = 0; round < 100; round++) {
+        WriteBatch b;
+        for (int i = 0; i < 10; i++) {
+          ASSERT_OK(b.Put("key" + ToString(t), value(round * 10 + i)));
+        }
+        ASSERT_OK(dbfull()->Write(WriteOptions(), &b));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(4 * 100, num_entries());
+  for (int t = 0; t < 4; t++) {
+    ASSERT_EQ(value(999), Get("key" + ToString(t)));
+  }
+}
+
 TEST_F(DBMemTableTest, InsertWithHint) {
   Options options;
   options.allow_concurrent_memtable_write = false;
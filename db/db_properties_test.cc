@@ -1040,6 +1040,54 @@ TEST_F(DBPropertiesTest, EstimatePendingCompBytes) {
   ASSERT_EQ(int_num, 0U);
 }
 
+TEST_F(DBPropertiesTest, WriteStallController) {
+  Options options = CurrentOptions();
+  options.level0_file_num_compaction_trigger = 2;
+  options.level0_slowdown_writes_trigger = 6;
+  options.level0_stop_writes_trigger = 100;
+  Reopen(options);
+  std::map<std::string, std::string> values;
+  ASSERT_FALSE(
+      db_->GetMapProperty(DB::Properties::kWriteStallController, &values));
+
+  env_->SetBackgroundThreads(1, Env::LOW);
+  test::SleepingBackgroundTask sleeping_task_low;
+  env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask, &sleeping_task_low,
+                 Env::Priority::LOW);
+  options.adaptive_write_stall = true;
+  Reopen(options);
+  ASSERT_TRUE(
+      db_->GetMapProperty(DB::Properties::kWriteStallController, &values));
+  ASSERT_EQ("0", values["engaged"]);
+
+  // Writes are throttled once L0 is past the target fraction of the slowdown
+  // trigger, before the trigger itself is reached
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(Put("key" + ToString(i), "value"));
+    ASSERT_OK(Flush());
+  }
+  ASSERT_EQ(5, NumTableFilesAtLevel(0));
+  ASSERT_TRUE(
+      db_->GetMapProperty(DB::Properties::kWriteStallController, &values));
+  ASSERT_EQ("1", values["engaged"]);
+  ASSERT_GT(std::stod(values["pressure"]), WriteRateController::kTargetPressure);
+  uint64_t delayed_write_rate = 0;
+  ASSERT_TRUE(db_->GetIntProperty(DB::Properties::kActualDelayedWriteRate,
+                                  &delayed_write_rate));
+  ASSERT_GT(delayed_write_rate, 0);
+  ASSERT_EQ(std::stoull(values["write-rate"]), delayed_write_rate);
+  std::string value;
+  ASSERT_TRUE(db_->GetProperty(DB::Properties::kWriteStallController, &value));
+  ASSERT_NE(std::string::npos, value.find("engaged: 1\n"));
+
+  sleeping_task_low.WakeUp();
+  sleeping_task_low.WaitUntilDone();
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  ASSERT_TRUE(
+      db_->GetMapProperty(DB::Properties::kWriteStallController, &values));
+  ASSERT_LT(std::stod(values["pressure"]), WriteRateController::kTargetPressure);
+}
+
 TEST_F(DBPropertiesTest, EstimateCompressionRatio) {
   if (!Snappy_Supported()) {
     return;
@@ -618,6 +618,121 @@ TEST_F(DBTest2, SharedWriteBufferLimitAcrossDB) {
   ROCKSDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
 }
 
+TEST_F(DBTest2, SharedWriteBufferFlushPolicyAcrossDB) {
+  std::string dbname2 = test::PerThreadDBPath("db_shared_wb_policy_db2");
+  Options options = CurrentOptions();
+  options.arena_block_size = 4096;
+  // Avoid undeterministic value by malloc_usable_size();
+  // Force arena block size to 1
+  ROCKSDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "Arena::Arena:0", [&](void* arg) {
+        size_t* block_size = static_cast<size_t*>(arg);
+        *block_size = 1;
+      });
+
+  ROCKSDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "Arena::AllocateNewBlock:0", [&](void* arg) {
+        std::pair<size_t*, size_t*>* pair =
+            static_cast<std::pair<size_t*, size_t*>*>(arg);
+        *std::get<0>(*pair) = *std::get<1>(*pair);
+      });
+  ROCKSDB_NAMESPACE::SyncPoint::GetInstance()->EnableProcessing();
+
+  options.write_buffer_size = 500000;  // this is never hit
+  // The soft limit is about 105000.
+  options.write_buffer_manager.reset(
+      new WriteBufferManager(120000, {}, NewLargestMemTableFlushPolicy()));
+  CreateAndReopenWithCF({"cf1"}, options);
+
+  ASSERT_OK(DestroyDB(dbname2, options));
+  DB* db2 = nullptr;
+  ASSERT_OK(DB::Open(options, dbname2, &db2));
+
+  WriteOptions wo;
+  wo.disableWAL = true;
+
+  // Two quiet column families in this DB and a busy one in DB2
+  ASSERT_OK(Put(0, Key(1), DummyString(10000), wo));
+  ASSERT_OK(Put(1, Key(1), DummyString(10000), wo));
+  ASSERT_OK(db2->Put(wo, Key(1), DummyString(50000)));
+  ASSERT_OK(db2->Put(wo, Key(2), DummyString(40000)));
+
+  // The write buffer is full. A write to this DB flushes the largest
+  // memtable, which is in DB2, rather than its own oldest one.
+  ASSERT_OK(Put(0, Key(2), DummyString(1), wo));
+  for (int i = 0; i < 1000 && GetNumberOfSstFilesForColumnFamily(
+                                  db2, "default") == 0;
+       i++) {
+    env_->SleepForMicroseconds(10000);
+  }
+  ASSERT_OK(static_cast<DBImpl*>(db2)->TEST_WaitForFlushMemTable());
+  ASSERT_EQ(GetNumberOfSstFilesForColumnFamily(db2, "default"),
+            static_cast<uint64_t>(1));
+  ASSERT_EQ(GetNumberOfSstFilesForColumnFamily(db_, "default") +
+                GetNumberOfSstFilesForColumnFamily(db_, "cf1"),
+            static_cast<uint64_t>(0));
+
+  std::string value;
+  ASSERT_OK(db2->Get(ReadOptions(), Key(1), &value));
+  ASSERT_EQ(DummyString(50000), value);
+  ASSERT_EQ(DummyString(10000), Get(1, Key(1)));
+
+  delete db2;
+  ASSERT_OK(DestroyDB(dbname2, options));
+
+  ROCKSDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
+}
+
+TEST_F(DBTest2, WriteBufferManagerStallsLargestDB) {
+  std::string dbname2 = test::PerThreadDBPath("db_shared_wb_stall_db2");
+  Options options = CurrentOptions();
+  options.write_buffer_size = 500000;  // this is never hit
+  options.write_buffer_manager.reset(
+      new WriteBufferManager(120000, {}, nullptr, true /* allow_stall */));
+  Reopen(options);
+
+  ASSERT_OK(DestroyDB(dbname2, options));
+  DB* db2 = nullptr;
+  ASSERT_OK(DB::Open(options, dbname2, &db2));
+
+  // Hold off the flushes so that the memory stays over the limit
+  test::SleepingBackgroundTask sleeping_task_high;
+  env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask,
+                 &sleeping_task_high, Env::Priority::HIGH);
+  sleeping_task_high.WaitUntilSleeping();
+
+  WriteOptions wo;
+  wo.disableWAL = true;
+  ASSERT_OK(db2->Put(wo, Key(1), DummyString(130000)));
+
+  // DB2 uses all of the write buffer, so its writes stall while the writes
+  // to this DB go on
+  wo.no_slowdown = true;
+  ASSERT_TRUE(db2->Put(wo, Key(2), "v").IsIncomplete());
+  ASSERT_OK(Put(Key(1), "v", wo));
+
+  wo.no_slowdown = false;
+  std::atomic<bool> done(false);
+  port::Thread writer([&] {
+    ASSERT_OK(db2->Put(wo, Key(2), "v"));
+    done = true;
+  });
+  env_->SleepForMicroseconds(100000);
+  ASSERT_FALSE(done);
+  ASSERT_OK(Put(Key(2), "v", wo));
+
+  sleeping_task_high.WakeUp();
+  sleeping_task_high.WaitUntilDone();
+  writer.join();
+  ASSERT_TRUE(done);
+  std::string value;
+  ASSERT_OK(db2->Get(ReadOptions(), Key(2), &value));
+  ASSERT_EQ("v", value);
+
+  delete db2;
+  ASSERT_OK(DestroyDB(dbname2, options));
+}
+
 TEST_F(DBTest2, TestWriteBufferNoLimitWithCache) {
   Options options = CurrentOptions();
   options.arena_block_size = 4096;
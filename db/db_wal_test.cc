@@ -1021,6 +1021,32 @@ TEST_F(DBWALTest, RecoverWithLargeLog) {
   } while (ChangeWalOptions());
 }
 
+TEST_F(DBWALTest, RecoverLargeBatchWithThreads) {
+  Options options = CurrentOptions();
+  options.avoid_flush_during_recovery = true;
+  CreateAndReopenWithCF({"one", "two"}, options);
+  WriteBatch batch;
+  const int kNumKeys = 3000;
+  for (int i = 0; i < kNumKeys; i++) {
+    // every key is written twice, the later write must win
+    ASSERT_OK(batch.Put(handles_[i % 3], Key(i), "a" + ToString(i)));
+    ASSERT_OK(batch.Put(handles_[i % 3], Key(i), "b" + ToString(i)));
+  }
+  ASSERT_OK(batch.Delete(handles_[1], Key(1)));
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  SequenceNumber last_sequence = dbfull()->GetLatestSequenceNumber();
+
+  for (int threads : {1, 2, 8}) {
+    options.wal_recovery_threads = threads;
+    ReopenWithColumnFamilies({"default", "one", "two"}, options);
+    ASSERT_EQ(last_sequence, dbfull()->GetLatestSequenceNumber());
+    for (int i = 0; i < kNumKeys; i++) {
+      std::string expected = i == 1 ? "NOT_FOUND" : "b" + ToString(i);
+      ASSERT_EQ(expected, Get(i % 3, Key(i)));
+    }
+  }
+}
+
 // In https://reviews.facebook.net/D20661 we change
 // recovery behavior: previously for each log file each column family
 // memtable was flushed, even it was empty. Now it's changed:
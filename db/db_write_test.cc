@@ -451,6 +451,271 @@ TEST_P(DBWriteTest, ConcurrentlyDisabledWAL) {
     ASSERT_LE(bytes_num, 1024 * 100);
 }
 
+// A WAL file that supports in place appends by staging the reserved bytes
+// and appending them to the real file on commit.
+class InPlaceWALFile : public FSWritableFileWrapper {
+ public:
+  InPlaceWALFile(std::unique_ptr<FSWritableFile>&& target,
+                 std::atomic<int>* reservations)
+      : FSWritableFileWrapper(target.get()),
+        file_(std::move(target)),
+        reservations_(reservations) {}
+
+  IOStatus ReserveAppend(size_t n, char** buf, const IOOptions& /*options*/,
+                         IODebugContext* /*dbg*/) override {
+    reserved_.resize(n);
+    *buf = &reserved_[0];
+    (*reservations_)++;
+    return IOStatus::OK();
+  }
+
+  void CopyToReserved(char* dst, const Slice& data) override {
+    memcpy(dst, data.data(), data.size());
+  }
+
+  IOStatus CommitReserved(size_t n, const IOOptions& options,
+                          IODebugContext* dbg) override {
+    EXPECT_EQ(reserved_.size(), n);
+    return file_->Append(Slice(reserved_.data(), n), options, dbg);
+  }
+
+ private:
+  std::unique_ptr<FSWritableFile> file_;
+  std::string reserved_;
+  std::atomic<int>* reservations_;
+};
+
+class InPlaceWALFileSystem : public FileSystemWrapper {
+ public:
+  explicit InPlaceWALFileSystem(const std::shared_ptr<FileSystem>& base)
+      : FileSystemWrapper(base) {}
+
+  const char* Name() const override { return "InPlaceWALFileSystem"; }
+
+  IOStatus NewWritableFile(const std::string& fname,
+                           const FileOptions& file_opts,
+                           std::unique_ptr<FSWritableFile>* result,
+                           IODebugContext* dbg) override {
+    IOStatus s = target()->NewWritableFile(fname, file_opts, result, dbg);
+    if (s.ok() && EndsWith(fname, ".log")) {
+      result->reset(new InPlaceWALFile(std::move(*result), &reservations_));
+    }
+    return s;
+  }
+
+  std::atomic<int> reservations_{0};
+};
+
+TEST_P(DBWriteTest, ParallelWALWrite) {
+  constexpr int kNumThreads = 4;
+  auto fs = std::make_shared<InPlaceWALFileSystem>(env_->GetFileSystem());
+  std::unique_ptr<Env> env(new CompositeEnvWrapper(env_, fs));
+  Options options = GetOptions();
+  options.env = env.get();
+  options.enable_parallel_wal_write = true;
+  Reopen(options);
+
+  // Make all threads join the same batch group, the first and the last
+  // batches are too small to be written by their own thread.
+  std::atomic<int> ready_count{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "WriteThread::JoinBatchGroup:Wait", [&](void* arg) {
+        ready_count++;
+        auto* w = reinterpret_cast<WriteThread::Writer*>(arg);
+        if (w->state == WriteThread::STATE_GROUP_LEADER) {
+          while (ready_count < kNumThreads) {
+            // busy waiting
+          }
+        }
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < kNumThreads; i++) {
+    values.push_back(rnd.RandomString(i == 0 || i == kNumThreads - 1
+                                          ? 100
+                                          : 40000 + i * 10000));
+  }
+  std::vector<port::Thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&, i] {
+      WriteBatch batch;
+      ASSERT_OK(batch.Put("key" + ToString(i), values[i]));
+      ASSERT_OK(batch.Put("other" + ToString(i), ToString(i)));
+      ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  if (GetParam() == DBTestBase::kDefault) {
+    ASSERT_GT(fs->reservations_.load(), 0);
+  }
+  ASSERT_EQ(static_cast<SequenceNumber>(2 * kNumThreads),
+            dbfull()->GetLatestSequenceNumber());
+
+  // every batch is recovered from its own record
+  Reopen(options);
+  ASSERT_EQ(static_cast<SequenceNumber>(2 * kNumThreads),
+            dbfull()->GetLatestSequenceNumber());
+  for (int i = 0; i < kNumThreads; i++) {
+    ASSERT_EQ(values[i], Get("key" + ToString(i)));
+    ASSERT_EQ(ToString(i), Get("other" + ToString(i)));
+  }
+  Close();
+}
+
+TEST_P(DBWriteTest, WriteAsync) {
+  Options options = GetOptions();
+  Reopen(options);
+  std::atomic<int> completed{0};
+  auto callback = [&](Status s) {
+    ASSERT_OK(s);
+    completed++;
+  };
+  auto wait_for_completed = [&](int n) {
+    while (completed.load() < n) {
+      env_->SleepForMicroseconds(1000);
+    }
+  };
+
+  if (GetParam() == DBTestBase::kDefault) {
+    // Async writes queued behind a leader return before it commits them
+    std::atomic<bool> leader_entered{false};
+    std::atomic<bool> queued{false};
+    SyncPoint::GetInstance()->SetCallBack(
+        "DBImpl::WriteImpl:BeforeLeaderEnters", [&](void*) {
+          if (!leader_entered.exchange(true)) {
+            while (!queued.load()) {
+              // busy waiting
+            }
+          }
+        });
+    SyncPoint::GetInstance()->EnableProcessing();
+    port::Thread leader(
+        [&] { ASSERT_OK(dbfull()->Put(WriteOptions(), "leader", "v")); });
+    while (!leader_entered.load()) {
+      env_->SleepForMicroseconds(1000);
+    }
+    WriteBatch batch1;
+    WriteBatch batch2;
+    ASSERT_OK(batch1.Put("async1", "v1"));
+    ASSERT_OK(batch2.Put("async2", "v2"));
+    dbfull()->WriteAsync(WriteOptions(), &batch1, callback);
+    dbfull()->WriteAsync(WriteOptions(), &batch2, callback);
+    ASSERT_EQ(0, completed.load());
+    queued = true;
+    leader.join();
+    wait_for_completed(2);
+    SyncPoint::GetInstance()->DisableProcessing();
+    SyncPoint::GetInstance()->ClearAllCallBacks();
+    ASSERT_EQ("v", Get("leader"));
+    ASSERT_EQ("v1", Get("async1"));
+    ASSERT_EQ("v2", Get("async2"));
+    completed = 0;
+  }
+
+  // Async writes mixed with blocking ones, their groups are led by the
+  // writing threads and the async write leader in turn
+  constexpr int kNumThreads = 4;
+  constexpr int kNumWrites = 200;
+  std::vector<std::unique_ptr<WriteBatch>> batches;
+  for (int i = 0; i < kNumThreads * kNumWrites; i++) {
+    batches.emplace_back(new WriteBatch());
+    ASSERT_OK(batches.back()->Put("key" + ToString(i), ToString(i)));
+  }
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = t * kNumWrites; i < (t + 1) * kNumWrites; i++) {
+        if (i % 4 == 0) {
+          ASSERT_OK(dbfull()->Write(WriteOptions(), batches[i].get()));
+          completed++;
+        } else {
+          dbfull()->WriteAsync(WriteOptions(), batches[i].get(), callback);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  wait_for_completed(kNumThreads * kNumWrites);
+  for (int i = 0; i < kNumThreads * kNumWrites; i++) {
+    ASSERT_EQ(ToString(i), Get("key" + ToString(i)));
+  }
+
+  // Invalid async writes fail through the callback
+  WriteOptions write_options;
+  write_options.sync = true;
+  write_options.disableWAL = true;
+  Status status;
+  dbfull()->WriteAsync(write_options, batches[0].get(),
+                       [&](Status s) { status = s; });
+  ASSERT_TRUE(status.IsInvalidArgument());
+
+  // Closing waits for the pending async writes
+  completed = 0;
+  for (int i = 0; i < kNumWrites; i++) {
+    dbfull()->WriteAsync(WriteOptions(), batches[i].get(), callback);
+  }
+  Close();
+  ASSERT_EQ(kNumWrites, completed.load());
+}
+
+TEST_P(DBWriteTest, BatchInsertInRanges) {
+  Options options = GetOptions();
+  options.batch_insert_threads = 4;
+  Reopen(options);
+  std::atomic<int> ranges{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::ParallelMemTableInsert:InsertRange",
+      [&](void*) { ranges++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  // Later entries of a key must shadow earlier ones of other ranges
+  const int kNumKeys = 10000;
+  WriteBatch batch(0, 0, 0, 8 /* protection_bytes_per_key */);
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_OK(batch.Put(Key(i), "v" + ToString(i)));
+  }
+  ASSERT_OK(batch.Put(Key(kNumKeys), "v"));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(batch.Put(Key(i), "new"));
+    ASSERT_OK(batch.Delete(Key(100 + i)));
+  }
+  ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+  // a small batch is inserted by its writer alone
+  const int small_batch_ranges = ranges.load();
+  ASSERT_OK(Put("small", "v"));
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  if (GetParam() != DBTestBase::kPipelinedWrite) {
+    ASSERT_GT(ranges.load(), 1);
+  }
+  ASSERT_EQ(small_batch_ranges, ranges.load());
+  ASSERT_EQ(static_cast<SequenceNumber>(kNumKeys + 1 + 200 + 1),
+            dbfull()->GetLatestSequenceNumber());
+
+  auto verify = [&]() {
+    ASSERT_EQ("new", Get(Key(0)));
+    ASSERT_EQ("new", Get(Key(99)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(100)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(199)));
+    ASSERT_EQ("v200", Get(Key(200)));
+    ASSERT_EQ("v9999", Get(Key(kNumKeys - 1)));
+    ASSERT_EQ("v", Get(Key(kNumKeys)));
+    ASSERT_EQ("v", Get("small"));
+  };
+  verify();
+  ASSERT_OK(Flush());
+  verify();
+  Reopen(options);
+  verify();
+}
+
 INSTANTIATE_TEST_CASE_P(DBWriteTestInstance, DBWriteTest,
                         testing::Values(DBTestBase::kDefault,
                                         DBTestBase::kConcurrentWALWrites,
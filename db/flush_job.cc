@@ -458,6 +458,11 @@ Status FlushJob::WriteLevel0Table() {
                    meta_.file_checksum, meta_.file_checksum_func_name);
 
     edit_->SetBlobFileAdditions(std::move(blob_file_additions));
+    // A persistent memtable drops its entries on recovery once the file is
+    // live, even if the crash hits before MarkFlushed()
+    for (MemTable* m : mems_) {
+      m->MarkFlushPending(meta_.fd.GetNumber());
+    }
   }
 #ifndef ROCKSDB_LITE
   // Piggyback FlushJobInfo on the first first flushed memtable.
@@ -483,6 +488,10 @@ Status FlushJob::WriteLevel0Table() {
 
   RecordTimeToHistogram(stats_, FLUSH_TIME, stats.micros);
   cfd_->internal_stats()->AddCompactionStats(0 /* level */, thread_pri_, stats);
+  if (has_output) {
+    cfd_->internal_stats()->AddPathStats(meta_.fd.GetPathId(),
+                                         meta_.fd.GetFileSize());
+  }
   cfd_->internal_stats()->AddCFStats(
       InternalStats::BYTES_FLUSHED,
       stats.bytes_written + stats.bytes_written_blob);
@@ -220,6 +220,7 @@ static const std::string cfstats_no_file_histogram =
 static const std::string cf_file_histogram = "cf-file-histogram";
 static const std::string dbstats = "dbstats";
 static const std::string levelstats = "levelstats";
+static const std::string pathstats = "pathstats";
 static const std::string num_immutable_mem_table = "num-immutable-mem-table";
 static const std::string num_immutable_mem_table_flushed =
     "num-immutable-mem-table-flushed";
@@ -267,6 +268,7 @@ static const std::string num_running_flushes = "num-running-flushes";
 static const std::string actual_delayed_write_rate =
     "actual-delayed-write-rate";
 static const std::string is_write_stopped = "is-write-stopped";
+static const std::string write_stall_controller = "write-stall-controller";
 static const std::string estimate_oldest_key_time = "estimate-oldest-key-time";
 static const std::string block_cache_capacity = "block-cache-capacity";
 static const std::string block_cache_usage = "block-cache-usage";
@@ -286,6 +288,7 @@ const std::string DB::Properties::kCFFileHistogram =
     rocksdb_prefix + cf_file_histogram;
 const std::string DB::Properties::kDBStats = rocksdb_prefix + dbstats;
 const std::string DB::Properties::kLevelStats = rocksdb_prefix + levelstats;
+const std::string DB::Properties::kPathStats = rocksdb_prefix + pathstats;
 const std::string DB::Properties::kNumImmutableMemTable =
     rocksdb_prefix + num_immutable_mem_table;
 const std::string DB::Properties::kNumImmutableMemTableFlushed =
@@ -351,6 +354,8 @@ const std::string DB::Properties::kActualDelayedWriteRate =
     rocksdb_prefix + actual_delayed_write_rate;
 const std::string DB::Properties::kIsWriteStopped =
     rocksdb_prefix + is_write_stopped;
+const std::string DB::Properties::kWriteStallController =
+    rocksdb_prefix + write_stall_controller;
 const std::string DB::Properties::kEstimateOldestKeyTime =
     rocksdb_prefix + estimate_oldest_key_time;
 const std::string DB::Properties::kBlockCacheCapacity =
@@ -372,6 +377,8 @@ const std::unordered_map<std::string, DBPropertyInfo>
           nullptr, nullptr}},
         {DB::Properties::kLevelStats,
          {false, &InternalStats::HandleLevelStats, nullptr, nullptr, nullptr}},
+        {DB::Properties::kPathStats,
+         {false, &InternalStats::HandlePathStats, nullptr, nullptr, nullptr}},
         {DB::Properties::kStats,
          {false, &InternalStats::HandleStats, nullptr, nullptr, nullptr}},
         {DB::Properties::kCFStats,
@@ -486,6 +493,9 @@ const std::unordered_map<std::string, DBPropertyInfo>
         {DB::Properties::kIsWriteStopped,
          {false, nullptr, &InternalStats::HandleIsWriteStopped, nullptr,
           nullptr}},
+        {DB::Properties::kWriteStallController,
+         {false, &InternalStats::HandleWriteStallController, nullptr,
+          &InternalStats::HandleWriteStallControllerMap, nullptr}},
         {DB::Properties::kEstimateOldestKeyTime,
          {false, nullptr, &InternalStats::HandleEstimateOldestKeyTime, nullptr,
           nullptr}},
@@ -592,6 +602,70 @@ bool InternalStats::HandleLevelStats(std::string* value, Slice /*suffix*/) {
   return true;
 }
 
+bool InternalStats::HandlePathStats(std::string* value, Slice /*suffix*/) {
+  char buf[1000];
+  const auto& cf_paths = cfd_->ioptions()->cf_paths;
+  std::vector<int> num_files(cf_paths.size(), 0);
+  std::vector<uint64_t> num_bytes(cf_paths.size(), 0);
+  const auto* vstorage = cfd_->current()->storage_info();
+  for (int level = 0; level < number_levels_; level++) {
+    for (const auto* f : vstorage->LevelFiles(level)) {
+      uint32_t path_id = f->fd.GetPathId();
+      if (path_id < cf_paths.size()) {
+        num_files[path_id]++;
+        num_bytes[path_id] += f->fd.GetFileSize();
+      }
+    }
+  }
+  snprintf(buf, sizeof(buf),
+           "Path Files Size(MB) Write(MB) WFiles Dir\n"
+           "----------------------------------------\n");
+  value->append(buf);
+
+  for (size_t p = 0; p < cf_paths.size(); p++) {
+    PathStats written;
+    if (p < path_stats_.size()) {
+      written = path_stats_[p];
+    }
+    snprintf(buf, sizeof(buf), "%4" ROCKSDB_PRIszt " %5d %8.0f %9.0f %6" PRIu64
+             " %s\n", p, num_files[p], num_bytes[p] / kMB,
+             written.bytes_written / kMB, written.num_files_written,
+             cf_paths[p].path.c_str());
+    value->append(buf);
+  }
+  return true;
+}
+
+bool InternalStats::HandleWriteStallControllerMap(
+    std::map<std::string, std::string>* values, Slice /*suffix*/) {
+  if (!cfd_->ioptions()->adaptive_write_stall) {
+    return false;
+  }
+  const WriteRateController& controller = cfd_->write_rate_controller();
+  (*values)["engaged"] = ToString(controller.engaged() ? 1 : 0);
+  (*values)["write-rate"] = ToString(controller.write_rate());
+  (*values)["pressure"] = ToString(controller.pressure());
+  (*values)["compaction-debt"] = ToString(controller.compaction_needed_bytes());
+  (*values)["debt-slope"] =
+      ToString(static_cast<int64_t>(controller.debt_slope()));
+  (*values)["drain-rate"] =
+      ToString(static_cast<uint64_t>(controller.drain_rate()));
+  (*values)["integral"] = ToString(controller.integral());
+  return true;
+}
+
+bool InternalStats::HandleWriteStallController(std::string* value,
+                                               Slice suffix) {
+  std::map<std::string, std::string> values;
+  if (!HandleWriteStallControllerMap(&values, suffix)) {
+    return false;
+  }
+  for (const auto& v : values) {
+    value->append(v.first + ": " + v.second + "\n");
+  }
+  return true;
+}
+
 bool InternalStats::HandleStats(std::string* value, Slice suffix) {
   if (!HandleCFStats(value, suffix)) {
     return false;
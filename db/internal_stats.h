@@ -372,6 +372,7 @@ class InternalStats {
       h.Clear();
     }
     blob_file_read_latency_.Clear();
+    path_stats_.clear();
     cf_stats_snapshot_.Clear();
     db_stats_snapshot_.Clear();
     bg_error_count_ = 0;
@@ -388,6 +389,30 @@ class InternalStats {
     comp_stats_[level].bytes_moved += amount;
   }
 
+  // Total bytes written into table files by flushes and compactions.
+  uint64_t GetBytesWritten() const {
+    uint64_t bytes_written = 0;
+    for (const auto& comp_stat : comp_stats_) {
+      bytes_written += comp_stat.bytes_written;
+    }
+    return bytes_written;
+  }
+
+  // Table files written by flushes and compactions into one of the column
+  // family's paths, i.e. into one storage tier.
+  struct PathStats {
+    uint64_t bytes_written = 0;
+    uint64_t num_files_written = 0;
+  };
+
+  void AddPathStats(uint32_t path_id, uint64_t bytes_written) {
+    if (path_id >= path_stats_.size()) {
+      path_stats_.resize(path_id + 1);
+    }
+    path_stats_[path_id].bytes_written += bytes_written;
+    path_stats_[path_id].num_files_written++;
+  }
+
   void AddCFStats(InternalCFStatsType type, uint64_t value) {
     cf_stats_value_[type] += value;
     ++cf_stats_count_[type];
@@ -467,6 +492,8 @@ class InternalStats {
   std::vector<CompactionStats> comp_stats_by_pri_;
   std::vector<HistogramImpl> file_read_latency_;
   HistogramImpl blob_file_read_latency_;
+  // Per-path write stats, indexed by path id
+  std::vector<PathStats> path_stats_;
 
   // Used to compute per-interval statistics
   struct CFStatsSnapshot {
@@ -561,6 +588,10 @@ class InternalStats {
   bool HandleNumFilesAtLevel(std::string* value, Slice suffix);
   bool HandleCompressionRatioAtLevelPrefix(std::string* value, Slice suffix);
   bool HandleLevelStats(std::string* value, Slice suffix);
+  bool HandlePathStats(std::string* value, Slice suffix);
+  bool HandleWriteStallController(std::string* value, Slice suffix);
+  bool HandleWriteStallControllerMap(std::map<std::string, std::string>* values,
+                                     Slice suffix);
   bool HandleStats(std::string* value, Slice suffix);
   bool HandleCFMapStats(std::map<std::string, std::string>* compaction_stats,
                         Slice suffix);
@@ -712,6 +743,10 @@ class InternalStats {
 
   void IncBytesMoved(int /*level*/, uint64_t /*amount*/) {}
 
+  uint64_t GetBytesWritten() const { return 0; }
+
+  void AddPathStats(uint32_t /*path_id*/, uint64_t /*bytes_written*/) {}
+
   void AddCFStats(InternalCFStatsType /*type*/, uint64_t /*value*/) {}
 
   void AddDBStats(InternalDBStatsType /*type*/, uint64_t /*value*/,
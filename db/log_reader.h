@@ -62,6 +62,9 @@ class Reader {
   // "*scratch" as temporary storage.  The contents filled in *record
   // will only be valid until the next mutating operation on this
   // reader or the next mutation to *scratch.
+  // A record stored in a single physical record is not copied: if the file
+  // returns data without copying it to the read buffer, e.g. from an mmap,
+  // *record points straight into the file's memory.
   virtual bool ReadRecord(Slice* record, std::string* scratch,
                           WALRecoveryMode wal_recovery_mode =
                               WALRecoveryMode::kTolerateCorruptedTailRecords);
@@ -11,6 +11,7 @@
 #include "db/log_writer.h"
 #include "file/sequence_file_reader.h"
 #include "file/writable_file_writer.h"
+#include "port/port.h"
 #include "rocksdb/env.h"
 #include "test_util/testharness.h"
 #include "test_util/testutil.h"
@@ -179,6 +180,28 @@ class LogTest : public ::testing::TestWithParam<std::tuple<int, bool>> {
     ASSERT_OK(writer_->AddRecord(Slice(msg)));
   }
 
+  // Writes the records through a single reservation, each one from its own
+  // thread.
+  void WriteReserved(const std::vector<std::string>& records) {
+    writer_->BeginReservation();
+    std::vector<Writer::ReservedRecord> reserved;
+    for (const auto& record : records) {
+      reserved.push_back(writer_->ReserveRecord(record.size()));
+    }
+    char* buf = nullptr;
+    ASSERT_OK(writer_->MapReservation(&buf));
+    std::vector<port::Thread> threads;
+    for (size_t i = 0; i < records.size(); i++) {
+      threads.emplace_back([&, i] {
+        writer_->WriteReservedRecord(buf, reserved[i], records[i]);
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    ASSERT_OK(writer_->CommitReservation(buf));
+  }
+
   size_t WrittenBytes() const {
     return dest_contents().size();
   }
@@ -285,6 +308,26 @@ TEST_P(LogTest, Fragmentation) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_P(LogTest, ReservedRecords) {
+  int header_size =
+      std::get<0>(GetParam()) ? kRecyclableHeaderSize : kHeaderSize;
+  Write("before");
+  // the third record starts after a 3 byte trailer
+  std::vector<std::string> records = {
+      "small", BigString("fill", kBlockSize - 3 * header_size - 6 - 5 - 3),
+      "", BigString("large", 100000), "last"};
+  WriteReserved(records);
+  Write("after");
+
+  ASSERT_EQ("before", Read());
+  for (const auto& record : records) {
+    ASSERT_EQ(record, Read());
+  }
+  ASSERT_EQ("after", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
 TEST_P(LogTest, MarginalTrailer) {
   // Make a trailer that is exactly the same length as an empty record.
   int header_size =
@@ -24,6 +24,8 @@ Writer::Writer(std::unique_ptr<WritableFileWriter>&& dest, uint64_t log_number,
       block_offset_(0),
       log_number_(log_number),
       recycle_log_files_(recycle_log_files),
+      reserved_bytes_(0),
+      reserved_block_offset_(0),
       manual_flush_(manual_flush) {
   for (int i = 0; i <= kMaxRecordType; i++) {
     char t = static_cast<char>(i);
@@ -117,8 +119,22 @@ bool Writer::TEST_BufferIsEmpty() { return dest_->TEST_BufferIsEmpty(); }
 IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   assert(n <= 0xffff);  // Must fit in two bytes
 
-  size_t header_size;
   char buf[kRecyclableHeaderSize];
+  size_t header_size = EncodeHeader(t, ptr, n, buf);
+  assert(block_offset_ + header_size + n <= kBlockSize);
+
+  // Write the header and the payload
+  IOStatus s = dest_->Append(Slice(buf, header_size));
+  if (s.ok()) {
+    s = dest_->Append(Slice(ptr, n));
+  }
+  block_offset_ += header_size + n;
+  return s;
+}
+
+size_t Writer::EncodeHeader(RecordType t, const char* ptr, size_t n,
+                            char* buf) const {
+  size_t header_size;
 
   // Format the header
   buf[4] = static_cast<char>(n & 0xff);
@@ -128,11 +144,9 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   uint32_t crc = type_crc_[t];
   if (t < kRecyclableFullType) {
     // Legacy record format
-    assert(block_offset_ + kHeaderSize + n <= kBlockSize);
     header_size = kHeaderSize;
   } else {
     // Recyclable record format
-    assert(block_offset_ + kRecyclableHeaderSize + n <= kBlockSize);
     header_size = kRecyclableHeaderSize;
 
     // Only encode low 32-bits of the 64-bit log number.  This means
@@ -150,13 +164,99 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   TEST_SYNC_POINT_CALLBACK("LogWriter::EmitPhysicalRecord:BeforeEncodeChecksum",
                            &crc);
   EncodeFixed32(buf, crc);
+  return header_size;
+}
 
-  // Write the header and the payload
-  IOStatus s = dest_->Append(Slice(buf, header_size));
+template <typename F>
+size_t Writer::ForEachFragment(size_t block_offset, size_t size,
+                               F emit) const {
+  const size_t header_size =
+      recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
+  size_t left = size;
+  bool begin = true;
+  // Same layout as AddRecord()
+  do {
+    size_t trailer = 0;
+    if (kBlockSize - block_offset < header_size) {
+      trailer = kBlockSize - block_offset;
+      block_offset = 0;
+    }
+    const size_t avail = kBlockSize - block_offset - header_size;
+    const size_t fragment_length = (left < avail) ? left : avail;
+
+    RecordType type;
+    const bool end = (left == fragment_length);
+    if (begin && end) {
+      type = recycle_log_files_ ? kRecyclableFullType : kFullType;
+    } else if (begin) {
+      type = recycle_log_files_ ? kRecyclableFirstType : kFirstType;
+    } else if (end) {
+      type = recycle_log_files_ ? kRecyclableLastType : kLastType;
+    } else {
+      type = recycle_log_files_ ? kRecyclableMiddleType : kMiddleType;
+    }
+
+    emit(type, fragment_length, trailer);
+    block_offset += header_size + fragment_length;
+    left -= fragment_length;
+    begin = false;
+  } while (left > 0);
+  return block_offset;
+}
+
+void Writer::BeginReservation() {
+  reserved_bytes_ = 0;
+  reserved_block_offset_ = block_offset_;
+}
+
+Writer::ReservedRecord Writer::ReserveRecord(size_t size) {
+  const size_t header_size =
+      recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
+  ReservedRecord record;
+  record.offset = reserved_bytes_;
+  record.block_offset = reserved_block_offset_;
+  reserved_block_offset_ = ForEachFragment(
+      reserved_block_offset_, size,
+      [&](RecordType /*type*/, size_t fragment_length, size_t trailer) {
+        reserved_bytes_ += trailer + header_size + fragment_length;
+      });
+  return record;
+}
+
+IOStatus Writer::MapReservation(char** buf) {
+  return dest_->ReserveAppend(reserved_bytes_, buf);
+}
+
+void Writer::WriteReservedRecord(char* buf, const ReservedRecord& record,
+                                 const Slice& slice) {
+  char* dst = buf + record.offset;
+  const char* ptr = slice.data();
+  ForEachFragment(
+      record.block_offset, slice.size(),
+      [&](RecordType type, size_t fragment_length, size_t trailer) {
+        if (trailer > 0) {
+          // Fill the trailer of the previous block
+          dest_->CopyToReserved(
+              dst, Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", trailer));
+          dst += trailer;
+        }
+        char header[kRecyclableHeaderSize];
+        size_t header_size = EncodeHeader(type, ptr, fragment_length, header);
+        dest_->CopyToReserved(dst, Slice(header, header_size));
+        dest_->CopyToReserved(dst + header_size, Slice(ptr, fragment_length));
+        dst += header_size + fragment_length;
+        ptr += fragment_length;
+      });
+}
+
+IOStatus Writer::CommitReservation(const char* buf) {
+  IOStatus s = dest_->CommitReserved(buf, reserved_bytes_);
   if (s.ok()) {
-    s = dest_->Append(Slice(ptr, n));
+    block_offset_ = reserved_block_offset_;
+    if (!manual_flush_) {
+      s = dest_->Flush();
+    }
   }
-  block_offset_ += header_size + n;
   return s;
 }
 
@@ -81,6 +81,28 @@ class Writer {
 
   IOStatus AddRecord(const Slice& slice);
 
+  // Where a record reserved by ReserveRecord() starts
+  struct ReservedRecord {
+    size_t offset = 0;        // from the start of the reserved room
+    size_t block_offset = 0;  // in its block
+  };
+
+  // Appending records from several threads, as an alternative to
+  // AddRecord(). BeginReservation() starts reserving records at the end of
+  // the log, and ReserveRecord() lays out a record of the given size after
+  // the ones reserved so far. MapReservation() then makes room for all of
+  // them in the file, and returns NotSupported if the file cannot be written
+  // in place, in which case the reservation is dropped. Each record is then
+  // written by WriteReservedRecord(), concurrently with the others, and
+  // CommitReservation() makes them part of the log. No other record may be
+  // added in between.
+  void BeginReservation();
+  ReservedRecord ReserveRecord(size_t size);
+  IOStatus MapReservation(char** buf);
+  void WriteReservedRecord(char* buf, const ReservedRecord& record,
+                           const Slice& slice);
+  IOStatus CommitReservation(const char* buf);
+
   WritableFileWriter* file() { return dest_.get(); }
   const WritableFileWriter* file() const { return dest_.get(); }
 
@@ -105,6 +127,21 @@ class Writer {
 
   IOStatus EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
 
+  // Encodes the header of a physical record into buf and returns its size
+  size_t EncodeHeader(RecordType type, const char* ptr, size_t length,
+                      char* buf) const;
+
+  // Calls emit(type, fragment_length, trailer) for every physical record of
+  // a record of size bytes starting at block_offset, and returns the block
+  // offset after the record. trailer is the number of bytes padding the
+  // previous block before the fragment.
+  template <typename F>
+  size_t ForEachFragment(size_t block_offset, size_t size, F emit) const;
+
+  // The end of the records reserved so far
+  size_t reserved_bytes_;
+  size_t reserved_block_offset_;
+
   // If true, it does not flush after each write. Instead it relies on the upper
   // layer to manually does the flush by calling ::WriteBuffer()
   bool manual_flush_;
@@ -56,6 +56,7 @@ ImmutableMemTableOptions::ImmutableMemTableOptions(
           mutable_cf_options.memtable_whole_key_filtering),
       inplace_update_support(ioptions.inplace_update_support),
       inplace_update_num_locks(mutable_cf_options.inplace_update_num_locks),
+      memtable_hot_key_slots(mutable_cf_options.memtable_hot_key_slots),
       inplace_callback(ioptions.inplace_callback),
       max_successive_merges(mutable_cf_options.max_successive_merges),
       statistics(ioptions.statistics),
@@ -97,11 +98,16 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       first_seqno_(0),
       earliest_seqno_(latest_seq),
       creation_seq_(latest_seq),
+      largest_recovered_seqno_(0),
+      persistent_(false),
       mem_next_logfile_number_(0),
       min_prep_log_referenced_(0),
       locks_(moptions_.inplace_update_support
                  ? moptions_.inplace_update_num_locks
                  : 0),
+      hot_keys_(nullptr),
+      num_hot_keys_(0),
+      hot_key_epoch_(0),
       prefix_extractor_(mutable_cf_options.prefix_extractor.get()),
       flush_state_(FLUSH_NOT_REQUESTED),
       clock_(ioptions.clock),
@@ -122,6 +128,69 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
                          6 /* hard coded 6 probes */,
                          moptions_.memtable_huge_page_size, ioptions.info_log));
   }
+
+  persistent_ = table_->IsPersistent();
+  // The entries of a persistent rep cannot be overwritten without being
+  // persisted again
+  if (!persistent_ && moptions_.memtable_hot_key_slots > 0 &&
+      !moptions_.inplace_update_support) {
+    num_hot_keys_ = moptions_.memtable_hot_key_slots;
+    char* mem = arena_.AllocateAligned(num_hot_keys_ * sizeof(HotKeySlot));
+    hot_keys_ = reinterpret_cast<HotKeySlot*>(mem);
+    for (size_t i = 0; i < num_hot_keys_; i++) {
+      new (&hot_keys_[i]) HotKeySlot();
+    }
+  }
+}
+
+void MemTable::Recover(const MemTableRep::RecoveredState& state) {
+  assert(persistent_ && num_entries_.load(std::memory_order_relaxed) == 0);
+  table_->Recover(state);
+  AddRecoveredEntries();
+}
+
+void MemTable::AddRecoveredEntries() {
+  size_t ts_sz = GetInternalKeyComparator().user_comparator()->timestamp_size();
+  SequenceNumber smallest_seqno = kMaxSequenceNumber;
+  std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    const char* entry = iter->key();
+    uint32_t key_length = 0;
+    const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+    Slice user_key(key_ptr, key_length - 8);
+    uint64_t packed = DecodeFixed64(key_ptr + key_length - 8);
+    SequenceNumber seq;
+    ValueType type;
+    UnPackSequenceAndType(packed, &seq, &type);
+    Slice value = GetLengthPrefixedSlice(key_ptr + key_length);
+
+    num_entries_.store(num_entries_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    data_size_.store(data_size_.load(std::memory_order_relaxed) +
+                         (value.data() + value.size() - entry),
+                     std::memory_order_relaxed);
+    if (type == kTypeDeletion) {
+      num_deletes_.store(num_deletes_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    }
+    Slice key_without_ts = StripTimestampFromUserKey(user_key, ts_sz);
+    if (bloom_filter_ && prefix_extractor_ &&
+        prefix_extractor_->InDomain(key_without_ts)) {
+      bloom_filter_->Add(prefix_extractor_->Transform(key_without_ts));
+    }
+    if (bloom_filter_ && moptions_.memtable_whole_key_filtering) {
+      bloom_filter_->Add(key_without_ts);
+    }
+    smallest_seqno = std::min(smallest_seqno, seq);
+    largest_recovered_seqno_ = std::max(largest_recovered_seqno_, seq);
+  }
+  if (largest_recovered_seqno_ > 0) {
+    first_seqno_.store(smallest_seqno, std::memory_order_relaxed);
+    if (smallest_seqno < earliest_seqno_.load(std::memory_order_relaxed)) {
+      earliest_seqno_.store(smallest_seqno, std::memory_order_relaxed);
+    }
+    UpdateFlushState();
+  }
 }
 
 MemTable::~MemTable() {
@@ -529,12 +598,12 @@ Status MemTable::VerifyEncodedEntry(Slice encoded,
       .GetStatus();
 }
 
-Status MemTable::Add(SequenceNumber s, ValueType type,
-                     const Slice& key, /* user key */
-                     const Slice& value,
-                     const ProtectionInfoKVOTS64* kv_prot_info,
-                     bool allow_concurrent,
-                     MemTablePostProcessInfo* post_process_info, void** hint) {
+Status MemTable::EncodeEntry(SequenceNumber s, ValueType type,
+                             const Slice& key, /* user key */
+                             const Slice& value,
+                             const ProtectionInfoKVOTS64* kv_prot_info,
+                             KeyHandle* handle, Slice* key_slice,
+                             uint32_t* encoded_len) {
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -543,35 +612,84 @@ Status MemTable::Add(SequenceNumber s, ValueType type,
   uint32_t key_size = static_cast<uint32_t>(key.size());
   uint32_t val_size = static_cast<uint32_t>(value.size());
   uint32_t internal_key_size = key_size + 8;
-  const uint32_t encoded_len = VarintLength(internal_key_size) +
-                               internal_key_size + VarintLength(val_size) +
-                               val_size;
+  *encoded_len = VarintLength(internal_key_size) + internal_key_size +
+                 VarintLength(val_size) + val_size;
   char* buf = nullptr;
   std::unique_ptr<MemTableRep>& table =
       type == kTypeRangeDeletion ? range_del_table_ : table_;
-  KeyHandle handle = table->Allocate(encoded_len, &buf);
+  *handle = table->Allocate(*encoded_len, &buf);
 
   char* p = EncodeVarint32(buf, internal_key_size);
   memcpy(p, key.data(), key_size);
-  Slice key_slice(p, key_size);
+  *key_slice = Slice(p, key_size);
   p += key_size;
   uint64_t packed = PackSequenceAndType(s, type);
   EncodeFixed64(p, packed);
   p += 8;
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
-  assert((unsigned)(p + val_size - buf) == (unsigned)encoded_len);
+  assert((unsigned)(p + val_size - buf) == (unsigned)*encoded_len);
   if (kv_prot_info != nullptr) {
-    Slice encoded(buf, encoded_len);
+    Slice encoded(buf, *encoded_len);
     TEST_SYNC_POINT_CALLBACK("MemTable::Add:Encoded", &encoded);
-    Status status = VerifyEncodedEntry(encoded, *kv_prot_info);
-    if (!status.ok()) {
-      return status;
-    }
+    return VerifyEncodedEntry(encoded, *kv_prot_info);
+  }
+  return Status::OK();
+}
+
+void MemTable::UpdateStatsAfterAdd(SequenceNumber s, ValueType type,
+                                   const Slice& key, uint32_t encoded_len) {
+  // this is a bit ugly, but is the way to avoid locked instructions
+  // when incrementing an atomic
+  num_entries_.store(num_entries_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+  data_size_.store(data_size_.load(std::memory_order_relaxed) + encoded_len,
+                   std::memory_order_relaxed);
+  if (type == kTypeDeletion) {
+    num_deletes_.store(num_deletes_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
   }
 
   size_t ts_sz = GetInternalKeyComparator().user_comparator()->timestamp_size();
   Slice key_without_ts = StripTimestampFromUserKey(key, ts_sz);
+  if (bloom_filter_ && prefix_extractor_ &&
+      prefix_extractor_->InDomain(key_without_ts)) {
+    bloom_filter_->Add(prefix_extractor_->Transform(key_without_ts));
+  }
+  if (bloom_filter_ && moptions_.memtable_whole_key_filtering) {
+    bloom_filter_->Add(key_without_ts);
+  }
+
+  // The first sequence number inserted into the memtable
+  assert(first_seqno_ == 0 || s >= first_seqno_);
+  if (first_seqno_ == 0) {
+    first_seqno_.store(s, std::memory_order_relaxed);
+
+    if (earliest_seqno_ == kMaxSequenceNumber) {
+      earliest_seqno_.store(GetFirstSequenceNumber(),
+                            std::memory_order_relaxed);
+    }
+    assert(first_seqno_.load() >= earliest_seqno_.load());
+  }
+  UpdateFlushState();
+}
+
+Status MemTable::Add(SequenceNumber s, ValueType type,
+                     const Slice& key, /* user key */
+                     const Slice& value,
+                     const ProtectionInfoKVOTS64* kv_prot_info,
+                     bool allow_concurrent,
+                     MemTablePostProcessInfo* post_process_info, void** hint) {
+  KeyHandle handle = nullptr;
+  Slice key_slice;
+  uint32_t encoded_len = 0;
+  Status status = EncodeEntry(s, type, key, value, kv_prot_info, &handle,
+                              &key_slice, &encoded_len);
+  if (!status.ok()) {
+    return status;
+  }
+  std::unique_ptr<MemTableRep>& table =
+      type == kTypeRangeDeletion ? range_del_table_ : table_;
 
   if (!allow_concurrent) {
     // Extract prefix for insert with hint.
@@ -588,39 +706,8 @@ Status MemTable::Add(SequenceNumber s, ValueType type,
         return Status::TryAgain("key+seq exists");
       }
     }
-
-    // this is a bit ugly, but is the way to avoid locked instructions
-    // when incrementing an atomic
-    num_entries_.store(num_entries_.load(std::memory_order_relaxed) + 1,
-                       std::memory_order_relaxed);
-    data_size_.store(data_size_.load(std::memory_order_relaxed) + encoded_len,
-                     std::memory_order_relaxed);
-    if (type == kTypeDeletion) {
-      num_deletes_.store(num_deletes_.load(std::memory_order_relaxed) + 1,
-                         std::memory_order_relaxed);
-    }
-
-    if (bloom_filter_ && prefix_extractor_ &&
-        prefix_extractor_->InDomain(key_without_ts)) {
-      bloom_filter_->Add(prefix_extractor_->Transform(key_without_ts));
-    }
-    if (bloom_filter_ && moptions_.memtable_whole_key_filtering) {
-      bloom_filter_->Add(key_without_ts);
-    }
-
-    // The first sequence number inserted into the memtable
-    assert(first_seqno_ == 0 || s >= first_seqno_);
-    if (first_seqno_ == 0) {
-      first_seqno_.store(s, std::memory_order_relaxed);
-
-      if (earliest_seqno_ == kMaxSequenceNumber) {
-        earliest_seqno_.store(GetFirstSequenceNumber(),
-                              std::memory_order_relaxed);
-      }
-      assert(first_seqno_.load() >= earliest_seqno_.load());
-    }
     assert(post_process_info == nullptr);
-    UpdateFlushState();
+    UpdateStatsAfterAdd(s, type, key, encoded_len);
   } else {
     bool res = (hint == nullptr)
                    ? table->InsertKeyConcurrently(handle)
@@ -636,6 +723,9 @@ Status MemTable::Add(SequenceNumber s, ValueType type,
       post_process_info->num_deletes++;
     }
 
+    size_t ts_sz =
+        GetInternalKeyComparator().user_comparator()->timestamp_size();
+    Slice key_without_ts = StripTimestampFromUserKey(key, ts_sz);
     if (bloom_filter_ && prefix_extractor_ &&
         prefix_extractor_->InDomain(key_without_ts)) {
       bloom_filter_->AddConcurrently(
@@ -657,6 +747,10 @@ Status MemTable::Add(SequenceNumber s, ValueType type,
         !first_seqno_.compare_exchange_weak(cur_earliest_seqno, s)) {
     }
   }
+  if (hot_keys_ != nullptr) {
+    UpdateHotKeySlot(s, type, key, handle,
+                     static_cast<uint32_t>(value.size()), allow_concurrent);
+  }
   if (type == kTypeRangeDeletion) {
     is_range_del_table_empty_.store(false, std::memory_order_relaxed);
   }
@@ -664,6 +758,118 @@ Status MemTable::Add(SequenceNumber s, ValueType type,
   return Status::OK();
 }
 
+void MemTable::UpdateHotKeySlot(SequenceNumber s, ValueType type,
+                                const Slice& key, KeyHandle handle,
+                                uint32_t value_size, bool allow_concurrent) {
+  if (type == kTypeRangeDeletion) {
+    hot_key_epoch_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  HotKeySlot& slot = hot_keys_[GetSliceRangedNPHash(key, num_hot_keys_)];
+  if (allow_concurrent) {
+    slot.mutex.lock();
+  }
+  if (type == kTypeValue) {
+    slot.entry = static_cast<const char*>(handle);
+    slot.seq = s;
+    slot.capacity = value_size;
+    slot.epoch = hot_key_epoch_.load(std::memory_order_relaxed);
+  } else {
+    // The latest entry of a key it holds might be this one
+    slot.entry = nullptr;
+  }
+  if (allow_concurrent) {
+    slot.mutex.unlock();
+  }
+}
+
+Status MemTable::CoalesceHotKey(SequenceNumber seq, const Slice& key,
+                                const Slice& value,
+                                const ProtectionInfoKVOTS64* kv_prot_info,
+                                SequenceNumber min_seq,
+                                bool allow_concurrent) {
+  if (hot_keys_ == nullptr ||
+      value.size() > std::numeric_limits<uint32_t>::max()) {
+    return Status::NotFound();
+  }
+  HotKeySlot& slot = hot_keys_[GetSliceRangedNPHash(key, num_hot_keys_)];
+  std::unique_lock<SpinMutex> lock(slot.mutex, std::defer_lock);
+  if (allow_concurrent) {
+    lock.lock();
+  }
+  // A range deletion added after the entry may have a sequence number in
+  // between
+  if (slot.entry == nullptr || slot.seq < min_seq || slot.seq >= seq ||
+      slot.epoch != hot_key_epoch_.load(std::memory_order_relaxed) ||
+      value.size() > slot.capacity) {
+    return Status::NotFound();
+  }
+  const char* entry = slot.entry;
+  uint32_t key_length = 0;
+  const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+  if (!comparator_.comparator.user_comparator()->Equal(
+          Slice(key_ptr, key_length - 8), key)) {
+    return Status::NotFound();
+  }
+  // The varint of a size not larger than the capacity is not longer than the
+  // varint of the capacity written by Add()
+  char* p = EncodeVarint32(const_cast<char*>(key_ptr) + key_length,
+                           static_cast<uint32_t>(value.size()));
+  memcpy(p, value.data(), value.size());
+  RecordTick(moptions_.statistics, NUMBER_KEYS_UPDATED);
+  if (kv_prot_info != nullptr) {
+    ProtectionInfoKVOTS64 updated_kv_prot_info(*kv_prot_info);
+    // `seq` is swallowed and the sequence number of the entry prevails.
+    updated_kv_prot_info.UpdateS(seq, slot.seq);
+    Slice encoded(entry, p + value.size() - entry);
+    return VerifyEncodedEntry(encoded, updated_kv_prot_info);
+  }
+  return Status::OK();
+}
+
+Status MemTable::AddToSortedRun(SequenceNumber s, ValueType type,
+                                const Slice& key, /* user key */
+                                const Slice& value,
+                                const ProtectionInfoKVOTS64* kv_prot_info,
+                                MemTableSortedRun* run) {
+  assert(type != kTypeRangeDeletion);
+  assert(FitsSortedRun(*run, key));
+  KeyHandle handle = nullptr;
+  Slice key_slice;
+  uint32_t encoded_len = 0;
+  Status status = EncodeEntry(s, type, key, value, kv_prot_info, &handle,
+                              &key_slice, &encoded_len);
+  if (!status.ok()) {
+    return status;
+  }
+  run->handles.push_back(handle);
+  run->last_key = key_slice;
+  if (hot_keys_ != nullptr) {
+    UpdateHotKeySlot(s, type, key, handle,
+                     static_cast<uint32_t>(value.size()),
+                     false /* allow_concurrent */);
+  }
+  // The entries of the run are not visible to reads before their sequence
+  // numbers are published, which happens after InsertSortedRun().
+  UpdateStatsAfterAdd(s, type, key, encoded_len);
+  UpdateOldestKeyTime();
+  return Status::OK();
+}
+
+Status MemTable::InsertSortedRun(MemTableSortedRun* run) {
+  size_t num_keys = run->handles.size();
+  size_t inserted = num_keys == 1
+                        ? (table_->InsertKey(run->handles[0]) ? 1 : 0)
+                        : table_->InsertSortedRun(run->handles.data(),
+                                                  num_keys);
+  run->handles.clear();
+  run->last_key.clear();
+  if (UNLIKELY(inserted < num_keys)) {
+    return Status::TryAgain("key+seq exists");
+  }
+  return Status::OK();
+}
+
 // Callback from MemTable::Get()
 namespace {
 
@@ -30,6 +30,7 @@
 #include "table/multiget_context.h"
 #include "util/dynamic_bloom.h"
 #include "util/hash.h"
+#include "util/mutexlock.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -48,6 +49,7 @@ struct ImmutableMemTableOptions {
   bool memtable_whole_key_filtering;
   bool inplace_update_support;
   size_t inplace_update_num_locks;
+  size_t memtable_hot_key_slots;
   UpdateStatus (*inplace_callback)(char* existing_value,
                                    uint32_t* existing_value_size,
                                    Slice delta_value,
@@ -68,6 +70,15 @@ struct MemTablePostProcessInfo {
   uint64_t num_deletes = 0;
 };
 
+// Entries of strictly increasing user keys, encoded into one memtable by
+// MemTable::AddToSortedRun but not yet inserted into its table. Only used in
+// non-concurrent memtable insert case.
+struct MemTableSortedRun {
+  std::vector<KeyHandle> handles;
+  // User key of the last entry
+  Slice last_key;
+};
+
 using MultiGetRange = MultiGetContext::Range;
 // Note:  Many of the methods in this class have comments indicating that
 // external synchronization is required as these methods are not thread-safe.
@@ -196,6 +207,60 @@ class MemTable {
              MemTablePostProcessInfo* post_process_info = nullptr,
              void** hint = nullptr);
 
+  // Overwrites in place the value of the latest put of key, if it was made
+  // through this memtable's hot key table with a sequence number in
+  // [min_seq, seq) and no entry of the key was added after it, and value
+  // fits in the space of its value. The entry keeps its sequence number, so
+  // the caller guarantees that no reader can see sequence numbers from
+  // min_seq on before seq is published, and that sequence numbers in
+  // [min_seq, seq) are only added by the caller, in order.
+  //
+  // Returns Status::NotFound() if the put cannot be coalesced and must be
+  // added, or an error if the updated entry fails verification against
+  // kv_prot_info.
+  //
+  // REQUIRES: if allow_concurrent = false, external synchronization to prevent
+  // simultaneous operations on the same MemTable.
+  Status CoalesceHotKey(SequenceNumber seq, const Slice& key,
+                        const Slice& value,
+                        const ProtectionInfoKVOTS64* kv_prot_info,
+                        SequenceNumber min_seq, bool allow_concurrent);
+
+  // Returns true if an entry of user key `key` can be appended to `run`,
+  // i.e. the run is empty or key is greater than the user key of its last
+  // entry.
+  bool FitsSortedRun(const MemTableSortedRun& run, const Slice& key) const {
+    return run.handles.empty() ||
+           GetInternalKeyComparator().user_comparator()->Compare(
+               key, run.last_key) > 0;
+  }
+
+  // Like Add() with allow_concurrent = false, but appends the encoded entry
+  // to `run` instead of inserting it. The entry is accounted for in the
+  // memtable statistics right away but is not found by reads until the run
+  // is passed to InsertSortedRun(). type must not be kTypeRangeDeletion.
+  //
+  // REQUIRES: FitsSortedRun(*run, key)
+  // REQUIRES: external synchronization to prevent simultaneous operations on
+  // the same MemTable.
+  Status AddToSortedRun(SequenceNumber seq, ValueType type, const Slice& key,
+                        const Slice& value,
+                        const ProtectionInfoKVOTS64* kv_prot_info,
+                        MemTableSortedRun* run);
+
+  // Inserts the entries of `run` into the table in one pass and clears it.
+  // A run of presorted keys costs about one skip list search per gap between
+  // existing keys it fills, instead of one search per key.
+  //
+  // Returns `Status::TryAgain` if the `seq`, `key` combination of an entry
+  // already exists in the memtable and
+  // `MemTableRepFactory::CanHandleDuplicatedKey()` is true. The entries from
+  // that one on are not inserted.
+  //
+  // REQUIRES: external synchronization to prevent simultaneous operations on
+  // the same MemTable.
+  Status InsertSortedRun(MemTableSortedRun* run);
+
   // Used to Get value associated with key or Get Merge Operands associated
   // with key.
   // If do_merge = true the default behavior which is Get value for key is
@@ -352,6 +417,41 @@ class MemTable {
     return earliest_seqno_.load(std::memory_order_relaxed);
   }
 
+  // Returns the largest sequence number of the entries added by Recover(), or
+  // 0 if there were none. WAL recovery skips the writes up to this sequence
+  // number, which the column family already has.
+  SequenceNumber GetLargestRecoveredSequenceNumber() const {
+    return largest_recovered_seqno_;
+  }
+
+  // Used by WAL recovery to carry the above over to a memtable that replaces
+  // a flushed one.
+  void SetLargestRecoveredSequenceNumber(SequenceNumber seq) {
+    largest_recovered_seqno_ = seq;
+  }
+
+  // Returns true if the entries survive a restart until MarkFlushed() is
+  // called, see MemTableRep::IsPersistent().
+  bool IsPersistent() const { return persistent_; }
+
+  // Adds the entries of the earlier memtables of the column family that were
+  // not flushed, see MemTableRep::Recover(). Called by DB::Open on the first
+  // memtable of a column family, if it is persistent.
+  void Recover(const MemTableRep::RecoveredState& state);
+
+  // See MemTableRep::MarkFlushPending().
+  void MarkFlushPending(uint64_t file_number) {
+    if (persistent_) {
+      table_->MarkFlushPending(file_number);
+    }
+  }
+
+  // See MemTableRep::CommitBatch().
+  void CommitBatch(SequenceNumber seq) {
+    assert(persistent_);
+    table_->CommitBatch(seq);
+  }
+
   // DB's latest sequence ID when the memtable is created. This number
   // may be updated to a more recent one before any key is inserted.
   SequenceNumber GetCreationSeq() const { return creation_seq_; }
@@ -497,6 +597,12 @@ class MemTable {
 
   SequenceNumber creation_seq_;
 
+  // Largest sequence number of the entries added by Recover()
+  SequenceNumber largest_recovered_seqno_;
+
+  // Whether table_ is persistent
+  bool persistent_;
+
   // The log files earlier than this number can be deleted.
   uint64_t mem_next_logfile_number_;
 
@@ -507,6 +613,23 @@ class MemTable {
   // rw locks for inplace updates
   std::vector<port::RWMutex> locks_;
 
+  // A slot of the hot key table, which remembers the entry of the latest put
+  // of a key hashed to it. Only locked with concurrent writes.
+  struct HotKeySlot {
+    SpinMutex mutex;
+    const char* entry = nullptr;
+    SequenceNumber seq = 0;
+    // Bytes the value of the entry can take
+    uint32_t capacity = 0;
+    // hot_key_epoch_ when the entry was added
+    uint64_t epoch = 0;
+  };
+  // Allocated from arena_ when memtable_hot_key_slots > 0
+  HotKeySlot* hot_keys_;
+  size_t num_hot_keys_;
+  // Incremented by every range deletion, which may cover a hot key
+  std::atomic<uint64_t> hot_key_epoch_;
+
   const SliceTransform* const prefix_extractor_;
   std::unique_ptr<DynamicBloom> bloom_filter_;
 
@@ -547,8 +670,29 @@ class MemTable {
   // Updates flush_state_ using ShouldFlushNow()
   void UpdateFlushState();
 
+  // Allocates and encodes an entry in the table of its type, and verifies it
+  // against kv_prot_info if given
+  Status EncodeEntry(SequenceNumber s, ValueType type, const Slice& key,
+                     const Slice& value,
+                     const ProtectionInfoKVOTS64* kv_prot_info,
+                     KeyHandle* handle, Slice* key_slice,
+                     uint32_t* encoded_len);
+
+  // Points the hot key slot of key to the entry of a put, or clears it for
+  // any other type of entry
+  void UpdateHotKeySlot(SequenceNumber s, ValueType type, const Slice& key,
+                        KeyHandle handle, uint32_t value_size,
+                        bool allow_concurrent);
+
+  // Accounts for an entry added without allow_concurrent
+  void UpdateStatsAfterAdd(SequenceNumber s, ValueType type, const Slice& key,
+                           uint32_t encoded_len);
+
   void UpdateOldestKeyTime();
 
+  // Accounts for the entries added by Recover()
+  void AddRecoveredEntries();
+
   void GetFromTable(const LookupKey& key,
                     SequenceNumber max_covering_tombstone_seq, bool do_merge,
                     ReadCallback* callback, bool* is_blob_index,
@@ -266,6 +266,7 @@ void MemTableListVersion::Remove(MemTable* m,
   assert(refs_ == 1);  // only when refs_ == 1 is MemTableListVersion mutable
   memlist_.remove(m);
 
+  TEST_SYNC_POINT_CALLBACK("MemTableListVersion::Remove:BeforeMarkFlushed", m);
   m->MarkFlushed();
   if (max_write_buffer_size_to_maintain_ > 0 ||
       max_write_buffer_number_to_maintain_ > 0) {
@@ -363,6 +364,14 @@ void MemTableList::PickMemtablesToFlush(uint64_t max_memtable_id,
   }
 }
 
+void MemTableList::MarkDropped() {
+  for (MemTable* m : current_->memlist_) {
+    if (m->IsPersistent()) {
+      m->MarkFlushed();
+    }
+  }
+}
+
 void MemTableList::RollbackMemtableFlush(const autovector<MemTable*>& mems,
                                          uint64_t /*file_number*/) {
   AutoThreadOperationStageUpdater stage_updater(
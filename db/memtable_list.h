@@ -254,6 +254,10 @@ class MemTableList {
   void PickMemtablesToFlush(uint64_t max_memtable_id,
                             autovector<MemTable*>* mems);
 
+  // Called when the column family is dropped, whose unflushed entries are
+  // not needed anymore. Lets persistent memtables delete them.
+  void MarkDropped();
+
   // Reset status of the given memtable list back to pending state so that
   // they can get picked up again on the next round of flush.
   void RollbackMemtableFlush(const autovector<MemTable*>& mems,
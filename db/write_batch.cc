@@ -35,6 +35,7 @@
 
 #include "rocksdb/write_batch.h"
 
+#include <algorithm>
 #include <map>
 #include <stack>
 #include <stdexcept>
@@ -140,6 +141,43 @@ struct BatchContentClassifier : public WriteBatch::Handler {
   }
 };
 
+// Collects the distinct column families written by a batch. Transaction
+// markers are left to the default handlers, which fail the iteration.
+struct ColumnFamilyCollector : public WriteBatch::Handler {
+  std::vector<uint32_t>* column_families;
+
+  explicit ColumnFamilyCollector(std::vector<uint32_t>* cfs)
+      : column_families(cfs) {}
+
+  Status Add(uint32_t column_family_id) {
+    if (std::find(column_families->begin(), column_families->end(),
+                  column_family_id) == column_families->end()) {
+      column_families->push_back(column_family_id);
+    }
+    return Status::OK();
+  }
+
+  Status PutCF(uint32_t cf, const Slice&, const Slice&) override {
+    return Add(cf);
+  }
+
+  Status DeleteCF(uint32_t cf, const Slice&) override { return Add(cf); }
+
+  Status SingleDeleteCF(uint32_t cf, const Slice&) override { return Add(cf); }
+
+  Status DeleteRangeCF(uint32_t cf, const Slice&, const Slice&) override {
+    return Add(cf);
+  }
+
+  Status MergeCF(uint32_t cf, const Slice&, const Slice&) override {
+    return Add(cf);
+  }
+
+  Status PutBlobIndexCF(uint32_t cf, const Slice&, const Slice&) override {
+    return Add(cf);
+  }
+};
+
 class TimestampAssigner : public WriteBatch::Handler {
  public:
   explicit TimestampAssigner(const Slice& ts,
@@ -564,13 +602,30 @@ Status WriteBatch::Iterate(Handler* handler) const {
 Status WriteBatchInternal::Iterate(const WriteBatch* wb,
                                    WriteBatch::Handler* handler, size_t begin,
                                    size_t end) {
-  if (begin > wb->rep_.size() || end > wb->rep_.size() || end < begin) {
+  return Iterate(Slice(wb->rep_),
+                 wb->content_flags_.load(std::memory_order_relaxed), handler,
+                 begin, end);
+}
+
+Status WriteBatchInternal::Iterate(const Slice& contents,
+                                   WriteBatch::Handler* handler, size_t begin,
+                                   size_t end) {
+  return Iterate(contents, ContentFlags::DEFERRED, handler, begin, end);
+}
+
+Status WriteBatchInternal::Iterate(const Slice& rep, uint32_t content_flags,
+                                   WriteBatch::Handler* handler, size_t begin,
+                                   size_t end) {
+#ifdef NDEBUG
+  (void)content_flags;
+#endif
+  if (begin > rep.size() || end > rep.size() || end < begin) {
     return Status::Corruption("Invalid start/end bounds for Iterate");
   }
   assert(begin <= end);
-  Slice input(wb->rep_.data() + begin, static_cast<size_t>(end - begin));
+  Slice input(rep.data() + begin, static_cast<size_t>(end - begin));
   bool whole_batch =
-      (begin == WriteBatchInternal::kHeader) && (end == wb->rep_.size());
+      (begin == WriteBatchInternal::kHeader) && (end == rep.size());
 
   Slice key, value, blob, xid;
   // Sometimes a sub-batch starts with a Noop. We want to exclude such Noops as
@@ -615,7 +670,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
     switch (tag) {
       case kTypeColumnFamilyValue:
       case kTypeValue:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_PUT));
         s = handler->PutCF(column_family, key, value);
         if (LIKELY(s.ok())) {
@@ -625,7 +680,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         break;
       case kTypeColumnFamilyDeletion:
       case kTypeDeletion:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_DELETE));
         s = handler->DeleteCF(column_family, key);
         if (LIKELY(s.ok())) {
@@ -635,7 +690,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         break;
       case kTypeColumnFamilySingleDeletion:
       case kTypeSingleDeletion:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_SINGLE_DELETE));
         s = handler->SingleDeleteCF(column_family, key);
         if (LIKELY(s.ok())) {
@@ -645,7 +700,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         break;
       case kTypeColumnFamilyRangeDeletion:
       case kTypeRangeDeletion:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_DELETE_RANGE));
         s = handler->DeleteRangeCF(column_family, key, value);
         if (LIKELY(s.ok())) {
@@ -655,7 +710,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         break;
       case kTypeColumnFamilyMerge:
       case kTypeMerge:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_MERGE));
         s = handler->MergeCF(column_family, key, value);
         if (LIKELY(s.ok())) {
@@ -665,7 +720,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         break;
       case kTypeColumnFamilyBlobIndex:
       case kTypeBlobIndex:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_BLOB_INDEX));
         s = handler->PutBlobIndexCF(column_family, key, value);
         if (LIKELY(s.ok())) {
@@ -678,7 +733,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         empty_batch = false;
         break;
       case kTypeBeginPrepareXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_BEGIN_PREPARE));
         s = handler->MarkBeginPrepare();
         assert(s.ok());
@@ -698,7 +753,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         }
         break;
       case kTypeBeginPersistedPrepareXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_BEGIN_PREPARE));
         s = handler->MarkBeginPrepare();
         assert(s.ok());
@@ -712,7 +767,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         }
         break;
       case kTypeBeginUnprepareXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_BEGIN_UNPREPARE));
         s = handler->MarkBeginPrepare(true /* unprepared */);
         assert(s.ok());
@@ -732,21 +787,21 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
         }
         break;
       case kTypeEndPrepareXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_END_PREPARE));
         s = handler->MarkEndPrepare(xid);
         assert(s.ok());
         empty_batch = true;
         break;
       case kTypeCommitXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_COMMIT));
         s = handler->MarkCommit(xid);
         assert(s.ok());
         empty_batch = true;
         break;
       case kTypeRollbackXID:
-        assert(wb->content_flags_.load(std::memory_order_relaxed) &
+        assert(content_flags &
                (ContentFlags::DEFERRED | ContentFlags::HAS_ROLLBACK));
         s = handler->MarkRollback(xid);
         assert(s.ok());
@@ -765,7 +820,7 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
     return s;
   }
   if (handler_continue && whole_batch &&
-      found != WriteBatchInternal::Count(wb)) {
+      found != DecodeFixed32(rep.data() + 8)) {
     return Status::Corruption("WriteBatch has wrong count");
   } else {
     return Status::OK();
@@ -1396,6 +1451,20 @@ class MemTableInserter : public WriteBatch::Handler {
 
   bool hint_per_batch_;
   bool hint_created_;
+  // Puts and deletes of increasing keys into the same memtable are buffered
+  // in sorted_run_ and inserted together by FinishSortedRun()
+  bool sorted_runs_;
+  MemTable* sorted_run_mem_;
+  MemTableSortedRun sorted_run_;
+  // Puts may be coalesced with earlier puts of sequence numbers from this
+  // one on, which are all inserted by this inserter and published together
+  const SequenceNumber hot_key_min_seq_;
+  // If set, entries of other column families are skipped
+  const std::vector<uint32_t>* column_families_;
+  // Persistent memtables written by the current batch, and the largest
+  // sequence number written to them, see CommitBatch()
+  autovector<MemTable*> persistent_mems_;
+  SequenceNumber persistent_seq_;
   // Hints for this batch
   using HintMap = std::unordered_map<MemTable*, void*>;
   using HintMapType = std::aligned_storage<sizeof(HintMap)>::type;
@@ -1482,7 +1551,12 @@ class MemTableInserter : public WriteBatch::Handler {
         duplicate_detector_(),
         dup_dectector_on_(false),
         hint_per_batch_(hint_per_batch),
-        hint_created_(false) {
+        hint_created_(false),
+        sorted_runs_(false),
+        sorted_run_mem_(nullptr),
+        hot_key_min_seq_(seq_per_batch ? kMaxSequenceNumber : _sequence),
+        column_families_(nullptr),
+        persistent_seq_(0) {
     assert(cf_mems_);
   }
 
@@ -1524,9 +1598,41 @@ class MemTableInserter : public WriteBatch::Handler {
   }
 
   void set_log_number_ref(uint64_t log) { log_number_ref_ = log; }
-  void set_prot_info(const WriteBatch::ProtectionInfo* prot_info) {
+  void set_prot_info(const WriteBatch::ProtectionInfo* prot_info,
+                     size_t first_entry = 0) {
     prot_info_ = prot_info;
-    prot_info_idx_ = 0;
+    prot_info_idx_ = first_entry;
+  }
+
+  void set_column_families(const std::vector<uint32_t>* column_families) {
+    column_families_ = column_families;
+  }
+
+  // Sorted runs are only used by non-concurrent writes that consume a
+  // sequence number per key, which never insert duplicate keys.
+  void set_sorted_runs(bool sorted_runs) {
+    sorted_runs_ = sorted_runs && !concurrent_memtable_writes_ &&
+                   !seq_per_batch_ && !hint_per_batch_;
+  }
+
+  // Inserts the pending sorted run, if any. Called after every batch.
+  Status FinishSortedRun() {
+    if (sorted_run_mem_ == nullptr) {
+      return Status::OK();
+    }
+    MemTable* mem = sorted_run_mem_;
+    sorted_run_mem_ = nullptr;
+    return mem->InsertSortedRun(&sorted_run_);
+  }
+
+  // Commits the writes of the batch to the persistent memtables, which then
+  // keep them across a crash. Called after every batch that was inserted
+  // successfully.
+  void CommitBatch() {
+    for (MemTable* mem : persistent_mems_) {
+      mem->CommitBatch(persistent_seq_);
+    }
+    persistent_mems_.clear();
   }
 
   SequenceNumber sequence() const { return sequence_; }
@@ -1542,11 +1648,20 @@ class MemTableInserter : public WriteBatch::Handler {
     }
   }
 
-  bool SeekToColumnFamily(uint32_t column_family_id, Status* s) {
+  bool SeekToColumnFamily(uint32_t column_family_id, Status* s,
+                          bool range_deletion = false) {
     // If we are in a concurrent mode, it is the caller's responsibility
     // to clone the original ColumnFamilyMemTables so that each thread
     // has its own instance.  Otherwise, it must be guaranteed that there
     // is no concurrent access
+    if (column_families_ != nullptr &&
+        std::find(column_families_->begin(), column_families_->end(),
+                  column_family_id) == column_families_->end()) {
+      // Inserted by another inserter of the same batch, only the sequence
+      // number is consumed here
+      *s = Status::OK();
+      return false;
+    }
     bool found = cf_mems_->Seek(column_family_id);
     if (!found) {
       if (ignore_missing_column_families_) {
@@ -1570,11 +1685,30 @@ class MemTableInserter : public WriteBatch::Handler {
       *s = Status::OK();
       return false;
     }
+    if (recovering_log_number_ != 0 && !range_deletion &&
+        sequence_ <=
+            cf_mems_->GetMemTable()->GetLargestRecoveredSequenceNumber()) {
+      // The write was made before the column family's persistent memtable
+      // was recovered, so the memtable already has it. Range deletions are
+      // not kept by persistent memtables and are replayed, which is why
+      // DBImpl refuses them without WAL.
+      *s = Status::OK();
+      return false;
+    }
 
     if (has_valid_writes_ != nullptr) {
       *has_valid_writes_ = true;
     }
 
+    MemTable* mem = cf_mems_->GetMemTable();
+    if (mem->IsPersistent() && !range_deletion) {
+      if (std::find(persistent_mems_.begin(), persistent_mems_.end(), mem) ==
+          persistent_mems_.end()) {
+        persistent_mems_.push_back(mem);
+      }
+      persistent_seq_ = sequence_;
+    }
+
     if (log_number_ref_ > 0) {
       cf_mems_->GetMemTable()->RefLogContainingPrepSection(log_number_ref_);
     }
@@ -1582,6 +1716,22 @@ class MemTableInserter : public WriteBatch::Handler {
     return true;
   }
 
+  // Appends the entry to the pending sorted run, first inserting the run if
+  // the entry does not extend it.
+  Status AddToSortedRun(MemTable* mem, ValueType type, const Slice& key,
+                        const Slice& value,
+                        const ProtectionInfoKVOTS64* kv_prot_info) {
+    if (sorted_run_mem_ != mem || !mem->FitsSortedRun(sorted_run_, key)) {
+      Status s = FinishSortedRun();
+      if (!s.ok()) {
+        return s;
+      }
+      sorted_run_mem_ = mem;
+    }
+    return mem->AddToSortedRun(sequence_, type, key, value, kv_prot_info,
+                               &sorted_run_);
+  }
+
   Status PutCFImpl(uint32_t column_family_id, const Slice& key,
                    const Slice& value, ValueType value_type,
                    const ProtectionInfoKVOTS64* kv_prot_info) {
@@ -1617,11 +1767,34 @@ class MemTableInserter : public WriteBatch::Handler {
     // inplace_update_support is inconsistent with snapshots, and therefore with
     // any kind of transactions including the ones that use seq_per_batch
     assert(!seq_per_batch_ || !moptions->inplace_update_support);
+    if (moptions->inplace_update_support) {
+      // An update in place reads the memtable, which must include the
+      // entries of the batch buffered in the sorted run, e.g. a delete of
+      // the same key
+      ret_status = FinishSortedRun();
+      if (!ret_status.ok()) {
+        return ret_status;
+      }
+    }
     if (!moptions->inplace_update_support) {
-      ret_status =
-          mem->Add(sequence_, value_type, key, value, kv_prot_info,
-                   concurrent_memtable_writes_, get_post_process_info(mem),
-                   hint_per_batch_ ? &GetHintMap()[mem] : nullptr);
+      if (value_type == kTypeValue && moptions->memtable_hot_key_slots > 0 &&
+          hot_key_min_seq_ != kMaxSequenceNumber) {
+        ret_status =
+            mem->CoalesceHotKey(sequence_, key, value, kv_prot_info,
+                                hot_key_min_seq_, concurrent_memtable_writes_);
+      } else {
+        ret_status = Status::NotFound();
+      }
+      if (!ret_status.IsNotFound()) {
+        // Coalesced with an earlier put of the key
+      } else if (sorted_runs_) {
+        ret_status = AddToSortedRun(mem, value_type, key, value, kv_prot_info);
+      } else {
+        ret_status =
+            mem->Add(sequence_, value_type, key, value, kv_prot_info,
+                     concurrent_memtable_writes_, get_post_process_info(mem),
+                     hint_per_batch_ ? &GetHintMap()[mem] : nullptr);
+      }
     } else if (moptions->inplace_callback == nullptr) {
       assert(!concurrent_memtable_writes_);
       ret_status = mem->Update(sequence_, key, value, kv_prot_info);
@@ -1746,10 +1919,14 @@ class MemTableInserter : public WriteBatch::Handler {
                     const ProtectionInfoKVOTS64* kv_prot_info) {
     Status ret_status;
     MemTable* mem = cf_mems_->GetMemTable();
-    ret_status =
-        mem->Add(sequence_, delete_type, key, value, kv_prot_info,
-                 concurrent_memtable_writes_, get_post_process_info(mem),
-                 hint_per_batch_ ? &GetHintMap()[mem] : nullptr);
+    if (sorted_runs_ && delete_type != kTypeRangeDeletion) {
+      ret_status = AddToSortedRun(mem, delete_type, key, value, kv_prot_info);
+    } else {
+      ret_status =
+          mem->Add(sequence_, delete_type, key, value, kv_prot_info,
+                   concurrent_memtable_writes_, get_post_process_info(mem),
+                   hint_per_batch_ ? &GetHintMap()[mem] : nullptr);
+    }
     if (UNLIKELY(ret_status.IsTryAgain())) {
       assert(seq_per_batch_);
       const bool kBatchBoundary = true;
@@ -1883,7 +2060,8 @@ class MemTableInserter : public WriteBatch::Handler {
     }
 
     Status ret_status;
-    if (UNLIKELY(!SeekToColumnFamily(column_family_id, &ret_status))) {
+    if (UNLIKELY(!SeekToColumnFamily(column_family_id, &ret_status,
+                                     true /* range_deletion */))) {
       if (ret_status.ok() && rebuilding_trx_ != nullptr) {
         assert(!write_after_commit_);
         // The CF is probably flushed and hence no need for insert but we still
@@ -1990,6 +2168,11 @@ class MemTableInserter : public WriteBatch::Handler {
       return Status::InvalidArgument(
           "Merge requires `ColumnFamilyOptions::merge_operator != nullptr`");
     }
+    // A merge may read the earlier entries of the batch from the memtable
+    ret_status = FinishSortedRun();
+    if (!ret_status.ok()) {
+      return ret_status;
+    }
     bool perform_merge = false;
     assert(!concurrent_memtable_writes_ ||
            moptions->max_successive_merges == 0);
@@ -2338,10 +2521,16 @@ Status WriteBatchInternal::InsertInto(
     SetSequence(w->batch, inserter.sequence());
     inserter.set_log_number_ref(w->log_ref);
     inserter.set_prot_info(w->batch->prot_info_.get());
+    inserter.set_sorted_runs(Count(w->batch) > 1);
     w->status = w->batch->Iterate(&inserter);
+    Status run_status = inserter.FinishSortedRun();
+    if (w->status.ok()) {
+      w->status = run_status;
+    }
     if (!w->status.ok()) {
       return w->status;
     }
+    inserter.CommitBatch();
     assert(!seq_per_batch || w->batch_cnt != 0);
     assert(!seq_per_batch || inserter.sequence() - w->sequence == w->batch_cnt);
   }
@@ -2368,7 +2557,15 @@ Status WriteBatchInternal::InsertInto(
   SetSequence(writer->batch, sequence);
   inserter.set_log_number_ref(writer->log_ref);
   inserter.set_prot_info(writer->batch->prot_info_.get());
+  inserter.set_sorted_runs(Count(writer->batch) > 1);
   Status s = writer->batch->Iterate(&inserter);
+  Status run_status = inserter.FinishSortedRun();
+  if (s.ok()) {
+    s = run_status;
+  }
+  if (s.ok()) {
+    inserter.CommitBatch();
+  }
   assert(!seq_per_batch || batch_cnt != 0);
   assert(!seq_per_batch || inserter.sequence() - sequence == batch_cnt);
   if (concurrent_memtable_writes) {
@@ -2377,6 +2574,73 @@ Status WriteBatchInternal::InsertInto(
   return s;
 }
 
+Status WriteBatchInternal::SplitIntoRanges(const WriteBatch* batch,
+                                           size_t entries_per_range,
+                                           std::vector<EntryRange>* ranges) {
+  assert(entries_per_range > 0);
+  Slice input(batch->rep_);
+  input.remove_prefix(WriteBatchInternal::kHeader);
+  Slice key, value, blob, xid;
+  uint32_t found = 0;
+  EntryRange range{WriteBatchInternal::kHeader, 0, 0};
+  while (!input.empty()) {
+    char tag = 0;
+    uint32_t column_family = 0;
+    Status s = ReadRecordFromWriteBatch(&input, &tag, &column_family, &key,
+                                        &value, &blob, &xid);
+    if (!s.ok()) {
+      return s;
+    }
+    switch (tag) {
+      case kTypeColumnFamilyValue:
+      case kTypeValue:
+      case kTypeColumnFamilyDeletion:
+      case kTypeDeletion:
+      case kTypeColumnFamilySingleDeletion:
+      case kTypeSingleDeletion:
+      case kTypeColumnFamilyRangeDeletion:
+      case kTypeRangeDeletion:
+      case kTypeColumnFamilyMerge:
+      case kTypeMerge:
+      case kTypeColumnFamilyBlobIndex:
+      case kTypeBlobIndex:
+        found++;
+        break;
+      default:
+        break;
+    }
+    if (found - range.first_entry == entries_per_range) {
+      range.end = batch->rep_.size() - input.size();
+      ranges->push_back(range);
+      range = EntryRange{range.end, 0, found};
+    }
+  }
+  if (range.begin < batch->rep_.size()) {
+    range.end = batch->rep_.size();
+    ranges->push_back(range);
+  }
+  return Status::OK();
+}
+
+Status WriteBatchInternal::InsertInto(
+    WriteThread::Writer* writer, const EntryRange& range,
+    ColumnFamilyMemTables* memtables, FlushScheduler* flush_scheduler,
+    TrimHistoryScheduler* trim_history_scheduler,
+    bool ignore_missing_column_families, DB* db, bool hint_per_batch) {
+  assert(writer->ShouldWriteToMemtable());
+  MemTableInserter inserter(
+      Sequence(writer->batch) + range.first_entry, memtables, flush_scheduler,
+      trim_history_scheduler, ignore_missing_column_families,
+      0 /* recovering_log_number */, db, true /* concurrent_memtable_writes */,
+      nullptr /* prot_info */, nullptr /*has_valid_writes*/,
+      false /* seq_per_batch */, true /* batch_per_txn */, hint_per_batch);
+  inserter.set_log_number_ref(writer->log_ref);
+  inserter.set_prot_info(writer->batch->prot_info_.get(), range.first_entry);
+  Status s = Iterate(writer->batch, &inserter, range.begin, range.end);
+  inserter.PostProcess();
+  return s;
+}
+
 Status WriteBatchInternal::InsertInto(
     const WriteBatch* batch, ColumnFamilyMemTables* memtables,
     FlushScheduler* flush_scheduler,
@@ -2389,7 +2653,15 @@ Status WriteBatchInternal::InsertInto(
                             ignore_missing_column_families, log_number, db,
                             concurrent_memtable_writes, batch->prot_info_.get(),
                             has_valid_writes, seq_per_batch, batch_per_txn);
+  inserter.set_sorted_runs(Count(batch) > 1);
   Status s = batch->Iterate(&inserter);
+  Status run_status = inserter.FinishSortedRun();
+  if (s.ok()) {
+    s = run_status;
+  }
+  if (s.ok()) {
+    inserter.CommitBatch();
+  }
   if (next_seq != nullptr) {
     *next_seq = inserter.sequence();
   }
@@ -2399,6 +2671,48 @@ Status WriteBatchInternal::InsertInto(
   return s;
 }
 
+Status WriteBatchInternal::InsertInto(
+    const Slice& contents, ColumnFamilyMemTables* memtables,
+    FlushScheduler* flush_scheduler,
+    TrimHistoryScheduler* trim_history_scheduler,
+    bool ignore_missing_column_families, uint64_t log_number, DB* db,
+    SequenceNumber* next_seq, bool* has_valid_writes, bool seq_per_batch,
+    bool batch_per_txn, const std::vector<uint32_t>* column_families) {
+  if (contents.size() < WriteBatchInternal::kHeader) {
+    return Status::Corruption("malformed WriteBatch (too small)");
+  }
+  MemTableInserter inserter(
+      DecodeFixed64(contents.data()), memtables, flush_scheduler,
+      trim_history_scheduler, ignore_missing_column_families, log_number, db,
+      false /* concurrent_memtable_writes */, nullptr /* prot_info */,
+      has_valid_writes, seq_per_batch, batch_per_txn);
+  inserter.set_column_families(column_families);
+  inserter.set_sorted_runs(DecodeFixed32(contents.data() + 8) > 1);
+  Status s = Iterate(contents, &inserter, WriteBatchInternal::kHeader,
+                     contents.size());
+  Status run_status = inserter.FinishSortedRun();
+  if (s.ok()) {
+    s = run_status;
+  }
+  if (s.ok()) {
+    inserter.CommitBatch();
+  }
+  if (next_seq != nullptr) {
+    *next_seq = inserter.sequence();
+  }
+  return s;
+}
+
+Status WriteBatchInternal::GetColumnFamilies(
+    const Slice& contents, std::vector<uint32_t>* column_families) {
+  if (contents.size() < WriteBatchInternal::kHeader) {
+    return Status::Corruption("malformed WriteBatch (too small)");
+  }
+  ColumnFamilyCollector collector(column_families);
+  return Iterate(contents, &collector, WriteBatchInternal::kHeader,
+                 contents.size());
+}
+
 Status WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= WriteBatchInternal::kHeader);
   assert(b->prot_info_ == nullptr);
@@ -190,6 +190,29 @@ class WriteBatchInternal {
       SequenceNumber* next_seq = nullptr, bool* has_valid_writes = nullptr,
       bool seq_per_batch = false, bool batch_per_txn = true);
 
+  // Same as the single batch form of InsertInto, but inserts the serialized
+  // batch `contents` in place, e.g. a WAL record that points into a file
+  // mapping, instead of a copy of it in a WriteBatch. If column_families is
+  // non-null, only the entries of those column families are inserted and the
+  // others just consume their sequence numbers, so that inserters with
+  // disjoint column family sets and their own `memtables` can insert the
+  // same batch concurrently.
+  static Status InsertInto(
+      const Slice& contents, ColumnFamilyMemTables* memtables,
+      FlushScheduler* flush_scheduler,
+      TrimHistoryScheduler* trim_history_scheduler,
+      bool ignore_missing_column_families = false, uint64_t log_number = 0,
+      DB* db = nullptr, SequenceNumber* next_seq = nullptr,
+      bool* has_valid_writes = nullptr, bool seq_per_batch = false,
+      bool batch_per_txn = true,
+      const std::vector<uint32_t>* column_families = nullptr);
+
+  // Appends the distinct column families written by the serialized batch
+  // `contents` to *column_families. Fails on batches with transaction
+  // markers.
+  static Status GetColumnFamilies(const Slice& contents,
+                                  std::vector<uint32_t>* column_families);
+
   static Status InsertInto(WriteThread::Writer* writer, SequenceNumber sequence,
                            ColumnFamilyMemTables* memtables,
                            FlushScheduler* flush_scheduler,
@@ -201,6 +224,34 @@ class WriteBatchInternal {
                            bool batch_per_txn = true,
                            bool hint_per_batch = false);
 
+  // A range of the entries of a batch: the offsets of its records in the
+  // batch contents and the index of its first entry among the entries that
+  // consume a sequence number.
+  struct EntryRange {
+    size_t begin;
+    size_t end;
+    uint32_t first_entry;
+  };
+
+  // Splits the entries of batch into ranges of entries_per_range entries,
+  // the last one possibly shorter, and appends them to *ranges.
+  static Status SplitIntoRanges(const WriteBatch* batch,
+                                size_t entries_per_range,
+                                std::vector<EntryRange>* ranges);
+
+  // Inserts a range of the batch of writer, which must consume a sequence
+  // number per key, as if by the concurrent form of InsertInto for the
+  // whole batch, so that the ranges of a batch can be inserted by several
+  // threads, each with its own `memtables`. The batch sequence number must
+  // have been set.
+  static Status InsertInto(WriteThread::Writer* writer,
+                           const EntryRange& range,
+                           ColumnFamilyMemTables* memtables,
+                           FlushScheduler* flush_scheduler,
+                           TrimHistoryScheduler* trim_history_scheduler,
+                           bool ignore_missing_column_families, DB* db,
+                           bool hint_per_batch);
+
   static Status Append(WriteBatch* dst, const WriteBatch* src,
                        const bool WAL_only = false);
 
@@ -211,11 +262,18 @@ class WriteBatchInternal {
   // Iterate over [begin, end) range of a write batch
   static Status Iterate(const WriteBatch* wb, WriteBatch::Handler* handler,
                         size_t begin, size_t end);
+  static Status Iterate(const Slice& contents, WriteBatch::Handler* handler,
+                        size_t begin, size_t end);
 
   // This write batch includes the latest state that should be persisted. Such
   // state meant to be used only during recovery.
   static void SetAsLastestPersistentState(WriteBatch* b);
   static bool IsLatestPersistentState(const WriteBatch* b);
+
+ private:
+  static Status Iterate(const Slice& rep, uint32_t content_flags,
+                        WriteBatch::Handler* handler, size_t begin,
+                        size_t end);
 };
 
 // LocalSavePoint is similar to a scope guard
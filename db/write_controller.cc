@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cmath>
 #include <ratio>
 
 #include "rocksdb/system_clock.h"
@@ -103,6 +104,96 @@ uint64_t WriteController::NowMicrosMonotonic(SystemClock* clock) {
   return clock->NowNanos() / std::milli::den;
 }
 
+constexpr double WriteRateController::kTargetPressure;
+
+uint64_t WriteRateController::Update(uint64_t now_micros, double pressure,
+                                     uint64_t compaction_needed_bytes,
+                                     uint64_t bytes_compacted, bool stopped,
+                                     uint64_t max_write_rate) {
+  const uint64_t kMinWriteRate = 16 * 1024u;  // Minimum write rate 16KB/s.
+  // Measurements closer together than this only update the engagement.
+  const uint64_t kMinIntervalMicros = 1000;
+  // Weight of the latest sample in the smoothed slope and drain rate.
+  const double kSmoothing = 0.5;
+  // Debt slopes are normalized by at least this drain rate, so that a small
+  // debt growing while nothing is being compacted does not saturate the
+  // derivative term.
+  const double kMinDrainRate = 1024.0 * 1024.0;
+  const double kProportionalGain = 1.0;
+  const double kIntegralGain = 0.5;
+  const double kDerivativeGain = 0.25;
+  const double kMaxIntegral = 2.0;
+  // Bounds of the change of the rate in one update.
+  const double kMaxDecrease = 0.7;
+  const double kMaxIncrease = 1.25;
+  // Largest fraction of the rate kept by an update while writes are stopped.
+  const double kStopRatio = 0.6;
+
+  max_write_rate = std::max(max_write_rate, kMinWriteRate);
+  pressure_ = pressure;
+  if (!initialized_) {
+    initialized_ = true;
+    write_rate_ = max_write_rate;
+    prev_time_ = now_micros;
+    prev_debt_ = compaction_needed_bytes;
+    prev_bytes_compacted_ = bytes_compacted;
+  }
+  const double error = pressure - kTargetPressure;
+  if (!engaged_ && (error > 0 || stopped)) {
+    engaged_ = true;
+    write_rate_ = max_write_rate;
+    integral_ = 0;
+  }
+  if (now_micros < prev_time_ + kMinIntervalMicros) {
+    write_rate_ = std::min(write_rate_, max_write_rate);
+    return write_rate_;
+  }
+
+  const double elapsed_secs =
+      static_cast<double>(now_micros - prev_time_) / 1000000.0;
+  const double slope = (static_cast<double>(compaction_needed_bytes) -
+                        static_cast<double>(prev_debt_)) /
+                       elapsed_secs;
+  const double drained =
+      static_cast<double>(bytes_compacted >= prev_bytes_compacted_
+                              ? bytes_compacted - prev_bytes_compacted_
+                              : 0) /
+      elapsed_secs;
+  debt_slope_ = kSmoothing * slope + (1 - kSmoothing) * debt_slope_;
+  drain_rate_ = kSmoothing * drained + (1 - kSmoothing) * drain_rate_;
+  prev_time_ = now_micros;
+  prev_debt_ = compaction_needed_bytes;
+  prev_bytes_compacted_ = bytes_compacted;
+
+  if (!engaged_) {
+    write_rate_ = max_write_rate;
+    return write_rate_;
+  }
+
+  integral_ = std::max(-kMaxIntegral,
+                       std::min(kMaxIntegral, integral_ + error * elapsed_secs));
+  const double derivative = std::max(
+      -1.0, std::min(1.0, debt_slope_ / std::max(drain_rate_, kMinDrainRate)));
+  const double control = kProportionalGain * error + kIntegralGain * integral_ +
+                   kDerivativeGain * derivative;
+  double factor =
+      std::max(kMaxDecrease, std::min(kMaxIncrease, std::exp(-control)));
+  if (stopped) {
+    // A stop trigger was reached: the rate was too high whatever the terms
+    // say.
+    factor = std::min(factor, kStopRatio);
+  }
+  write_rate_ = static_cast<uint64_t>(static_cast<double>(write_rate_) * factor);
+  write_rate_ = std::max(kMinWriteRate, std::min(max_write_rate, write_rate_));
+
+  if (error < 0 && debt_slope_ <= 0 && !stopped &&
+      write_rate_ >= max_write_rate) {
+    engaged_ = false;
+    integral_ = 0;
+  }
+  return write_rate_;
+}
+
 StopWriteToken::~StopWriteToken() {
   assert(controller_->total_stopped_ >= 1);
   --controller_->total_stopped_;
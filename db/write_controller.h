@@ -144,4 +144,55 @@ class CompactionPressureToken : public WriteControllerToken {
   virtual ~CompactionPressureToken();
 };
 
+// WriteRateController sets the write rate admitted into one column family
+// while it is under write pressure, when DBOptions::adaptive_write_stall is
+// set. It is a PID loop on the write pressure, the largest ratio of a stall
+// metric to its slowdown trigger: the proportional and integral terms act on
+// the distance of the pressure above a target set below the triggers, and
+// the derivative term on the growth rate of the compaction debt relative to
+// the measured throughput of flushes and compactions. The loop engages once
+// the pressure exceeds the target and disengages once it is back under the
+// target with the debt no longer growing and the rate back at its maximum.
+// It is updated every time the column family recalculates its write stall
+// conditions.
+// Prerequisite: DB mutex held.
+class WriteRateController {
+ public:
+  // Pressure the loop drives the column family towards, as a fraction of the
+  // slowdown triggers.
+  static constexpr double kTargetPressure = 0.8;
+
+  WriteRateController() = default;
+
+  // Takes a measurement and returns the admitted write rate in bytes per
+  // second. `compaction_needed_bytes` is the compaction debt,
+  // `bytes_compacted` the total number of bytes written by flushes and
+  // compactions so far and `stopped` whether a stop trigger stops writes.
+  uint64_t Update(uint64_t now_micros, double pressure,
+                  uint64_t compaction_needed_bytes, uint64_t bytes_compacted,
+                  bool stopped, uint64_t max_write_rate);
+
+  bool engaged() const { return engaged_; }
+  uint64_t write_rate() const { return write_rate_; }
+  double pressure() const { return pressure_; }
+  uint64_t compaction_needed_bytes() const { return prev_debt_; }
+  // Bytes per second, negative while compactions pay the debt back.
+  double debt_slope() const { return debt_slope_; }
+  // Bytes per second written by flushes and compactions.
+  double drain_rate() const { return drain_rate_; }
+  double integral() const { return integral_; }
+
+ private:
+  bool engaged_ = false;
+  bool initialized_ = false;
+  uint64_t write_rate_ = 0;
+  double pressure_ = 0;
+  double integral_ = 0;
+  double debt_slope_ = 0;
+  double drain_rate_ = 0;
+  uint64_t prev_time_ = 0;
+  uint64_t prev_debt_ = 0;
+  uint64_t prev_bytes_compacted_ = 0;
+};
+
 }  // namespace ROCKSDB_NAMESPACE
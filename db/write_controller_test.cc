@@ -239,6 +239,71 @@ TEST_F(WriteControllerTest, CreditAccumulation) {
   ASSERT_EQ(10 SECS, controller.GetDelay(clock_.get(), 10 MB));
 }
 
+TEST_F(WriteControllerTest, WriteRateController) {
+  WriteRateController controller;
+  uint64_t now = 1 SECS;
+  uint64_t debt = 10 MB;
+  uint64_t compacted = 0;
+
+  // Below the target pressure writes are not throttled
+  ASSERT_EQ(40 MBPS,
+            controller.Update(now, 0.5, debt, compacted, false, 40 MBPS));
+  ASSERT_FALSE(controller.engaged());
+
+  // Above it, the rate goes down smoothly while the debt grows faster than
+  // compactions pay it back
+  uint64_t rate = 40 MBPS;
+  for (int i = 0; i < 10; i++) {
+    now += 1 SECS;
+    debt += 20 MB;
+    compacted += 10 MB;
+    uint64_t new_rate =
+        controller.Update(now, 1.0, debt, compacted, false, 40 MBPS);
+    ASSERT_TRUE(controller.engaged());
+    ASSERT_LT(new_rate, rate);
+    ASSERT_GE(new_rate, rate / 2);
+    rate = new_rate;
+  }
+  ASSERT_GT(controller.debt_slope(), 0);
+  ASSERT_GT(controller.drain_rate(), 0);
+  ASSERT_GT(controller.integral(), 0);
+
+  // A stop cuts the rate further
+  now += 1 SECS;
+  uint64_t stopped_rate =
+      controller.Update(now, 1.0, debt, compacted, true, 40 MBPS);
+  ASSERT_LE(stopped_rate, rate * 6 / 10 + 1);
+  ASSERT_GE(stopped_rate, 16 * 1024u);
+  rate = stopped_rate;
+
+  // Measurements too close together do not change the rate
+  ASSERT_EQ(rate,
+            controller.Update(now + 10, 1.0, debt, compacted, false, 40 MBPS));
+
+  // Once compactions pay the debt back, the rate recovers step by step and
+  // the controller disengages at the maximum rate
+  int steps = 0;
+  while (controller.engaged()) {
+    now += 1 SECS;
+    debt = debt > 20 MB ? debt - 20 MB : 0;
+    compacted += 20 MB;
+    uint64_t new_rate =
+        controller.Update(now, 0.2, debt, compacted, false, 40 MBPS);
+    ASSERT_GE(new_rate, rate);
+    ASSERT_LE(new_rate, rate * 5 / 4 + 1);
+    rate = new_rate;
+    ASSERT_LT(++steps, 1000);
+  }
+  ASSERT_GT(steps, 1);
+  ASSERT_EQ(40 MBPS, rate);
+
+  // The rate never exceeds the maximum, which may change
+  now += 1 SECS;
+  ASSERT_EQ(10 MBPS,
+            controller.Update(now, 0.9, debt, compacted, false, 10 MBPS));
+  ASSERT_TRUE(controller.engaged());
+}
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
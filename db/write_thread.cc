@@ -221,6 +221,16 @@ void WriteThread::SetState(Writer* w, uint8_t new_state) {
   }
 }
 
+void WriteThread::HandOffLeadership(Writer* w) {
+  if (w->async) {
+    assert(async_leader_handler_);
+    w->state.store(STATE_GROUP_LEADER, std::memory_order_relaxed);
+    async_leader_handler_(static_cast<AsyncWriter*>(w));
+  } else {
+    SetState(w, STATE_GROUP_LEADER);
+  }
+}
+
 bool WriteThread::LinkOne(Writer* w, std::atomic<Writer*>* newest_writer) {
   assert(newest_writer != nullptr);
   assert(w->state == STATE_INIT);
@@ -396,6 +406,7 @@ void WriteThread::JoinBatchGroup(Writer* w) {
      * 2) An existing leader pick us as its follewer and
      * 2.1) finishes the memtable writes on our behalf
      * 2.2) Or tell us to finish the memtable writes in pralallel
+     * 2.3) Or tell us to write our WAL record in parallel first
      * 3) (pipelined write) An existing leader pick us as its follower and
      *    finish book-keeping and WAL write for us, enqueue us as pending
      *    memtable writer, and
@@ -405,12 +416,26 @@ void WriteThread::JoinBatchGroup(Writer* w) {
      */
     TEST_SYNC_POINT_CALLBACK("WriteThread::JoinBatchGroup:BeganWaiting", w);
     AwaitState(w, STATE_GROUP_LEADER | STATE_MEMTABLE_WRITER_LEADER |
-                      STATE_PARALLEL_MEMTABLE_WRITER | STATE_COMPLETED,
+                      STATE_PARALLEL_MEMTABLE_WRITER |
+                      STATE_PARALLEL_WAL_WRITER | STATE_COMPLETED,
                &jbg_ctx);
     TEST_SYNC_POINT_CALLBACK("WriteThread::JoinBatchGroup:DoneWaiting", w);
   }
 }
 
+bool WriteThread::JoinBatchGroupAsync(AsyncWriter* w) {
+  assert(w->batch != nullptr);
+  assert(!w->no_slowdown);
+  assert(!enable_pipelined_write_);
+
+  if (LinkOne(w, &newest_writer_)) {
+    w->state.store(STATE_GROUP_LEADER, std::memory_order_relaxed);
+    return true;
+  }
+  // w now belongs to its leader
+  return false;
+}
+
 size_t WriteThread::EnterAsBatchGroupLeader(Writer* leader,
                                             WriteGroup* write_group) {
   assert(leader->link_older == nullptr);
@@ -597,6 +622,52 @@ void WriteThread::LaunchParallelMemTableWriters(WriteGroup* write_group) {
   }
 }
 
+void WriteThread::LaunchParallelWALWriters(WriteGroup* write_group) {
+  assert(write_group != nullptr);
+  assert(write_group->log_writer != nullptr);
+  assert(write_group->wal_buf != nullptr);
+  Writer* leader = write_group->leader;
+  size_t followers = 0;
+  for (auto w : *write_group) {
+    if (w != leader && w->parallel_wal_write) {
+      followers++;
+    }
+  }
+  write_group->running.store(followers + 1);
+  // lets the leader wait in CompleteParallelWALWriter
+  leader->state.store(STATE_PARALLEL_WAL_WRITER, std::memory_order_relaxed);
+  for (auto w : *write_group) {
+    if (w != leader && w->parallel_wal_write) {
+      SetState(w, STATE_PARALLEL_WAL_WRITER);
+    }
+  }
+}
+
+static WriteThread::AdaptationContext cpwalw_ctx("CompleteParallelWALWriter");
+// This method is called by both the leader and parallel followers
+void WriteThread::CompleteParallelWALWriter(Writer* w) {
+  Writer* leader = w->write_group->leader;
+  if (w->write_group->running-- > 1) {
+    // we're not the last one, w->write_group may be gone once the leader
+    // resumes
+    if (w == leader) {
+      AwaitState(w, STATE_GROUP_LEADER, &cpwalw_ctx);
+    } else {
+      AwaitState(w, STATE_PARALLEL_MEMTABLE_WRITER | STATE_COMPLETED,
+                 &cpwalw_ctx);
+    }
+    return;
+  }
+  // else we're the last parallel worker and resume the leader
+  if (w == leader) {
+    w->state.store(STATE_GROUP_LEADER, std::memory_order_relaxed);
+  } else {
+    SetState(leader, STATE_GROUP_LEADER);
+    AwaitState(w, STATE_PARALLEL_MEMTABLE_WRITER | STATE_COMPLETED,
+               &cpwalw_ctx);
+  }
+}
+
 static WriteThread::AdaptationContext cpmtw_ctx("CompleteParallelMemTableWriter");
 // This method is called by both the leader and parallel followers
 bool WriteThread::CompleteParallelMemTableWriter(Writer* w) {
@@ -738,7 +809,7 @@ void WriteThread::ExitAsBatchGroupLeader(WriteGroup& write_group,
       // nullptr when they enqueued (we were definitely enqueued before them
       // and are still in the list).  That means leader handoff occurs when
       // we call MarkJoined
-      SetState(last_writer->link_newer, STATE_GROUP_LEADER);
+      HandOffLeadership(last_writer->link_newer);
     }
     // else nobody else was waiting, although there might already be a new
     // leader now
@@ -750,7 +821,13 @@ void WriteThread::ExitAsBatchGroupLeader(WriteGroup& write_group,
       // as it is marked committed the other thread's Await may return and
       // deallocate the Writer.
       auto next = last_writer->link_older;
-      SetState(last_writer, STATE_COMPLETED);
+      if (last_writer->async) {
+        AsyncWriter* async_writer = static_cast<AsyncWriter*>(last_writer);
+        async_writer->done(async_writer->FinalStatus());
+        delete async_writer;
+      } else {
+        SetState(last_writer, STATE_COMPLETED);
+      }
 
       last_writer = next;
     }
@@ -781,7 +858,7 @@ void WriteThread::ExitUnbatched(Writer* w) {
     Writer* next_leader = w->link_newer;
     assert(next_leader != nullptr);
     next_leader->link_older = nullptr;
-    SetState(next_leader, STATE_GROUP_LEADER);
+    HandOffLeadership(next_leader);
   }
 }
 
@@ -10,11 +10,13 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <type_traits>
 #include <vector>
 
 #include "db/dbformat.h"
+#include "db/log_writer.h"
 #include "db/pre_release_callback.h"
 #include "db/write_callback.h"
 #include "monitoring/instrumented_mutex.h"
@@ -70,6 +72,12 @@ class WriteThread {
     // A state indicating that the thread may be waiting using StateMutex()
     // and StateCondVar()
     STATE_LOCKED_WAITING = 32,
+
+    // The state used to inform a waiting writer that it should write its
+    // own WAL record into the room reserved for it by the group leader, then
+    // call CompleteParallelWALWriter. The leader is also in this state while
+    // it waits for the followers.
+    STATE_PARALLEL_WAL_WRITER = 64,
   };
 
   struct Writer;
@@ -82,6 +90,10 @@ class WriteThread {
     Status status;
     std::atomic<size_t> running;
     size_t size = 0;
+    // The log and the memory its records are written to when they are
+    // written in parallel, see LaunchParallelWALWriters
+    log::Writer* log_writer = nullptr;
+    char* wal_buf = nullptr;
 
     struct Iterator {
       Writer* writer;
@@ -130,6 +142,10 @@ class WriteThread {
     SequenceNumber sequence;  // the sequence number to use for the first key
     Status status;
     Status callback_status;   // status returned by callback->Callback()
+    // where the WAL record of the writer goes in a parallel WAL write
+    log::Writer::ReservedRecord wal_record;
+    bool parallel_wal_write;  // the writer writes wal_record itself
+    bool async;               // an AsyncWriter, no thread waits on it
 
     std::aligned_storage<sizeof(std::mutex)>::type state_mutex_bytes;
     std::aligned_storage<sizeof(std::condition_variable)>::type state_cv_bytes;
@@ -152,6 +168,8 @@ class WriteThread {
           state(STATE_INIT),
           write_group(nullptr),
           sequence(kMaxSequenceNumber),
+          parallel_wal_write(false),
+          async(false),
           link_older(nullptr),
           link_newer(nullptr) {}
 
@@ -174,6 +192,8 @@ class WriteThread {
           state(STATE_INIT),
           write_group(nullptr),
           sequence(kMaxSequenceNumber),
+          parallel_wal_write(false),
+          async(false),
           link_older(nullptr),
           link_newer(nullptr) {}
 
@@ -250,6 +270,24 @@ class WriteThread {
     }
   };
 
+  // A writer of DB::WriteAsync. No thread waits on it: it is heap allocated,
+  // and whoever completes it calls done with its final status and deletes
+  // it. When it is handed leadership, the async leader handler leads its
+  // group on its behalf.
+  struct AsyncWriter : public Writer {
+    WriteOptions write_options;
+    std::function<void(const Status&)> done;
+
+    AsyncWriter(const WriteOptions& _write_options, WriteBatch* _batch,
+                std::function<void(const Status&)>&& _done)
+        : Writer(_write_options, _batch, nullptr /*callback*/, 0 /*log_ref*/,
+                 false /*disable_memtable*/),
+          write_options(_write_options),
+          done(std::move(_done)) {
+      async = true;
+    }
+  };
+
   struct AdaptationContext {
     const char* name;
     std::atomic<int32_t> value;
@@ -281,6 +319,23 @@ class WriteThread {
   // Writer* w:        Writer to be executed as part of a batch group
   void JoinBatchGroup(Writer* w);
 
+  // Registers w as ready to become part of a batch group without waiting.
+  // Returns true if w has become the leader of a write batch group, and the
+  // caller should lead it as it would after JoinBatchGroup. Otherwise w is
+  // owned by the write thread and may already be gone when this returns.
+  //
+  // Like JoinBatchGroup this blocks during a write stall, so w must not
+  // have no_slowdown set and the db mutex SHOULD NOT be held.
+  bool JoinBatchGroupAsync(AsyncWriter* w);
+
+  // Sets the function that leads the group of an AsyncWriter which is handed
+  // leadership by another writer. It is called from the thread of the
+  // previous leader, possibly with the db mutex held, so it should pass the
+  // writer on to another thread rather than lead in place.
+  void SetAsyncLeaderHandler(std::function<void(AsyncWriter*)> handler) {
+    async_leader_handler_ = std::move(handler);
+  }
+
   // Constructs a write batch group led by leader, which should be a
   // Writer passed to JoinBatchGroup on the current thread.
   //
@@ -290,7 +345,8 @@ class WriteThread {
   size_t EnterAsBatchGroupLeader(Writer* leader, WriteGroup* write_group);
 
   // Unlinks the Writer-s in a batch group, wakes up the non-leaders,
-  // and wakes up the next leader (if any).
+  // and wakes up the next leader (if any). Async non-leaders are completed
+  // here, the leader is left to the caller.
   //
   // WriteGroup* write_group: the write group
   // Status status:           Status of write operation
@@ -324,6 +380,20 @@ class WriteThread {
   // someone else has already taken responsibility for that.
   bool CompleteParallelMemTableWriter(Writer* w);
 
+  // Causes JoinBatchGroup to return STATE_PARALLEL_WAL_WRITER for the
+  // non-leader members of the group with parallel_wal_write set, so each of
+  // them writes its own WAL record. write_group->log_writer, wal_buf and the
+  // wal_record of those writers must be set before.
+  //
+  // WriteGroup* write_group: Extra state used to coordinate the parallel write
+  void LaunchParallelWALWriters(WriteGroup* write_group);
+
+  // Reports that w wrote its WAL record. If w is the group leader, waits for
+  // the followers to write theirs and returns in STATE_GROUP_LEADER.
+  // Otherwise waits until the leader moves w on to
+  // STATE_PARALLEL_MEMTABLE_WRITER or STATE_COMPLETED.
+  void CompleteParallelWALWriter(Writer* w);
+
   // Waits for all preceding writers (unlocking mu while waiting), then
   // registers w as the currently proceeding writer.
   //
@@ -393,6 +463,9 @@ class WriteThread {
   port::Mutex stall_mu_;
   port::CondVar stall_cv_;
 
+  // Leads the groups of AsyncWriter-s that are handed leadership
+  std::function<void(AsyncWriter*)> async_leader_handler_;
+
   // Waits for w->state & goal_mask using w->StateMutex().  Returns
   // the state that satisfies goal_mask.
   uint8_t BlockingAwaitState(Writer* w, uint8_t goal_mask);
@@ -406,6 +479,10 @@ class WriteThread {
   // Set writer state and wake the writer up if it is waiting.
   void SetState(Writer* w, uint8_t new_state);
 
+  // Makes w the leader of the next batch group, passing it to
+  // async_leader_handler_ if no thread waits on it.
+  void HandOffLeadership(Writer* w);
+
   // Links w into the newest_writer list. Return true if w was linked directly
   // into the leader position.  Safe to call from multiple threads without
   // external locking.
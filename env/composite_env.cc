@@ -91,6 +91,7 @@ class CompositeRandomAccessFileWrapper : public RandomAccessFile {
     target_->Hint((FSRandomAccessFile::AccessPattern)pattern);
   }
   bool use_direct_io() const override { return target_->use_direct_io(); }
+  bool use_mmap_reads() const override { return target_->use_mmap_reads(); }
   size_t GetRequiredBufferAlignment() const override {
     return target_->GetRequiredBufferAlignment();
   }
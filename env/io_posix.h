@@ -296,6 +296,7 @@ class PosixMmapReadableFile : public FSRandomAccessFile {
   virtual IOStatus Read(uint64_t offset, size_t n, const IOOptions& opts,
                         Slice* result, char* scratch,
                         IODebugContext* dbg) const override;
+  virtual bool use_mmap_reads() const override { return true; }
   virtual IOStatus InvalidateCache(size_t offset, size_t length) override;
 };
 
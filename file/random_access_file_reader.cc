@@ -147,7 +147,8 @@ Status RandomAccessFileReader::Read(const IOOptions& opts, uint64_t offset,
           // the opts.timeout before calling file_->Read
           assert(!opts.timeout.count() || allowed == n);
           s = file_->Read(offset + pos, allowed, opts, &tmp_result,
-                          scratch + pos, nullptr);
+                          scratch == nullptr ? nullptr : scratch + pos,
+                          nullptr);
         }
 #ifndef ROCKSDB_LITE
         if (ShouldNotifyListeners()) {
@@ -111,7 +111,8 @@ class RandomAccessFileReader {
   RandomAccessFileReader& operator=(const RandomAccessFileReader&) = delete;
 
   // In non-direct IO mode,
-  // 1. if using mmap, result is stored in a buffer other than scratch;
+  // 1. if using mmap, result is stored in a buffer other than scratch, and
+  // scratch can be null if use_mmap_reads() is true;
   // 2. if not using mmap, result is stored in the buffer starting from scratch.
   //
   // In direct IO mode, an aligned buffer is allocated internally.
@@ -142,6 +143,8 @@ class RandomAccessFileReader {
 
   bool use_direct_io() const { return file_->use_direct_io(); }
 
+  bool use_mmap_reads() const { return file_->use_mmap_reads(); }
+
   IOStatus PrepareIOOptions(const ReadOptions& ro, IOOptions& opts);
 };
 }  // namespace ROCKSDB_NAMESPACE
@@ -136,6 +136,31 @@ IOStatus WritableFileWriter::Pad(const size_t pad_bytes) {
   return IOStatus::OK();
 }
 
+IOStatus WritableFileWriter::ReserveAppend(size_t n, char** buf) {
+  if (use_direct_io()) {
+    return IOStatus::NotSupported("ReserveAppend with direct I/O");
+  }
+  IOStatus s;
+  if (buf_.CurrentSize() > 0) {
+    s = Flush();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return writable_file_->ReserveAppend(n, buf, IOOptions(), nullptr);
+}
+
+IOStatus WritableFileWriter::CommitReserved(const char* buf, size_t n) {
+  assert(buf_.CurrentSize() == 0);
+  IOStatus s = writable_file_->CommitReserved(n, IOOptions(), nullptr);
+  if (s.ok()) {
+    UpdateFileChecksum(Slice(buf, n));
+    pending_sync_ = true;
+    filesize_ += n;
+  }
+  return s;
+}
+
 IOStatus WritableFileWriter::Close() {
   // Do not quit immediately on failure the file MUST be closed
   IOStatus s;
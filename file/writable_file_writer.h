@@ -225,6 +225,18 @@ class WritableFileWriter {
   // returns NotSupported status.
   IOStatus SyncWithoutFlush(bool use_fsync);
 
+  // In place appends from several threads, see FSWritableFile::
+  // ReserveAppend(). Returns NotSupported if the file does not support them,
+  // or uses direct I/O. Flushes the buffer first.
+  IOStatus ReserveAppend(size_t n, char** buf);
+
+  void CopyToReserved(char* dst, const Slice& data) {
+    writable_file_->CopyToReserved(dst, data);
+  }
+
+  // REQUIRES: buf and n as returned and passed to the last ReserveAppend()
+  IOStatus CommitReserved(const char* buf, size_t n);
+
   uint64_t GetFileSize() const { return filesize_; }
 
   IOStatus InvalidateCache(size_t offset, size_t length) {
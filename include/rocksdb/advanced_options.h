@@ -276,6 +276,24 @@ struct AdvancedColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   size_t inplace_update_num_locks = 10000;
 
+  // If > 0, a memtable keeps a hash table of this many slots that remember
+  // the latest put of recently written keys. When a key is put again by the
+  // same write group, or by the same WriteBatch with concurrent memtable
+  // writes, the new value overwrites the value of the earlier put in place
+  // if it is not larger, instead of adding an entry for every version.
+  // Superseded versions of a group are not visible to any reader or snapshot
+  // before the group is published, so only the memtable of workloads that
+  // overwrite a few hot keys at a high rate fills more slowly; the WAL still
+  // logs every write.
+  //
+  // Not used with inplace_update_support or with persistent memtable reps.
+  // Incompatible with unordered_write.
+  //
+  // Default: 0 (disabled)
+  //
+  // Dynamically changeable through SetOptions() API
+  size_t memtable_hot_key_slots = 0;
+
   // existing_value - pointer to previous value (from both memtable and sst).
   //                  nullptr if key doesn't exist
   // existing_value_size - pointer to size of existing_value).
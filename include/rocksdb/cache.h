@@ -23,8 +23,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 #include "rocksdb/memory_allocator.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/statistics.h"
@@ -34,6 +36,7 @@ namespace ROCKSDB_NAMESPACE {
 
 class Cache;
 struct ConfigOptions;
+class SecondaryCache;
 
 extern const bool kDefaultToAdaptiveMutex;
 
@@ -44,6 +47,18 @@ enum CacheMetadataChargePolicy {
 const CacheMetadataChargePolicy kDefaultCacheMetadataChargePolicy =
     kFullChargeCacheMetadata;
 
+// Counters of one shard of a sharded cache, see Cache::GetShardStats().
+struct CacheShardStats {
+  // Current capacity and usage of the shard
+  size_t capacity = 0;
+  size_t usage = 0;
+  // Lookups that found, or didn't find, their key in the shard
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Operations that found the shard locked by another thread
+  uint64_t lock_waits = 0;
+};
+
 struct LRUCacheOptions {
   // Capacity of the cache.
   size_t capacity = 0;
@@ -87,6 +102,43 @@ struct LRUCacheOptions {
   CacheMetadataChargePolicy metadata_charge_policy =
       kDefaultCacheMetadataChargePolicy;
 
+  // A SecondaryCache instance to use as the non-volatile tier. Entries
+  // inserted with a CacheItemHelper are demoted into it when evicted, and
+  // looked up in it on a miss. See SecondaryCache.
+  std::shared_ptr<SecondaryCache> secondary_cache;
+
+  // If true, every shard keeps a count-min sketch of the recent lookups of
+  // its keys (TinyLFU), and an insertion that has to evict entries is only
+  // admitted if its key was looked up more often recently than the key of
+  // the least recently used entry. Blocks read once, e.g. by a scan, then
+  // don't push frequently read blocks out of the cache. A rejected entry
+  // inserted with a handle is still returned through the handle, and freed
+  // once released.
+  bool use_admission_filter = false;
+
+  // If not nullptr, the admission filter records the
+  // CACHE_ADMISSION_ADMITTED and CACHE_ADMISSION_REJECTED tickers into it.
+  std::shared_ptr<Statistics> admission_statistics;
+
+  // If true, the capacity is periodically moved, a small step at a time, from
+  // the shard that missed the fewest lookups since the last rebalancing to
+  // the shard that missed the most, so that the shards holding hot keys get
+  // more of the cache. A shard never gets less than a quarter or more than
+  // four times its even share. SetCapacity() restores the even split.
+  bool adaptive_shard_capacity = false;
+
+  // If true and num_shard_bits is negative, the number of shards is derived
+  // from the number of cores, about two shards per core to keep the lock
+  // contention low, instead of from the capacity alone. Every shard is still
+  // at least 512KB.
+  bool shard_bits_from_cores = false;
+
+  // If true, every shard counts its lookup hits and misses and the
+  // acquisitions of its mutex that had to wait, see Cache::GetShardStats().
+  // The counters are shared by all the threads using a shard, so this adds
+  // contended writes to every lookup.
+  bool track_shard_stats = false;
+
   LRUCacheOptions() {}
   LRUCacheOptions(size_t _capacity, int _num_shard_bits,
                   bool _strict_capacity_limit, double _high_pri_pool_ratio,
@@ -117,15 +169,17 @@ extern std::shared_ptr<Cache> NewLRUCache(
     std::shared_ptr<MemoryAllocator> memory_allocator = nullptr,
     bool use_adaptive_mutex = kDefaultToAdaptiveMutex,
     CacheMetadataChargePolicy metadata_charge_policy =
-        kDefaultCacheMetadataChargePolicy);
+        kDefaultCacheMetadataChargePolicy,
+    const std::shared_ptr<SecondaryCache>& secondary_cache = nullptr);
 
 extern std::shared_ptr<Cache> NewLRUCache(const LRUCacheOptions& cache_opts);
 
 // Similar to NewLRUCache, but create a cache based on CLOCK algorithm with
-// better concurrent performance in some cases. See util/clock_cache.cc for
-// more detail.
+// better concurrent performance in some cases. Lookups and releases don't
+// take a lock, and entries inserted with Priority::HIGH survive more passes
+// of the clock. See cache/clock_cache.cc for more detail.
 //
-// Return nullptr if it is not supported.
+// Return nullptr if it is not supported (in ROCKSDB_LITE).
 extern std::shared_ptr<Cache> NewClockCache(
     size_t capacity, int num_shard_bits = -1,
     bool strict_capacity_limit = false,
@@ -167,6 +221,34 @@ class Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle {};
 
+  // The type of the deleter passed to Insert().
+  using DeleterFn = void (*)(const Slice& key, void* value);
+
+  // A set of callbacks that let a cache save an entry to a SecondaryCache,
+  // e.g. when it is evicted. The value is saved in a serialized form of
+  // size_cb(value) bytes, written in one or more pieces by saveto_cb, and
+  // del_cb plays the role of the deleter passed to Insert().
+  using SizeCallback = size_t (*)(void* obj);
+  using SaveToCallback = Status (*)(void* from_obj, size_t from_offset,
+                                    size_t length, void* out);
+
+  struct CacheItemHelper {
+    SizeCallback size_cb;
+    SaveToCallback saveto_cb;
+    DeleterFn del_cb;
+
+    CacheItemHelper() : size_cb(nullptr), saveto_cb(nullptr), del_cb(nullptr) {}
+    CacheItemHelper(SizeCallback _size_cb, SaveToCallback _saveto_cb,
+                    DeleterFn _del_cb)
+        : size_cb(_size_cb), saveto_cb(_saveto_cb), del_cb(_del_cb) {}
+  };
+
+  // Rebuilds a value from the size bytes of its serialized form at buf,
+  // which are only valid during the call and must not be modified. Returns
+  // the new value in *out_obj and its charge in *charge.
+  using CreateCallback = std::function<Status(void* buf, size_t size,
+                                              void** out_obj, size_t* charge)>;
+
   // The type of the Cache
   virtual const char* Name() const = 0;
 
@@ -190,6 +272,19 @@ class Cache {
                         Handle** handle = nullptr,
                         Priority priority = Priority::LOW) = 0;
 
+  // Like Insert() above, but the entry can also be saved to a secondary
+  // cache using the callbacks in helper, which must outlive the entry.
+  // Caches without a secondary cache ignore everything but helper->del_cb.
+  virtual Status Insert(const Slice& key, void* value,
+                        const CacheItemHelper* helper, size_t charge,
+                        Handle** handle = nullptr,
+                        Priority priority = Priority::LOW) {
+    if (helper == nullptr) {
+      return Status::InvalidArgument();
+    }
+    return Insert(key, value, charge, helper->del_cb, handle, priority);
+  }
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -199,6 +294,31 @@ class Cache {
   // function.
   virtual Handle* Lookup(const Slice& key, Statistics* stats = nullptr) = 0;
 
+  // Like Lookup() above, but on a miss the key is also looked up in the
+  // secondary cache, if any. A value found there is rebuilt by create_cb and
+  // inserted with the given helper and priority.
+  //
+  // If wait is false, the returned handle may still be pending on the
+  // secondary cache lookup. Its value may only be read after IsReady()
+  // returned true, or Wait() or WaitAll() returned, and is nullptr if the
+  // lookup eventually failed. A pending handle has to be released like any
+  // other handle.
+  virtual Handle* Lookup(const Slice& key, const CacheItemHelper* /*helper*/,
+                         const CreateCallback& /*create_cb*/,
+                         Priority /*priority*/, bool /*wait*/,
+                         Statistics* stats = nullptr) {
+    return Lookup(key, stats);
+  }
+
+  // Returns whether the value of a handle returned by Lookup() is ready.
+  virtual bool IsReady(Handle* /*handle*/) { return true; }
+
+  // Waits until the value of a handle returned by Lookup() is ready.
+  virtual void Wait(Handle* /*handle*/) {}
+
+  // Waits until the values of all the handles are ready.
+  virtual void WaitAll(std::vector<Handle*>& /*handles*/) {}
+
   // Increments the reference count for the handle if it refers to an entry in
   // the cache. Returns true if refcount was incremented; otherwise, returns
   // false.
@@ -285,6 +405,15 @@ class Cache {
 
   virtual std::string GetPrintableOptions() const { return ""; }
 
+  // Fills stats with the counters of every shard of the cache, to spot the
+  // shards whose keys are hot or whose lock is contended. Caches that are not
+  // sharded return no stats. The hits and lock waits are only counted with
+  // LRUCacheOptions::track_shard_stats, and the misses also with
+  // LRUCacheOptions::adaptive_shard_capacity.
+  virtual void GetShardStats(std::vector<CacheShardStats>* stats) const {
+    stats->clear();
+  }
+
   MemoryAllocator* memory_allocator() const { return memory_allocator_.get(); }
 
  private:
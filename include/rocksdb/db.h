@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -397,6 +398,23 @@ class DB {
   // Note: consider setting options.sync = true.
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
 
+  // Like Write, but without waiting for the updates to be committed by
+  // another writer. `callback` is called exactly once with the status Write
+  // would have returned, possibly on another thread and before WriteAsync
+  // returns. `updates` must be kept alive until then.
+  //
+  // The calling thread may still block: when it is picked to lead a write
+  // group it performs the group's writes before returning, and it waits out
+  // a write stall like Write. Configurations the write queue cannot run
+  // without a waiting thread, such as options.no_slowdown, low_pri and
+  // pipelined, unordered or two-queue writes, fall back to Write.
+  //
+  // `callback` should be short and must not close the DB.
+  virtual void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                          std::function<void(Status)> callback) {
+    callback(Write(options, updates));
+  }
+
   // If the database contains an entry for "key" store the
   // corresponding value in *value and return OK.
   //
@@ -763,6 +781,12 @@ class DB {
     //      of files per level and total size of each level (MB).
     static const std::string kLevelStats;
 
+    //  "rocksdb.pathstats" - returns multi-line string containing the number
+    //      and total size (MB) of the live files in each of the column
+    //      family's paths, and the bytes (MB) and files written into each path
+    //      by flushes and compactions.
+    static const std::string kPathStats;
+
     //  "rocksdb.num-immutable-mem-table" - returns number of immutable
     //      memtables that have not yet been flushed.
     static const std::string kNumImmutableMemTable;
@@ -906,6 +930,14 @@ class DB {
     //  "rocksdb.is-write-stopped" - Return 1 if write has been stopped.
     static const std::string kIsWriteStopped;
 
+    //  "rocksdb.write-stall-controller" - returns a multi-line string with the
+    //      state of the column family's write rate controller: whether it
+    //      throttles writes, the admitted write rate, the write pressure, the
+    //      compaction debt and its slope and the rate at which flushes and
+    //      compactions write. Also available as a "map" property. Only
+    //      available with DBOptions::adaptive_write_stall.
+    static const std::string kWriteStallController;
+
     //  "rocksdb.estimate-oldest-key-time" - returns an estimation of
     //      oldest key timestamp in the DB. Currently only available for
     //      FIFO compaction with
@@ -757,6 +757,11 @@ class RandomAccessFile {
   // uses direct IO.
   virtual bool use_direct_io() const { return false; }
 
+  // Indicates the upper layers if Read() always returns slices pointing into
+  // a memory mapping that lives as long as this file, without ever writing
+  // to scratch. Callers may then pass a null scratch buffer.
+  virtual bool use_mmap_reads() const { return false; }
+
   // Use the returned alignment value to allocate
   // aligned buffer for Direct I/O
   virtual size_t GetRequiredBufferAlignment() const { return kDefaultPageSize; }
@@ -1550,6 +1555,7 @@ class RandomAccessFileWrapper : public RandomAccessFile {
   }
   void Hint(AccessPattern pattern) override { target_->Hint(pattern); }
   bool use_direct_io() const override { return target_->use_direct_io(); }
+  bool use_mmap_reads() const override { return target_->use_mmap_reads(); }
   size_t GetRequiredBufferAlignment() const override {
     return target_->GetRequiredBufferAlignment();
   }
@@ -20,6 +20,7 @@
 
 #include <chrono>
 #include <cstdarg>
+#include <cstring>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -709,6 +710,11 @@ class FSRandomAccessFile {
   // uses direct IO.
   virtual bool use_direct_io() const { return false; }
 
+  // Indicates the upper layers if Read() always returns slices pointing into
+  // a memory mapping that lives as long as this file, without ever writing
+  // to scratch. Callers may then pass a null scratch buffer.
+  virtual bool use_mmap_reads() const { return false; }
+
   // Use the returned alignment value to allocate
   // aligned buffer for Direct I/O
   virtual size_t GetRequiredBufferAlignment() const { return kDefaultPageSize; }
@@ -943,6 +949,28 @@ class FSWritableFile {
     return IOStatus::OK();
   }
 
+  // Lets several threads fill the end of the file at once. ReserveAppend()
+  // makes room for n bytes after the data appended so far and sets *buf to
+  // the memory they go to. They are written with CopyToReserved(), which
+  // can be called concurrently for disjoint ranges, and become part of the
+  // file, as if passed to Append(), once CommitReserved() is called. No
+  // other write may be issued in between. Typically only supported by
+  // memory mapped files.
+  virtual IOStatus ReserveAppend(size_t /*n*/, char** /*buf*/,
+                                 const IOOptions& /*options*/,
+                                 IODebugContext* /*dbg*/) {
+    return IOStatus::NotSupported("ReserveAppend");
+  }
+
+  virtual void CopyToReserved(char* dst, const Slice& data) {
+    memcpy(dst, data.data(), data.size());
+  }
+
+  virtual IOStatus CommitReserved(size_t /*n*/, const IOOptions& /*options*/,
+                                  IODebugContext* /*dbg*/) {
+    return IOStatus::NotSupported("CommitReserved");
+  }
+
   // If you're adding methods here, remember to add them to
   // WritableFileWrapper too.
 
@@ -1330,6 +1358,7 @@ class FSRandomAccessFileWrapper : public FSRandomAccessFile {
   };
   void Hint(AccessPattern pattern) override { target_->Hint(pattern); }
   bool use_direct_io() const override { return target_->use_direct_io(); }
+  bool use_mmap_reads() const override { return target_->use_mmap_reads(); }
   size_t GetRequiredBufferAlignment() const override {
     return target_->GetRequiredBufferAlignment();
   }
@@ -1436,6 +1465,20 @@ class FSWritableFileWrapper : public FSWritableFile {
     return target_->Allocate(offset, len, options, dbg);
   }
 
+  IOStatus ReserveAppend(size_t n, char** buf, const IOOptions& options,
+                         IODebugContext* dbg) override {
+    return target_->ReserveAppend(n, buf, options, dbg);
+  }
+
+  void CopyToReserved(char* dst, const Slice& data) override {
+    target_->CopyToReserved(dst, data);
+  }
+
+  IOStatus CommitReserved(size_t n, const IOOptions& options,
+                          IODebugContext* dbg) override {
+    return target_->CommitReserved(n, options, dbg);
+  }
+
  private:
   FSWritableFile* target_;
 };
@@ -38,8 +38,10 @@
 #include <rocksdb/slice.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -157,6 +159,22 @@ class MemTableRep {
     return true;
   }
 
+  // Inserts num_keys keys, in increasing order, as if by InsertKey(). Returns
+  // the number of leading keys inserted, which is less than num_keys only if
+  // MemTableRepFactory::CanHandleDuplicatedKey() is true and the <key, seq>
+  // of the next key already exists.
+  //
+  // Skip-list based memtables link a sorted run in one pass over the list.
+  // Other implementations fall back to InsertKey() by default.
+  virtual size_t InsertSortedRun(const KeyHandle* handles, size_t num_keys) {
+    for (size_t i = 0; i < num_keys; i++) {
+      if (!InsertKey(handles[i])) {
+        return i;
+      }
+    }
+    return num_keys;
+  }
+
   // Returns true iff an entry that compares equal to key is in the collection.
   virtual bool Contains(const char* key) const = 0;
 
@@ -174,6 +192,39 @@ class MemTableRep {
   // of time. Otherwise, RocksDB may be blocked.
   virtual void MarkFlushed() {}
 
+  // Returns true if the entries are kept in persistent storage, e.g. on
+  // persistent memory, and survive the rep until MarkFlushed() is called.
+  // When the DB is opened, the first rep of every column family is given the
+  // entries of the earlier reps that were destroyed without being flushed,
+  // e.g. by a crash, see Recover().
+  virtual bool IsPersistent() const { return false; }
+
+  // The column families and table files of the DB, as recovered from the
+  // MANIFEST.
+  struct RecoveredState {
+    // Returns true if the table file is in the column family of the rep
+    std::function<bool(uint64_t file_number)> is_live_table_file;
+    // Ids of the column families of the DB
+    std::vector<uint32_t> column_families;
+  };
+
+  // Called on a persistent rep when the DB is opened, before any write.
+  // Adds the entries of the earlier reps of the column family, except for
+  // those of a rep whose flush result is in a live table file.
+  virtual void Recover(const RecoveredState& /*state*/) {}
+
+  // Called on a persistent rep once a flush wrote its entries to the table
+  // file file_number, before the file is installed in the MANIFEST.
+  //
+  // Invariant: MarkReadOnly() is called, before MarkFlushPending().
+  virtual void MarkFlushPending(uint64_t /*file_number*/) {}
+
+  // Called on a persistent rep once all the entries of a write batch were
+  // inserted, with the largest sequence number they have. Only the entries
+  // of committed batches are recovered, so a crash never exposes half of a
+  // batch.
+  virtual void CommitBatch(uint64_t /*seq*/) {}
+
   // Look up key from the mem table, since the first key in the mem table whose
   // user_key matches the one given k, call the function callback_func(), with
   // callback_args directly forwarded as the first parameter, and the mem table
@@ -381,5 +432,27 @@ extern MemTableRepFactory* NewHashLinkListRepFactory(
     bool if_log_bucket_dist_when_flash = true,
     uint32_t threshold_use_skiplist = 256);
 
+// This creates MemTableReps that split the key space into up to
+// num_partitions ranges and keep each range in a skip list of its own, so
+// that concurrent writers to different ranges do not contend on the same
+// skip list nodes. The ranges of a memtable are the quantiles of the keys
+// sampled by the memtable it replaces, up to its creation, so the first
+// memtable has a single range. Iterators visit the ranges in key order.
+extern MemTableRepFactory* NewPartitionedSkipListRepFactory(
+    size_t num_partitions = 16);
+
+// This creates MemTableReps that hash the prefixes of the keys, as given by
+// the prefix extractor, into buckets of sorted vectors. An insert appends
+// the key to an unsorted tail of its bucket, which is sorted into a run once
+// it holds run_size keys; the runs of a bucket are merged as they grow, up to
+// 16 * run_size keys, which bounds the work of an insert under the bucket
+// lock. Lookups search the runs of one bucket, and total order iterators,
+// e.g. of a flush, merge the runs of all the buckets. Without a prefix
+// extractor all the keys share one bucket.
+// @bucket_count: number of fixed array buckets
+// @run_size: number of keys appended to a bucket before they are sorted
+extern MemTableRepFactory* NewHashVectorRepFactory(size_t bucket_count = 50000,
+                                                   size_t run_size = 64);
+
 #endif  // ROCKSDB_LITE
 }  // namespace ROCKSDB_NAMESPACE
@@ -280,6 +280,19 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // Default: empty
   std::vector<DbPath> cf_paths;
 
+  // If non-negative and there are at least two paths, flushes and automatic
+  // level compactions write the files of levels 0 to first_path_max_level
+  // into the first path, regardless of its target_size, and the files of
+  // deeper levels into the remaining paths, picked by target_size as usual.
+  // This keeps the upper levels on a fast tier, e.g. a pmem directory listed
+  // in PMEnvOptions::sst_paths, while compactions migrate the data to the
+  // slower paths as it moves down the tree. Manual compactions still write
+  // to CompactRangeOptions::target_path_id.
+  //
+  // Only supported with level compaction.
+  // Default: -1 (disabled)
+  int first_path_max_level = -1;
+
   // Compaction concurrent thread limiter for the column family.
   // If non-nullptr, use given concurrent thread limiter to control
   // the max outstanding compaction tasks. Limiter can be shared with
@@ -907,6 +920,19 @@ struct DBOptions {
   // Dynamically changeable through SetDBOptions() API.
   uint64_t delayed_write_rate = 0;
 
+  // If true, the write rate of a column family under write pressure is set
+  // by a feedback controller instead of being stepped down and up by fixed
+  // ratios around the slowdown triggers. The controller measures how close
+  // the column family is to its slowdown triggers, how fast its compaction
+  // debt grows and how fast flushes and compactions drain it, starts
+  // throttling writes before a trigger is reached and adjusts the admitted
+  // rate, bounded by delayed_write_rate, every time the LSM tree changes.
+  // The stop triggers still stop writes. The state of the controller is
+  // reported by the "rocksdb.write-stall-controller" property.
+  //
+  // Default: false
+  bool adaptive_write_stall = false;
+
   // By default, a single write thread queue is maintained. The thread gets
   // to the head of the queue becomes write batch group leader and responsible
   // for writing to WAL and memtable for the batch group.
@@ -948,6 +974,19 @@ struct DBOptions {
   // Default: false
   bool unordered_write = false;
 
+  // If true, the members of a write group write their own WAL records in
+  // parallel, each copying and checksumming its batch, instead of the group
+  // leader writing the whole group as one record. The leader only reserves
+  // room for the records and publishes them once they are all written. This
+  // requires a WAL file that can be written in place, i.e. whose
+  // FSWritableFile supports ReserveAppend(), such as the WAL files of
+  // PMFileSystem; otherwise the option has no effect. Large batches benefit
+  // the most. Not used with enable_pipelined_write, two_write_queues or
+  // manual_wal_flush.
+  //
+  // Default: false
+  bool enable_parallel_wal_write = false;
+
   // If true, allow multi-writers to update mem tables in parallel.
   // Only some memtable_factory-s support concurrent writes; currently it
   // is implemented only for SkipListFactory.  Concurrent memtable writes
@@ -958,6 +997,17 @@ struct DBOptions {
   // Default: true
   bool allow_concurrent_memtable_write = true;
 
+  // Maximum number of threads that insert a single large WriteBatch into the
+  // memtables when allow_concurrent_memtable_write is set. The entries of
+  // the batch are split into ranges that are inserted concurrently by the
+  // writing thread and up to batch_insert_threads - 1 helper threads of the
+  // DB, which are shared by all the writers. Batches with merges or
+  // transaction markers, and writes with seq_per_batch, are always inserted
+  // by one thread.
+  //
+  // Default: 1
+  int batch_insert_threads = 1;
+
   // If true, threads synchronizing with the write batch group leader will
   // wait for up to write_thread_max_yield_usec before blocking on a mutex.
   // This can substantially improve throughput for concurrent workloads,
@@ -1157,6 +1207,15 @@ struct DBOptions {
   // Default: false
   bool best_efforts_recovery = false;
 
+  // Maximum number of threads that insert a single large WriteBatch into the
+  // memtables while recovering from the WAL. The column families written by
+  // the batch are split among the threads. Values greater than 1 only help
+  // when large batches write several column families; batches with
+  // transaction markers are always inserted by one thread.
+  //
+  // Default: 1
+  int wal_recovery_threads = 1;
+
   // It defines how many times db resume is called by a separate thread when
   // background retryable IO Error happens. When background retryable IO
   // Error happens, SetBGError is called to deal with the error. If the error
@@ -67,6 +67,9 @@ struct PerfContext {
   uint64_t block_cache_hit_count;      // total number of block cache hits
   uint64_t block_read_count;           // total number of block reads (with IO)
   uint64_t block_read_byte;            // total number of bytes from block reads
+  // total number of bytes copied into buffers by block reads, including
+  // decompressed output; blocks used in place from a file mapping add none
+  uint64_t block_read_copy_byte;
   uint64_t block_read_time;            // total nanos spent on block reads
   uint64_t block_cache_index_hit_count;   // total number of index block hits
   uint64_t index_block_read_count;        // total number of index block reads
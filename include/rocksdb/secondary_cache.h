@@ -0,0 +1,138 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/cache.h"
+#include "rocksdb/compression_type.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class FileSystem;
+
+// The result of a SecondaryCache lookup. The lookup may complete
+// asynchronously, in which case Value() and Size() may only be called once
+// IsReady() returned true or Wait() returned.
+class SecondaryCacheResultHandle {
+ public:
+  virtual ~SecondaryCacheResultHandle() {}
+
+  // Returns whether the lookup is complete.
+  virtual bool IsReady() = 0;
+
+  // Blocks until the lookup is complete.
+  virtual void Wait() = 0;
+
+  // The value rebuilt by the CreateCallback of the lookup, or nullptr if the
+  // lookup failed. The caller takes ownership of it.
+  virtual void* Value() = 0;
+
+  // The charge of the value, as returned by the CreateCallback.
+  virtual size_t Size() = 0;
+};
+
+// A cache tier below a Cache, typically on a cheaper medium, e.g. compressed
+// in DRAM or in files on local flash or pmem. An LRUCache configured with
+// LRUCacheOptions::secondary_cache demotes the entries it evicts into the
+// secondary cache, provided they were inserted with a Cache::CacheItemHelper,
+// and looks up the keys it misses in it. The secondary cache stores values in
+// their serialized form, and a hit rebuilds the value with the CreateCallback
+// of the lookup, so a block cache hit in the secondary cache avoids reading
+// the block from its table file.
+//
+// Implementations must be thread safe.
+class SecondaryCache {
+ public:
+  virtual ~SecondaryCache() {}
+
+  virtual const char* Name() const = 0;
+
+  // Saves the serialized form of value, obtained with the callbacks of
+  // helper, under key. The secondary cache doesn't take ownership of value.
+  // A value promoted by Lookup() is inserted again when the primary cache
+  // evicts it, so the implementations may skip a key they still have.
+  virtual Status Insert(const Slice& key, void* value,
+                        const Cache::CacheItemHelper* helper) = 0;
+
+  // Looks up key and, if found, rebuilds its value with create_cb. Returns
+  // nullptr if the key is not found. If wait is false, the returned handle
+  // may not be ready yet.
+  virtual std::unique_ptr<SecondaryCacheResultHandle> Lookup(
+      const Slice& key, const Cache::CreateCallback& create_cb, bool wait) = 0;
+
+  // Erases key, if present.
+  virtual void Erase(const Slice& key) = 0;
+
+  // Waits until all the handles are ready.
+  virtual void WaitAll(std::vector<SecondaryCacheResultHandle*> handles) = 0;
+
+  virtual std::string GetPrintableOptions() const = 0;
+};
+
+struct CompressedSecondaryCacheOptions {
+  // Total size of the compressed values and their metadata.
+  size_t capacity = 0;
+
+  // The cache is sharded into 2^num_shard_bits shards, see NewLRUCache().
+  int num_shard_bits = -1;
+
+  // Compression of the saved values. Values that don't compress to less
+  // than 7/8 of their size, and all values if the compression type is not
+  // supported, are stored uncompressed.
+  CompressionType compression_type = kLZ4Compression;
+
+  // Compression format version, see BlockBasedTableOptions::format_version.
+  uint32_t compress_format_version = 2;
+
+  // Allocator of the buffers the compressed values are uncompressed into.
+  std::shared_ptr<MemoryAllocator> memory_allocator;
+};
+
+// Creates a secondary cache that keeps the saved values compressed in memory,
+// in an LRU cache of its own. Lookups are always synchronous. Returns nullptr
+// if the options are not valid.
+extern std::shared_ptr<SecondaryCache> NewCompressedSecondaryCache(
+    const CompressedSecondaryCacheOptions& options);
+
+struct FileSecondaryCacheOptions {
+  // Directory of the cache files. It is created if missing, and the cache
+  // files left in it by a previous instance are deleted.
+  std::string path;
+
+  // Total size of the cache files.
+  uint64_t capacity = 0;
+
+  // The values are appended to an in-memory buffer of this size, which is
+  // written to a new cache file by a background thread when full. When the
+  // files exceed capacity, the oldest one is deleted with all its values.
+  size_t file_size = 16 << 20;
+
+  // The FileSystem of the cache files, FileSystem::Default() if nullptr. With
+  // a PMFileSystem whose PMEnvOptions::cache_paths include path, the files
+  // are written and read through a pmem mapping.
+  std::shared_ptr<FileSystem> fs;
+
+  // Read the cache files through a memory mapping if the FileSystem
+  // supports it, which avoids copying a value before rebuilding it.
+  bool use_mmap_reads = false;
+
+  // Number of threads that read the values of lookups with wait set to false.
+  // If 0, all lookups read synchronously.
+  int lookup_threads = 0;
+};
+
+// Creates a secondary cache that keeps the saved values in log structured
+// files on a local FileSystem, such as a flash or pmem device.
+extern Status NewFileSecondaryCache(const FileSecondaryCacheOptions& options,
+                                    std::shared_ptr<SecondaryCache>* result);
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -128,7 +128,8 @@ enum Tickers : uint32_t {
   NUMBER_KEYS_WRITTEN,
   // Number of Keys read,
   NUMBER_KEYS_READ,
-  // Number keys updated, if inplace update is enabled
+  // Number keys updated, if inplace update is enabled, or coalesced by the
+  // memtable hot key table
   NUMBER_KEYS_UPDATED,
   // The number of uncompressed bytes issued by DB::Put(), DB::Delete(),
   // DB::Merge(), and DB::Write().
@@ -387,6 +388,19 @@ enum Tickers : uint32_t {
   ERROR_HANDLER_AUTORESUME_RETRY_TOTAL_COUNT,
   ERROR_HANDLER_AUTORESUME_SUCCESS_COUNT,
 
+  // # of the NUMBER_SUPERVERSION_ACQUIRES that took the DB mutex, to clean
+  // up the previous SuperVersion or after losing a race with its
+  // replacement.
+  NUMBER_SUPERVERSION_ACQUIRES_LOCKED,
+
+  // # of block cache misses that were found in the secondary cache.
+  SECONDARY_CACHE_HITS,
+
+  // # of insertions that the admission filter of a block cache admitted or
+  // rejected, out of those that had to evict an entry.
+  CACHE_ADMISSION_ADMITTED,
+  CACHE_ADMISSION_REJECTED,
+
   TICKER_ENUM_MAX
 };
 
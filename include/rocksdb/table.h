@@ -208,6 +208,16 @@ struct BlockBasedTableOptions {
 
   IndexType index_type = kBinarySearch;
 
+  // If true, an index block, an index partition or the top level index of
+  // partitioned filters is decoded into arrays of its keys and block handles
+  // when it is inserted into the block cache. Index seeks then binary search
+  // those arrays, comparing fixed-width key prefixes first with the default
+  // bytewise comparator, instead of parsing the delta encoded entries of the
+  // block. The decoded arrays are charged to the block cache with the block,
+  // which roughly doubles the cache usage of these blocks. Lookups through
+  // the hash index of kHashSearch still parse the block.
+  bool decode_index_blocks = false;
+
   // The index type that will be used for the data block.
   enum DataBlockIndexType : char {
     kDataBlockBinarySearch = 0,   // traditional block type
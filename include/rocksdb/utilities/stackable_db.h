@@ -185,6 +185,11 @@ class StackableDB : public DB {
     return db_->Write(opts, updates);
   }
 
+  virtual void WriteAsync(const WriteOptions& opts, WriteBatch* updates,
+                          std::function<void(Status)> callback) override {
+    db_->WriteAsync(opts, updates, std::move(callback));
+  }
+
   using DB::NewIterator;
   virtual Iterator* NewIterator(const ReadOptions& opts,
                                 ColumnFamilyHandle* column_family) override {
@@ -12,20 +12,106 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <string>
+#include <vector>
 #include "rocksdb/cache.h"
 
 namespace ROCKSDB_NAMESPACE {
 
+// The mutable memtable of a column family, as offered by a DB instance to the
+// flush policy of its WriteBufferManager.
+struct WriteBufferFlushCandidate {
+  std::string db_name;
+  uint32_t column_family_id = 0;
+  std::string column_family_name;
+  // Approximate memory used by the memtable.
+  size_t memory_usage = 0;
+  uint64_t num_entries = 0;
+  // Number of point deletions in the memtable.
+  uint64_t num_deletes = 0;
+  // Time, in seconds since the epoch, of the first write to the memtable.
+  uint64_t oldest_key_time = 0;
+  // Number of files in L0 of the column family.
+  int num_level0_files = 0;
+  // Number of the L0 files whose user key range overlaps the memtable's, that
+  // is the L0 files a flush of the memtable would overlap with. Only set if
+  // the policy NeedsLevel0Overlap().
+  int num_level0_overlapping_files = 0;
+};
+
+// Chooses which memtable to flush when a WriteBufferManager is full, among the
+// mutable memtables of all the DB instances sharing it.
+class WriteBufferFlushPolicy {
+ public:
+  virtual ~WriteBufferFlushPolicy() {}
+
+  virtual const char* Name() const = 0;
+
+  // Whether the candidates need num_level0_overlapping_files, which takes a
+  // seek to both ends of every candidate memtable.
+  virtual bool NeedsLevel0Overlap() const { return false; }
+
+  // Returns the index in `candidates` of the memtable to flush, or
+  // candidates.size() to flush none of them. `candidates` is not empty.
+  // Called by one thread at a time.
+  virtual size_t PickVictim(
+      const std::vector<WriteBufferFlushCandidate>& candidates) = 0;
+};
+
+// Flushes the memtable with the oldest write, as a DB does by itself among
+// its column families when no policy is set.
+extern std::shared_ptr<WriteBufferFlushPolicy> NewOldestMemTableFlushPolicy();
+
+// Flushes the largest memtable, which frees the most memory per flush and
+// keeps a busy column family from triggering tiny flushes of quiet ones.
+extern std::shared_ptr<WriteBufferFlushPolicy> NewLargestMemTableFlushPolicy();
+
+// Flushes the memtable with the most point deletions per byte, so that
+// tombstones reach compaction early. Falls back to the largest memtable when
+// none has deletions.
+extern std::shared_ptr<WriteBufferFlushPolicy> NewTombstoneDensityFlushPolicy();
+
+// Flushes the memtable overlapping the fewest L0 files, preferring the
+// largest among those, to keep L0 compactions small.
+extern std::shared_ptr<WriteBufferFlushPolicy>
+NewLeastLevel0OverlapFlushPolicy();
+
 class WriteBufferManager {
  public:
+  // The interface through which a WriteBufferManager reaches the DB instances
+  // sharing it. Every DB opened with a flush policy or stalls registers one.
+  class Client {
+   public:
+    virtual ~Client() {}
+
+    // Appends a candidate for every non-empty mutable memtable of the client.
+    virtual void GetFlushCandidates(
+        bool level0_overlap,
+        std::vector<WriteBufferFlushCandidate>* candidates) = 0;
+
+    // Switches the mutable memtable of the column family and schedules its
+    // flush, without waiting for the flush. Called from a thread of the
+    // manager, as it may wait for the writes in progress on the client.
+    virtual void Flush(uint32_t column_family_id) = 0;
+  };
+
   // _buffer_size = 0 indicates no limit. Memory won't be capped.
   // memory_usage() won't be valid and ShouldFlush() will always return true.
   // if `cache` is provided, we'll put dummy entries in the cache and cost
   // the memory allocated to the cache. It can be used even if _buffer_size = 0.
-  explicit WriteBufferManager(size_t _buffer_size,
-                              std::shared_ptr<Cache> cache = {});
+  // If `flush_policy` is provided, it chooses the memtable to flush when the
+  // buffer is full among the memtables of all the DBs sharing the manager;
+  // otherwise each DB flushes its own oldest memtable.
+  // If `allow_stall` is true, writes to a DB are stalled while memory usage
+  // is over the buffer size and the DB uses more than an even share of it,
+  // so that writes to DBs using little memory go on.
+  explicit WriteBufferManager(
+      size_t _buffer_size, std::shared_ptr<Cache> cache = {},
+      std::shared_ptr<WriteBufferFlushPolicy> flush_policy = nullptr,
+      bool allow_stall = false);
   // No copying allowed
   WriteBufferManager(const WriteBufferManager&) = delete;
   WriteBufferManager& operator=(const WriteBufferManager&) = delete;
@@ -53,13 +139,16 @@ class WriteBufferManager {
   // Should only be called from write thread
   bool ShouldFlush() const {
     if (enabled()) {
-      if (mutable_memtable_memory_usage() >
-          mutable_limit_.load(std::memory_order_relaxed)) {
+      // The memtables the flush policy picked in other DBs are about to be
+      // switched.
+      size_t mutable_usage = mutable_memtable_memory_usage();
+      mutable_usage -= std::min(
+          mutable_usage, memory_flush_requested_.load(std::memory_order_relaxed));
+      if (mutable_usage > mutable_limit_.load(std::memory_order_relaxed)) {
         return true;
       }
       size_t local_size = buffer_size();
-      if (memory_usage() >= local_size &&
-          mutable_memtable_memory_usage() >= local_size / 2) {
+      if (memory_usage() >= local_size && mutable_usage >= local_size / 2) {
         // If the memory exceeds the buffer size, we trigger more aggressive
         // flush. But if already more than half memory is being flushed,
         // triggering more flush may not help. We will hold it instead.
@@ -92,14 +181,60 @@ class WriteBufferManager {
     } else if (enabled()) {
       memory_used_.fetch_sub(mem, std::memory_order_relaxed);
     }
+    if (stalled_writers_.load(std::memory_order_relaxed) > 0) {
+      NotifyStalledWriters();
+    }
   }
 
   void SetBufferSize(size_t new_size) {
     buffer_size_.store(new_size, std::memory_order_relaxed);
     mutable_limit_.store(new_size * 7 / 8, std::memory_order_relaxed);
+    if (stalled_writers_.load(std::memory_order_relaxed) > 0) {
+      NotifyStalledWriters();
+    }
+  }
+
+  const std::shared_ptr<WriteBufferFlushPolicy>& flush_policy() const {
+    return flush_policy_;
+  }
+
+  bool allow_stall() const { return allow_stall_; }
+
+  // Called by a DB on open and close. Must be called with no DB mutex held.
+  void RegisterClient(Client* client);
+  void UnregisterClient(Client* client);
+
+  // Picks the memtable to flush among those of all the registered clients,
+  // leaving out those already being flushed on behalf of the manager.
+  // Returns true and the column family in *column_family_id if it belongs to
+  // `requester`. Otherwise has its client flush it from a background thread
+  // and returns false. Only valid with a flush_policy(). Must be called with
+  // no DB mutex held.
+  bool PickFlushVictim(Client* requester, uint32_t* column_family_id);
+
+  // Whether writes may have to stall, that is whether memory usage is over
+  // the buffer size with stalls allowed.
+  bool ShouldStall() const {
+    return allow_stall_ && enabled() && memory_usage() >= buffer_size();
+  }
+
+  // Whether a client using `client_memory_usage` bytes of memtables takes
+  // more than an even share of the buffer, so that its writes should stall
+  // while ShouldStall().
+  bool IsStallTarget(size_t client_memory_usage) const {
+    size_t num_clients = num_clients_.load(std::memory_order_relaxed);
+    return client_memory_usage > buffer_size() / std::max<size_t>(
+                                                     num_clients, 1);
   }
 
+  // Waits until memory is freed, the buffer size changes or a client leaves,
+  // for at most `timeout_micros`.
+  void WaitForStallChange(uint64_t timeout_micros);
+
  private:
+  void NotifyStalledWriters();
+  void BGFlushThread();
+
   std::atomic<size_t> buffer_size_;
   std::atomic<size_t> mutable_limit_;
   std::atomic<size_t> memory_used_;
@@ -109,6 +244,18 @@ class WriteBufferManager {
   struct CacheRep;
   std::unique_ptr<CacheRep> cache_rep_;
 
+  const std::shared_ptr<WriteBufferFlushPolicy> flush_policy_;
+  const bool allow_stall_;
+  std::atomic<size_t> num_clients_;
+  // Memory of the memtables picked by the flush policy that are waiting for
+  // their client to switch them.
+  std::atomic<size_t> memory_flush_requested_;
+  std::atomic<size_t> stalled_writers_;
+  // The registered clients, the flushes waiting for the background thread
+  // and the stalled writers.
+  struct ClientRep;
+  std::unique_ptr<ClientRep> client_rep_;
+
   void ReserveMemWithCache(size_t mem);
   void FreeMemWithCache(size_t mem);
 };
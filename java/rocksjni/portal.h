@@ -4996,6 +4996,14 @@ class TickerTypeJni {
         return -0x1A;
       case ROCKSDB_NAMESPACE::Tickers::ERROR_HANDLER_AUTORESUME_SUCCESS_COUNT:
         return -0x1B;
+      case ROCKSDB_NAMESPACE::Tickers::NUMBER_SUPERVERSION_ACQUIRES_LOCKED:
+        return -0x1C;
+      case ROCKSDB_NAMESPACE::Tickers::SECONDARY_CACHE_HITS:
+        return -0x1D;
+      case ROCKSDB_NAMESPACE::Tickers::CACHE_ADMISSION_ADMITTED:
+        return -0x1E;
+      case ROCKSDB_NAMESPACE::Tickers::CACHE_ADMISSION_REJECTED:
+        return -0x1F;
       case ROCKSDB_NAMESPACE::Tickers::TICKER_ENUM_MAX:
         // 0x5F for backwards compatibility on current minor version.
         return 0x5F;
@@ -5322,6 +5330,14 @@ class TickerTypeJni {
       case -0x1B:
         return ROCKSDB_NAMESPACE::Tickers::
             ERROR_HANDLER_AUTORESUME_SUCCESS_COUNT;
+      case -0x1C:
+        return ROCKSDB_NAMESPACE::Tickers::NUMBER_SUPERVERSION_ACQUIRES_LOCKED;
+      case -0x1D:
+        return ROCKSDB_NAMESPACE::Tickers::SECONDARY_CACHE_HITS;
+      case -0x1E:
+        return ROCKSDB_NAMESPACE::Tickers::CACHE_ADMISSION_ADMITTED;
+      case -0x1F:
+        return ROCKSDB_NAMESPACE::Tickers::CACHE_ADMISSION_REJECTED;
       case 0x5F:
         // 0x5F for backwards compatibility on current minor version.
         return ROCKSDB_NAMESPACE::Tickers::TICKER_ENUM_MAX;
@@ -752,6 +752,28 @@ public enum TickerType {
     ERROR_HANDLER_AUTORESUME_RETRY_TOTAL_COUNT((byte) -0x1A),
     ERROR_HANDLER_AUTORESUME_SUCCESS_COUNT((byte) -0x1B),
 
+    /**
+     * # of the SuperVersion acquisitions that took the DB mutex.
+     */
+    NUMBER_SUPERVERSION_ACQUIRES_LOCKED((byte) -0x1C),
+
+    /**
+     * # of block cache misses that were found in the secondary cache.
+     */
+    SECONDARY_CACHE_HITS((byte) -0x1D),
+
+    /**
+     * # of block cache insertions that had to evict an entry and were
+     * admitted by the admission filter.
+     */
+    CACHE_ADMISSION_ADMITTED((byte) -0x1E),
+
+    /**
+     * # of block cache insertions that had to evict an entry and were
+     * rejected by the admission filter.
+     */
+    CACHE_ADMISSION_REJECTED((byte) -0x1F),
+
     TICKER_ENUM_MAX((byte) 0x5F);
 
     private final byte value;
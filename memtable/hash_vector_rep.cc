@@ -0,0 +1,539 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+#include "util/murmurhash.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// A sorted run of memtable keys. Runs are never modified once built, so
+// readers share them without holding the bucket lock.
+using Run = std::vector<const char*>;
+
+// Runs are not merged beyond kMaxMergedRuns times the run size, which bounds
+// the work an insert does under the bucket lock. A bucket has a logarithmic
+// number of runs up to that size, and a linear number of full ones.
+const size_t kMaxMergedRuns = 16;
+
+size_t RunBytes(const Run& run) { return run.capacity() * sizeof(const char*); }
+
+class HashVectorRep : public MemTableRep {
+ public:
+  HashVectorRep(const MemTableRep::KeyComparator& compare,
+                Allocator* allocator, const SliceTransform* transform,
+                size_t bucket_count, size_t run_size);
+
+  void Insert(KeyHandle handle) override;
+
+  void InsertConcurrently(KeyHandle handle) override { Insert(handle); }
+
+  bool Contains(const char* key) const override;
+
+  void MarkReadOnly() override {
+    immutable_.store(true, std::memory_order_release);
+  }
+
+  size_t ApproximateMemoryUsage() override;
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  ~HashVectorRep() override;
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override;
+
+  MemTableRep::Iterator* GetDynamicPrefixIterator(
+      Arena* arena = nullptr) override;
+
+ private:
+  // The keys of a bucket are appended to its tail, which is sorted into a
+  // run once it holds run_size_ keys. The runs are merged like a binary
+  // counter, up to max_merged_run_size_ keys.
+  struct Bucket {
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<const Run>> runs;  // oldest first
+    Run tail;
+  };
+
+  // Iterates over a sorted run.
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    Iterator(const MemTableRep::KeyComparator& compare,
+             std::shared_ptr<const Run> run)
+        : compare_(compare), run_(std::move(run)), pos_(0) {
+      SetInvalid();
+    }
+
+    ~Iterator() override {}
+
+    bool Valid() const override {
+      return run_ != nullptr && pos_ < run_->size();
+    }
+
+    const char* key() const override {
+      assert(Valid());
+      return (*run_)[pos_];
+    }
+
+    void Next() override {
+      assert(Valid());
+      pos_++;
+    }
+
+    void Prev() override {
+      assert(Valid());
+      if (pos_ == 0) {
+        SetInvalid();
+      } else {
+        pos_--;
+      }
+    }
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      if (run_ == nullptr) {
+        return;
+      }
+      const char* target = (memtable_key != nullptr)
+                               ? memtable_key
+                               : EncodeKey(&tmp_, internal_key);
+      pos_ = static_cast<size_t>(
+          std::lower_bound(run_->begin(), run_->end(), target,
+                           [this](const char* a, const char* b) {
+                             return compare_(a, b) < 0;
+                           }) -
+          run_->begin());
+    }
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override {
+      if (run_ == nullptr) {
+        return;
+      }
+      const char* target = (memtable_key != nullptr)
+                               ? memtable_key
+                               : EncodeKey(&tmp_, internal_key);
+      size_t upper = static_cast<size_t>(
+          std::upper_bound(run_->begin(), run_->end(), target,
+                           [this](const char* a, const char* b) {
+                             return compare_(a, b) < 0;
+                           }) -
+          run_->begin());
+      if (upper == 0) {
+        SetInvalid();
+      } else {
+        pos_ = upper - 1;
+      }
+    }
+
+    void SeekToFirst() override { pos_ = 0; }
+
+    void SeekToLast() override {
+      if (run_ == nullptr || run_->empty()) {
+        SetInvalid();
+      } else {
+        pos_ = run_->size() - 1;
+      }
+    }
+
+   protected:
+    void Reset(std::shared_ptr<const Run> run) {
+      run_ = std::move(run);
+      SetInvalid();
+    }
+
+   private:
+    void SetInvalid() { pos_ = run_ != nullptr ? run_->size() : 0; }
+
+    const MemTableRep::KeyComparator& compare_;
+    std::shared_ptr<const Run> run_;
+    size_t pos_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  // Iterates over the bucket of the prefix of the last sought key.
+  class DynamicIterator : public Iterator {
+   public:
+    explicit DynamicIterator(const HashVectorRep* rep)
+        : Iterator(rep->compare_, nullptr), rep_(rep) {}
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      Reset(rep_->SortedBucket(ExtractUserKey(internal_key)));
+      Iterator::Seek(internal_key, memtable_key);
+    }
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override {
+      Reset(rep_->SortedBucket(ExtractUserKey(internal_key)));
+      Iterator::SeekForPrev(internal_key, memtable_key);
+    }
+
+    void SeekToFirst() override {
+      // Prefix iterator does not support total order.
+      // We simply set the iterator to invalid state
+      Reset(nullptr);
+    }
+
+    void SeekToLast() override {
+      // Prefix iterator does not support total order.
+      // We simply set the iterator to invalid state
+      Reset(nullptr);
+    }
+
+   private:
+    const HashVectorRep* rep_;
+  };
+
+  bool Less(const char* a, const char* b) const { return compare_(a, b) < 0; }
+
+  size_t GetHash(const Slice& user_key) const {
+    Slice prefix;
+    if (transform_ != nullptr && transform_->InDomain(user_key)) {
+      prefix = transform_->Transform(user_key);
+    }
+    return MurmurHash(prefix.data(), static_cast<int>(prefix.size()), 0) %
+           bucket_count_;
+  }
+
+  Bucket* GetBucket(const Slice& user_key) const {
+    return buckets_[GetHash(user_key)].load(std::memory_order_acquire);
+  }
+
+  // Copies the runs of a bucket, with its tail sorted as the newest run.
+  void SnapshotBucket(const Bucket* bucket,
+                      std::vector<std::shared_ptr<const Run>>* runs) const;
+
+  // Returns the keys of the bucket of user_key's prefix in order.
+  std::shared_ptr<const Run> SortedBucket(const Slice& user_key) const;
+
+  // Returns all the keys in order.
+  std::shared_ptr<const Run> SortedAll();
+
+  // k-way merge of sorted runs
+  void MergeRuns(const std::vector<std::shared_ptr<const Run>>& runs,
+                 Run* merged) const;
+
+  const MemTableRep::KeyComparator& compare_;
+  const SliceTransform* transform_;
+  const size_t bucket_count_;
+  const size_t run_size_;
+  const size_t max_merged_run_size_;
+  std::atomic<Bucket*>* buckets_;
+  std::atomic<size_t> num_buckets_used_;
+  std::atomic<size_t> num_entries_;
+  // Bytes of the runs of the buckets
+  std::atomic<size_t> run_bytes_;
+  std::atomic<bool> immutable_;
+
+  // All the keys in order, merged once the rep is read only
+  std::once_flag sorted_all_once_;
+  std::shared_ptr<const Run> sorted_all_;
+};
+
+HashVectorRep::HashVectorRep(const MemTableRep::KeyComparator& compare,
+                             Allocator* allocator,
+                             const SliceTransform* transform,
+                             size_t bucket_count, size_t run_size)
+    : MemTableRep(allocator),
+      compare_(compare),
+      transform_(transform),
+      bucket_count_(std::max<size_t>(bucket_count, 1)),
+      run_size_(std::max<size_t>(run_size, 1)),
+      max_merged_run_size_(run_size_ * kMaxMergedRuns),
+      num_buckets_used_(0),
+      num_entries_(0),
+      run_bytes_(0),
+      immutable_(false) {
+  auto mem =
+      allocator->AllocateAligned(sizeof(std::atomic<Bucket*>) * bucket_count_);
+  buckets_ = new (mem) std::atomic<Bucket*>[bucket_count_];
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    buckets_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+HashVectorRep::~HashVectorRep() {
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    delete buckets_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void HashVectorRep::Insert(KeyHandle handle) {
+  const char* key = static_cast<char*>(handle);
+  assert(!Contains(key));
+  std::atomic<Bucket*>& slot = buckets_[GetHash(UserKey(key))];
+  Bucket* bucket = slot.load(std::memory_order_acquire);
+  if (bucket == nullptr) {
+    Bucket* new_bucket = new Bucket();
+    if (slot.compare_exchange_strong(bucket, new_bucket)) {
+      bucket = new_bucket;
+      num_buckets_used_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      // another writer initialized it first
+      delete new_bucket;
+    }
+  }
+  std::lock_guard<std::mutex> lock(bucket->mutex);
+  bucket->tail.push_back(key);
+  num_entries_.fetch_add(1, std::memory_order_relaxed);
+  if (bucket->tail.size() < run_size_) {
+    return;
+  }
+  Run* run = new Run();
+  run->swap(bucket->tail);
+  std::sort(run->begin(), run->end(),
+            [this](const char* a, const char* b) { return Less(a, b); });
+  run_bytes_.fetch_add(RunBytes(*run), std::memory_order_relaxed);
+  bucket->runs.emplace_back(run);
+  auto& runs = bucket->runs;
+  while (runs.size() >= 2 &&
+         runs[runs.size() - 2]->size() <= 2 * runs.back()->size() &&
+         runs[runs.size() - 2]->size() + runs.back()->size() <=
+             max_merged_run_size_) {
+    const Run& older = *runs[runs.size() - 2];
+    const Run& newer = *runs.back();
+    Run* merged = new Run();
+    merged->reserve(older.size() + newer.size());
+    std::merge(older.begin(), older.end(), newer.begin(), newer.end(),
+               std::back_inserter(*merged),
+               [this](const char* a, const char* b) { return Less(a, b); });
+    // readers may still hold the merged runs for a while
+    run_bytes_.fetch_add(RunBytes(*merged), std::memory_order_relaxed);
+    run_bytes_.fetch_sub(RunBytes(older) + RunBytes(newer),
+                         std::memory_order_relaxed);
+    runs.pop_back();
+    runs.back().reset(merged);
+  }
+}
+
+bool HashVectorRep::Contains(const char* key) const {
+  Bucket* bucket = GetBucket(UserKey(key));
+  if (bucket == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(bucket->mutex);
+  for (const auto& run : bucket->runs) {
+    if (std::binary_search(
+            run->begin(), run->end(), key,
+            [this](const char* a, const char* b) { return Less(a, b); })) {
+      return true;
+    }
+  }
+  for (const char* entry : bucket->tail) {
+    if (compare_(entry, key) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t HashVectorRep::ApproximateMemoryUsage() {
+  // The bucket array is allocated through allocator, the buckets, their
+  // tails and runs are not. A tail holds up to run_size_ keys. sorted_all_
+  // is counted before it is merged, since the usage of a memtable must not
+  // change once it is immutable.
+  return num_buckets_used_.load(std::memory_order_relaxed) *
+             (sizeof(Bucket) + run_size_ * sizeof(const char*)) +
+         run_bytes_.load(std::memory_order_relaxed) +
+         num_entries_.load(std::memory_order_relaxed) * sizeof(const char*);
+}
+
+void HashVectorRep::Get(const LookupKey& k, void* callback_args,
+                        bool (*callback_func)(void* arg, const char* entry)) {
+  Bucket* bucket = GetBucket(k.user_key());
+  if (bucket == nullptr) {
+    return;
+  }
+  const char* target = k.memtable_key().data();
+  auto greater = [this](const char* a, const char* b) { return Less(b, a); };
+  // The runs are read after the lock is released, the tail's keys from the
+  // target on are copied into a heap since usually only the first few are
+  // visited.
+  std::vector<std::shared_ptr<const Run>> runs;
+  std::vector<const char*> tail;
+  {
+    std::lock_guard<std::mutex> lock(bucket->mutex);
+    runs = bucket->runs;
+    for (const char* entry : bucket->tail) {
+      if (!Less(entry, target)) {
+        tail.push_back(entry);
+      }
+    }
+  }
+  std::make_heap(tail.begin(), tail.end(), greater);
+
+  std::vector<std::pair<Run::const_iterator, Run::const_iterator>> cursors;
+  for (const auto& run : runs) {
+    auto begin = std::lower_bound(
+        run->begin(), run->end(), target,
+        [this](const char* a, const char* b) { return Less(a, b); });
+    if (begin != run->end()) {
+      cursors.emplace_back(begin, run->end());
+    }
+  }
+  while (true) {
+    const char* next = nullptr;
+    size_t next_cursor = cursors.size();
+    for (size_t i = 0; i < cursors.size(); i++) {
+      if (cursors[i].first != cursors[i].second &&
+          (next == nullptr || Less(*cursors[i].first, next))) {
+        next = *cursors[i].first;
+        next_cursor = i;
+      }
+    }
+    if (!tail.empty() && (next == nullptr || Less(tail.front(), next))) {
+      next = tail.front();
+      next_cursor = cursors.size();
+      std::pop_heap(tail.begin(), tail.end(), greater);
+      tail.pop_back();
+    } else if (next != nullptr) {
+      ++cursors[next_cursor].first;
+    }
+    if (next == nullptr || !callback_func(callback_args, next)) {
+      break;
+    }
+  }
+}
+
+void HashVectorRep::SnapshotBucket(
+    const Bucket* bucket,
+    std::vector<std::shared_ptr<const Run>>* runs) const {
+  Run* tail = new Run();
+  {
+    std::lock_guard<std::mutex> lock(bucket->mutex);
+    runs->insert(runs->end(), bucket->runs.begin(), bucket->runs.end());
+    *tail = bucket->tail;
+  }
+  std::sort(tail->begin(), tail->end(),
+            [this](const char* a, const char* b) { return Less(a, b); });
+  runs->emplace_back(tail);
+}
+
+void HashVectorRep::MergeRuns(
+    const std::vector<std::shared_ptr<const Run>>& runs, Run* merged) const {
+  using Cursor = std::pair<Run::const_iterator, Run::const_iterator>;
+  std::vector<Cursor> heap;
+  size_t total = 0;
+  for (const auto& run : runs) {
+    if (!run->empty()) {
+      heap.emplace_back(run->begin(), run->end());
+      total += run->size();
+    }
+  }
+  merged->reserve(total);
+  auto greater = [this](const Cursor& a, const Cursor& b) {
+    return Less(*b.first, *a.first);
+  };
+  std::make_heap(heap.begin(), heap.end(), greater);
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    Cursor& cursor = heap.back();
+    merged->push_back(*cursor.first);
+    if (++cursor.first == cursor.second) {
+      heap.pop_back();
+    } else {
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+  }
+}
+
+std::shared_ptr<const Run> HashVectorRep::SortedBucket(
+    const Slice& user_key) const {
+  Bucket* bucket = GetBucket(user_key);
+  if (bucket == nullptr) {
+    return std::make_shared<const Run>();
+  }
+  std::vector<std::shared_ptr<const Run>> runs;
+  SnapshotBucket(bucket, &runs);
+  std::shared_ptr<Run> sorted = std::make_shared<Run>();
+  MergeRuns(runs, sorted.get());
+  return sorted;
+}
+
+std::shared_ptr<const Run> HashVectorRep::SortedAll() {
+  auto merge_all = [this]() {
+    std::vector<std::shared_ptr<const Run>> runs;
+    for (size_t i = 0; i < bucket_count_; ++i) {
+      Bucket* bucket = buckets_[i].load(std::memory_order_acquire);
+      if (bucket != nullptr) {
+        SnapshotBucket(bucket, &runs);
+      }
+    }
+    std::shared_ptr<Run> sorted = std::make_shared<Run>();
+    MergeRuns(runs, sorted.get());
+    return sorted;
+  };
+  if (!immutable_.load(std::memory_order_acquire)) {
+    return merge_all();
+  }
+  // flush and the readers of an immutable memtable share one merge
+  std::call_once(sorted_all_once_, [&]() { sorted_all_ = merge_all(); });
+  return sorted_all_;
+}
+
+MemTableRep::Iterator* HashVectorRep::GetIterator(Arena* arena) {
+  std::shared_ptr<const Run> sorted = SortedAll();
+  if (arena == nullptr) {
+    return new Iterator(compare_, std::move(sorted));
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(Iterator));
+    return new (mem) Iterator(compare_, std::move(sorted));
+  }
+}
+
+MemTableRep::Iterator* HashVectorRep::GetDynamicPrefixIterator(Arena* arena) {
+  if (arena == nullptr) {
+    return new DynamicIterator(this);
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(DynamicIterator));
+    return new (mem) DynamicIterator(this);
+  }
+}
+
+class HashVectorRepFactory : public MemTableRepFactory {
+ public:
+  HashVectorRepFactory(size_t bucket_count, size_t run_size)
+      : bucket_count_(bucket_count), run_size_(run_size) {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* transform,
+                                 Logger* /*logger*/) override {
+    return new HashVectorRep(compare, allocator, transform, bucket_count_,
+                             run_size_);
+  }
+
+  const char* Name() const override { return "HashVectorRepFactory"; }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
+ private:
+  const size_t bucket_count_;
+  const size_t run_size_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewHashVectorRepFactory(size_t bucket_count,
+                                            size_t run_size) {
+  return new HashVectorRepFactory(bucket_count, run_size);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
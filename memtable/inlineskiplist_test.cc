@@ -10,6 +10,7 @@
 #include "memtable/inlineskiplist.h"
 #include <set>
 #include <unordered_set>
+#include <vector>
 #include "memory/concurrent_arena.h"
 #include "rocksdb/env.h"
 #include "test_util/testharness.h"
@@ -78,6 +79,19 @@ class InlineSkipTest : public testing::Test {
     return res;
   }
 
+  size_t InsertSortedRun(TestInlineSkipList* list,
+                         const std::vector<Key>& run) {
+    std::vector<const char*> bufs;
+    for (Key key : run) {
+      char* buf = list->AllocateKey(sizeof(Key));
+      memcpy(buf, &key, sizeof(Key));
+      bufs.push_back(buf);
+    }
+    size_t inserted = list->InsertSortedRun(bufs.data(), bufs.size());
+    keys_.insert(run.begin(), run.begin() + inserted);
+    return inserted;
+  }
+
   void Validate(TestInlineSkipList* list) {
     // Check keys exist.
     for (Key key : keys_) {
@@ -309,6 +323,41 @@ TEST_F(InlineSkipTest, InsertWithHint_CompatibleWithInsertWithoutHint) {
   Validate(&list);
 }
 
+TEST_F(InlineSkipTest, InsertSortedRun) {
+  Arena arena;
+  TestComparator cmp;
+  TestInlineSkipList list(cmp, &arena);
+  // Into an empty list
+  std::vector<Key> run;
+  for (Key key = 1000; key < 2000; key += 2) {
+    run.push_back(key);
+  }
+  ASSERT_EQ(run.size(), InsertSortedRun(&list, run));
+  Validate(&list);
+
+  // Interleaved with the existing keys, before and after them
+  Random rnd(301);
+  for (int round = 0; round < 100; round++) {
+    run.clear();
+    Key key = rnd.Uniform(3000);
+    while (key < 3000) {
+      if (!list.Contains(Encode(&key))) {
+        run.push_back(key);
+      }
+      key += 1 + rnd.Uniform(10);
+    }
+    ASSERT_EQ(run.size(), InsertSortedRun(&list, run));
+    Validate(&list);
+  }
+
+  // Stops at the first key that is already in the list
+  ASSERT_EQ(1U, InsertSortedRun(&list, {3020}));
+  ASSERT_EQ(1U, InsertSortedRun(&list, {3010, 3020, 3030}));
+  Validate(&list);
+  Key key = 3030;
+  ASSERT_FALSE(list.Contains(Encode(&key)));
+}
+
 #ifndef ROCKSDB_VALGRIND_RUN
 // We want to make sure that with a single writer and multiple
 // concurrent readers (with no synchronization other than when a
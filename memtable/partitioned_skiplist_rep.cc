@@ -0,0 +1,389 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "memtable/inlineskiplist.h"
+#include "rocksdb/memtablerep.h"
+#include "test_util/sync_point.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// One in kSampleInterval inserts, on average, samples its user key for the
+// partition boundaries of the next memtable.
+const int kSampleInterval = 256;
+
+class PartitionedSkipListRep;
+
+// The partition boundaries learned by the memtables of a factory.
+// A boundary is the memtable key of the smallest internal key of a user key,
+// so that all the versions of a user key fall into the same partition.
+struct LearnedBoundaries {
+  std::mutex mutex;
+  // The memtable created last, until it is marked read only. The memtable
+  // that replaces it is created while it is still mutable, and takes its
+  // boundaries from the keys it sampled so far.
+  PartitionedSkipListRep* active = nullptr;
+  // The boundaries of the last memtable marked read only, used when there is
+  // no active memtable, e.g. for the first memtable after a reopen with the
+  // same factory
+  std::shared_ptr<const std::vector<std::string>> boundaries;
+};
+
+using PartitionList = InlineSkipList<const MemTableRep::KeyComparator&>;
+
+class PartitionedSkipListRep : public MemTableRep {
+ public:
+  PartitionedSkipListRep(const MemTableRep::KeyComparator& compare,
+                         Allocator* allocator, size_t num_partitions,
+                         std::shared_ptr<LearnedBoundaries> learned)
+      : MemTableRep(allocator),
+        cmp_(compare),
+        num_partitions_(num_partitions),
+        learned_(std::move(learned)) {
+    {
+      std::lock_guard<std::mutex> lock(learned_->mutex);
+      std::shared_ptr<const std::vector<std::string>> boundaries;
+      if (learned_->active != nullptr) {
+        boundaries = learned_->active->SampleBoundaries(false /* take */);
+      }
+      if (boundaries == nullptr) {
+        boundaries = learned_->boundaries;
+      }
+      if (boundaries != nullptr) {
+        boundaries_ = *boundaries;
+      }
+      learned_->active = this;
+    }
+    // The boundaries may have been learned under another comparator, by a
+    // memtable of another column family sharing the factory.
+    auto less = [this](const std::string& a, const std::string& b) {
+      return cmp_(a.data(), b.data()) < 0;
+    };
+    std::sort(boundaries_.begin(), boundaries_.end(), less);
+    boundaries_.erase(
+        std::unique(boundaries_.begin(), boundaries_.end(),
+                    [this](const std::string& a, const std::string& b) {
+                      return cmp_(a.data(), b.data()) == 0;
+                    }),
+        boundaries_.end());
+    for (size_t i = 0; i <= boundaries_.size(); i++) {
+      partitions_.emplace_back(new PartitionList(compare, allocator));
+    }
+    size_t num_partitions_used = partitions_.size();
+    TEST_SYNC_POINT_CALLBACK("PartitionedSkipListRep:NumPartitions",
+                             &num_partitions_used);
+  }
+
+  // Every partition is built with the same height parameters, so a node
+  // allocated by one of them can be linked into any other.
+  KeyHandle Allocate(const size_t len, char** buf) override {
+    *buf = partitions_[0]->AllocateKey(len);
+    return static_cast<KeyHandle>(*buf);
+  }
+
+  void Insert(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKey(KeyHandle handle) override {
+    const char* key = static_cast<char*>(handle);
+    MaybeSample(key);
+    return partitions_[PartitionOf(key)]->Insert(key);
+  }
+
+  void InsertConcurrently(KeyHandle handle) override {
+    InsertKeyConcurrently(handle);
+  }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override {
+    const char* key = static_cast<char*>(handle);
+    MaybeSample(key);
+    return partitions_[PartitionOf(key)]->InsertConcurrently(key);
+  }
+
+  // Splits the run at the partition boundaries it crosses, which are few
+  // compared to its keys.
+  size_t InsertSortedRun(const KeyHandle* handles, size_t num_keys) override {
+    const char* const* keys = reinterpret_cast<const char* const*>(handles);
+    size_t begin = 0;
+    while (begin < num_keys) {
+      size_t partition = PartitionOf(keys[begin]);
+      size_t end = num_keys;
+      if (partition < boundaries_.size()) {
+        const char* boundary = boundaries_[partition].data();
+        end = static_cast<size_t>(
+            std::lower_bound(keys + begin, keys + num_keys, boundary,
+                             [this](const char* k, const char* b) {
+                               return cmp_(k, b) < 0;
+                             }) -
+            keys);
+      }
+      for (size_t i = begin; i < end; i++) {
+        MaybeSample(keys[i]);
+      }
+      size_t inserted =
+          partitions_[partition]->InsertSortedRun(keys + begin, end - begin);
+      if (inserted < end - begin) {
+        return begin + inserted;
+      }
+      begin = end;
+    }
+    return num_keys;
+  }
+
+  bool Contains(const char* key) const override {
+    return partitions_[PartitionOf(key)]->Contains(key);
+  }
+
+  // Keeps the boundaries sampled by this memtable for the memtables created
+  // while there is no active one.
+  void MarkReadOnly() override {
+    std::shared_ptr<const std::vector<std::string>> boundaries =
+        SampleBoundaries(true /* take */);
+    std::lock_guard<std::mutex> lock(learned_->mutex);
+    if (learned_->active == this) {
+      learned_->active = nullptr;
+    }
+    if (boundaries != nullptr) {
+      learned_->boundaries = boundaries;
+    }
+  }
+
+  // Returns the quantiles of the user keys sampled so far as partition
+  // boundaries, or nullptr if there are too few samples. If take is set, the
+  // samples are released.
+  std::shared_ptr<const std::vector<std::string>> SampleBoundaries(bool take) {
+    std::vector<std::string> samples;
+    {
+      std::lock_guard<std::mutex> lock(samples_mutex_);
+      if (take) {
+        samples.swap(samples_);
+      } else {
+        samples = samples_;
+      }
+    }
+    if (samples.size() < num_partitions_) {
+      return nullptr;
+    }
+    std::string scratch;
+    for (auto& user_key : samples) {
+      InternalKey ikey(user_key, kMaxSequenceNumber, kValueTypeForSeek);
+      EncodeKey(&scratch, ikey.Encode());
+      user_key = scratch;
+    }
+    std::sort(samples.begin(), samples.end(),
+              [this](const std::string& a, const std::string& b) {
+                return cmp_(a.data(), b.data()) < 0;
+              });
+    std::shared_ptr<std::vector<std::string>> boundaries =
+        std::make_shared<std::vector<std::string>>();
+    for (size_t i = 1; i < num_partitions_; i++) {
+      const std::string& sample = samples[i * samples.size() / num_partitions_];
+      if (boundaries->empty() ||
+          cmp_(boundaries->back().data(), sample.data()) < 0) {
+        boundaries->push_back(sample);
+      }
+    }
+    return boundaries;
+  }
+
+  size_t ApproximateMemoryUsage() override {
+    // All memory is allocated through allocator; nothing to report here
+    return 0;
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override {
+    const char* key = k.memtable_key().data();
+    PartitionList::Iterator iter(partitions_[PartitionOf(key)].get());
+    for (iter.Seek(key);
+         iter.Valid() && callback_func(callback_args, iter.key());
+         iter.Next()) {
+    }
+  }
+
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) override {
+    std::string start_tmp;
+    std::string end_tmp;
+    const char* start_key = EncodeKey(&start_tmp, start_ikey);
+    const char* end_key = EncodeKey(&end_tmp, end_ikey);
+    uint64_t count = 0;
+    for (size_t p = PartitionOf(start_key); p <= PartitionOf(end_key); p++) {
+      uint64_t start_count = partitions_[p]->EstimateCount(start_key);
+      uint64_t end_count = partitions_[p]->EstimateCount(end_key);
+      count += (end_count >= start_count) ? (end_count - start_count) : 0;
+    }
+    return count;
+  }
+
+  ~PartitionedSkipListRep() override {
+    std::lock_guard<std::mutex> lock(learned_->mutex);
+    if (learned_->active == this) {
+      learned_->active = nullptr;
+    }
+  }
+
+  // Iterates over the partitions in key order, one at a time.
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const PartitionedSkipListRep* rep)
+        : rep_(rep), iter_(rep->partitions_[0].get()) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return iter_.Valid(); }
+
+    const char* key() const override { return iter_.key(); }
+
+    void Next() override {
+      iter_.Next();
+      SkipEmptyPartitionsForward();
+    }
+
+    void Prev() override {
+      iter_.Prev();
+      SkipEmptyPartitionsBackward();
+    }
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      const char* encoded_key = (memtable_key != nullptr)
+                                    ? memtable_key
+                                    : EncodeKey(&tmp_, internal_key);
+      SetPartition(rep_->PartitionOf(encoded_key));
+      iter_.Seek(encoded_key);
+      SkipEmptyPartitionsForward();
+    }
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override {
+      const char* encoded_key = (memtable_key != nullptr)
+                                    ? memtable_key
+                                    : EncodeKey(&tmp_, internal_key);
+      SetPartition(rep_->PartitionOf(encoded_key));
+      iter_.SeekForPrev(encoded_key);
+      SkipEmptyPartitionsBackward();
+    }
+
+    void SeekToFirst() override {
+      SetPartition(0);
+      iter_.SeekToFirst();
+      SkipEmptyPartitionsForward();
+    }
+
+    void SeekToLast() override {
+      SetPartition(rep_->partitions_.size() - 1);
+      iter_.SeekToLast();
+      SkipEmptyPartitionsBackward();
+    }
+
+   private:
+    void SetPartition(size_t partition) {
+      partition_ = partition;
+      iter_.SetList(rep_->partitions_[partition].get());
+    }
+
+    void SkipEmptyPartitionsForward() {
+      while (!iter_.Valid() && partition_ + 1 < rep_->partitions_.size()) {
+        SetPartition(partition_ + 1);
+        iter_.SeekToFirst();
+      }
+    }
+
+    void SkipEmptyPartitionsBackward() {
+      while (!iter_.Valid() && partition_ > 0) {
+        SetPartition(partition_ - 1);
+        iter_.SeekToLast();
+      }
+    }
+
+    const PartitionedSkipListRep* rep_;
+    PartitionList::Iterator iter_;
+    size_t partition_ = 0;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
+    void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                      : operator new(sizeof(Iterator));
+    return new (mem) Iterator(this);
+  }
+
+ private:
+  // Returns the partition of the memtable key, the number of boundaries not
+  // greater than it.
+  size_t PartitionOf(const char* key) const {
+    auto it = std::upper_bound(
+        boundaries_.begin(), boundaries_.end(), key,
+        [this](const char* k, const std::string& boundary) {
+          return cmp_(k, boundary.data()) < 0;
+        });
+    return static_cast<size_t>(it - boundaries_.begin());
+  }
+
+  void MaybeSample(const char* key) {
+    if (num_partitions_ > 1 &&
+        Random::GetTLSInstance()->OneIn(kSampleInterval)) {
+      Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(key));
+      std::lock_guard<std::mutex> lock(samples_mutex_);
+      samples_.emplace_back(user_key.data(), user_key.size());
+    }
+  }
+
+  const MemTableRep::KeyComparator& cmp_;
+  const size_t num_partitions_;
+  std::shared_ptr<LearnedBoundaries> learned_;
+  std::vector<std::string> boundaries_;
+  std::vector<std::unique_ptr<PartitionList>> partitions_;
+  std::mutex samples_mutex_;
+  std::vector<std::string> samples_;
+};
+
+class PartitionedSkipListRepFactory : public MemTableRepFactory {
+ public:
+  explicit PartitionedSkipListRepFactory(size_t num_partitions)
+      : num_partitions_(std::max<size_t>(num_partitions, 1)),
+        learned_(std::make_shared<LearnedBoundaries>()) {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* /*transform*/,
+                                 Logger* /*logger*/) override {
+    return new PartitionedSkipListRep(compare, allocator, num_partitions_,
+                                      learned_);
+  }
+
+  const char* Name() const override {
+    return "PartitionedSkipListRepFactory";
+  }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
+  bool CanHandleDuplicatedKey() const override { return true; }
+
+ private:
+  const size_t num_partitions_;
+  std::shared_ptr<LearnedBoundaries> learned_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewPartitionedSkipListRepFactory(size_t num_partitions) {
+  return new PartitionedSkipListRepFactory(num_partitions);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -67,6 +67,11 @@ public:
    return skip_list_.InsertConcurrently(static_cast<char*>(handle));
  }
 
+ size_t InsertSortedRun(const KeyHandle* handles, size_t num_keys) override {
+   return skip_list_.InsertSortedRun(
+       reinterpret_cast<const char* const*>(handles), num_keys);
+ }
+
   // Returns true iff an entry that compares equal to key is in the list.
  bool Contains(const char* key) const override {
    return skip_list_.Contains(key);
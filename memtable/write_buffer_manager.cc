@@ -8,7 +8,11 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "rocksdb/write_buffer_manager.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include "port/port.h"
 #include "util/coding.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -48,14 +52,59 @@ struct WriteBufferManager::CacheRep {
 struct WriteBufferManager::CacheRep {};
 #endif  // ROCKSDB_LITE
 
-WriteBufferManager::WriteBufferManager(size_t _buffer_size,
-                                       std::shared_ptr<Cache> cache)
+struct WriteBufferManager::ClientRep {
+  struct FlushRequest {
+    Client* client;
+    uint32_t column_family_id;
+    size_t memory_usage;
+  };
+
+  // Protects the members below and serializes the calls to the flush policy.
+  std::mutex mutex;
+  std::vector<Client*> clients;
+  std::deque<FlushRequest> flush_requests;
+  // The request the background thread is running, if any.
+  FlushRequest running = {nullptr, 0, 0};
+  // Signaled when a request is queued or done, and on shutdown.
+  std::condition_variable flush_cv;
+  port::Thread flush_thread;
+  bool shutting_down = false;
+
+  std::mutex stall_mutex;
+  std::condition_variable stall_cv;
+  // Incremented under stall_mutex on every change that may end a stall.
+  uint64_t stall_epoch = 0;
+
+  bool IsRequested(Client* client, uint32_t column_family_id) const {
+    if (running.client == client &&
+        running.column_family_id == column_family_id) {
+      return true;
+    }
+    for (const FlushRequest& request : flush_requests) {
+      if (request.client == client &&
+          request.column_family_id == column_family_id) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+WriteBufferManager::WriteBufferManager(
+    size_t _buffer_size, std::shared_ptr<Cache> cache,
+    std::shared_ptr<WriteBufferFlushPolicy> flush_policy, bool allow_stall)
     : buffer_size_(_buffer_size),
       mutable_limit_(buffer_size_ * 7 / 8),
       memory_used_(0),
       memory_active_(0),
       dummy_size_(0),
-      cache_rep_(nullptr) {
+      cache_rep_(nullptr),
+      flush_policy_(std::move(flush_policy)),
+      allow_stall_(allow_stall),
+      num_clients_(0),
+      memory_flush_requested_(0),
+      stalled_writers_(0),
+      client_rep_(new ClientRep()) {
 #ifndef ROCKSDB_LITE
   if (cache) {
     // Construct the cache key using the pointer to this.
@@ -67,6 +116,14 @@ WriteBufferManager::WriteBufferManager(size_t _buffer_size,
 }
 
 WriteBufferManager::~WriteBufferManager() {
+  {
+    std::lock_guard<std::mutex> lock(client_rep_->mutex);
+    client_rep_->shutting_down = true;
+    client_rep_->flush_cv.notify_all();
+  }
+  if (client_rep_->flush_thread.joinable()) {
+    client_rep_->flush_thread.join();
+  }
 #ifndef ROCKSDB_LITE
   if (cache_rep_) {
     for (auto* handle : cache_rep_->dummy_handles_) {
@@ -145,4 +202,224 @@ void WriteBufferManager::FreeMemWithCache(size_t mem) {
   (void)mem;
 #endif  // ROCKSDB_LITE
 }
+
+void WriteBufferManager::RegisterClient(Client* client) {
+  std::lock_guard<std::mutex> lock(client_rep_->mutex);
+  client_rep_->clients.push_back(client);
+  num_clients_.store(client_rep_->clients.size(), std::memory_order_relaxed);
+}
+
+void WriteBufferManager::UnregisterClient(Client* client) {
+  {
+    std::unique_lock<std::mutex> lock(client_rep_->mutex);
+    auto& clients = client_rep_->clients;
+    clients.erase(std::remove(clients.begin(), clients.end(), client),
+                  clients.end());
+    num_clients_.store(clients.size(), std::memory_order_relaxed);
+    auto& requests = client_rep_->flush_requests;
+    for (auto it = requests.begin(); it != requests.end();) {
+      if (it->client == client) {
+        memory_flush_requested_.fetch_sub(it->memory_usage,
+                                          std::memory_order_relaxed);
+        it = requests.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    client_rep_->flush_cv.wait(
+        lock, [&] { return client_rep_->running.client != client; });
+  }
+  // The share of the clients left grows.
+  NotifyStalledWriters();
+}
+
+bool WriteBufferManager::PickFlushVictim(Client* requester,
+                                         uint32_t* column_family_id) {
+  assert(flush_policy_ != nullptr);
+  std::lock_guard<std::mutex> lock(client_rep_->mutex);
+  std::vector<WriteBufferFlushCandidate> candidates;
+  std::vector<Client*> owners;
+  bool level0_overlap = flush_policy_->NeedsLevel0Overlap();
+  for (Client* client : client_rep_->clients) {
+    size_t begin = candidates.size();
+    client->GetFlushCandidates(level0_overlap, &candidates);
+    // Leave out the memtables already on their way to be switched.
+    size_t end = begin;
+    for (size_t i = begin; i < candidates.size(); i++) {
+      if (!client_rep_->IsRequested(client,
+                                    candidates[i].column_family_id)) {
+        if (end != i) {
+          candidates[end] = std::move(candidates[i]);
+        }
+        end++;
+      }
+    }
+    candidates.resize(end);
+    owners.resize(end, client);
+  }
+  if (candidates.empty()) {
+    return false;
+  }
+  size_t victim = flush_policy_->PickVictim(candidates);
+  if (victim >= candidates.size()) {
+    return false;
+  }
+  if (owners[victim] == requester) {
+    *column_family_id = candidates[victim].column_family_id;
+    return true;
+  }
+  // The requester is in the middle of a write to its own DB, and the victim
+  // may have to wait for the writes to its DB, so another thread does it.
+  memory_flush_requested_.fetch_add(candidates[victim].memory_usage,
+                                    std::memory_order_relaxed);
+  client_rep_->flush_requests.push_back(
+      {owners[victim], candidates[victim].column_family_id,
+       candidates[victim].memory_usage});
+  if (!client_rep_->flush_thread.joinable()) {
+    client_rep_->flush_thread =
+        port::Thread(&WriteBufferManager::BGFlushThread, this);
+  }
+  client_rep_->flush_cv.notify_all();
+  return false;
+}
+
+void WriteBufferManager::BGFlushThread() {
+  std::unique_lock<std::mutex> lock(client_rep_->mutex);
+  while (true) {
+    client_rep_->flush_cv.wait(lock, [&] {
+      return client_rep_->shutting_down ||
+             !client_rep_->flush_requests.empty();
+    });
+    if (client_rep_->shutting_down) {
+      break;
+    }
+    client_rep_->running = client_rep_->flush_requests.front();
+    client_rep_->flush_requests.pop_front();
+    lock.unlock();
+    client_rep_->running.client->Flush(client_rep_->running.column_family_id);
+    lock.lock();
+    memory_flush_requested_.fetch_sub(client_rep_->running.memory_usage,
+                                      std::memory_order_relaxed);
+    client_rep_->running = {nullptr, 0, 0};
+    client_rep_->flush_cv.notify_all();
+  }
+}
+
+void WriteBufferManager::WaitForStallChange(uint64_t timeout_micros) {
+  std::unique_lock<std::mutex> lock(client_rep_->stall_mutex);
+  uint64_t epoch = client_rep_->stall_epoch;
+  stalled_writers_.fetch_add(1, std::memory_order_relaxed);
+  client_rep_->stall_cv.wait_for(
+      lock, std::chrono::microseconds(timeout_micros),
+      [&] { return client_rep_->stall_epoch != epoch; });
+  stalled_writers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WriteBufferManager::NotifyStalledWriters() {
+  std::lock_guard<std::mutex> lock(client_rep_->stall_mutex);
+  client_rep_->stall_epoch++;
+  client_rep_->stall_cv.notify_all();
+}
+
+namespace {
+class OldestMemTableFlushPolicy : public WriteBufferFlushPolicy {
+ public:
+  const char* Name() const override { return "OldestMemTableFlushPolicy"; }
+
+  size_t PickVictim(
+      const std::vector<WriteBufferFlushCandidate>& candidates) override {
+    size_t victim = 0;
+    for (size_t i = 1; i < candidates.size(); i++) {
+      if (candidates[i].oldest_key_time <
+          candidates[victim].oldest_key_time) {
+        victim = i;
+      }
+    }
+    return victim;
+  }
+};
+
+class LargestMemTableFlushPolicy : public WriteBufferFlushPolicy {
+ public:
+  const char* Name() const override { return "LargestMemTableFlushPolicy"; }
+
+  size_t PickVictim(
+      const std::vector<WriteBufferFlushCandidate>& candidates) override {
+    size_t victim = 0;
+    for (size_t i = 1; i < candidates.size(); i++) {
+      if (candidates[i].memory_usage > candidates[victim].memory_usage) {
+        victim = i;
+      }
+    }
+    return victim;
+  }
+};
+
+class TombstoneDensityFlushPolicy : public WriteBufferFlushPolicy {
+ public:
+  const char* Name() const override { return "TombstoneDensityFlushPolicy"; }
+
+  size_t PickVictim(
+      const std::vector<WriteBufferFlushCandidate>& candidates) override {
+    size_t victim = 0;
+    double victim_density = Density(candidates[0]);
+    for (size_t i = 1; i < candidates.size(); i++) {
+      double density = Density(candidates[i]);
+      if (density > victim_density ||
+          (density == victim_density &&
+           candidates[i].memory_usage > candidates[victim].memory_usage)) {
+        victim = i;
+        victim_density = density;
+      }
+    }
+    return victim;
+  }
+
+ private:
+  static double Density(const WriteBufferFlushCandidate& candidate) {
+    return static_cast<double>(candidate.num_deletes) /
+           static_cast<double>(std::max<size_t>(candidate.memory_usage, 1));
+  }
+};
+
+class LeastLevel0OverlapFlushPolicy : public WriteBufferFlushPolicy {
+ public:
+  const char* Name() const override {
+    return "LeastLevel0OverlapFlushPolicy";
+  }
+
+  bool NeedsLevel0Overlap() const override { return true; }
+
+  size_t PickVictim(
+      const std::vector<WriteBufferFlushCandidate>& candidates) override {
+    size_t victim = 0;
+    for (size_t i = 1; i < candidates.size(); i++) {
+      const WriteBufferFlushCandidate& c = candidates[i];
+      const WriteBufferFlushCandidate& v = candidates[victim];
+      if (c.num_level0_overlapping_files < v.num_level0_overlapping_files ||
+          (c.num_level0_overlapping_files == v.num_level0_overlapping_files &&
+           c.memory_usage > v.memory_usage)) {
+        victim = i;
+      }
+    }
+    return victim;
+  }
+};
+}  // namespace
+
+std::shared_ptr<WriteBufferFlushPolicy> NewOldestMemTableFlushPolicy() {
+  return std::make_shared<OldestMemTableFlushPolicy>();
+}
+
+std::shared_ptr<WriteBufferFlushPolicy> NewLargestMemTableFlushPolicy() {
+  return std::make_shared<LargestMemTableFlushPolicy>();
+}
+
+std::shared_ptr<WriteBufferFlushPolicy> NewTombstoneDensityFlushPolicy() {
+  return std::make_shared<TombstoneDensityFlushPolicy>();
+}
+
+std::shared_ptr<WriteBufferFlushPolicy> NewLeastLevel0OverlapFlushPolicy() {
+  return std::make_shared<LeastLevel0OverlapFlushPolicy>();
+}
 }  // namespace ROCKSDB_NAMESPACE
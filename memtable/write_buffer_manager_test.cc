@@ -8,6 +8,10 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "rocksdb/write_buffer_manager.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "port/port.h"
 #include "test_util/testharness.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -222,6 +226,164 @@ TEST_F(WriteBufferManagerTest, CacheFull) {
 }
 
 #endif  // ROCKSDB_LITE
+
+namespace {
+WriteBufferFlushCandidate MakeCandidate(uint32_t column_family_id,
+                                        size_t memory_usage,
+                                        uint64_t num_deletes,
+                                        uint64_t oldest_key_time,
+                                        int num_level0_overlapping_files) {
+  WriteBufferFlushCandidate candidate;
+  candidate.column_family_id = column_family_id;
+  candidate.memory_usage = memory_usage;
+  candidate.num_deletes = num_deletes;
+  candidate.oldest_key_time = oldest_key_time;
+  candidate.num_level0_overlapping_files = num_level0_overlapping_files;
+  return candidate;
+}
+
+class FakeClient : public WriteBufferManager::Client {
+ public:
+  void GetFlushCandidates(
+      bool /*level0_overlap*/,
+      std::vector<WriteBufferFlushCandidate>* candidates) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    candidates->insert(candidates->end(), memtables_.begin(),
+                       memtables_.end());
+  }
+
+  void Flush(uint32_t column_family_id) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.push_back(column_family_id);
+    cv_.notify_all();
+    cv_.wait(lock, [&] { return !blocked_; });
+  }
+
+  void AddMemTable(const WriteBufferFlushCandidate& candidate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memtables_.push_back(candidate);
+  }
+
+  void SetBlocked(bool blocked) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocked_ = blocked;
+    cv_.notify_all();
+  }
+
+  // Waits for `n` flushes and returns the column family of the last one.
+  uint32_t WaitForFlushes(size_t n) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return flushed_.size() >= n; });
+    return flushed_[n - 1];
+  }
+
+  size_t NumFlushes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushed_.size();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<WriteBufferFlushCandidate> memtables_;
+  std::vector<uint32_t> flushed_;
+  bool blocked_ = false;
+};
+}  // namespace
+
+TEST_F(WriteBufferManagerTest, FlushPolicies) {
+  std::vector<WriteBufferFlushCandidate> candidates;
+  candidates.push_back(MakeCandidate(0, 1000, 0, 30, 2));
+  candidates.push_back(MakeCandidate(1, 4000, 10, 10, 3));
+  candidates.push_back(MakeCandidate(2, 2000, 10, 20, 1));
+  candidates.push_back(MakeCandidate(3, 3000, 0, 40, 1));
+
+  ASSERT_EQ(1U, NewOldestMemTableFlushPolicy()->PickVictim(candidates));
+  ASSERT_EQ(1U, NewLargestMemTableFlushPolicy()->PickVictim(candidates));
+  ASSERT_EQ(2U, NewTombstoneDensityFlushPolicy()->PickVictim(candidates));
+  auto overlap = NewLeastLevel0OverlapFlushPolicy();
+  ASSERT_TRUE(overlap->NeedsLevel0Overlap());
+  ASSERT_EQ(3U, overlap->PickVictim(candidates));
+
+  // Without deletions the densest is the largest
+  candidates[1].num_deletes = 0;
+  candidates[2].num_deletes = 0;
+  ASSERT_EQ(1U, NewTombstoneDensityFlushPolicy()->PickVictim(candidates));
+}
+
+TEST_F(WriteBufferManagerTest, PickFlushVictimAcrossClients) {
+  WriteBufferManager wbf(10 * 1024 * 1024, {}, NewLargestMemTableFlushPolicy());
+  FakeClient requester;
+  FakeClient other;
+  wbf.RegisterClient(&requester);
+  wbf.RegisterClient(&other);
+  uint32_t column_family_id = 100;
+  ASSERT_FALSE(wbf.PickFlushVictim(&requester, &column_family_id));
+
+  requester.AddMemTable(MakeCandidate(1, 1 * 1024 * 1024, 0, 0, 0));
+  requester.AddMemTable(MakeCandidate(2, 3 * 1024 * 1024, 0, 0, 0));
+  other.AddMemTable(MakeCandidate(5, 5 * 1024 * 1024, 0, 0, 0));
+  wbf.ReserveMem(9 * 1024 * 1024);
+  ASSERT_TRUE(wbf.ShouldFlush());
+
+  // The largest memtable is flushed by a thread of the manager, and is left
+  // out of the next picks until its flush is done
+  other.SetBlocked(true);
+  ASSERT_FALSE(wbf.PickFlushVictim(&requester, &column_family_id));
+  ASSERT_EQ(5U, other.WaitForFlushes(1));
+  ASSERT_FALSE(wbf.ShouldFlush());
+  ASSERT_TRUE(wbf.PickFlushVictim(&requester, &column_family_id));
+  ASSERT_EQ(2U, column_family_id);
+  ASSERT_EQ(1U, other.NumFlushes());
+  ASSERT_EQ(0U, requester.NumFlushes());
+
+  // The memtable is still there when the flush is done; the manager counts it
+  // as mutable again
+  other.SetBlocked(false);
+  while (!wbf.ShouldFlush()) {
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(wbf.PickFlushVictim(&requester, &column_family_id));
+  ASSERT_EQ(5U, other.WaitForFlushes(2));
+
+  wbf.UnregisterClient(&other);
+  ASSERT_TRUE(wbf.PickFlushVictim(&requester, &column_family_id));
+  ASSERT_EQ(2U, column_family_id);
+  wbf.UnregisterClient(&requester);
+  wbf.FreeMem(9 * 1024 * 1024);
+}
+
+TEST_F(WriteBufferManagerTest, StallTarget) {
+  WriteBufferManager wbf(10 * 1024 * 1024, {}, nullptr, true /*allow_stall*/);
+  FakeClient client1;
+  FakeClient client2;
+  wbf.RegisterClient(&client1);
+  wbf.RegisterClient(&client2);
+
+  wbf.ReserveMem(9 * 1024 * 1024);
+  ASSERT_FALSE(wbf.ShouldStall());
+  wbf.ReserveMem(2 * 1024 * 1024);
+  ASSERT_TRUE(wbf.ShouldStall());
+  // Only the clients using more than half of the buffer stall
+  ASSERT_TRUE(wbf.IsStallTarget(6 * 1024 * 1024));
+  ASSERT_FALSE(wbf.IsStallTarget(4 * 1024 * 1024));
+
+  // Freeing memory wakes up the stalled writers
+  port::Thread stalled([&] {
+    while (wbf.ShouldStall()) {
+      wbf.WaitForStallChange(10 * 1000);
+    }
+  });
+  wbf.FreeMem(2 * 1024 * 1024);
+  stalled.join();
+  ASSERT_FALSE(wbf.ShouldStall());
+
+  wbf.UnregisterClient(&client2);
+  wbf.ReserveMem(2 * 1024 * 1024);
+  ASSERT_FALSE(wbf.IsStallTarget(6 * 1024 * 1024));
+  wbf.UnregisterClient(&client1);
+  wbf.FreeMem(11 * 1024 * 1024);
+}
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -45,6 +45,7 @@ PerfContext::PerfContext(const PerfContext& other) {
   block_cache_hit_count = other.block_cache_hit_count;
   block_read_count = other.block_read_count;
   block_read_byte = other.block_read_byte;
+  block_read_copy_byte = other.block_read_copy_byte;
   block_read_time = other.block_read_time;
   block_cache_index_hit_count = other.block_cache_index_hit_count;
   index_block_read_count = other.index_block_read_count;
@@ -142,6 +143,7 @@ PerfContext::PerfContext(PerfContext&& other) noexcept {
   block_cache_hit_count = other.block_cache_hit_count;
   block_read_count = other.block_read_count;
   block_read_byte = other.block_read_byte;
+  block_read_copy_byte = other.block_read_copy_byte;
   block_read_time = other.block_read_time;
   block_cache_index_hit_count = other.block_cache_index_hit_count;
   index_block_read_count = other.index_block_read_count;
@@ -241,6 +243,7 @@ PerfContext& PerfContext::operator=(const PerfContext& other) {
   block_cache_hit_count = other.block_cache_hit_count;
   block_read_count = other.block_read_count;
   block_read_byte = other.block_read_byte;
+  block_read_copy_byte = other.block_read_copy_byte;
   block_read_time = other.block_read_time;
   block_cache_index_hit_count = other.block_cache_index_hit_count;
   index_block_read_count = other.index_block_read_count;
@@ -337,6 +340,7 @@ void PerfContext::Reset() {
   block_cache_hit_count = 0;
   block_read_count = 0;
   block_read_byte = 0;
+  block_read_copy_byte = 0;
   block_read_time = 0;
   block_cache_index_hit_count = 0;
   index_block_read_count = 0;
@@ -457,6 +461,7 @@ std::string PerfContext::ToString(bool exclude_zero_counters) const {
   PERF_CONTEXT_OUTPUT(block_cache_hit_count);
   PERF_CONTEXT_OUTPUT(block_read_count);
   PERF_CONTEXT_OUTPUT(block_read_byte);
+  PERF_CONTEXT_OUTPUT(block_read_copy_byte);
   PERF_CONTEXT_OUTPUT(block_read_time);
   PERF_CONTEXT_OUTPUT(block_cache_index_hit_count);
   PERF_CONTEXT_OUTPUT(index_block_read_count);
@@ -206,6 +206,11 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
      "rocksdb.error.handler.autoresume.retry.total.count"},
     {ERROR_HANDLER_AUTORESUME_SUCCESS_COUNT,
      "rocksdb.error.handler.autoresume.success.count"},
+    {NUMBER_SUPERVERSION_ACQUIRES_LOCKED,
+     "rocksdb.number.superversion_acquires.locked"},
+    {SECONDARY_CACHE_HITS, "rocksdb.secondary.cache.hits"},
+    {CACHE_ADMISSION_ADMITTED, "rocksdb.cache.admission.admitted"},
+    {CACHE_ADMISSION_REJECTED, "rocksdb.cache.admission.rejected"},
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
@@ -301,6 +301,10 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct MutableCFOptions, max_successive_merges),
           OptionType::kSizeT, OptionVerificationType::kNormal,
           OptionTypeFlags::kMutable}},
+        {"memtable_hot_key_slots",
+         {offsetof(struct MutableCFOptions, memtable_hot_key_slots),
+          OptionType::kSizeT, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
         {"memtable_huge_page_size",
          {offsetof(struct MutableCFOptions, memtable_huge_page_size),
           OptionType::kSizeT, OptionVerificationType::kNormal,
@@ -503,6 +507,10 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::optimize_filters_for_hits),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"first_path_max_level",
+         {offset_of(&ColumnFamilyOptions::first_path_max_level),
+          OptionType::kInt, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
         {"force_consistency_checks",
          {offset_of(&ColumnFamilyOptions::force_consistency_checks),
           OptionType::kBoolean, OptionVerificationType::kNormal,
@@ -843,11 +851,13 @@ ImmutableCFOptions::ImmutableCFOptions(const ImmutableDBOptions& db_options,
       force_consistency_checks(cf_options.force_consistency_checks),
       allow_ingest_behind(db_options.allow_ingest_behind),
       preserve_deletes(db_options.preserve_deletes),
+      adaptive_write_stall(db_options.adaptive_write_stall),
       listeners(db_options.listeners),
       row_cache(db_options.row_cache),
       memtable_insert_with_hint_prefix_extractor(
           cf_options.memtable_insert_with_hint_prefix_extractor.get()),
       cf_paths(cf_options.cf_paths),
+      first_path_max_level(cf_options.first_path_max_level),
       compaction_thread_limiter(cf_options.compaction_thread_limiter),
       file_checksum_gen_factory(db_options.file_checksum_gen_factory.get()),
       sst_partitioner_factory(cf_options.sst_partitioner_factory),
@@ -933,6 +943,9 @@ void MutableCFOptions::Dump(Logger* log) const {
   ROCKS_LOG_INFO(log,
                  "                 inplace_update_num_locks: %" ROCKSDB_PRIszt,
                  inplace_update_num_locks);
+  ROCKS_LOG_INFO(log,
+                 "                   memtable_hot_key_slots: %" ROCKSDB_PRIszt,
+                 memtable_hot_key_slots);
   ROCKS_LOG_INFO(
       log, "                         prefix_extractor: %s",
       prefix_extractor == nullptr ? "nullptr" : prefix_extractor->Name());
@@ -109,6 +109,8 @@ struct ImmutableCFOptions {
 
   bool preserve_deletes;
 
+  bool adaptive_write_stall;
+
   // A vector of EventListeners which callback functions will be called
   // when specific RocksDB event happens.
   std::vector<std::shared_ptr<EventListener>> listeners;
@@ -119,6 +121,8 @@ struct ImmutableCFOptions {
 
   std::vector<DbPath> cf_paths;
 
+  int first_path_max_level;
+
   std::shared_ptr<ConcurrentTaskLimiter> compaction_thread_limiter;
 
   FileChecksumGenFactory* file_checksum_gen_factory;
@@ -144,6 +148,7 @@ struct MutableCFOptions {
         memtable_huge_page_size(options.memtable_huge_page_size),
         max_successive_merges(options.max_successive_merges),
         inplace_update_num_locks(options.inplace_update_num_locks),
+        memtable_hot_key_slots(options.memtable_hot_key_slots),
         prefix_extractor(options.prefix_extractor),
         disable_auto_compactions(options.disable_auto_compactions),
         soft_pending_compaction_bytes_limit(
@@ -196,6 +201,7 @@ struct MutableCFOptions {
         memtable_huge_page_size(0),
         max_successive_merges(0),
         inplace_update_num_locks(0),
+        memtable_hot_key_slots(0),
         prefix_extractor(nullptr),
         disable_auto_compactions(false),
         soft_pending_compaction_bytes_limit(0),
@@ -253,6 +259,7 @@ struct MutableCFOptions {
   size_t memtable_huge_page_size;
   size_t max_successive_merges;
   size_t inplace_update_num_locks;
+  size_t memtable_hot_key_slots;
   std::shared_ptr<const SliceTransform> prefix_extractor;
 
   // Compaction related options
@@ -299,10 +299,22 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct ImmutableDBOptions, unordered_write),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"adaptive_write_stall",
+         {offsetof(struct ImmutableDBOptions, adaptive_write_stall),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"enable_parallel_wal_write",
+         {offsetof(struct ImmutableDBOptions, enable_parallel_wal_write),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
         {"allow_concurrent_memtable_write",
          {offsetof(struct ImmutableDBOptions, allow_concurrent_memtable_write),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"batch_insert_threads",
+         {offsetof(struct ImmutableDBOptions, batch_insert_threads),
+          OptionType::kInt, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
         {"wal_recovery_mode",
          OptionTypeInfo::Enum<WALRecoveryMode>(
              offsetof(struct ImmutableDBOptions, wal_recovery_mode),
@@ -383,6 +395,10 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct ImmutableDBOptions, best_efforts_recovery),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"wal_recovery_threads",
+         {offsetof(struct ImmutableDBOptions, wal_recovery_threads),
+          OptionType::kInt, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
         {"max_bgerror_resume_count",
          {offsetof(struct ImmutableDBOptions, max_bgerror_resume_count),
           OptionType::kInt, OptionVerificationType::kNormal,
@@ -550,7 +566,10 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       enable_thread_tracking(options.enable_thread_tracking),
       enable_pipelined_write(options.enable_pipelined_write),
       unordered_write(options.unordered_write),
+      enable_parallel_wal_write(options.enable_parallel_wal_write),
+      adaptive_write_stall(options.adaptive_write_stall),
       allow_concurrent_memtable_write(options.allow_concurrent_memtable_write),
+      batch_insert_threads(options.batch_insert_threads),
       enable_write_thread_adaptive_yield(
           options.enable_write_thread_adaptive_yield),
       write_thread_max_yield_usec(options.write_thread_max_yield_usec),
@@ -578,6 +597,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       log_readahead_size(options.log_readahead_size),
       file_checksum_gen_factory(options.file_checksum_gen_factory),
       best_efforts_recovery(options.best_efforts_recovery),
+      wal_recovery_threads(options.wal_recovery_threads),
       max_bgerror_resume_count(options.max_bgerror_resume_count),
       bgerror_resume_retry_interval(options.bgerror_resume_retry_interval),
       allow_data_in_errors(options.allow_data_in_errors),
@@ -692,8 +712,14 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    enable_pipelined_write);
   ROCKS_LOG_HEADER(log, "                 Options.unordered_write: %d",
                    unordered_write);
+  ROCKS_LOG_HEADER(log, "              Options.enable_parallel_wal_write: %d",
+                   enable_parallel_wal_write);
+  ROCKS_LOG_HEADER(log, "                   Options.adaptive_write_stall: %d",
+                   adaptive_write_stall);
   ROCKS_LOG_HEADER(log, "        Options.allow_concurrent_memtable_write: %d",
                    allow_concurrent_memtable_write);
+  ROCKS_LOG_HEADER(log, "                   Options.batch_insert_threads: %d",
+                   batch_insert_threads);
   ROCKS_LOG_HEADER(log, "     Options.enable_write_thread_adaptive_yield: %d",
                    enable_write_thread_adaptive_yield);
   ROCKS_LOG_HEADER(log,
@@ -742,6 +768,8 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                                              : kUnknownFileChecksumFuncName);
   ROCKS_LOG_HEADER(log, "                Options.best_efforts_recovery: %d",
                    static_cast<int>(best_efforts_recovery));
+  ROCKS_LOG_HEADER(log, "                 Options.wal_recovery_threads: %d",
+                   wal_recovery_threads);
   ROCKS_LOG_HEADER(log, "               Options.max_bgerror_resume_count: %d",
                    max_bgerror_resume_count);
   ROCKS_LOG_HEADER(log,
@@ -65,7 +65,10 @@ struct ImmutableDBOptions {
   bool enable_thread_tracking;
   bool enable_pipelined_write;
   bool unordered_write;
+  bool enable_parallel_wal_write;
+  bool adaptive_write_stall;
   bool allow_concurrent_memtable_write;
+  int batch_insert_threads;
   bool enable_write_thread_adaptive_yield;
   uint64_t write_thread_max_yield_usec;
   uint64_t write_thread_slow_yield_usec;
@@ -91,6 +94,7 @@ struct ImmutableDBOptions {
   size_t log_readahead_size;
   std::shared_ptr<FileChecksumGenFactory> file_checksum_gen_factory;
   bool best_efforts_recovery;
+  int wal_recovery_threads;
   int max_bgerror_resume_count;
   uint64_t bgerror_resume_retry_interval;
   bool allow_data_in_errors;
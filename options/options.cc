@@ -47,6 +47,7 @@ AdvancedColumnFamilyOptions::AdvancedColumnFamilyOptions(const Options& options)
           options.max_write_buffer_size_to_maintain),
       inplace_update_support(options.inplace_update_support),
       inplace_update_num_locks(options.inplace_update_num_locks),
+      memtable_hot_key_slots(options.memtable_hot_key_slots),
       inplace_callback(options.inplace_callback),
       memtable_prefix_bloom_size_ratio(
           options.memtable_prefix_bloom_size_ratio),
@@ -353,6 +354,10 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
         log,
         "                Options.inplace_update_num_locks: %" ROCKSDB_PRIszt,
         inplace_update_num_locks);
+    ROCKS_LOG_HEADER(
+        log,
+        "                  Options.memtable_hot_key_slots: %" ROCKSDB_PRIszt,
+        memtable_hot_key_slots);
     // TODO: easier config for bloom (maybe based on avg key/value size)
     ROCKS_LOG_HEADER(
         log, "              Options.memtable_prefix_bloom_size_ratio: %f",
@@ -380,6 +385,8 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                      force_consistency_checks);
     ROCKS_LOG_HEADER(log, "               Options.report_bg_io_stats: %d",
                      report_bg_io_stats);
+    ROCKS_LOG_HEADER(log, "             Options.first_path_max_level: %d",
+                     first_path_max_level);
     ROCKS_LOG_HEADER(log, "                              Options.ttl: %" PRIu64,
                      ttl);
     ROCKS_LOG_HEADER(log,
@@ -122,8 +122,12 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.delayed_write_rate = mutable_db_options.delayed_write_rate;
   options.enable_pipelined_write = immutable_db_options.enable_pipelined_write;
   options.unordered_write = immutable_db_options.unordered_write;
+  options.enable_parallel_wal_write =
+      immutable_db_options.enable_parallel_wal_write;
+  options.adaptive_write_stall = immutable_db_options.adaptive_write_stall;
   options.allow_concurrent_memtable_write =
       immutable_db_options.allow_concurrent_memtable_write;
+  options.batch_insert_threads = immutable_db_options.batch_insert_threads;
   options.enable_write_thread_adaptive_yield =
       immutable_db_options.enable_write_thread_adaptive_yield;
   options.max_write_batch_group_size_bytes =
@@ -162,6 +166,7 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.file_checksum_gen_factory =
       immutable_db_options.file_checksum_gen_factory;
   options.best_efforts_recovery = immutable_db_options.best_efforts_recovery;
+  options.wal_recovery_threads = immutable_db_options.wal_recovery_threads;
   options.max_bgerror_resume_count =
       immutable_db_options.max_bgerror_resume_count;
   options.bgerror_resume_retry_interval =
@@ -190,6 +195,7 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
   cf_opts.max_successive_merges = mutable_cf_options.max_successive_merges;
   cf_opts.inplace_update_num_locks =
       mutable_cf_options.inplace_update_num_locks;
+  cf_opts.memtable_hot_key_slots = mutable_cf_options.memtable_hot_key_slots;
   cf_opts.prefix_extractor = mutable_cf_options.prefix_extractor;
 
   // Compaction related options
@@ -164,6 +164,7 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
       "pin_l0_filter_and_index_blocks_in_cache=1;"
       "pin_top_level_index_and_filter=1;"
       "index_type=kHashSearch;"
+      "decode_index_blocks=true;"
       "data_block_index_type=kDataBlockBinaryAndHash;"
       "index_shortening=kNoShortening;"
       "data_block_hash_table_util_ratio=0.75;"
@@ -313,7 +314,10 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "fail_if_options_file_error=false;"
                              "enable_pipelined_write=false;"
                              "unordered_write=false;"
+                             "enable_parallel_wal_write=false;"
+                             "adaptive_write_stall=false;"
                              "allow_concurrent_memtable_write=true;"
+                             "batch_insert_threads=1;"
                              "wal_recovery_mode=kPointInTimeRecovery;"
                              "enable_write_thread_adaptive_yield=true;"
                              "write_thread_slow_yield_usec=5;"
@@ -335,6 +339,7 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "log_readahead_size=0;"
                              "write_dbid_to_manifest=false;"
                              "best_efforts_recovery=false;"
+                             "wal_recovery_threads=1;"
                              "max_bgerror_resume_count=2;"
                              "bgerror_resume_retry_interval=1000000"
                              "db_host_id=hostname;"
@@ -493,7 +498,9 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "paranoid_file_checks=true;"
       "force_consistency_checks=true;"
       "inplace_update_num_locks=7429;"
+      "memtable_hot_key_slots=1024;"
       "optimize_filters_for_hits=false;"
+      "first_path_max_level=1;"
       "level_compaction_dynamic_level_bytes=false;"
       "inplace_update_support=false;"
       "compaction_style=kCompactionStyleFIFO;"
@@ -1121,6 +1121,22 @@ TEST_F(OptionsTest, GetMemTableRepFactoryFromString) {
   ASSERT_NOK(GetMemTableRepFactoryFromString("vector:1024:invalid_opt",
                                              &new_mem_factory));
 
+  ASSERT_OK(GetMemTableRepFactoryFromString("partitioned_skip_list",
+                                            &new_mem_factory));
+  ASSERT_OK(GetMemTableRepFactoryFromString("partitioned_skip_list:8",
+                                            &new_mem_factory));
+  ASSERT_EQ(std::string(new_mem_factory->Name()),
+            "PartitionedSkipListRepFactory");
+  ASSERT_NOK(GetMemTableRepFactoryFromString(
+      "partitioned_skip_list:8:invalid_opt", &new_mem_factory));
+
+  ASSERT_OK(GetMemTableRepFactoryFromString("hash_vector", &new_mem_factory));
+  ASSERT_OK(
+      GetMemTableRepFactoryFromString("hash_vector:1000", &new_mem_factory));
+  ASSERT_EQ(std::string(new_mem_factory->Name()), "HashVectorRepFactory");
+  ASSERT_NOK(GetMemTableRepFactoryFromString("hash_vector:1000:invalid_opt",
+                                             &new_mem_factory));
+
   ASSERT_NOK(GetMemTableRepFactoryFromString("cuckoo", &new_mem_factory));
   // CuckooHash memtable is already removed.
   ASSERT_NOK(GetMemTableRepFactoryFromString("cuckoo:1024", &new_mem_factory));
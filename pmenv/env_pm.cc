@@ -1,5 +1,6 @@
 #include "pmenv/env_pm.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <libpmem.h>
@@ -8,291 +9,494 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+
+#include "env/composite_env_wrapper.h"
+#include "env/io_posix.h"
+#include "options/options_helper.h"
+#include "port/port.h"
 #include "rocksdb/env.h"
+#include "rocksdb/utilities/object_registry.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/string_util.h"
 
 namespace rocksdb {
 
 namespace {
 
-class PMWritableFile : public WritableFile {
+// A WAL file written by PMWritableFile starts with a header area made of a
+// segment descriptor and kPMLogNumCommitSlots commit slots, followed by the
+// log data itself. Every write group publishes the committed data length
+// into the next slot in round-robin order instead of rewriting one global
+// length word, so a torn slot only loses the group that was being committed
+// while the previous slots still describe all earlier groups.
+//
+// The descriptor carries the epoch of the segment, which is bumped every time
+// the file is recycled. Only slots stamped with the current epoch are valid,
+// so the slots and the stale tail of a previous incarnation are never read.
+//
+// Segment descriptor layout (one cache line):
+//   magic (8 bytes) | epoch (4 bytes) | masked crc32c of the preceding
+//   12 bytes (4 bytes) | padding
+// Commit slot layout:
+//   committed length (8 bytes) | group number (8 bytes) | epoch (4 bytes) |
+//   masked crc32c of the preceding 20 bytes (4 bytes) | padding
+constexpr uint64_t kPMLogMagic = 0x706d656d77616c31ull;  // "pmemwal1"
+constexpr size_t kPMLogDescriptorSize = 64;
+constexpr size_t kPMLogDescriptorPayload = 12;
+constexpr size_t kPMLogCommitSlotSize = 32;
+constexpr size_t kPMLogNumCommitSlots = 8;
+constexpr size_t kPMLogCommitSlotPayload = 20;
+constexpr size_t kPMLogHeaderSize =
+    kPMLogDescriptorSize + kPMLogCommitSlotSize * kPMLogNumCommitSlots;
+
+void EncodePMLogDescriptor(char* dst, uint32_t epoch) {
+  memset(dst, 0, kPMLogDescriptorSize);
+  EncodeFixed64(dst, kPMLogMagic);
+  EncodeFixed32(dst + 8, epoch);
+  EncodeFixed32(dst + kPMLogDescriptorPayload,
+                crc32c::Mask(crc32c::Value(dst, kPMLogDescriptorPayload)));
+}
+
+// Returns the epoch of the segment, or 0 if the descriptor is not valid.
+uint32_t DecodePMLogEpoch(const char* header) {
+  uint32_t expected =
+      crc32c::Unmask(DecodeFixed32(header + kPMLogDescriptorPayload));
+  if (crc32c::Value(header, kPMLogDescriptorPayload) != expected ||
+      DecodeFixed64(header) != kPMLogMagic) {
+    return 0;
+  }
+  return DecodeFixed32(header + 8);
+}
+
+void EncodePMLogCommitSlot(char* dst, uint64_t length, uint64_t group,
+                           uint32_t epoch) {
+  memset(dst, 0, kPMLogCommitSlotSize);
+  EncodeFixed64(dst, length);
+  EncodeFixed64(dst + 8, group);
+  EncodeFixed32(dst + 16, epoch);
+  EncodeFixed32(dst + kPMLogCommitSlotPayload,
+                crc32c::Mask(crc32c::Value(dst, kPMLogCommitSlotPayload)));
+}
+
+bool DecodePMLogCommitSlot(const char* src, uint32_t epoch, uint64_t* length,
+                           uint64_t* group) {
+  uint32_t expected =
+      crc32c::Unmask(DecodeFixed32(src + kPMLogCommitSlotPayload));
+  if (crc32c::Value(src, kPMLogCommitSlotPayload) != expected ||
+      DecodeFixed32(src + 16) != epoch) {
+    return false;
+  }
+  *length = DecodeFixed64(src);
+  *group = DecodeFixed64(src + 8);
+  return *group != 0;
+}
+
+// Returns the data length published by the newest valid commit slot of the
+// current epoch, or 0 if no group was ever committed.
+uint64_t PMLogCommittedLength(const char* header) {
+  uint32_t epoch = DecodePMLogEpoch(header);
+  if (epoch == 0) {
+    return 0;
+  }
+  const char* slots = header + kPMLogDescriptorSize;
+  uint64_t best_group = 0;
+  uint64_t best_length = 0;
+  for (size_t i = 0; i < kPMLogNumCommitSlots; i++) {
+    uint64_t length, group;
+    if (DecodePMLogCommitSlot(slots + i * kPMLogCommitSlotSize, epoch, &length,
+                              &group) &&
+        group > best_group) {
+      best_group = group;
+      best_length = length;
+    }
+  }
+  return best_length;
+}
+
+// Name prefix of the pre-created WAL segments waiting in a pool.
+const char* const kPMLogSegmentPrefix = "PMWAL-SEGMENT-";
+
+// A mapped WAL file that has not been wrapped by PMWritableFile yet.
+struct PMLogSegment {
+  std::string fname;
+  uint8_t* map_base = nullptr;
+  size_t mapped_len = 0;
+  int is_pmem = 0;
+};
+
+// Reads the header area of a WAL file. Returns false if the file is too
+// short or was not written by PMWritableFile.
+bool ReadPMLogHeader(const std::string& fname, char* header) {
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = pread(fd, header, kPMLogHeaderSize, 0);
+  close(fd);
+  return n == static_cast<ssize_t>(kPMLogHeaderSize) &&
+         DecodePMLogEpoch(header) != 0;
+}
+
+class PMWritableFile : public FSWritableFile {
  public:
-  static Status Create(const std::string& fname, WritableFile** p_file,
-                       size_t init_size, size_t size_addition) {
-    void* pmemaddr;
-    size_t mapped_len;
-    int is_pmem;
-    /* create a pmem file and memory map it */
-    if ((pmemaddr = pmem_map_file(fname.c_str(), init_size,
-                                  PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0666,
-                                  &mapped_len, &is_pmem)) == NULL) {
-      perror("pmem_map_file");
-      exit(1);
-    }
-    *p_file =
-        new PMWritableFile((uint8_t*)pmemaddr, init_size, size_addition, fname);
-    return Status::OK();
-  }
-  Status Append(const Slice& slice,
-                const DataVerificationInfo& /* verification_info */) override {
-    return Append(slice);
-  }
-  Status Append(const Slice& slice) override {
+  // Takes over the mapping of segment and starts a new incarnation of it
+  // with the given epoch.
+  PMWritableFile(const PMLogSegment& segment, uint32_t epoch,
+                 size_t _size_addition)
+      : data_length(0),
+        committed_length_(0),
+        next_group_(0),
+        epoch_(epoch),
+        file_size(segment.mapped_len),
+        size_addition(_size_addition),
+        map_base(segment.map_base),
+        is_pmem_(segment.is_pmem),
+        fname_(segment.fname) {
+    // stamp the new epoch, which invalidates all existing commit slots
+    EncodePMLogDescriptor((char*)map_base, epoch_);
+    pmem_persist(map_base, kPMLogDescriptorSize);
+  }
+
+  ~PMWritableFile() override {
+    if (map_base != nullptr) {
+      Close(IOOptions(), nullptr).PermitUncheckedError();
+    }
+  }
+
+  IOStatus Append(const Slice& slice, const IOOptions& options,
+                  const DataVerificationInfo& /* verification_info */,
+                  IODebugContext* dbg) override {
+    return Append(slice, options, dbg);
+  }
+  IOStatus Append(const Slice& slice, const IOOptions& /*options*/,
+                  IODebugContext* /*dbg*/) override {
     size_t len = slice.size();
     // the least file size to write the new slice
-    size_t least_file_size = sizeof(size_t) + data_length + len;
+    size_t least_file_size = kPMLogHeaderSize + data_length + len;
     // left space is not enough, need expand
-    MayNeedRemap(least_file_size);
-    // pmem_memcpy_persist(map_base + sizeof(size_t) + data_length,
-    // slice.data(),len);
-    memcpy(map_base + sizeof(size_t) + data_length, slice.data(), len);
+    IOStatus s = MayNeedRemap(least_file_size);
+    if (!s.ok()) {
+      return s;
+    }
+    // Non-temporal copy: the touched cache lines are flushed here, and the
+    // single drain for the whole write group is issued by Flush().
+    pmem_memcpy_nodrain(map_base + kPMLogHeaderSize + data_length,
+                        slice.data(), len);
     data_length += len;
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  Status Truncate(uint64_t size) override {
-    MayNeedRemap(size);
-    data_length = size;
-    return Status::OK();
+  // In place appends let every writer of a write group copy its own record
+  // into the mapping. As with Append(), the copies are drained, and
+  // published in a commit slot, by the next Flush().
+  IOStatus ReserveAppend(size_t n, char** buf, const IOOptions& /*options*/,
+                         IODebugContext* /*dbg*/) override {
+    IOStatus s = MayNeedRemap(kPMLogHeaderSize + data_length + n);
+    if (s.ok()) {
+      *buf = (char*)map_base + kPMLogHeaderSize + data_length;
+    }
+    return s;
   }
 
-  Status Close() override {
-    Sync();
-    pmem_unmap(map_base, file_size);
-    return Status::OK();
+  void CopyToReserved(char* dst, const Slice& data) override {
+    pmem_memcpy_nodrain(dst, data.data(), data.size());
   }
 
-  Status Flush() override {
-    // DCPMM need no flush
-    return Status::OK();
+  IOStatus CommitReserved(size_t n, const IOOptions& /*options*/,
+                          IODebugContext* /*dbg*/) override {
+    data_length += n;
+    return IOStatus::OK();
   }
 
-  Status Sync() override {
-    // sync the cacheline which is not persist
-    if (data_length > persist_length_) {
-      pmem_persist(map_base + sizeof(size_t) + persist_length_,
-                   data_length - persist_length_);
-      persist_length_ = data_length;
+  IOStatus Truncate(uint64_t size, const IOOptions& /*options*/,
+                    IODebugContext* /*dbg*/) override {
+    IOStatus s = MayNeedRemap(kPMLogHeaderSize + size);
+    if (s.ok()) {
+      data_length = size;
+    }
+    return s;
+  }
+
+  IOStatus Close(const IOOptions& options, IODebugContext* dbg) override {
+    IOStatus s = Sync(options, dbg);
+    pmem_unmap(map_base, file_size);
+    map_base = nullptr;
+    return s;
+  }
+
+  IOStatus Flush(const IOOptions& /*options*/,
+                 IODebugContext* /*dbg*/) override {
+    // Publish the group written so far. Its data is made durable before the
+    // slot is stored, so a slot never covers data lost by a power failure.
+    // The slot store itself is not drained, so a process crash keeps the
+    // group and only Sync() makes it durable.
+    if (data_length != committed_length_) {
+      // Truncate() may have moved the data length below the published one
+      size_t begin = std::min(committed_length_, data_length);
+      if (is_pmem_) {
+        pmem_drain();
+      } else if (data_length > begin &&
+                 pmem_msync(map_base + kPMLogHeaderSize + begin,
+                            data_length - begin) != 0) {
+        return IOError("While pmem_msync", fname_, errno);
+      }
+      char slot[kPMLogCommitSlotSize];
+      next_group_++;
+      EncodePMLogCommitSlot(slot, data_length, next_group_, epoch_);
+      pmem_memcpy_nodrain(
+          map_base + kPMLogDescriptorSize +
+              (next_group_ % kPMLogNumCommitSlots) * kPMLogCommitSlotSize,
+          slot, kPMLogCommitSlotSize);
+      committed_length_ = data_length;
+    }
+    return IOStatus::OK();
+  }
+
+  IOStatus Sync(const IOOptions& options, IODebugContext* dbg) override {
+    IOStatus s = Flush(options, dbg);
+    if (!s.ok()) {
+      return s;
+    }
+    // Makes the newest commit slot durable
+    if (is_pmem_) {
+      pmem_drain();
+    } else if (pmem_msync(map_base, kPMLogHeaderSize) != 0) {
+      return IOError("While pmem_msync", fname_, errno);
     }
-    // write file metadata and persist
-    pmem_memcpy_persist((void*)map_base, &data_length, sizeof(size_t));
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  uint64_t GetFileSize() override {
+  uint64_t GetFileSize(const IOOptions& /*options*/,
+                       IODebugContext* /*dbg*/) override {
     // it is the data length, not the physical space size
     return data_length;
   }
- private:
-  PMWritableFile(uint8_t* base, size_t init_size, size_t _size_addition,
-                 const std::string& fname)
-      : data_length(0),
-        persist_length_(0),
-        file_size(init_size),
-        size_addition(_size_addition),
-        map_base(base),
-        fname_(fname) {
-    // reset the data length in offset 0
-    pmem_memset_persist(map_base, 0, sizeof(size_t));
-  }
 
-  void MayNeedRemap(size_t new_size) {
+ private:
+  // Only reached when a WAL outgrows its whole reserved mapping.
+  IOStatus MayNeedRemap(size_t new_size) {
     if (new_size > file_size) {
       size_t count = (new_size - file_size - 1) / size_addition + 1;
       size_t add_size = count * size_addition;
-      int is_pmem;
       // remmap the file with larger file size
       pmem_unmap(map_base, file_size);
       map_base =
           (uint8_t*)pmem_map_file(fname_.c_str(), file_size + add_size,
-                                  PMEM_FILE_CREATE, 0666, &file_size, &is_pmem);
+                                  PMEM_FILE_CREATE, 0666, &file_size, &is_pmem_);
       if (map_base == NULL) {
-        perror("truncate: pmem_remap_file");
-        exit(1);
+        return IOError("While remapping a pmem WAL", fname_, errno);
       }
     }
+    return IOStatus::OK();
   }
 
  private:
-  size_t data_length;  // the writen data length
-  size_t persist_length_;
-  size_t file_size;      // the length of the whole file
-  size_t size_addition;  // expand size_addition bytes
-                         // every time left space is not enough
-  uint8_t* map_base;     // mmap()-ed area
+  size_t data_length;        // the writen data length
+  size_t committed_length_;  // the length published in the newest slot
+  uint64_t next_group_;      // number of the last published write group
+  uint32_t epoch_;           // incarnation of this segment
+  size_t file_size;          // the length of the whole file
+  size_t size_addition;      // expand size_addition bytes
+                             // every time left space is not enough
+  uint8_t* map_base;         // mmap()-ed area
+  int is_pmem_;
   std::string fname_;
 };
-class PMWritableFileSST : public WritableFile {
+
+// Writes an SST file straight into a pmem mapping. The file is created with
+// init_size bytes and grown in steps of size_addition; Close() trims it back
+// to the data length.
+class PMWritableFileSST : public FSWritableFile {
  public:
-  static Status Create(const std::string& fname, WritableFile** p_file,
-                       size_t init_size, size_t size_addition) {
-    void* pmemaddr;
+  // Sets *result to nullptr, without an error, if the mapping is not on
+  // persistent memory and allow_non_pmem is false. The file is not left
+  // behind in that case.
+  static IOStatus Create(const std::string& fname, size_t init_size,
+                         size_t size_addition, bool allow_non_pmem,
+                         std::unique_ptr<FSWritableFile>* result) {
+    result->reset();
     size_t mapped_len;
     int is_pmem;
-    /* create a pmem file and memory map it */
-    if ((pmemaddr = pmem_map_file(fname.c_str(), init_size,
-                                  PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0666,
-                                  &mapped_len, &is_pmem)) == NULL) {
-      perror("pmem_map_file");
-      exit(1);
-    }
-    *p_file =
-        new PMWritableFileSST((uint8_t*)pmemaddr, init_size, size_addition, fname);
-    return Status::OK();
-  }
-  Status Append(const Slice& slice,
-                const DataVerificationInfo& /* verification_info */) override {
-    return Append(slice);
-  }
-  Status Append(const Slice& slice) override {
-    //   printf("%s append size=%lu\n",fname_.c_str(),slice.size());
+    // create a pmem file and memory map it
+    void* base = pmem_map_file(fname.c_str(), init_size,
+                               PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0666,
+                               &mapped_len, &is_pmem);
+    if (base == NULL) {
+      return IOError("While pmem_map_file", fname, errno);
+    }
+    if (!is_pmem && !allow_non_pmem) {
+      pmem_unmap(base, mapped_len);
+      unlink(fname.c_str());
+      return IOStatus::OK();
+    }
+    result->reset(new PMWritableFileSST((uint8_t*)base, mapped_len, is_pmem,
+                                        size_addition, fname));
+    return IOStatus::OK();
+  }
+
+  ~PMWritableFileSST() override {
+    if (map_base != nullptr) {
+      Close(IOOptions(), nullptr).PermitUncheckedError();
+    }
+  }
+
+  IOStatus Append(const Slice& slice, const IOOptions& options,
+                  const DataVerificationInfo& /* verification_info */,
+                  IODebugContext* dbg) override {
+    return Append(slice, options, dbg);
+  }
+  IOStatus Append(const Slice& slice, const IOOptions& /*options*/,
+                  IODebugContext* /*dbg*/) override {
     size_t len = slice.size();
-    // the least file size to write the new slice
-    size_t least_file_size = data_length + len;
     // left space is not enough, need expand
-    MayNeedRemap(least_file_size);
-    // pmem_memcpy_persist(map_base + data_length,
-    // slice.data(),len);
-    memcpy(map_base+ data_length, slice.data(), len);
+    IOStatus s = MayNeedRemap(data_length + len);
+    if (!s.ok()) {
+      return s;
+    }
+    memcpy(map_base + data_length, slice.data(), len);
     data_length += len;
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  Status Truncate(uint64_t size) override {
-    MayNeedRemap(size);
-    // Sync();
+  // Only the data length changes here; the file itself is resized to the
+  // data length by Close().
+  IOStatus Truncate(uint64_t size, const IOOptions& /*options*/,
+                    IODebugContext* /*dbg*/) override {
+    IOStatus s = MayNeedRemap(size);
+    if (!s.ok()) {
+      return s;
+    }
+    if (size > data_length) {
+      // the mapping may still hold bytes of a previous, longer data length
+      memset(map_base + data_length, 0, size - data_length);
+    }
     data_length = size;
-    // persist_length_=size;
-    // file_size = size;
-    // if(ftruncate(fd_,size)!=0){
-    //     return Status::IOError(std::string("ftruncate error: ").append(fname_).append(strerror(errno)));
-    // }
-    return Status::OK();
+    persist_length_ = std::min(persist_length_, data_length);
+    return IOStatus::OK();
   }
 
-  Status Close() override {
-    // Sync();
+  IOStatus Close(const IOOptions& options, IODebugContext* dbg) override {
+    IOStatus s = Sync(options, dbg);
     pmem_unmap(map_base, file_size);
-    if(file_size!=data_length){
-        if(ftruncate(fd_,data_length)!=0){
-        return Status::IOError(std::string("ftruncate error: ").append(fname_).append(strerror(errno)));
-    }
+    map_base = nullptr;
+    if (s.ok() && file_size != data_length &&
+        truncate(fname_.c_str(), data_length) != 0) {
+      s = IOError("While truncating a pmem SST", fname_, errno);
     }
-    return Status::OK();
+    return s;
   }
 
-  Status Flush() override {
+  IOStatus Flush(const IOOptions& /*options*/,
+                 IODebugContext* /*dbg*/) override {
     // DCPMM need no flush
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  Status Sync() override {
-    // printf("%s sync\n",fname_.c_str());
+  IOStatus Sync(const IOOptions& /*options*/,
+                IODebugContext* /*dbg*/) override {
     // sync the cacheline which is not persist
     if (data_length > persist_length_) {
-      pmem_persist(map_base + persist_length_,
-                   data_length - persist_length_);
+      if (is_pmem_) {
+        pmem_persist(map_base + persist_length_,
+                     data_length - persist_length_);
+      } else if (pmem_msync(map_base + persist_length_,
+                            data_length - persist_length_) != 0) {
+        return IOError("While pmem_msync", fname_, errno);
+      }
       persist_length_ = data_length;
     }
-    // write file metadata and persist
-    // pmem_memcpy_persist((void*)map_base, &data_length, sizeof(size_t));
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  uint64_t GetFileSize() override {
+  uint64_t GetFileSize(const IOOptions& /*options*/,
+                       IODebugContext* /*dbg*/) override {
     // it is the data length, not the physical space size
     return data_length;
   }
+
  private:
-  PMWritableFileSST(uint8_t* base, size_t init_size, size_t _size_addition,
-                 const std::string& fname)
+  PMWritableFileSST(uint8_t* base, size_t mapped_len, int is_pmem,
+                    size_t _size_addition, const std::string& fname)
       : data_length(0),
         persist_length_(0),
-        file_size(init_size),
+        file_size(mapped_len),
         size_addition(_size_addition),
         map_base(base),
-        fname_(fname) {
-    // reset the data length in offset 0
-    // pmem_memset_persist(map_base, 0, sizeof(size_t));
-    fd_=open(fname.c_str(),O_WRONLY);
-  }
+        is_pmem_(is_pmem),
+        fname_(fname) {}
 
-  void MayNeedRemap(size_t new_size,int is_truncate=0) {
+  IOStatus MayNeedRemap(size_t new_size) {
     if (new_size > file_size) {
       size_t count = (new_size - file_size - 1) / size_addition + 1;
       size_t add_size = count * size_addition;
-      int is_pmem;
       // remmap the file with larger file size
       pmem_unmap(map_base, file_size);
-      if(!is_truncate){
-          map_base =
+      map_base =
           (uint8_t*)pmem_map_file(fname_.c_str(), file_size + add_size,
-                                  PMEM_FILE_CREATE, 0666, &file_size, &is_pmem);
-      }else{
-          map_base =
-          (uint8_t*)pmem_map_file(fname_.c_str(), new_size,
-                                  PMEM_FILE_CREATE, 0666, &file_size, &is_pmem);
-      }
-      
+                                  PMEM_FILE_CREATE, 0666, &file_size, &is_pmem_);
       if (map_base == NULL) {
-        perror("error: pmem_remap_file");
-        exit(1);
+        return IOError("While remapping a pmem SST", fname_, errno);
       }
     }
+    return IOStatus::OK();
   }
 
  private:
-  size_t data_length;  // the writen data length
-  size_t persist_length_;
-  size_t file_size;      // the length of the whole file
-  size_t size_addition;  // expand size_addition bytes
-                         // every time left space is not enough
-  int fd_;
-  uint8_t* map_base;     // mmap()-ed area
+  size_t data_length;      // the writen data length
+  size_t persist_length_;  // the data length made durable by Sync()
+  size_t file_size;        // the length of the whole file
+  size_t size_addition;    // expand size_addition bytes
+                           // every time left space is not enough
+  uint8_t* map_base;       // mmap()-ed area
+  int is_pmem_;
   std::string fname_;
 };
 
-class PMSequentialFile : public SequentialFile {
+class PMSequentialFile : public FSSequentialFile {
  public:
-  static Status Open(const std::string& fname, SequentialFile** p_file,size_t st_size) {
+  static IOStatus Open(const std::string& fname,
+                       std::unique_ptr<FSSequentialFile>* result) {
     size_t maplen;
     int ispmem;
-    // whole file
-    void* base = pmem_map_file(fname.c_str(), st_size, PMEM_FILE_CREATE,
-                               0666, &maplen, &ispmem);
-    // no matter map ok or fail, we can close now
+    // map the whole existing file
+    void* base = pmem_map_file(fname.c_str(), 0, 0, 0, &maplen, &ispmem);
     if (base == NULL) {
-      return Status::IOError(
-          std::string("PMmmap file failed in PMSequentialFile: ").append(strerror(errno)));
+      return IOError("While pmem_map_file", fname, errno);
     }
-    // printf("openfile:%s file_size=%ld",fname.c_str(),stat.st_size>>20);
-    *p_file = new PMSequentialFile(base, st_size);
-    return Status::OK();
+    result->reset(new PMSequentialFile(base, maplen));
+    return IOStatus::OK();
   }
 
-  Status Read(size_t n, Slice* result, char* /*scratch*/) override {
+  IOStatus Read(size_t n, const IOOptions& /*options*/, Slice* result,
+                char* /*scratch*/, IODebugContext* /*dbg*/) override {
     assert(seek <= data_length);
     auto len = std::min(data_length - seek, n);
     *result = Slice((char*)data + seek, len);
     seek += len;
-    return Status::OK();
+    return IOStatus::OK();
   }
-  Status Skip(uint64_t n) override {
+
+  IOStatus Skip(uint64_t n) override {
     assert(seek <= data_length);
-    auto len = std::min(data_length - seek, n);
+    auto len = std::min<uint64_t>(data_length - seek, n);
     seek += len;
-    return Status::OK();
+    return IOStatus::OK();
   }
 
-  ~PMSequentialFile() {
-    void* base = (void*)(data - sizeof(size_t));
+  ~PMSequentialFile() override {
+    void* base = (void*)(data - kPMLogHeaderSize);
     pmem_unmap(base, file_size);
   }
 
  private:
   PMSequentialFile(void* base, size_t _file_size) : file_size(_file_size) {
-    data_length = *((size_t*)base);
-    // printf("data_size=%ldMB\n",data_length>>20);
-    data = (uint8_t*)base + sizeof(size_t);
+    data_length = std::min<size_t>(PMLogCommittedLength((const char*)base),
+                                   file_size - kPMLogHeaderSize);
+    data = (uint8_t*)base + kPMLogHeaderSize;
     seek = 0;
   }
 
@@ -302,228 +506,472 @@ class PMSequentialFile : public SequentialFile {
   size_t data_length;  // the length of data
   size_t seek;         // next offset to read
 };
-// class PMRandomAccessFile : public RandomAccessFile {
-//  public:
-//   static Status Open(const std::string& fname,
-//                      RandomAccessFile** p_file) {
-//     int fd = open(fname.c_str(), O_RDONLY);
-//     if (fd < 0) {
-//       return Status::IOError(std::string("PMopen '")
-//                                  .append(fname)
-//                                  .append("' failed: ")
-//                                  .append(strerror(errno)));
-//     }
-//     // get the file size
-//     struct stat stat;
-//     if (fstat(fd, &stat) < 0) {
-//       close(fd);
-//       return Status::IOError(std::string("PMfstat '")
-//                                  .append(fname)
-//                                  .append("' failed: ")
-//                                  .append(strerror(errno)));
-//     }
-//     close(fd);
-//     size_t maplen;
-//     int ispmem;
-//     // whole file
-//     void* base = pmem_map_file(fname.c_str(), stat.st_size, PMEM_FILE_CREATE,
-//                                0666, &maplen, &ispmem);
-//     // no matter map ok or fail, we can close now
-//     if (base == NULL) {
-//       return Status::IOError(
-//           std::string("PMmmap file failed: ").append(strerror(errno)));
-//     }
-//     // printf("openfile:%s file_size=%ld",fname.c_str(),stat.st_size>>20);
-//     *p_file = new PMRandomAccessFile(base, (size_t)stat.st_size);
-//     return Status::OK();
-//   }
-
-//   Status Read(uint64_t offset, size_t n, Slice* result,char* scratch) const override {
-//         //异常处理
-//         memcpy(scratch,data+offset,n);
-//         *result = Slice((char*)scratch, n);
-//         return Status::OK();
-//     }
-//   ~PMRandomAccessFile(){
-//     void* base = (void*)(data - sizeof(size_t));
-//     pmem_unmap(base, file_size);
-//   }
-//  private:
-//   PMRandomAccessFile(void* base, size_t _file_size) : file_size(_file_size) {
-//     data_length = *((size_t*)base);
-//     data = (uint8_t*)base + sizeof(size_t);
-//   }
-
-//   private:
-//   size_t file_size;    // the length of the whole file
-//   size_t data_length;  // the length of data
-//   uint8_t* data;       // the base address of data
-// };
-
-class PMRandomAccessFile : public RandomAccessFile {
+
+class PMRandomAccessFile : public FSRandomAccessFile {
  public:
-  static Status Open(const std::string& fname,
-                     RandomAccessFile** p_file) {
-    int fd = open(fname.c_str(), O_RDONLY);
-    if (fd < 0) {
-      return Status::IOError(std::string("PMopen '")
-                                 .append(fname)
-                                 .append("' failed in PMRandomAccessFile: ")
-                                 .append(strerror(errno)));
-    }
-    // get the file size
-    struct stat stat;
-    if (fstat(fd, &stat) < 0) {
-      close(fd);
-      return Status::IOError(std::string("PMfstat '")
-                                 .append(fname)
-                                 .append("' failed in PMRandomAccessFile: ")
-                                 .append(strerror(errno)));
-    }
-    close(fd);
+  // Sets *result to nullptr, without an error, if the mapping is not on
+  // persistent memory and allow_non_pmem is false.
+  static IOStatus Open(const std::string& fname, bool zero_copy,
+                       bool allow_non_pmem,
+                       std::unique_ptr<FSRandomAccessFile>* result) {
+    result->reset();
     size_t maplen;
     int ispmem;
-    // whole file
-    void* base = pmem_map_file(fname.c_str(), stat.st_size, PMEM_FILE_CREATE,
-                               0666, &maplen, &ispmem);
-    // no matter map ok or fail, we can close now
+    // map the whole existing file
+    void* base = pmem_map_file(fname.c_str(), 0, 0, 0, &maplen, &ispmem);
     if (base == NULL) {
-      return Status::IOError(
-          std::string("PMmmap file failed in PMRandomAccessFile: ").append(strerror(errno)));
+      return IOError("While pmem_map_file", fname, errno);
     }
-    // printf("openfile:%s file_size=%ld",fname.c_str(),stat.st_size>>20);
-    *p_file = new PMRandomAccessFile(base, (size_t)stat.st_size,fname);
-    return Status::OK();
-  }
-
-  Status Read(uint64_t offset, size_t n, Slice* result,char* scratch) const override {
-    //   printf("%s read offset=%lu,size=%lu\n",fname.c_str(),offset,n);
-        //异常处理
-        memcpy(scratch,data+offset,n);
-        *result = Slice((char*)scratch, n);
-        return Status::OK();
+    if (!ispmem && !allow_non_pmem) {
+      pmem_unmap(base, maplen);
+      return IOStatus::OK();
+    }
+    result->reset(new PMRandomAccessFile(base, maplen, fname, zero_copy));
+    return IOStatus::OK();
+  }
+
+  IOStatus Read(uint64_t offset, size_t n, const IOOptions& /*options*/,
+                Slice* result, char* scratch,
+                IODebugContext* /*dbg*/) const override {
+    if (offset > file_size) {
+      *result = Slice();
+      return IOError("While pmem read offset " + ToString(offset) +
+                         " larger than file length " + ToString(file_size),
+                     fname, EINVAL);
     }
-  ~PMRandomAccessFile(){
-    pmem_unmap(data, file_size);
+    n = std::min<size_t>(n, file_size - offset);
+    if (zero_copy_) {
+      // the mapping stays valid until this file is destroyed
+      *result = Slice((char*)data + offset, n);
+    } else {
+      memcpy(scratch, data + offset, n);
+      *result = Slice((char*)scratch, n);
+    }
+    return IOStatus::OK();
   }
+
+  bool use_mmap_reads() const override { return zero_copy_; }
+
+  ~PMRandomAccessFile() override { pmem_unmap(data, file_size); }
+
  private:
-  PMRandomAccessFile(void* base, size_t _file_size,std::string _fname) : file_size(_file_size),fname(_fname) {
+  PMRandomAccessFile(void* base, size_t _file_size, std::string _fname,
+                     bool zero_copy)
+      : file_size(_file_size), fname(_fname), zero_copy_(zero_copy) {
     data = (uint8_t*)base;
   }
 
-  private:
+ private:
   size_t file_size;    // the length of the whole file
   uint8_t* data;       // the base address of data
   std::string fname;
+  bool zero_copy_;     // return slices into the mapping instead of copying
 };
 
+std::string DirName(const std::string& fname) {
+  auto pos = fname.rfind('/');
+  return pos == std::string::npos ? "." : fname.substr(0, pos);
+}
+
 }  // Anonymous namespace
-static bool EndsWith(const std::string& str, const std::string& suffix) {
-  auto str_len = str.length();
-  auto suffix_len = suffix.length();
-  if (str_len < suffix_len) {
-    return false;
+
+// Keeps up to wal_pool_size WAL segments of one directory created, mapped
+// and pre-faulted by a background thread. Switching to a new WAL then only
+// moves a ready file, instead of allocating and faulting it in on the
+// foreground write path.
+class PMLogSegmentPool {
+ public:
+  PMLogSegmentPool(const std::string& dir, const PMEnvOptions& options)
+      : dir_(dir),
+        options_(options),
+        next_id_(0),
+        shutdown_(false),
+        disabled_(false) {
+    RemoveStaleSegments();
+    if (options_.wal_pool_size > 0) {
+      thread_ = port::Thread([this] { BackgroundThread(); });
+    }
   }
-  return memcmp(str.c_str() + str_len - suffix_len, suffix.c_str(),
-                suffix_len) == 0;
-}
 
-static bool IsWALFile(const std::string& fname) {
-  return EndsWith(fname, ".log");
+  ~PMLogSegmentPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    for (auto& segment : ready_) {
+      pmem_unmap(segment.map_base, segment.mapped_len);
+      unlink(segment.fname.c_str());
+    }
+  }
+
+  // Hands out a segment moved to fname, failing with EEXIST rather than
+  // replacing an existing file. Falls back to creating it on the caller's
+  // thread when no ready segment is available. Returns NotSupported
+  // if the directory is not on persistent memory and allow_non_pmem is false.
+  IOStatus Take(const std::string& fname, PMLogSegment* segment) {
+    bool from_pool = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (disabled_) {
+        return IOStatus::NotSupported("Not on persistent memory", dir_);
+      }
+      if (!ready_.empty()) {
+        *segment = ready_.front();
+        ready_.pop_front();
+        from_pool = true;
+      }
+    }
+    if (from_pool) {
+      // Unlike rename(), link() fails instead of replacing an existing fname
+      if (link(segment->fname.c_str(), fname.c_str()) == 0) {
+        cv_.notify_one();
+        unlink(segment->fname.c_str());
+        segment->fname = fname;
+        return IOStatus::OK();
+      }
+      if (errno == EEXIST) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          ready_.push_front(*segment);
+        }
+        return IOError("While creating a pmem WAL", fname, EEXIST);
+      }
+      cv_.notify_one();
+      pmem_unmap(segment->map_base, segment->mapped_len);
+      unlink(segment->fname.c_str());
+    }
+    IOStatus s = CreateSegment(fname, false /* prefault */, segment);
+    if (s.IsNotSupported()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      disabled_ = true;
+    }
+    return s;
+  }
+
+ private:
+  IOStatus CreateSegment(const std::string& fname, bool prefault,
+                         PMLogSegment* segment) {
+    size_t reserved_size =
+        std::max(options_.wal_reserved_size, options_.wal_init_size);
+    void* base = pmem_map_file(
+        fname.c_str(), reserved_size,
+        PMEM_FILE_CREATE | PMEM_FILE_EXCL | PMEM_FILE_SPARSE, 0666,
+        &segment->mapped_len, &segment->is_pmem);
+    if (base == NULL) {
+      return IOError("While pmem_map_file", fname, errno);
+    }
+    if (!segment->is_pmem && !options_.allow_non_pmem) {
+      pmem_unmap(base, segment->mapped_len);
+      unlink(fname.c_str());
+      return IOStatus::NotSupported("Not on persistent memory", fname);
+    }
+    if (prefault) {
+      // Touch every page of the initial part, so that block allocation and
+      // page faults happen here rather than under the first writes.
+      volatile uint8_t* p = (volatile uint8_t*)base;
+      size_t len = std::min(options_.wal_init_size, segment->mapped_len);
+      for (size_t off = 0; off < len; off += 4096) {
+        p[off] = 0;
+      }
+    }
+    segment->fname = fname;
+    segment->map_base = (uint8_t*)base;
+    return IOStatus::OK();
+  }
+
+  void BackgroundThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shutdown_ && !disabled_) {
+      if (ready_.size() >= options_.wal_pool_size) {
+        cv_.wait(lock);
+        continue;
+      }
+      std::string fname =
+          dir_ + "/" + kPMLogSegmentPrefix + ToString(next_id_++) + ".pool";
+      lock.unlock();
+      PMLogSegment segment;
+      IOStatus s = CreateSegment(fname, true /* prefault */, &segment);
+      lock.lock();
+      if (s.ok()) {
+        ready_.push_back(segment);
+      } else if (s.IsNotSupported()) {
+        disabled_ = true;
+      } else {
+        // Take() keeps creating WALs on demand; try again after the next one.
+        cv_.wait(lock);
+      }
+    }
+  }
+
+  // Segments left behind by a previous process are not worth recovering.
+  void RemoveStaleSegments() {
+    DIR* d = opendir(dir_.c_str());
+    if (d == nullptr) {
+      return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+      if (strncmp(entry->d_name, kPMLogSegmentPrefix,
+                  strlen(kPMLogSegmentPrefix)) == 0) {
+        unlink((dir_ + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(d);
+  }
+
+  const std::string dir_;
+  const PMEnvOptions options_;
+  uint64_t next_id_;
+  bool shutdown_;
+  bool disabled_;  // the directory is not on persistent memory
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<PMLogSegment> ready_;
+  port::Thread thread_;
+};
+
+PMFileSystem::PMFileSystem(const std::shared_ptr<FileSystem>& base,
+                           const PMEnvOptions& options)
+    : FileSystemWrapper(base), options_(options) {}
+
+PMFileSystem::~PMFileSystem() {}
+
+Status PMFileSystem::ParseOptions(const std::string& opts_str,
+                                  PMEnvOptions* options) {
+  std::unordered_map<std::string, std::string> opts_map;
+  Status s = StringToMap(opts_str, &opts_map);
+  if (!s.ok()) {
+    return s;
+  }
+  try {
+    for (const auto& o : opts_map) {
+      if (o.first == "wal_on_pmem") {
+        options->wal_on_pmem = ParseBoolean(o.first, o.second);
+      } else if (o.first == "sst_paths") {
+        options->sst_paths = StringSplit(o.second, ':');
+      } else if (o.first == "cache_paths") {
+        options->cache_paths = StringSplit(o.second, ':');
+      } else if (o.first == "allow_non_pmem") {
+        options->allow_non_pmem = ParseBoolean(o.first, o.second);
+      } else if (o.first == "wal_init_size") {
+        options->wal_init_size = ParseSizeT(o.second);
+      } else if (o.first == "wal_reserved_size") {
+        options->wal_reserved_size = ParseSizeT(o.second);
+      } else if (o.first == "wal_size_addition") {
+        options->wal_size_addition = ParseSizeT(o.second);
+      } else if (o.first == "wal_pool_size") {
+        options->wal_pool_size = ParseSizeT(o.second);
+      } else if (o.first == "sst_init_size") {
+        options->sst_init_size = ParseSizeT(o.second);
+      } else if (o.first == "sst_size_addition") {
+        options->sst_size_addition = ParseSizeT(o.second);
+      } else {
+        return Status::InvalidArgument("Unknown PMFileSystem option", o.first);
+      }
+    }
+  } catch (std::exception& e) {
+    return Status::InvalidArgument("Invalid PMFileSystem option", e.what());
+  }
+  if (options->wal_size_addition == 0) {
+    return Status::InvalidArgument("wal_size_addition must be positive");
+  }
+  if (options->sst_init_size == 0 || options->sst_size_addition == 0) {
+    return Status::InvalidArgument(
+        "sst_init_size and sst_size_addition must be positive");
+  }
+  return Status::OK();
 }
 
-static bool IsSSTFile(const std::string& fname) {
-  return EndsWith(fname, ".sst");
+bool PMFileSystem::IsPMWALFile(const std::string& fname) const {
+  return options_.wal_on_pmem && EndsWith(fname, ".log");
 }
 
-Status PMEnv::NewWritableFile(const std::string& fname,
-                              std::unique_ptr<WritableFile>* result,
-                              const EnvOptions& env_options) {
-  // if it is not a log file, then fall back to original logic
-  if (!IsWALFile(fname) /*&& !IsSSTFile(fname)*/) {
-    return EnvWrapper::NewWritableFile(fname, result, env_options);
+namespace {
+bool IsUnderPaths(const std::string& fname,
+                  const std::vector<std::string>& paths) {
+  std::string dir = DirName(fname);
+  for (const auto& path : paths) {
+    std::string p = path;
+    while (p.size() > 1 && p.back() == '/') {
+      p.pop_back();
+    }
+    if (dir == p || StartsWith(dir, p + "/")) {
+      return true;
+    }
   }
-  WritableFile* file = nullptr;
-  // don not use recycle log
-  Status s;
-  if(IsWALFile(fname)){
-        s = PMWritableFile::Create(fname, &file, init_size_, size_additon_);
+  return false;
+}
+}  // namespace
+
+bool PMFileSystem::IsPMSSTFile(const std::string& fname) const {
+  if (EndsWith(fname, ".sst")) {
+    return IsUnderPaths(fname, options_.sst_paths);
   }
-  else if(IsSSTFile(fname)){
-        s = PMWritableFileSST::Create(fname, &file, init_size_, size_additon_);
+  if (EndsWith(fname, ".cache")) {
+    return IsUnderPaths(fname, options_.cache_paths);
   }
-  
-  if (s.ok()) {
-    result->reset(file);
+  return false;
+}
+
+PMLogSegmentPool* PMFileSystem::GetLogSegmentPool(const std::string& fname) {
+  std::string dir = DirName(fname);
+  std::lock_guard<std::mutex> lock(pools_mutex_);
+  auto& pool = pools_[dir];
+  if (!pool) {
+    pool.reset(new PMLogSegmentPool(dir, options_));
   }
-  return s;
+  return pool.get();
 }
 
-Status PMEnv::NewSequentialFile(const std::string& fname,
-                                std::unique_ptr<SequentialFile>* result,
-                                const EnvOptions& env_options) {
-  if (!IsWALFile(fname)) {
-    return EnvWrapper::NewSequentialFile(fname, result, env_options);
-  }
-    int fd = open(fname.c_str(), O_RDONLY);
-    if (fd < 0) {
-      return Status::IOError(std::string("PMopen '")
-                                 .append(fname)
-                                 .append("' failed in PMSequentialFile: ")
-                                 .append(strerror(errno)));
-    }
-    // get the file size
-    struct stat stat;
-    if (fstat(fd, &stat) < 0) {
-      close(fd);
-      return Status::IOError(std::string("PMfstat '")
-                                 .append(fname)
-                                 .append("' failed in PMSequentialFile: ")
-                                 .append(strerror(errno)));
-    }
-    close(fd);
-    if(stat.st_size==0)return EnvWrapper::NewSequentialFile(fname, result, env_options);
-
-  SequentialFile* file = nullptr;
-  Status s = PMSequentialFile::Open(fname, &file,stat.st_size);
+IOStatus PMFileSystem::NewWritableFile(const std::string& fname,
+                                       const FileOptions& file_opts,
+                                       std::unique_ptr<FSWritableFile>* result,
+                                       IODebugContext* dbg) {
+  if (file_opts.use_direct_writes) {
+    return FileSystemWrapper::NewWritableFile(fname, file_opts, result, dbg);
+  }
+  if (IsPMSSTFile(fname)) {
+    IOStatus s = PMWritableFileSST::Create(
+        fname, options_.sst_init_size, options_.sst_size_addition,
+        options_.allow_non_pmem, result);
+    if (s.ok() && *result == nullptr) {
+      return FileSystemWrapper::NewWritableFile(fname, file_opts, result, dbg);
+    }
+    return s;
+  }
+  if (!IsPMWALFile(fname)) {
+    return FileSystemWrapper::NewWritableFile(fname, file_opts, result, dbg);
+  }
+  PMLogSegment segment;
+  IOStatus s = GetLogSegmentPool(fname)->Take(fname, &segment);
+  if (s.IsNotSupported()) {
+    return FileSystemWrapper::NewWritableFile(fname, file_opts, result, dbg);
+  }
   if (s.ok()) {
-    result->reset(file);
+    result->reset(
+        new PMWritableFile(segment, 1 /* epoch */, options_.wal_size_addition));
   }
   return s;
 }
 
-Status PMEnv::NewRandomAccessFile(const std::string& fname,
-                                  std::unique_ptr<RandomAccessFile>* result,
-                                  const EnvOptions& env_options) {
-  if (!IsSSTFile(fname)) {
-    return EnvWrapper::NewRandomAccessFile(fname, result, env_options);
+IOStatus PMFileSystem::ReuseWritableFile(
+    const std::string& fname, const std::string& old_fname,
+    const FileOptions& file_opts, std::unique_ptr<FSWritableFile>* result,
+    IODebugContext* dbg) {
+  char header[kPMLogHeaderSize];
+  if (!IsPMWALFile(fname) || !ReadPMLogHeader(old_fname, header)) {
+    return FileSystemWrapper::ReuseWritableFile(fname, old_fname, file_opts,
+                                                result, dbg);
+  }
+  IOStatus s = RenameFile(old_fname, fname, file_opts.io_options, dbg);
+  if (!s.ok()) {
+    return s;
+  }
+  PMLogSegment segment;
+  segment.fname = fname;
+  // map the whole existing file
+  void* base = pmem_map_file(fname.c_str(), 0, 0, 0, &segment.mapped_len,
+                             &segment.is_pmem);
+  if (base == NULL) {
+    return IOError("While pmem_map_file", fname, errno);
+  }
+  segment.map_base = (uint8_t*)base;
+  uint32_t epoch = DecodePMLogEpoch(header) + 1;
+  if (epoch == 0) {
+    epoch = 1;
+  }
+  result->reset(new PMWritableFile(segment, epoch, options_.wal_size_addition));
+  return IOStatus::OK();
+}
+
+IOStatus PMFileSystem::NewSequentialFile(
+    const std::string& fname, const FileOptions& file_opts,
+    std::unique_ptr<FSSequentialFile>* result, IODebugContext* dbg) {
+  // WALs are recognised by their header, so those written by the base
+  // FileSystem, e.g. before pmem was enabled, remain readable.
+  char header[kPMLogHeaderSize];
+  if (!EndsWith(fname, ".log") || !ReadPMLogHeader(fname, header)) {
+    return FileSystemWrapper::NewSequentialFile(fname, file_opts, result, dbg);
   }
-  RandomAccessFile* file = nullptr;
-  Status s = PMRandomAccessFile::Open(fname, &file);
-  if (s.ok()) {
-    result->reset(file);
+  return PMSequentialFile::Open(fname, result);
+}
+
+IOStatus PMFileSystem::NewRandomAccessFile(
+    const std::string& fname, const FileOptions& file_opts,
+    std::unique_ptr<FSRandomAccessFile>* result, IODebugContext* dbg) {
+  if (!IsPMSSTFile(fname) || file_opts.use_direct_reads) {
+    return FileSystemWrapper::NewRandomAccessFile(fname, file_opts, result,
+                                                  dbg);
+  }
+  // With allow_mmap_reads the table reader consumes blocks straight from the
+  // pmem mapping, like it does for PosixMmapReadableFile.
+  IOStatus s = PMRandomAccessFile::Open(fname, file_opts.use_mmap_reads,
+                                        options_.allow_non_pmem, result);
+  if (s.ok() && *result == nullptr) {
+    return FileSystemWrapper::NewRandomAccessFile(fname, file_opts, result,
+                                                  dbg);
   }
   return s;
 }
 
-Status PMEnv::GetFileSize(const std::string& f, uint64_t* s){
-  if (!IsWALFile(f)) {
-    return EnvWrapper::GetFileSize(f,s);
-  }
-  EnvWrapper::GetFileSize(f,s);
-  if(*s==0)return Status::OK();
-  int fd=open(f.c_str(),O_RDONLY);
-  if(fd < 0){
-      return Status::IOError(std::string("While open a pmem file for getsize").append(f).append(strerror(errno)));
+IOStatus PMFileSystem::GetFileSize(const std::string& fname,
+                                   const IOOptions& options, uint64_t* size,
+                                   IODebugContext* dbg) {
+  IOStatus s = FileSystemWrapper::GetFileSize(fname, options, size, dbg);
+  char header[kPMLogHeaderSize];
+  if (s.ok() && *size != 0 && EndsWith(fname, ".log") &&
+      ReadPMLogHeader(fname, header)) {
+    *size = PMLogCommittedLength(header);
   }
-  if(pread(fd,s,sizeof(size_t),0)<=0){
-      return Status::IOError(std::string("While open a pmem file for read data_size").append(f).append(strerror(errno)));
+  return s;
+}
+
+std::shared_ptr<FileSystem> NewPMFileSystem(
+    const std::shared_ptr<FileSystem>& base, const PMEnvOptions& options) {
+  return std::make_shared<PMFileSystem>(base, options);
+}
+
+Status IsFileOnPmem(const std::string& fname, bool* is_pmem) {
+  size_t mapped_len = 0;
+  int pmem = 0;
+  void* base = pmem_map_file(fname.c_str(), 0, 0, 0, &mapped_len, &pmem);
+  if (base == NULL) {
+    return IOError("While pmem_map_file", fname, errno);
   }
-  close(fd);
+  pmem_unmap(base, mapped_len);
+  *is_pmem = pmem != 0;
   return Status::OK();
 }
-Env* NewPMEnv(Env* base_env) {
-  return new PMEnv(base_env ? base_env : rocksdb::Env::Default());
+
+Env* NewPMEnv(Env* base_env) { return NewPMEnv(base_env, PMEnvOptions()); }
+
+Env* NewPMEnv(Env* base_env, const PMEnvOptions& options) {
+  Env* env = base_env ? base_env : rocksdb::Env::Default();
+  return new CompositeEnvWrapper(
+      env, NewPMFileSystem(env->GetFileSystem(), options));
+}
+
+#ifndef ROCKSDB_LITE
+void RegisterPMFileSystem(ObjectLibrary& library) {
+  library.Register<FileSystem>(
+      "pmem://.*",
+      [](const std::string& uri, std::unique_ptr<FileSystem>* f,
+         std::string* errmsg) -> FileSystem* {
+        PMEnvOptions options;
+        Status s =
+            PMFileSystem::ParseOptions(uri.substr(strlen("pmem://")), &options);
+        if (!s.ok()) {
+          *errmsg = s.ToString();
+          return nullptr;
+        }
+        f->reset(new PMFileSystem(FileSystem::Default(), options));
+        return f->get();
+      });
 }
+#endif  // ROCKSDB_LITE
 
 }  // namespace rocksdb
@@ -1,36 +1,136 @@
 #pragma once
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
 #include "rocksdb/env.h"
+#include "rocksdb/file_system.h"
 #include "rocksdb/status.h"
 
 namespace rocksdb {
 
-class PMEnv : public EnvWrapper {
+class PMLogSegmentPool;
+
+struct PMEnvOptions {
+  // Keep WAL files on pmem.
+  bool wal_on_pmem = true;
+
+  // SST files created under one of these directories are written and read
+  // through a pmem mapping. List the first of the cf_paths/db_paths here and
+  // set ColumnFamilyOptions::first_path_max_level to keep the upper levels
+  // on pmem.
+  std::vector<std::string> sst_paths;
+
+  // Secondary cache files (see NewFileSecondaryCache()) created under one of
+  // these directories are written and read through a pmem mapping like SST
+  // files.
+  std::vector<std::string> cache_paths;
+
+  // By default a file whose mapping is not on real persistent memory is
+  // handled by the base FileSystem instead. Set this to use the pmem code
+  // paths anyway, e.g. with a tmpfs file standing in for the device.
+  bool allow_non_pmem = false;
+
+  // Bytes of every WAL segment that are allocated and pre-faulted up front.
+  size_t wal_init_size = 128 << 20;
+
+  // Size of the sparse mapping reserved for every WAL segment. A WAL can grow
+  // up to this size without being remapped.
+  size_t wal_reserved_size = 512 << 20;
+
+  // Once a WAL outgrows its reserved mapping, it is remapped in steps of
+  // this many bytes.
+  size_t wal_size_addition = 32 << 20;
+
+  // Number of WAL segments kept created and pre-faulted by a background
+  // thread, per WAL directory. 0 creates every WAL on demand.
+  size_t wal_pool_size = 2;
+
+  // Bytes allocated up front for every SST file written on pmem. Files are
+  // trimmed to their data length when closed.
+  size_t sst_init_size = 64 << 20;
+
+  // Once an SST file outgrows its mapping, it is remapped in steps of this
+  // many bytes.
+  size_t sst_size_addition = 16 << 20;
+};
+
+// A FileSystem that keeps WAL files, and SST files under the configured
+// paths, in pmem mappings managed with libpmem. All other files, and files
+// opened for direct I/O, are handled by the base FileSystem.
+//
+// Registered in the ObjectRegistry as "pmem://", optionally followed by
+// options, e.g.
+//   pmem://sst_paths=/mnt/pmem0/db;allow_non_pmem=true;wal_pool_size=4
+// where sst_paths and cache_paths are ':'-separated lists.
+class PMFileSystem : public FileSystemWrapper {
  public:
-  PMEnv(Env* base_env) : EnvWrapper(base_env) {}
+  PMFileSystem(const std::shared_ptr<FileSystem>& base,
+               const PMEnvOptions& options);
+  ~PMFileSystem() override;
 
- private:
-  // we should use DCPMM-awared filesystem for WAL file
-  Status NewWritableFile(const std::string& fname,
-                         std::unique_ptr<WritableFile>* result,
-                         const EnvOptions& env_options) override;
-  //   Status DeleteFile(const std::string& fname)override;
+  static const char* kClassName() { return "PMFileSystem"; }
+  const char* Name() const override { return kClassName(); }
+
+  // Parses the options part of a "pmem://" URI.
+  static Status ParseOptions(const std::string& opts_str,
+                             PMEnvOptions* options);
+
+  IOStatus NewWritableFile(const std::string& fname,
+                           const FileOptions& file_opts,
+                           std::unique_ptr<FSWritableFile>* result,
+                           IODebugContext* dbg) override;
+  // A recycled WAL keeps its mapping layout and gets a new epoch, so the
+  // commit slots of its previous incarnation are ignored by readers.
+  IOStatus ReuseWritableFile(const std::string& fname,
+                             const std::string& old_fname,
+                             const FileOptions& file_opts,
+                             std::unique_ptr<FSWritableFile>* result,
+                             IODebugContext* dbg) override;
   // The WAL file may have extra format, so should be handled before reading
-  Status NewSequentialFile(const std::string& fname,
-                           std::unique_ptr<SequentialFile>* result,
-                           const EnvOptions& options) override;
-  Status NewRandomAccessFile(const std::string& f,
-                             std::unique_ptr<RandomAccessFile>* r,
-                             const EnvOptions& options) override;
+  IOStatus NewSequentialFile(const std::string& fname,
+                             const FileOptions& file_opts,
+                             std::unique_ptr<FSSequentialFile>* result,
+                             IODebugContext* dbg) override;
+  IOStatus NewRandomAccessFile(const std::string& fname,
+                               const FileOptions& file_opts,
+                               std::unique_ptr<FSRandomAccessFile>* result,
+                               IODebugContext* dbg) override;
+  IOStatus GetFileSize(const std::string& fname, const IOOptions& options,
+                       uint64_t* size, IODebugContext* dbg) override;
 
-  Status GetFileSize(const std::string& f, uint64_t* s) override;
+ private:
+  bool IsPMWALFile(const std::string& fname) const;
+  // SST files under sst_paths and secondary cache files under cache_paths
+  bool IsPMSSTFile(const std::string& fname) const;
+  PMLogSegmentPool* GetLogSegmentPool(const std::string& fname);
 
-      private : size_t init_size_ = 128 << 20;
-  size_t size_additon_ = 32 << 20;
+  const PMEnvOptions options_;
+  std::mutex pools_mutex_;
+  // WAL segment pools keyed by directory
+  std::map<std::string, std::unique_ptr<PMLogSegmentPool>> pools_;
 };
 
-}  // namespace rocksdb
\ No newline at end of file
+std::shared_ptr<FileSystem> NewPMFileSystem(
+    const std::shared_ptr<FileSystem>& base, const PMEnvOptions& options);
+
+Env* NewPMEnv(Env* base_env, const PMEnvOptions& options);
+
+// Sets *is_pmem to whether a mapping of the existing, non-empty file fname is
+// on real persistent memory, i.e. whether PMFileSystem would persist it with
+// CPU cache flushes rather than msync.
+Status IsFileOnPmem(const std::string& fname, bool* is_pmem);
+
+#ifndef ROCKSDB_LITE
+class ObjectLibrary;
+
+// Registers the factory of the "pmem://<options>" FileSystem URIs, e.g.
+// "pmem://allow_non_pmem=true;wal_pool_size=2", into library. Called by
+// ObjectLibrary::Default() when the library is built with pmem support.
+void RegisterPMFileSystem(ObjectLibrary& library);
+#endif  // ROCKSDB_LITE
+
+}  // namespace rocksdb
@@ -0,0 +1,307 @@
+// Tests for PMFileSystem. They use a tmpfs directory, or the regular test
+// directory, as the stand-in for a pmem device, which is why most of them
+// set allow_non_pmem.
+
+#include "pmenv/env_pm.h"
+
+#include <algorithm>
+
+#include "file/file_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/db.h"
+#include "rocksdb/utilities/object_registry.h"
+#include "test_util/testharness.h"
+#include "util/random.h"
+#include "util/string_util.h"
+
+namespace rocksdb {
+
+class PMFileSystemTest : public testing::Test {
+ public:
+  PMFileSystemTest() : base_env_(Env::Default()) {
+    std::string shm = "/dev/shm";
+    if (base_env_->FileExists(shm).ok()) {
+      test_dir_ = test::PerThreadDBPath(shm, "pm_fs_test");
+    } else {
+      test_dir_ = test::PerThreadDBPath(base_env_, "pm_fs_test");
+    }
+    EXPECT_OK(DestroyDir(base_env_, test_dir_));
+    EXPECT_OK(base_env_->CreateDirIfMissing(test_dir_));
+    options_.allow_non_pmem = true;
+    options_.wal_init_size = 1 << 20;
+    options_.wal_reserved_size = 4 << 20;
+    options_.wal_size_addition = 1 << 20;
+    options_.sst_init_size = 1 << 20;
+    options_.sst_size_addition = 1 << 20;
+  }
+
+  ~PMFileSystemTest() override {
+    // stop the segment pools before removing their files
+    fs_.reset();
+    EXPECT_OK(DestroyDir(base_env_, test_dir_));
+  }
+
+  void Reset() {
+    fs_ = NewPMFileSystem(base_env_->GetFileSystem(), options_);
+  }
+
+  void WriteFile(const std::string& fname, const std::string& data) {
+    std::unique_ptr<FSWritableFile> file;
+    ASSERT_OK(fs_->NewWritableFile(fname, FileOptions(), &file, nullptr));
+    ASSERT_OK(file->Append(data, IOOptions(), nullptr));
+    ASSERT_OK(file->Sync(IOOptions(), nullptr));
+    ASSERT_OK(file->Close(IOOptions(), nullptr));
+  }
+
+  std::string ReadFile(const std::string& fname) {
+    std::unique_ptr<FSSequentialFile> file;
+    EXPECT_OK(fs_->NewSequentialFile(fname, FileOptions(), &file, nullptr));
+    std::string result;
+    std::string scratch(4096, '\0');
+    while (true) {
+      Slice chunk;
+      EXPECT_OK(file->Read(scratch.size(), IOOptions(), &chunk, &scratch[0],
+                           nullptr));
+      if (chunk.empty()) {
+        break;
+      }
+      result.append(chunk.data(), chunk.size());
+    }
+    return result;
+  }
+
+  Env* base_env_;
+  std::string test_dir_;
+  PMEnvOptions options_;
+  std::shared_ptr<FileSystem> fs_;
+};
+
+TEST_F(PMFileSystemTest, WALRoundTrip) {
+  for (size_t pool_size : {0, 2}) {
+    options_.wal_pool_size = pool_size;
+    Reset();
+    Random rnd(301);
+    // large enough to outgrow the reserved mapping
+    std::string data = rnd.RandomString(5 << 20);
+    std::string fname = test_dir_ + "/" + ToString(10 + pool_size) + ".log";
+    WriteFile(fname, data);
+
+    uint64_t size = 0;
+    ASSERT_OK(fs_->GetFileSize(fname, IOOptions(), &size, nullptr));
+    ASSERT_EQ(data.size(), size);
+    ASSERT_EQ(data, ReadFile(fname));
+    ASSERT_OK(fs_->DeleteFile(fname, IOOptions(), nullptr));
+  }
+}
+
+TEST_F(PMFileSystemTest, ExistingWALIsNotReplaced) {
+  for (size_t pool_size : {0, 2}) {
+    options_.wal_pool_size = pool_size;
+    Reset();
+    std::string fname = test_dir_ + "/" + ToString(20 + pool_size) + ".log";
+    ASSERT_OK(WriteStringToFile(base_env_, "existing", fname));
+    // Let the pool create its segments
+    WriteFile(test_dir_ + "/" + ToString(30 + pool_size) + ".log", "a");
+    for (int i = 0; i < 100 && pool_size > 0; i++) {
+      std::vector<std::string> children;
+      ASSERT_OK(base_env_->GetChildren(test_dir_, &children));
+      if (std::count_if(children.begin(), children.end(),
+                        [](const std::string& child) {
+                          return child.find("PMWAL-SEGMENT-") == 0;
+                        }) >= 2) {
+        break;
+      }
+      base_env_->SleepForMicroseconds(10000);
+    }
+
+    std::unique_ptr<FSWritableFile> file;
+    ASSERT_NOK(fs_->NewWritableFile(fname, FileOptions(), &file, nullptr));
+    std::string data;
+    ASSERT_OK(ReadFileToString(base_env_, fname, &data));
+    ASSERT_EQ("existing", data);
+
+    // The segment is still available to the next WAL
+    WriteFile(test_dir_ + "/" + ToString(40 + pool_size) + ".log", "b");
+  }
+}
+
+TEST_F(PMFileSystemTest, OnlyFlushedGroupsAreVisible) {
+  Reset();
+  std::string fname = test_dir_ + "/000001.log";
+  std::unique_ptr<FSWritableFile> file;
+  ASSERT_OK(fs_->NewWritableFile(fname, FileOptions(), &file, nullptr));
+  ASSERT_OK(file->Append("group1", IOOptions(), nullptr));
+  ASSERT_OK(file->Flush(IOOptions(), nullptr));
+  ASSERT_OK(file->Append("group2", IOOptions(), nullptr));
+
+  uint64_t size = 0;
+  ASSERT_OK(fs_->GetFileSize(fname, IOOptions(), &size, nullptr));
+  ASSERT_EQ(6U, size);
+  ASSERT_EQ("group1", ReadFile(fname));
+
+  ASSERT_OK(file->Close(IOOptions(), nullptr));
+  ASSERT_EQ("group1group2", ReadFile(fname));
+}
+
+TEST_F(PMFileSystemTest, RecycledWALIgnoresPreviousEpoch) {
+  Reset();
+  std::string old_fname = test_dir_ + "/000001.log";
+  std::string fname = test_dir_ + "/000002.log";
+  WriteFile(old_fname, std::string(1000, 'a'));
+
+  std::unique_ptr<FSWritableFile> file;
+  ASSERT_OK(fs_->ReuseWritableFile(fname, old_fname, FileOptions(), &file,
+                                   nullptr));
+  ASSERT_TRUE(fs_->FileExists(old_fname, IOOptions(), nullptr).IsNotFound());
+  uint64_t size = 0;
+  ASSERT_OK(fs_->GetFileSize(fname, IOOptions(), &size, nullptr));
+  ASSERT_EQ(0U, size);
+
+  ASSERT_OK(file->Append("bb", IOOptions(), nullptr));
+  ASSERT_OK(file->Close(IOOptions(), nullptr));
+  ASSERT_EQ("bb", ReadFile(fname));
+}
+
+TEST_F(PMFileSystemTest, FallBackWithoutPmem) {
+  options_.allow_non_pmem = false;
+  options_.sst_paths = {test_dir_};
+  Reset();
+  // tmpfs and disk files are not persistent memory, so both files are
+  // handled by the base FileSystem and keep their plain format.
+  std::string wal = test_dir_ + "/000001.log";
+  std::string sst = test_dir_ + "/000002.sst";
+  WriteFile(wal, "wal data");
+  WriteFile(sst, "sst data");
+
+  uint64_t size = 0;
+  ASSERT_OK(base_env_->GetFileSize(wal, &size));
+  ASSERT_EQ(8U, size);
+  ASSERT_EQ("wal data", ReadFile(wal));
+
+  std::unique_ptr<FSRandomAccessFile> file;
+  FileOptions file_opts;
+  file_opts.use_mmap_reads = true;
+  ASSERT_OK(fs_->NewRandomAccessFile(sst, file_opts, &file, nullptr));
+  char scratch[8];
+  Slice result;
+  ASSERT_OK(file->Read(0, 8, IOOptions(), &result, scratch, nullptr));
+  ASSERT_EQ("sst data", result.ToString());
+}
+
+TEST_F(PMFileSystemTest, ZeroCopySSTReads) {
+  options_.sst_paths = {test_dir_ + "/"};
+  Reset();
+  std::string sst = test_dir_ + "/000001.sst";
+  WriteFile(sst, "0123456789");
+
+  for (bool mmap_reads : {false, true}) {
+    FileOptions file_opts;
+    file_opts.use_mmap_reads = mmap_reads;
+    std::unique_ptr<FSRandomAccessFile> file;
+    ASSERT_OK(fs_->NewRandomAccessFile(sst, file_opts, &file, nullptr));
+    ASSERT_EQ(mmap_reads, file->use_mmap_reads());
+    char scratch[16];
+    Slice result;
+    ASSERT_OK(file->Read(2, 16, IOOptions(), &result, scratch, nullptr));
+    ASSERT_EQ("23456789", result.ToString());
+    ASSERT_EQ(!mmap_reads, result.data() == scratch);
+    ASSERT_NOK(file->Read(11, 1, IOOptions(), &result, scratch, nullptr));
+  }
+}
+
+TEST_F(PMFileSystemTest, SSTWrittenOnPmem) {
+  options_.sst_paths = {test_dir_};
+  Reset();
+  std::string sst = test_dir_ + "/000001.sst";
+  Random rnd(301);
+  // outgrows the initial mapping
+  std::string data = rnd.RandomString((3 << 20) / 2);
+  std::unique_ptr<FSWritableFile> file;
+  ASSERT_OK(fs_->NewWritableFile(sst, FileOptions(), &file, nullptr));
+  ASSERT_OK(file->Append(data, IOOptions(), nullptr));
+  ASSERT_OK(file->Truncate(data.size() - 10, IOOptions(), nullptr));
+  ASSERT_OK(file->Append("tail", IOOptions(), nullptr));
+  ASSERT_EQ(data.size() - 6, file->GetFileSize(IOOptions(), nullptr));
+  ASSERT_OK(file->Sync(IOOptions(), nullptr));
+  ASSERT_OK(file->Close(IOOptions(), nullptr));
+  file.reset();
+
+  // the preallocated space is released on close
+  uint64_t size = 0;
+  ASSERT_OK(base_env_->GetFileSize(sst, &size));
+  ASSERT_EQ(data.size() - 6, size);
+  ASSERT_EQ(data.substr(0, data.size() - 10) + "tail", ReadFile(sst));
+
+  // a file that is not closed explicitly is trimmed when destroyed
+  std::string sst2 = test_dir_ + "/000002.sst";
+  ASSERT_OK(fs_->NewWritableFile(sst2, FileOptions(), &file, nullptr));
+  ASSERT_OK(file->Append("abc", IOOptions(), nullptr));
+  file.reset();
+  ASSERT_OK(base_env_->GetFileSize(sst2, &size));
+  ASSERT_EQ(3U, size);
+}
+
+#ifndef ROCKSDB_LITE
+TEST_F(PMFileSystemTest, LoadFromRegistry) {
+  std::shared_ptr<FileSystem> fs;
+  ASSERT_OK(FileSystem::Load(
+      "pmem://sst_paths=/a:/b;allow_non_pmem=true;wal_pool_size=4", &fs));
+  ASSERT_STREQ(PMFileSystem::kClassName(), fs->Name());
+  ASSERT_NOK(FileSystem::Load("pmem://wal_pool_size=many", &fs));
+  ASSERT_NOK(FileSystem::Load("pmem://no_such_option=1", &fs));
+
+  PMEnvOptions options;
+  ASSERT_OK(PMFileSystem::ParseOptions(
+      "sst_paths=/a:/b;cache_paths=/c;wal_on_pmem=false;wal_init_size=4096",
+      &options));
+  ASSERT_EQ(2U, options.sst_paths.size());
+  ASSERT_EQ("/b", options.sst_paths[1]);
+  ASSERT_EQ(1U, options.cache_paths.size());
+  ASSERT_EQ("/c", options.cache_paths[0]);
+  ASSERT_FALSE(options.wal_on_pmem);
+  ASSERT_EQ(4096U, options.wal_init_size);
+}
+#endif  // ROCKSDB_LITE
+
+TEST_F(PMFileSystemTest, DBRecoversFromPMWAL) {
+  options_.sst_paths = {test_dir_};
+  std::unique_ptr<Env> env(NewPMEnv(base_env_, options_));
+  Options options;
+  options.env = env.get();
+  options.create_if_missing = true;
+  options.allow_mmap_reads = true;
+  std::string dbname = test_dir_ + "/db";
+
+  for (int recycle : {0, 2}) {
+    options.recycle_log_file_num = recycle;
+    ASSERT_OK(DestroyDB(dbname, options));
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options, dbname, &db));
+    WriteOptions wo;
+    wo.sync = true;
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(db->Put(wo, "key" + ToString(i), "value" + ToString(i)));
+      if (i == 50) {
+        ASSERT_OK(db->Flush(FlushOptions()));
+      }
+    }
+    delete db;
+
+    ASSERT_OK(DB::Open(options, dbname, &db));
+    for (int i = 0; i < 100; i++) {
+      std::string value;
+      ASSERT_OK(db->Get(ReadOptions(), "key" + ToString(i), &value));
+      ASSERT_EQ("value" + ToString(i), value);
+    }
+    delete db;
+  }
+  ASSERT_OK(DestroyDB(dbname, options));
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
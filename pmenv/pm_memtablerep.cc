@@ -0,0 +1,671 @@
+#include "pmenv/pm_memtablerep.h"
+
+#include <libpmem.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "db/memtable.h"
+#include "logging/logging.h"
+#include "memory/arena.h"
+#include "memtable/skiplist.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "test_util/sync_point.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+namespace rocksdb {
+
+namespace {
+
+// A memtable segment file starts with a kPMMemSegmentHeaderSize byte header
+// holding the magic number, the id of the column family whose memtable owns
+// the segment, a flag that is set once that memtable has been flushed, and
+// the number of the table file its flush wrote, once written. Entries follow,
+// each stored as a record
+//
+//   [length: fixed32][masked crc32c of entry: fixed32][entry][padding]
+//
+// padded to kPMMemRecordAlign. Records are sealed when their entry is
+// inserted, and persisted together when the write batch is committed. The
+// unused tail of a segment is zeroed, so a scan stops at the first zero
+// length or checksum mismatch, i.e. right after the last entry that was
+// fully persisted.
+//
+// The MEMTABLE-COMMIT file of the directory holds the largest sequence number
+// of the committed batches, which is persisted after the records of the
+// batch. Entries of larger sequence numbers were not committed and are
+// dropped on recovery.
+constexpr uint64_t kPMMemMagic = 0x706d656d6d656d31;  // "pmemmem1"
+constexpr size_t kPMMemSegmentHeaderSize = 64;
+constexpr size_t kPMMemMagicOffset = 0;
+constexpr size_t kPMMemColumnFamilyOffset = 8;
+constexpr size_t kPMMemFlushedOffset = 12;
+constexpr size_t kPMMemFlushFileOffset = 16;
+constexpr size_t kPMMemRecordHeaderSize = 8;
+constexpr size_t kPMMemRecordAlign = 8;
+constexpr size_t kPMMemCommitFileSize = 64;
+constexpr size_t kPMMemCommitSeqOffset = 8;
+const char* const kPMMemSegmentPrefix = "MEMTABLE-";
+const char* const kPMMemSegmentSuffix = ".pmt";
+const char* const kPMMemCommitFileName = "MEMTABLE-COMMIT";
+
+size_t AlignRecord(size_t n) {
+  return (n + kPMMemRecordAlign - 1) & ~(kPMMemRecordAlign - 1);
+}
+
+void PersistRange(const void* addr, size_t len, int is_pmem) {
+  if (is_pmem) {
+    pmem_persist(addr, len);
+  } else {
+    pmem_msync(addr, len);
+  }
+}
+
+// Returns the sequence number of a memtable entry of len bytes, or
+// kMaxSequenceNumber if it is malformed.
+SequenceNumber EntrySequence(const char* entry, uint32_t len) {
+  uint32_t key_length = 0;
+  const char* key_ptr = GetVarint32Ptr(entry, entry + len, &key_length);
+  if (key_ptr == nullptr || key_length < 8 ||
+      key_length > static_cast<size_t>(entry + len - key_ptr)) {
+    return kMaxSequenceNumber;
+  }
+  return DecodeFixed64(key_ptr + key_length - 8) >> 8;
+}
+
+class PMMemSegment {
+ public:
+  PMMemSegment(const std::string& fname, char* base, size_t size, int is_pmem)
+      : fname_(fname),
+        base_(base),
+        size_(size),
+        is_pmem_(is_pmem),
+        used_(kPMMemSegmentHeaderSize),
+        persisted_(kPMMemSegmentHeaderSize) {}
+
+  ~PMMemSegment() { pmem_unmap(base_, size_); }
+
+  // Creates and maps a new segment of size bytes for column_family.
+  static Status Create(const std::string& fname, size_t size,
+                       uint32_t column_family, bool allow_non_pmem,
+                       std::unique_ptr<PMMemSegment>* result) {
+    size_t mapped_len = 0;
+    int is_pmem = 0;
+    char* base = static_cast<char*>(
+        pmem_map_file(fname.c_str(), size, PMEM_FILE_CREATE | PMEM_FILE_EXCL,
+                      0666, &mapped_len, &is_pmem));
+    if (base == nullptr) {
+      return Status::IOError("While mapping a pmem memtable segment", fname);
+    }
+    if (!is_pmem && !allow_non_pmem) {
+      pmem_unmap(base, mapped_len);
+      unlink(fname.c_str());
+      return Status::NotSupported("Not on persistent memory", fname);
+    }
+    result->reset(new PMMemSegment(fname, base, mapped_len, is_pmem));
+    EncodeFixed64(base + kPMMemMagicOffset, kPMMemMagic);
+    EncodeFixed32(base + kPMMemColumnFamilyOffset, column_family);
+    PersistRange(base, kPMMemSegmentHeaderSize, is_pmem);
+    return Status::OK();
+  }
+
+  // Maps an existing segment. Sets *flushed if its memtable was flushed, and
+  // *flush_file_number to the table file its flush wrote, or 0.
+  static Status Open(const std::string& fname, uint32_t column_family,
+                     std::unique_ptr<PMMemSegment>* result, bool* flushed,
+                     uint64_t* flush_file_number) {
+    size_t mapped_len = 0;
+    int is_pmem = 0;
+    char* base = static_cast<char*>(
+        pmem_map_file(fname.c_str(), 0, 0, 0, &mapped_len, &is_pmem));
+    if (base == nullptr) {
+      return Status::IOError("While mapping a pmem memtable segment", fname);
+    }
+    result->reset(new PMMemSegment(fname, base, mapped_len, is_pmem));
+    if (mapped_len < kPMMemSegmentHeaderSize ||
+        DecodeFixed64(base + kPMMemMagicOffset) != kPMMemMagic ||
+        DecodeFixed32(base + kPMMemColumnFamilyOffset) != column_family) {
+      result->reset();
+      return Status::Corruption("Bad pmem memtable segment header", fname);
+    }
+    *flushed = base[kPMMemFlushedOffset] != 0;
+    *flush_file_number = DecodeFixed64(base + kPMMemFlushFileOffset);
+    return Status::OK();
+  }
+
+  const std::string& fname() const { return fname_; }
+  size_t used() const { return used_; }
+
+  bool Contains(const char* p) const { return p >= base_ && p < base_ + size_; }
+
+  // Reserves a record for an entry of len bytes. Returns nullptr if the
+  // segment is full.
+  char* Allocate(size_t len) {
+    size_t record_size = AlignRecord(kPMMemRecordHeaderSize + len);
+    if (len > UINT32_MAX || used_ + record_size > size_) {
+      return nullptr;
+    }
+    char* record = base_ + used_;
+    used_ += record_size;
+    EncodeFixed32(record, static_cast<uint32_t>(len));
+    return record + kPMMemRecordHeaderSize;
+  }
+
+  // Seals the record of an entry returned by Allocate(). It is persisted by
+  // the next PersistSealed().
+  void Seal(const char* entry) {
+    char* record = const_cast<char*>(entry) - kPMMemRecordHeaderSize;
+    uint32_t len = DecodeFixed32(record);
+    EncodeFixed32(record + 4, crc32c::Mask(crc32c::Value(entry, len)));
+  }
+
+  // Persists the records allocated since the last call, which must all be
+  // sealed. Returns false if there were none.
+  bool PersistSealed() {
+    if (persisted_ == used_) {
+      return false;
+    }
+    PersistRange(base_ + persisted_, used_ - persisted_, is_pmem_);
+    persisted_ = used_;
+    return true;
+  }
+
+  // Calls f(entry, len) on every complete entry of the segment, in insertion
+  // order. If f returns false, the segment is truncated before the entry.
+  template <typename F>
+  void Scan(F f) {
+    size_t offset = kPMMemSegmentHeaderSize;
+    while (offset + kPMMemRecordHeaderSize <= size_) {
+      char* record = base_ + offset;
+      uint32_t len = DecodeFixed32(record);
+      if (len == 0 || len > size_ - offset - kPMMemRecordHeaderSize) {
+        break;
+      }
+      const char* entry = record + kPMMemRecordHeaderSize;
+      if (crc32c::Unmask(DecodeFixed32(record + 4)) !=
+          crc32c::Value(entry, len)) {
+        break;
+      }
+      if (!f(entry, len)) {
+        EncodeFixed32(record, 0);
+        PersistRange(record, 4, is_pmem_);
+        break;
+      }
+      offset += AlignRecord(kPMMemRecordHeaderSize + len);
+    }
+    used_ = offset;
+    persisted_ = offset;
+  }
+
+  void MarkFlushPending(uint64_t file_number) {
+    EncodeFixed64(base_ + kPMMemFlushFileOffset, file_number);
+    PersistRange(base_ + kPMMemFlushFileOffset, 8, is_pmem_);
+  }
+
+  void MarkFlushed() {
+    base_[kPMMemFlushedOffset] = 1;
+    PersistRange(base_ + kPMMemFlushedOffset, 1, is_pmem_);
+  }
+
+ private:
+  const std::string fname_;
+  char* const base_;
+  const size_t size_;
+  const int is_pmem_;
+  size_t used_;
+  // Records before this offset are persisted
+  size_t persisted_;
+};
+
+// The segment files of one directory, and its commit file. Segments left
+// behind by memtables that were not flushed are kept per column family until
+// a memtable of that column family recovers them.
+class PMMemSegmentDir {
+ public:
+  PMMemSegmentDir(const std::string& dir, size_t segment_size,
+                  bool allow_non_pmem)
+      : dir_(dir),
+        segment_size_(segment_size),
+        allow_non_pmem_(allow_non_pmem),
+        next_generation_(1),
+        commit_base_(nullptr),
+        commit_size_(0),
+        commit_is_pmem_(0),
+        committed_seq_(0) {
+    std::vector<std::string> children;
+    // a missing directory simply has no leftover segments
+    Env::Default()->GetChildren(dir_, &children).PermitUncheckedError();
+    for (const auto& child : children) {
+      unsigned int column_family = 0;
+      unsigned long long generation = 0;
+      char suffix[8] = {0};
+      if (child.compare(0, strlen(kPMMemSegmentPrefix), kPMMemSegmentPrefix) !=
+              0 ||
+          sscanf(child.c_str() + strlen(kPMMemSegmentPrefix), "%u-%llu%7s",
+                 &column_family, &generation, suffix) != 3 ||
+          strcmp(suffix, kPMMemSegmentSuffix) != 0) {
+        continue;
+      }
+      leftover_[column_family][generation] = dir_ + "/" + child;
+      next_generation_ = std::max(next_generation_,
+                                   static_cast<uint64_t>(generation) + 1);
+    }
+    std::string fname = dir_ + "/" + kPMMemCommitFileName;
+    commit_base_ = static_cast<char*>(pmem_map_file(
+        fname.c_str(), 0, 0, 0, &commit_size_, &commit_is_pmem_));
+    if (commit_base_ != nullptr) {
+      if (commit_size_ >= kPMMemCommitFileSize &&
+          DecodeFixed64(commit_base_) == kPMMemMagic) {
+        committed_seq_ = DecodeFixed64(commit_base_ + kPMMemCommitSeqOffset);
+      } else {
+        // nothing was committed with it
+        pmem_unmap(commit_base_, commit_size_);
+        commit_base_ = nullptr;
+        unlink(fname.c_str());
+      }
+    }
+  }
+
+  ~PMMemSegmentDir() {
+    if (commit_base_ != nullptr) {
+      pmem_unmap(commit_base_, commit_size_);
+    }
+  }
+
+  // Largest sequence number of the committed batches
+  SequenceNumber committed_seq() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return committed_seq_;
+  }
+
+  // Hands the segments left behind for column_family over to the caller, in
+  // the order they were created. Deletes those of the column families that
+  // are not in column_families, which were dropped.
+  std::vector<std::string> ClaimLeftover(
+      uint32_t column_family, const std::vector<uint32_t>& column_families) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> fnames;
+    for (auto it = leftover_.begin(); it != leftover_.end();) {
+      if (it->first == column_family) {
+        for (const auto& generation : it->second) {
+          fnames.push_back(generation.second);
+        }
+      } else if (std::find(column_families.begin(), column_families.end(),
+                           it->first) == column_families.end()) {
+        for (const auto& generation : it->second) {
+          unlink(generation.second.c_str());
+        }
+      } else {
+        ++it;
+        continue;
+      }
+      it = leftover_.erase(it);
+    }
+    return fnames;
+  }
+
+  // Gives segments of a memtable that was destroyed without being flushed
+  // back, so that they are recovered if the DB is reopened.
+  void ReturnLeftover(uint32_t column_family,
+                      const std::vector<std::string>& fnames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& segments = leftover_[column_family];
+    for (const auto& fname : fnames) {
+      unsigned int cf = 0;
+      unsigned long long generation = 0;
+      sscanf(fname.c_str() + dir_.size() + 1 + strlen(kPMMemSegmentPrefix),
+             "%u-%llu", &cf, &generation);
+      segments[generation] = fname;
+    }
+  }
+
+  Status NewSegment(uint32_t column_family, size_t min_size,
+                    std::unique_ptr<PMMemSegment>* result) {
+    uint64_t generation;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Status s = CreateCommitFile();
+      if (!s.ok()) {
+        return s;
+      }
+      generation = next_generation_++;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s%u-%llu%s", kPMMemSegmentPrefix,
+             column_family, static_cast<unsigned long long>(generation),
+             kPMMemSegmentSuffix);
+    size_t size = std::max(
+        segment_size_,
+        kPMMemSegmentHeaderSize +
+            AlignRecord(kPMMemRecordHeaderSize + min_size));
+    return PMMemSegment::Create(dir_ + "/" + name, size, column_family,
+                                allow_non_pmem_, result);
+  }
+
+  // Persists seq as the largest committed sequence number. The memtables of
+  // several column families may commit concurrently during WAL recovery.
+  void Commit(SequenceNumber seq) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(commit_base_ != nullptr);
+    if (seq > committed_seq_) {
+      EncodeFixed64(commit_base_ + kPMMemCommitSeqOffset, seq);
+      PersistRange(commit_base_ + kPMMemCommitSeqOffset, 8, commit_is_pmem_);
+      committed_seq_ = seq;
+    }
+  }
+
+ private:
+  // REQUIRES: mutex_ held
+  Status CreateCommitFile() {
+    if (commit_base_ != nullptr) {
+      return Status::OK();
+    }
+    std::string fname = dir_ + "/" + kPMMemCommitFileName;
+    char* base = static_cast<char*>(
+        pmem_map_file(fname.c_str(), kPMMemCommitFileSize, PMEM_FILE_CREATE,
+                      0666, &commit_size_, &commit_is_pmem_));
+    if (base == nullptr) {
+      return Status::IOError("While mapping the pmem memtable commit file",
+                             fname);
+    }
+    EncodeFixed64(base + kPMMemCommitSeqOffset, committed_seq_);
+    PersistRange(base + kPMMemCommitSeqOffset, 8, commit_is_pmem_);
+    // the magic number marks the file as complete
+    EncodeFixed64(base, kPMMemMagic);
+    PersistRange(base, 8, commit_is_pmem_);
+    commit_base_ = base;
+    return Status::OK();
+  }
+
+  const std::string dir_;
+  const size_t segment_size_;
+  const bool allow_non_pmem_;
+  std::mutex mutex_;
+  uint64_t next_generation_;
+  std::map<uint32_t, std::map<uint64_t, std::string>> leftover_;
+  char* commit_base_;
+  size_t commit_size_;
+  int commit_is_pmem_;
+  SequenceNumber committed_seq_;
+};
+
+class PMSkipListRep : public MemTableRep {
+ public:
+  PMSkipListRep(const MemTableRep::KeyComparator& compare,
+                Allocator* allocator, Logger* logger, uint32_t column_family,
+                const std::shared_ptr<PMMemSegmentDir>& segment_dir)
+      : MemTableRep(allocator),
+        skip_list_(compare, allocator),
+        logger_(logger),
+        column_family_(column_family),
+        segment_dir_(segment_dir),
+        num_recovered_segments_(0),
+        segment_bytes_(0),
+        use_dram_(false),
+        read_only_(false),
+        flushed_(false) {}
+
+  ~PMSkipListRep() override {
+    std::vector<std::string> fnames;
+    for (const auto& segment : segments_) {
+      fnames.push_back(segment->fname());
+    }
+    segments_.clear();
+    if (flushed_) {
+      for (const auto& fname : fnames) {
+        unlink(fname.c_str());
+      }
+    } else if (!fnames.empty()) {
+      segment_dir_->ReturnLeftover(column_family_, fnames);
+    }
+  }
+
+  KeyHandle Allocate(const size_t len, char** buf) override {
+    *buf = nullptr;
+    if (segments_.size() > num_recovered_segments_) {
+      PMMemSegment* segment = segments_.back().get();
+      size_t used = segment->used();
+      *buf = segment->Allocate(len);
+      segment_bytes_.fetch_add(segment->used() - used,
+                               std::memory_order_relaxed);
+    }
+    if (*buf == nullptr && !use_dram_) {
+      std::unique_ptr<PMMemSegment> segment;
+      Status s = segment_dir_->NewSegment(column_family_, len, &segment);
+      if (s.ok()) {
+        *buf = segment->Allocate(len);
+        segment_bytes_.fetch_add(segment->used(), std::memory_order_relaxed);
+        segments_.push_back(std::move(segment));
+      } else {
+        ROCKS_LOG_ERROR(logger_,
+                        "Failed to create a pmem memtable segment, "
+                        "keeping the memtable in DRAM: %s",
+                        s.ToString().c_str());
+        use_dram_ = true;
+      }
+    }
+    if (*buf == nullptr) {
+      return MemTableRep::Allocate(len, buf);
+    }
+    return static_cast<KeyHandle>(*buf);
+  }
+
+  void Recover(const RecoveredState& state) override {
+    assert(segments_.empty());
+    const SequenceNumber committed_seq = segment_dir_->committed_seq();
+    for (const auto& fname :
+         segment_dir_->ClaimLeftover(column_family_, state.column_families)) {
+      std::unique_ptr<PMMemSegment> segment;
+      bool flushed = false;
+      uint64_t flush_file_number = 0;
+      Status s = PMMemSegment::Open(fname, column_family_, &segment, &flushed,
+                                    &flush_file_number);
+      if (!s.ok()) {
+        ROCKS_LOG_ERROR(logger_, "Skipping pmem memtable segment: %s",
+                        s.ToString().c_str());
+        continue;
+      }
+      if (flushed || (flush_file_number != 0 &&
+                      state.is_live_table_file(flush_file_number))) {
+        // the memtable was flushed but its segments were not removed yet
+        segment.reset();
+        unlink(fname.c_str());
+        continue;
+      }
+      // The entries of a memtable are in sequence order, so those of a batch
+      // that was not committed are at the end of its last segments. They are
+      // truncated since their sequence numbers will be reused.
+      segment->Scan([&](const char* entry, uint32_t len) {
+        if (EntrySequence(entry, len) > committed_seq) {
+          return false;
+        }
+        skip_list_.Insert(entry);
+        return true;
+      });
+      segment_bytes_.fetch_add(segment->used(), std::memory_order_relaxed);
+      segments_.push_back(std::move(segment));
+    }
+    // new entries never go to a segment that was recovered
+    num_recovered_segments_ = segments_.size();
+  }
+
+  void Insert(KeyHandle handle) override {
+    const char* entry = static_cast<char*>(handle);
+    // A sorted run may span the last two segments
+    for (size_t i = segments_.size(); i > num_recovered_segments_; i--) {
+      if (segments_[i - 1]->Contains(entry)) {
+        segments_[i - 1]->Seal(entry);
+        break;
+      }
+    }
+    skip_list_.Insert(entry);
+  }
+
+  void CommitBatch(uint64_t seq) override {
+    TEST_SYNC_POINT("PMSkipListRep::CommitBatch");
+    bool persisted = false;
+    for (size_t i = segments_.size(); i > num_recovered_segments_; i--) {
+      if (!segments_[i - 1]->PersistSealed()) {
+        break;
+      }
+      persisted = true;
+    }
+    if (persisted) {
+      segment_dir_->Commit(seq);
+    }
+  }
+
+  bool Contains(const char* key) const override {
+    return skip_list_.Contains(key);
+  }
+
+  void MarkReadOnly() override { read_only_ = true; }
+
+  // segments_ is only stable once the memtable is not written anymore
+  void MarkFlushPending(uint64_t file_number) override {
+    assert(read_only_);
+    for (const auto& segment : segments_) {
+      segment->MarkFlushPending(file_number);
+    }
+  }
+
+  void MarkFlushed() override {
+    assert(read_only_);
+    for (const auto& segment : segments_) {
+      segment->MarkFlushed();
+    }
+    flushed_ = true;
+  }
+
+  bool IsPersistent() const override { return true; }
+
+  size_t ApproximateMemoryUsage() override {
+    // Entries of the segments count towards the memtable size so that the
+    // memtable is flushed once write_buffer_size bytes of them are written.
+    // Entries allocated in DRAM after a fallback are accounted by allocator_.
+    // Called concurrently with Allocate(), which may grow segments_.
+    return segment_bytes_.load(std::memory_order_relaxed);
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override {
+    PMSkipListRep::Iterator iter(&skip_list_);
+    Slice dummy_slice;
+    for (iter.Seek(dummy_slice, k.memtable_key().data());
+         iter.Valid() && callback_func(callback_args, iter.key());
+         iter.Next()) {
+    }
+  }
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
+    void* mem = arena ? arena->AllocateAligned(sizeof(PMSkipListRep::Iterator))
+                      : operator new(sizeof(PMSkipListRep::Iterator));
+    return new (mem) PMSkipListRep::Iterator(&skip_list_);
+  }
+
+ private:
+  typedef SkipList<const char*, const MemTableRep::KeyComparator&> List;
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const List* list) : iter_(list) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return iter_.Valid(); }
+
+    const char* key() const override { return iter_.key(); }
+
+    void Next() override { iter_.Next(); }
+
+    void Prev() override { iter_.Prev(); }
+
+    void Seek(const Slice& user_key, const char* memtable_key) override {
+      if (memtable_key != nullptr) {
+        iter_.Seek(memtable_key);
+      } else {
+        iter_.Seek(EncodeKey(&tmp_, user_key));
+      }
+    }
+
+    void SeekForPrev(const Slice& user_key, const char* memtable_key) override {
+      if (memtable_key != nullptr) {
+        iter_.SeekForPrev(memtable_key);
+      } else {
+        iter_.SeekForPrev(EncodeKey(&tmp_, user_key));
+      }
+    }
+
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+   private:
+    List::Iterator iter_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  List skip_list_;
+  Logger* const logger_;
+  const uint32_t column_family_;
+  std::shared_ptr<PMMemSegmentDir> segment_dir_;
+  // The first num_recovered_segments_ segments were recovered and are
+  // read-only. The last segment after them, if any, takes new entries.
+  std::vector<std::unique_ptr<PMMemSegment>> segments_;
+  size_t num_recovered_segments_;
+  // Bytes used in segments_, read by ApproximateMemoryUsage() without
+  // synchronization with the writer
+  std::atomic<size_t> segment_bytes_;
+  bool use_dram_;
+  bool read_only_;
+  bool flushed_;
+};
+
+class PMSkipListRepFactory : public MemTableRepFactory {
+ public:
+  PMSkipListRepFactory(const std::string& dir, size_t segment_size,
+                       bool allow_non_pmem)
+      : segment_dir_(std::make_shared<PMMemSegmentDir>(dir, segment_size,
+                                                       allow_non_pmem)) {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* transform,
+                                 Logger* logger) override {
+    return CreateMemTableRep(compare, allocator, transform, logger, 0);
+  }
+
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* /*transform*/,
+                                 Logger* logger,
+                                 uint32_t column_family_id) override {
+    return new PMSkipListRep(compare, allocator, logger, column_family_id,
+                             segment_dir_);
+  }
+
+  const char* Name() const override { return "PMSkipListRepFactory"; }
+
+ private:
+  std::shared_ptr<PMMemSegmentDir> segment_dir_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewPMSkipListRepFactory(const std::string& dir,
+                                            size_t segment_size,
+                                            bool allow_non_pmem) {
+  return new PMSkipListRepFactory(dir, segment_size, allow_non_pmem);
+}
+
+}  // namespace rocksdb
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "rocksdb/memtablerep.h"
+
+namespace rocksdb {
+
+// Returns a factory of skip list memtables whose entries live in files
+// mapped from a pmem directory. The entries of a write batch are persisted
+// together once the batch is inserted, so the contents of a memtable that was
+// not flushed survive a restart, without ever exposing part of a batch: when
+// the DB is opened, the memtable of each column family recovers the entries
+// left in dir by its previous incarnations, except for those whose flush
+// result is in the MANIFEST, and WAL recovery only replays the writes they do
+// not cover. Only the skip list index itself is kept in DRAM and is rebuilt
+// on open.
+//
+// dir should be on a DAX-mounted pmem device and must be used by a single
+// DB. Entries are appended to segment files of segment_size bytes. Segment
+// files whose mapping is not on real persistent memory are only used when
+// allow_non_pmem is set; otherwise, as when a segment cannot be created, the
+// memtable keeps its entries in DRAM like a regular skip list memtable.
+// Batches that write several column families are only recovered atomically
+// if they all use the same factory.
+//
+// REQUIRES: allow_concurrent_memtable_write == false,
+//           inplace_update_support == false
+// Range deletions are not kept on pmem and still need the WAL: the DB
+// refuses them with WriteOptions::disableWAL.
+MemTableRepFactory* NewPMSkipListRepFactory(const std::string& dir,
+                                            size_t segment_size = 64 << 20,
+                                            bool allow_non_pmem = false);
+
+}  // namespace rocksdb
@@ -0,0 +1,298 @@
+// Tests for the pmem memtable. They use a tmpfs directory, or the regular
+// test directory, as the stand-in for a pmem device.
+
+#include "pmenv/pm_memtablerep.h"
+
+#include "file/file_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/db.h"
+#include "test_util/sync_point.h"
+#include "test_util/testharness.h"
+#include "util/string_util.h"
+
+namespace rocksdb {
+
+class PMMemTableTest : public testing::Test {
+ public:
+  PMMemTableTest() : env_(Env::Default()) {
+    std::string shm = "/dev/shm";
+    if (env_->FileExists(shm).ok()) {
+      test_dir_ = test::PerThreadDBPath(shm, "pm_memtable_test");
+    } else {
+      test_dir_ = test::PerThreadDBPath(env_, "pm_memtable_test");
+    }
+    EXPECT_OK(DestroyDir(env_, test_dir_));
+    EXPECT_OK(env_->CreateDirIfMissing(test_dir_));
+    mem_dir_ = test_dir_ + "/mem";
+    EXPECT_OK(env_->CreateDirIfMissing(mem_dir_));
+    dbname_ = test_dir_ + "/db";
+    crash_mem_dir_ = test_dir_ + "/crash_mem";
+    crash_dbname_ = test_dir_ + "/crash_db";
+  }
+
+  ~PMMemTableTest() override {
+    SyncPoint::GetInstance()->DisableProcessing();
+    SyncPoint::GetInstance()->ClearAllCallBacks();
+    delete db_;
+    EXPECT_OK(DestroyDir(env_, test_dir_));
+  }
+
+  Options CurrentOptions() {
+    Options options;
+    options.create_if_missing = true;
+    options.allow_concurrent_memtable_write = false;
+    options.avoid_flush_during_shutdown = true;
+    // keeps the recovered entries in the active memtable
+    options.avoid_flush_during_recovery = true;
+    options.memtable_factory.reset(
+        NewPMSkipListRepFactory(mem_dir_, 1 << 20, true /* allow_non_pmem */));
+    return options;
+  }
+
+  void Reopen(const Options& options) {
+    delete db_;
+    db_ = nullptr;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  std::string Get(const std::string& key) {
+    std::string value;
+    Status s = db_->Get(ReadOptions(), key, &value);
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    }
+    EXPECT_OK(s);
+    return value;
+  }
+
+  // Counts the segment files of the memtables in dir
+  size_t NumSegments(const std::string& dir) {
+    std::vector<std::string> children;
+    EXPECT_OK(env_->GetChildren(dir, &children));
+    size_t num = 0;
+    for (const auto& child : children) {
+      if (EndsWith(child, ".pmt")) {
+        num++;
+      }
+    }
+    return num;
+  }
+
+  // Copies the DB and memtable directories as they are, which is what a
+  // crash at this point would leave behind.
+  void CopyForCrash() {
+    for (const auto& dir : {std::make_pair(dbname_, crash_dbname_),
+                            std::make_pair(mem_dir_, crash_mem_dir_)}) {
+      ASSERT_OK(DestroyDir(env_, dir.second));
+      ASSERT_OK(env_->CreateDirIfMissing(dir.second));
+      std::vector<std::string> children;
+      ASSERT_OK(env_->GetChildren(dir.first, &children));
+      for (const auto& child : children) {
+        if (child == "." || child == "..") {
+          continue;
+        }
+        ASSERT_OK(CopyFile(env_->GetFileSystem(), dir.first + "/" + child,
+                           dir.second + "/" + child, 0 /* size */,
+                           false /* use_fsync */));
+      }
+    }
+  }
+
+  // Opens the DB copied by CopyForCrash() instead of the current one.
+  void OpenCrashCopy(Options* options) {
+    delete db_;
+    db_ = nullptr;
+    dbname_ = crash_dbname_;
+    mem_dir_ = crash_mem_dir_;
+    options->memtable_factory.reset(
+        NewPMSkipListRepFactory(mem_dir_, 1 << 20, true /* allow_non_pmem */));
+    Reopen(*options);
+  }
+
+  uint64_t NumEntriesActiveMemTable() {
+    uint64_t num = 0;
+    EXPECT_TRUE(
+        db_->GetIntProperty("rocksdb.num-entries-active-mem-table", &num));
+    return num;
+  }
+
+  Env* env_;
+  std::string test_dir_;
+  std::string mem_dir_;
+  std::string dbname_;
+  std::string crash_mem_dir_;
+  std::string crash_dbname_;
+  DB* db_ = nullptr;
+};
+
+TEST_F(PMMemTableTest, ReattachWithoutWAL) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  WriteOptions wo;
+  wo.disableWAL = true;
+  // spans several segments
+  std::string value(1000, 'v');
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_OK(db_->Put(wo, "key" + ToString(i), value + ToString(i)));
+  }
+  ASSERT_OK(db_->Delete(wo, "key7"));
+
+  Reopen(options);
+  ASSERT_EQ(3001U, NumEntriesActiveMemTable());
+  ASSERT_EQ("NOT_FOUND", Get("key7"));
+  for (int i = 0; i < 3000; i += 97) {
+    ASSERT_EQ(value + ToString(i), Get("key" + ToString(i)));
+  }
+  ASSERT_OK(db_->Put(wo, "key1", "new"));
+
+  // the re-attached entries and the new ones are both kept
+  Reopen(options);
+  ASSERT_EQ("new", Get("key1"));
+  ASSERT_EQ(value + ToString(2), Get("key2"));
+
+  // flushed memtables are removed from the pmem directory
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  Reopen(options);
+  ASSERT_EQ(0U, NumEntriesActiveMemTable());
+  ASSERT_EQ("new", Get("key1"));
+  ASSERT_EQ(0U, NumSegments(mem_dir_));
+}
+
+TEST_F(PMMemTableTest, WALReplaySkipsReattachedWrites) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), "key" + ToString(i), ToString(i)));
+  }
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             "key10", "key20"));
+
+  // Every write is both in the WAL and in the memtable. Only the range
+  // deletion, which is not kept by the memtable, is replayed.
+  Reopen(options);
+  ASSERT_EQ(101U, NumEntriesActiveMemTable());
+  ASSERT_EQ("0", Get("key0"));
+  ASSERT_EQ("NOT_FOUND", Get("key15"));
+  ASSERT_EQ("25", Get("key25"));
+  ASSERT_OK(db_->Put(WriteOptions(), "key0", "new"));
+
+  Reopen(options);
+  ASSERT_EQ(102U, NumEntriesActiveMemTable());
+  ASSERT_EQ("new", Get("key0"));
+  ASSERT_EQ("NOT_FOUND", Get("key15"));
+}
+
+TEST_F(PMMemTableTest, CrashBeforeMarkFlushed) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  WriteOptions wo;
+  wo.disableWAL = true;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db_->Put(wo, "key" + ToString(i), ToString(i)));
+  }
+
+  // The flush result is in the MANIFEST, but the segments are not marked
+  // flushed yet
+  SyncPoint::GetInstance()->SetCallBack(
+      "MemTableListVersion::Remove:BeforeMarkFlushed",
+      [&](void* /*arg*/) { CopyForCrash(); });
+  SyncPoint::GetInstance()->EnableProcessing();
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  // The segments are dropped since their table file is live
+  OpenCrashCopy(&options);
+  ASSERT_EQ(0U, NumEntriesActiveMemTable());
+  ASSERT_EQ(0U, NumSegments(mem_dir_));
+  ASSERT_EQ("7", Get("key7"));
+  ASSERT_OK(db_->Delete(wo, "key7"));
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  Reopen(options);
+  ASSERT_EQ("NOT_FOUND", Get("key7"));
+}
+
+TEST_F(PMMemTableTest, CrashInsideBatch) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  WriteOptions wo;
+  wo.disableWAL = true;
+  ASSERT_OK(db_->Put(wo, "x", "x"));
+
+  // The records of the batch are written but the batch is not committed
+  WriteBatch batch;
+  ASSERT_OK(batch.Put("a", "a"));
+  ASSERT_OK(batch.Put("b", "b"));
+  SyncPoint::GetInstance()->SetCallBack(
+      "PMSkipListRep::CommitBatch", [&](void* /*arg*/) { CopyForCrash(); });
+  SyncPoint::GetInstance()->EnableProcessing();
+  ASSERT_OK(db_->Write(wo, &batch));
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  OpenCrashCopy(&options);
+  ASSERT_EQ(1U, NumEntriesActiveMemTable());
+  ASSERT_EQ("x", Get("x"));
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+
+  // The next writes reuse the sequence numbers of the dropped batch, which
+  // must not come back
+  ASSERT_OK(db_->Put(wo, "c", "c"));
+  ASSERT_OK(db_->Put(wo, "d", "d"));
+  Reopen(options);
+  ASSERT_EQ(3U, NumEntriesActiveMemTable());
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("c", Get("c"));
+  ASSERT_EQ("d", Get("d"));
+}
+
+TEST_F(PMMemTableTest, RangeDeletionNeedsWAL) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  WriteOptions wo;
+  wo.disableWAL = true;
+  ASSERT_OK(db_->Put(wo, "key1", "1"));
+  ASSERT_TRUE(db_->DeleteRange(wo, db_->DefaultColumnFamily(), "key0", "key2")
+                  .IsNotSupported());
+  ASSERT_EQ("1", Get("key1"));
+
+  // With the WAL, the range deletion survives a crash
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             "key0", "key2"));
+  CopyForCrash();
+  OpenCrashCopy(&options);
+  ASSERT_EQ("NOT_FOUND", Get("key1"));
+}
+
+TEST_F(PMMemTableTest, DroppedColumnFamily) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  WriteOptions wo;
+  wo.disableWAL = true;
+  ColumnFamilyHandle* handle = nullptr;
+  ASSERT_OK(db_->CreateColumnFamily(options, "dropped", &handle));
+  ASSERT_OK(db_->Put(wo, handle, "key", "value"));
+  ASSERT_EQ(1U, NumSegments(mem_dir_));
+
+  // A crash after the drop leaves the segments behind, which the next open
+  // deletes
+  ASSERT_OK(db_->DropColumnFamily(handle));
+  CopyForCrash();
+  ASSERT_OK(db_->DestroyColumnFamilyHandle(handle));
+  // Destroying the last reference deletes them right away
+  ASSERT_EQ(0U, NumSegments(mem_dir_));
+
+  ASSERT_EQ(1U, NumSegments(crash_mem_dir_));
+  OpenCrashCopy(&options);
+  ASSERT_EQ(0U, NumSegments(mem_dir_));
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
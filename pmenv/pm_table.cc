@@ -0,0 +1,878 @@
+#include "pmenv/pm_table.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/pinned_iterators_manager.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "file/random_access_file_reader.h"
+#include "file/writable_file_writer.h"
+#include "logging/logging.h"
+#include "memory/arena.h"
+#include "options/configurable_helper.h"
+#include "port/port.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/utilities/options_type.h"
+#include "table/block_based/block.h"
+#include "table/format.h"
+#include "table/get_context.h"
+#include "table/internal_iterator.h"
+#include "table/meta_blocks.h"
+#include "table/table_builder.h"
+#include "table/table_reader.h"
+#include "util/coding.h"
+#include "util/vector_iterator.h"
+
+namespace rocksdb {
+
+// A PM table is laid out as
+//   [records] [padding] [offset array] [padding] [top-level index]
+//   [range deletions] [properties] [metaindex] [footer]
+// where a record is
+//   key size (varint32) | value size (varint32) | internal key | value
+// The offset array holds the file offset of every record in key order, as
+// fixed32 or, once the records outgrow 4GB, fixed64. The top-level index
+// holds, as fixed64, the first 8 bytes of the user key of every
+// index_interval-th record read as a big endian number, so that their
+// numeric order is the bytewise order of the keys. Both arrays start on a
+// cache line. Range deletions are records too. Blocks have no trailer.
+//
+// kPMTableMagicNumber was picked by running
+//    echo rocksdb.table.pm | sha1sum
+// and taking the leading 64 bits.
+const uint64_t kPMTableMagicNumber = 0x4938b489d31cdd17ull;
+
+namespace {
+
+const std::string kPMTableOffsetsBlock = "rocksdb.pm.offsets";
+const std::string kPMTableIndexBlock = "rocksdb.pm.index";
+const std::string kPMTableOffsetWidth = "rocksdb.pm.offset.width";
+const std::string kPMTableIndexInterval = "rocksdb.pm.index.interval";
+
+constexpr size_t kPMTableAlignment = CACHE_LINE_SIZE;
+// Interpolation rounds over the top-level index before it falls back to
+// bisection, which bounds the cost of skewed key distributions.
+constexpr int kMaxInterpolationRounds = 4;
+// Ranges of at most this many entries are scanned linearly.
+constexpr size_t kLinearScanEntries = 8;
+
+uint64_t KeyPrefix(const Slice& user_key) {
+  uint64_t prefix = 0;
+  for (size_t i = 0; i < sizeof(prefix); i++) {
+    prefix <<= 8;
+    if (i < user_key.size()) {
+      prefix |= static_cast<unsigned char>(user_key[i]);
+    }
+  }
+  return prefix;
+}
+
+void AppendRecordHeader(std::string* dst, const Slice& key,
+                        const Slice& value) {
+  PutVarint32(dst, static_cast<uint32_t>(key.size()));
+  PutVarint32(dst, static_cast<uint32_t>(value.size()));
+}
+
+bool DecodeRecord(const char* p, const char* limit, Slice* key,
+                  Slice* value) {
+  uint32_t key_size = 0;
+  uint32_t value_size = 0;
+  p = GetVarint32Ptr(p, limit, &key_size);
+  if (p != nullptr) {
+    p = GetVarint32Ptr(p, limit, &value_size);
+  }
+  if (p == nullptr || key_size < kNumInternalBytes ||
+      static_cast<uint64_t>(limit - p) <
+          static_cast<uint64_t>(key_size) + value_size) {
+    return false;
+  }
+  *key = Slice(p, key_size);
+  *value = Slice(p + key_size, value_size);
+  return true;
+}
+
+class PMTableBuilder : public TableBuilder {
+ public:
+  PMTableBuilder(const TableBuilderOptions& options, uint32_t column_family_id,
+                 WritableFileWriter* file, uint32_t index_interval)
+      : ioptions_(options.ioptions), file_(file) {
+    // Key prefixes only order like the keys under the bytewise comparator.
+    if (options.internal_comparator.user_comparator() == BytewiseComparator()) {
+      index_interval_ = index_interval;
+    }
+    properties_.num_data_blocks = 1;
+    properties_.column_family_id = column_family_id;
+    properties_.column_family_name = options.column_family_name;
+    properties_.creation_time = options.creation_time;
+    properties_.oldest_key_time = options.oldest_key_time;
+    properties_.file_creation_time = options.file_creation_time;
+    properties_.db_id = options.db_id;
+    properties_.db_session_id = options.db_session_id;
+    properties_.db_host_id = ioptions_.db_host_id;
+    if (!ReifyDbHostIdProperty(ioptions_.env, &properties_.db_host_id).ok()) {
+      ROCKS_LOG_INFO(ioptions_.info_log, "db_host_id property will not be set");
+    }
+    properties_.prefix_extractor_name =
+        options.moptions.prefix_extractor != nullptr
+            ? options.moptions.prefix_extractor->Name()
+            : "nullptr";
+    for (auto& factory : *options.int_tbl_prop_collector_factories) {
+      table_properties_collectors_.emplace_back(
+          factory->CreateIntTblPropCollector(column_family_id));
+    }
+  }
+
+  ~PMTableBuilder() override {
+    status_.PermitUncheckedError();
+    io_status_.PermitUncheckedError();
+  }
+
+  void Add(const Slice& key, const Slice& value) override {
+    ParsedInternalKey parsed;
+    status_ = ParseInternalKey(key, &parsed, false /* log_err_key */);
+    if (!status_.ok()) {
+      return;
+    }
+    if (parsed.type == kTypeRangeDeletion) {
+      AppendRecordHeader(&range_dels_, key, value);
+      range_dels_.append(key.data(), key.size());
+      range_dels_.append(value.data(), value.size());
+      properties_.num_range_deletions++;
+    } else {
+      if (index_interval_ > 0 && offsets_.size() % index_interval_ == 0) {
+        index_.push_back(KeyPrefix(parsed.user_key));
+      }
+      offsets_.push_back(offset_);
+      std::string header;
+      AppendRecordHeader(&header, key, value);
+      io_status_ = Append(header);
+      if (io_status_.ok()) {
+        io_status_ = Append(key);
+      }
+      if (io_status_.ok()) {
+        io_status_ = Append(value);
+      }
+      if (io_status_.ok()) {
+        properties_.num_entries++;
+        properties_.raw_key_size += key.size();
+        properties_.raw_value_size += value.size();
+        if (parsed.type == kTypeDeletion ||
+            parsed.type == kTypeSingleDeletion) {
+          properties_.num_deletions++;
+        } else if (parsed.type == kTypeMerge) {
+          properties_.num_merge_operands++;
+        }
+      }
+      status_ = io_status_;
+    }
+    NotifyCollectTableCollectorsOnAdd(
+        key, value, offset_, table_properties_collectors_, ioptions_.info_log);
+  }
+
+  Status status() const override { return status_; }
+
+  IOStatus io_status() const override { return io_status_; }
+
+  Status Finish() override {
+    assert(!closed_);
+    closed_ = true;
+    if (!status_.ok()) {
+      return status_;
+    }
+    properties_.data_size = offset_;
+    const uint32_t offset_width =
+        offset_ <= std::numeric_limits<uint32_t>::max() ? 4 : 8;
+
+    MetaIndexBuilder meta_index_builder;
+    std::string block;
+    block.reserve(offsets_.size() * offset_width);
+    for (uint64_t offset : offsets_) {
+      if (offset_width == 4) {
+        PutFixed32(&block, static_cast<uint32_t>(offset));
+      } else {
+        PutFixed64(&block, offset);
+      }
+    }
+    BlockHandle handle;
+    io_status_ = WriteAlignedBlock(block, &handle);
+    if (io_status_.ok()) {
+      meta_index_builder.Add(kPMTableOffsetsBlock, handle);
+      properties_.index_size = block.size();
+    }
+    if (io_status_.ok() && !index_.empty()) {
+      block.clear();
+      for (uint64_t prefix : index_) {
+        PutFixed64(&block, prefix);
+      }
+      io_status_ = WriteAlignedBlock(block, &handle);
+      if (io_status_.ok()) {
+        meta_index_builder.Add(kPMTableIndexBlock, handle);
+        properties_.index_size += block.size();
+      }
+    }
+    if (io_status_.ok() && !range_dels_.empty()) {
+      io_status_ = WriteBlock(range_dels_, &handle);
+      if (io_status_.ok()) {
+        meta_index_builder.Add(kRangeDelBlock, handle);
+      }
+    }
+
+    if (io_status_.ok()) {
+      std::string val;
+      PutFixed32(&val, offset_width);
+      properties_.user_collected_properties[kPMTableOffsetWidth] = val;
+      val.clear();
+      PutFixed32(&val, index_.empty() ? 0 : index_interval_);
+      properties_.user_collected_properties[kPMTableIndexInterval] = val;
+
+      PropertyBlockBuilder property_block_builder;
+      property_block_builder.AddTableProperty(properties_);
+      property_block_builder.Add(properties_.user_collected_properties);
+      NotifyCollectTableCollectorsOnFinish(table_properties_collectors_,
+                                           ioptions_.info_log,
+                                           &property_block_builder);
+      io_status_ = WriteBlock(property_block_builder.Finish(), &handle);
+    }
+    if (io_status_.ok()) {
+      meta_index_builder.Add(kPropertiesBlock, handle);
+      io_status_ = WriteBlock(meta_index_builder.Finish(), &handle);
+    }
+    if (io_status_.ok()) {
+      Footer footer(kPMTableMagicNumber, 1);
+      footer.set_metaindex_handle(handle);
+      footer.set_index_handle(BlockHandle::NullBlockHandle());
+      std::string footer_encoding;
+      footer.EncodeTo(&footer_encoding);
+      io_status_ = Append(footer_encoding);
+    }
+    status_ = io_status_;
+    return status_;
+  }
+
+  void Abandon() override { closed_ = true; }
+
+  uint64_t NumEntries() const override { return properties_.num_entries; }
+
+  uint64_t FileSize() const override { return offset_; }
+
+  TableProperties GetTableProperties() const override { return properties_; }
+
+  std::string GetFileChecksum() const override {
+    return file_ != nullptr ? file_->GetFileChecksum() : kUnknownFileChecksum;
+  }
+
+  const char* GetFileChecksumFuncName() const override {
+    return file_ != nullptr ? file_->GetFileChecksumFuncName()
+                            : kUnknownFileChecksumFuncName;
+  }
+
+ private:
+  IOStatus Append(const Slice& data) {
+    IOStatus s = file_->Append(data);
+    if (s.ok()) {
+      offset_ += data.size();
+    }
+    return s;
+  }
+
+  IOStatus WriteBlock(const Slice& block, BlockHandle* handle) {
+    handle->set_offset(offset_);
+    handle->set_size(block.size());
+    return Append(block);
+  }
+
+  IOStatus WriteAlignedBlock(const Slice& block, BlockHandle* handle) {
+    size_t padding = static_cast<size_t>(
+        (kPMTableAlignment - offset_ % kPMTableAlignment) % kPMTableAlignment);
+    if (padding > 0) {
+      IOStatus s = Append(std::string(padding, '\0'));
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return WriteBlock(block, handle);
+  }
+
+  const ImmutableCFOptions& ioptions_;
+  std::vector<std::unique_ptr<IntTblPropCollector>>
+      table_properties_collectors_;
+  WritableFileWriter* file_;
+  uint32_t index_interval_ = 0;
+  uint64_t offset_ = 0;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> index_;
+  std::string range_dels_;
+  Status status_;
+  IOStatus io_status_;
+  TableProperties properties_;
+  bool closed_ = false;
+};
+
+class PMTableReader : public TableReader {
+ public:
+  static Status Open(const TableReaderOptions& options,
+                     std::unique_ptr<RandomAccessFileReader>&& file,
+                     uint64_t file_size,
+                     std::unique_ptr<TableReader>* table_reader);
+
+  InternalIterator* NewIterator(const ReadOptions&,
+                                const SliceTransform* prefix_extractor,
+                                Arena* arena, bool skip_filters,
+                                TableReaderCaller caller,
+                                size_t compaction_readahead_size = 0,
+                                bool allow_unprepared_value = false) override;
+
+  FragmentedRangeTombstoneIterator* NewRangeTombstoneIterator(
+      const ReadOptions& read_options) override;
+
+  Status Get(const ReadOptions& readOptions, const Slice& key,
+             GetContext* get_context, const SliceTransform* prefix_extractor,
+             bool skip_filters = false) override;
+
+  uint64_t ApproximateOffsetOf(const Slice& key,
+                               TableReaderCaller caller) override;
+
+  uint64_t ApproximateSize(const Slice& start, const Slice& end,
+                           TableReaderCaller caller) override;
+
+  void SetupForCompaction() override {}
+
+  std::shared_ptr<const TableProperties> GetTableProperties() const override {
+    return table_properties_;
+  }
+
+  size_t ApproximateMemoryUsage() const override {
+    return buf_ != nullptr ? file_data_.size() : 0;
+  }
+
+  size_t num_entries() const { return num_entries_; }
+
+  const InternalKeyComparator& internal_comparator() const {
+    return internal_comparator_;
+  }
+
+  // Decodes the i-th record in key order. Returns false if it is malformed.
+  bool GetEntry(size_t i, Slice* key, Slice* value) const;
+
+  // Sets *index to the first entry not less than target.
+  Status LowerBound(const Slice& target, size_t* index) const;
+
+ private:
+  PMTableReader(const InternalKeyComparator& internal_comparator,
+                std::unique_ptr<RandomAccessFileReader>&& file,
+                std::shared_ptr<const TableProperties> table_properties)
+      : internal_comparator_(internal_comparator),
+        file_(std::move(file)),
+        table_properties_(std::move(table_properties)) {}
+
+  Status Init(const TableReaderOptions& options, uint64_t file_size);
+
+  Status GetBlock(const BlockHandle& handle, Slice* block) const;
+
+  uint64_t RecordOffset(size_t i) const {
+    return offset_width_ == 4 ? DecodeFixed32(offsets_ + i * 4)
+                              : DecodeFixed64(offsets_ + i * 8);
+  }
+
+  uint64_t IndexAt(size_t i) const { return DecodeFixed64(index_ + i * 8); }
+
+  // Returns the first top-level index entry not less than prefix.
+  size_t IndexLowerBound(uint64_t prefix) const;
+
+  const InternalKeyComparator internal_comparator_;
+  std::unique_ptr<RandomAccessFileReader> file_;
+  std::shared_ptr<const TableProperties> table_properties_;
+  // The whole file, in place when reads are served from a mapping and
+  // otherwise from buf_.
+  Slice file_data_;
+  std::unique_ptr<char[]> buf_;
+  uint64_t data_size_ = 0;
+  const char* offsets_ = nullptr;
+  uint32_t offset_width_ = 4;
+  size_t num_entries_ = 0;
+  const char* index_ = nullptr;
+  size_t index_size_ = 0;
+  uint32_t index_interval_ = 0;
+  std::shared_ptr<FragmentedRangeTombstoneList> fragmented_range_dels_;
+  // Pins values handed to GetContext when the table is never closed.
+  std::unique_ptr<Cleanable> dummy_cleanable_;
+};
+
+class PMTableIterator : public InternalIterator {
+ public:
+  explicit PMTableIterator(const PMTableReader* table) : table_(table) {}
+
+  bool Valid() const override { return index_ < table_->num_entries(); }
+
+  void SeekToFirst() override {
+    status_ = Status::OK();
+    index_ = 0;
+    Update();
+  }
+
+  void SeekToLast() override {
+    status_ = Status::OK();
+    index_ = table_->num_entries() > 0 ? table_->num_entries() - 1 : 0;
+    Update();
+  }
+
+  void Seek(const Slice& target) override {
+    status_ = table_->LowerBound(target, &index_);
+    if (!status_.ok()) {
+      index_ = table_->num_entries();
+    }
+    Update();
+  }
+
+  void SeekForPrev(const Slice& target) override {
+    Seek(target);
+    if (!status_.ok()) {
+      return;
+    }
+    if (!Valid()) {
+      SeekToLast();
+    } else if (table_->internal_comparator().Compare(key_, target) > 0) {
+      Prev();
+    }
+  }
+
+  void Next() override {
+    assert(Valid());
+    index_++;
+    Update();
+  }
+
+  void Prev() override {
+    assert(Valid());
+    index_ = index_ > 0 ? index_ - 1 : table_->num_entries();
+    Update();
+  }
+
+  Slice key() const override {
+    assert(Valid());
+    return key_;
+  }
+
+  Slice value() const override {
+    assert(Valid());
+    return value_;
+  }
+
+  Status status() const override { return status_; }
+
+  void SetPinnedItersMgr(PinnedIteratorsManager* pinned_iters_mgr) override {
+    pinned_iters_mgr_ = pinned_iters_mgr;
+  }
+
+  // Keys and values point into the table, which outlives the iterator.
+  bool IsKeyPinned() const override {
+    return pinned_iters_mgr_ != nullptr && pinned_iters_mgr_->PinningEnabled();
+  }
+
+  bool IsValuePinned() const override { return IsKeyPinned(); }
+
+ private:
+  void Update() {
+    if (Valid() && !table_->GetEntry(index_, &key_, &value_)) {
+      status_ = Status::Corruption("bad record in PM table");
+      index_ = table_->num_entries();
+    }
+  }
+
+  const PMTableReader* table_;
+  size_t index_ = std::numeric_limits<size_t>::max();
+  Slice key_;
+  Slice value_;
+  Status status_;
+  PinnedIteratorsManager* pinned_iters_mgr_ = nullptr;
+};
+
+Status PMTableReader::Open(const TableReaderOptions& options,
+                           std::unique_ptr<RandomAccessFileReader>&& file,
+                           uint64_t file_size,
+                           std::unique_ptr<TableReader>* table_reader) {
+  TableProperties* props = nullptr;
+  Status s = ReadTableProperties(file.get(), file_size, kPMTableMagicNumber,
+                                 options.ioptions, &props,
+                                 true /* compression_type_missing */);
+  if (!s.ok()) {
+    return s;
+  }
+  std::shared_ptr<const TableProperties> table_properties(props);
+  std::unique_ptr<PMTableReader> reader(new PMTableReader(
+      options.internal_comparator, std::move(file), table_properties));
+  s = reader->Init(options, file_size);
+  if (s.ok()) {
+    *table_reader = std::move(reader);
+  }
+  return s;
+}
+
+Status PMTableReader::Init(const TableReaderOptions& options,
+                           uint64_t file_size) {
+  if (!file_->file()->use_mmap_reads()) {
+    buf_.reset(new char[file_size]);
+  }
+  Status s = file_->Read(IOOptions(), 0, static_cast<size_t>(file_size),
+                         &file_data_, buf_.get(), nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  if (file_data_.size() != file_size) {
+    return Status::Corruption("truncated PM table");
+  }
+  if (buf_ != nullptr && file_data_.data() != buf_.get()) {
+    memcpy(buf_.get(), file_data_.data(), file_data_.size());
+    file_data_ = Slice(buf_.get(), file_data_.size());
+  }
+
+  const auto& user_props = table_properties_->user_collected_properties;
+  auto width = user_props.find(kPMTableOffsetWidth);
+  auto interval = user_props.find(kPMTableIndexInterval);
+  if (width == user_props.end() || width->second.size() != 4 ||
+      interval == user_props.end() || interval->second.size() != 4) {
+    return Status::Corruption("missing PM table properties");
+  }
+  offset_width_ = DecodeFixed32(width->second.data());
+  index_interval_ = DecodeFixed32(interval->second.data());
+  num_entries_ = static_cast<size_t>(table_properties_->num_entries);
+  data_size_ = table_properties_->data_size;
+  if ((offset_width_ != 4 && offset_width_ != 8) || data_size_ > file_size) {
+    return Status::Corruption("bad PM table properties");
+  }
+
+  Footer footer;
+  s = ReadFooterFromFile(IOOptions(), file_.get(), nullptr, file_size, &footer,
+                         kPMTableMagicNumber);
+  if (!s.ok()) {
+    return s;
+  }
+  Slice metaindex;
+  s = GetBlock(footer.metaindex_handle(), &metaindex);
+  if (!s.ok()) {
+    return s;
+  }
+  BlockContents metaindex_contents(metaindex);
+  Block metaindex_block(std::move(metaindex_contents));
+  std::unique_ptr<InternalIterator> meta_iter(metaindex_block.NewDataIterator(
+      BytewiseComparator(), kDisableGlobalSequenceNumber));
+
+  BlockHandle handle;
+  Slice block;
+  s = FindMetaBlock(meta_iter.get(), kPMTableOffsetsBlock, &handle);
+  if (s.ok()) {
+    s = GetBlock(handle, &block);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  if (block.size() != num_entries_ * offset_width_) {
+    return Status::Corruption("bad PM table offset array");
+  }
+  offsets_ = block.data();
+
+  if (index_interval_ > 0) {
+    s = FindMetaBlock(meta_iter.get(), kPMTableIndexBlock, &handle);
+    if (s.ok()) {
+      s = GetBlock(handle, &block);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    index_size_ = block.size() / 8;
+    if (index_size_ * 8 != block.size() ||
+        index_size_ != (num_entries_ + index_interval_ - 1) / index_interval_) {
+      return Status::Corruption("bad PM table index");
+    }
+    index_ = block.data();
+  }
+
+  if (table_properties_->num_range_deletions > 0) {
+    s = FindMetaBlock(meta_iter.get(), kRangeDelBlock, &handle);
+    if (s.ok()) {
+      s = GetBlock(handle, &block);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    const char* p = block.data();
+    const char* limit = block.data() + block.size();
+    while (p < limit) {
+      Slice key;
+      Slice value;
+      if (!DecodeRecord(p, limit, &key, &value)) {
+        return Status::Corruption("bad PM table range deletion");
+      }
+      keys.push_back(key.ToString());
+      values.push_back(value.ToString());
+      p = value.data() + value.size();
+    }
+    std::unique_ptr<InternalIterator> iter(
+        new VectorIterator(std::move(keys), std::move(values),
+                           &internal_comparator_));
+    fragmented_range_dels_ = std::make_shared<FragmentedRangeTombstoneList>(
+        std::move(iter), internal_comparator_);
+  }
+
+  if (options.immortal) {
+    dummy_cleanable_.reset(new Cleanable());
+  }
+  return Status::OK();
+}
+
+Status PMTableReader::GetBlock(const BlockHandle& handle, Slice* block) const {
+  if (handle.offset() > file_data_.size() ||
+      handle.size() > file_data_.size() - handle.offset()) {
+    return Status::Corruption("PM table block out of range");
+  }
+  *block = Slice(file_data_.data() + handle.offset(),
+                 static_cast<size_t>(handle.size()));
+  return Status::OK();
+}
+
+bool PMTableReader::GetEntry(size_t i, Slice* key, Slice* value) const {
+  uint64_t offset = RecordOffset(i);
+  if (offset >= data_size_) {
+    return false;
+  }
+  return DecodeRecord(file_data_.data() + offset,
+                      file_data_.data() + data_size_, key, value);
+}
+
+size_t PMTableReader::IndexLowerBound(uint64_t prefix) const {
+  // The result is in [lo, hi]: entries before lo are less than prefix and
+  // entries from hi on are not.
+  size_t lo = 0;
+  size_t hi = index_size_;
+  for (int round = 0;
+       round < kMaxInterpolationRounds && hi - lo > kLinearScanEntries;
+       round++) {
+    uint64_t lo_prefix = IndexAt(lo);
+    uint64_t hi_prefix = IndexAt(hi - 1);
+    if (prefix <= lo_prefix) {
+      return lo;
+    }
+    if (prefix > hi_prefix) {
+      return hi;
+    }
+    double fraction = static_cast<double>(prefix - lo_prefix) /
+                      static_cast<double>(hi_prefix - lo_prefix);
+    size_t pos = lo + static_cast<size_t>(fraction * (hi - 1 - lo));
+    if (IndexAt(pos) < prefix) {
+      lo = pos + 1;
+    } else {
+      hi = pos;
+    }
+  }
+  while (hi - lo > kLinearScanEntries) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (IndexAt(mid) < prefix) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  while (lo < hi && IndexAt(lo) < prefix) {
+    lo++;
+  }
+  return lo;
+}
+
+Status PMTableReader::LowerBound(const Slice& target, size_t* index) const {
+  size_t lo = 0;
+  size_t hi = num_entries_;
+  if (index_ != nullptr) {
+    // Sampled entries with a smaller key prefix are before the target and
+    // those with a larger one after it.
+    uint64_t prefix = KeyPrefix(ExtractUserKey(target));
+    size_t first = IndexLowerBound(prefix);
+    if (first > 0) {
+      lo = (first - 1) * index_interval_ + 1;
+    }
+    size_t last = prefix == std::numeric_limits<uint64_t>::max()
+                      ? index_size_
+                      : IndexLowerBound(prefix + 1);
+    if (last < index_size_) {
+      hi = last * index_interval_;
+    }
+  }
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    Slice key;
+    Slice value;
+    if (!GetEntry(mid, &key, &value)) {
+      return Status::Corruption("bad record in PM table");
+    }
+    if (internal_comparator_.Compare(key, target) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *index = lo;
+  return Status::OK();
+}
+
+InternalIterator* PMTableReader::NewIterator(
+    const ReadOptions& /*options*/, const SliceTransform* /*prefix_extractor*/,
+    Arena* arena, bool /*skip_filters*/, TableReaderCaller /*caller*/,
+    size_t /*compaction_readahead_size*/, bool /*allow_unprepared_value*/) {
+  if (arena == nullptr) {
+    return new PMTableIterator(this);
+  }
+  auto mem = arena->AllocateAligned(sizeof(PMTableIterator));
+  return new (mem) PMTableIterator(this);
+}
+
+FragmentedRangeTombstoneIterator* PMTableReader::NewRangeTombstoneIterator(
+    const ReadOptions& read_options) {
+  if (fragmented_range_dels_ == nullptr) {
+    return nullptr;
+  }
+  SequenceNumber snapshot = kMaxSequenceNumber;
+  if (read_options.snapshot != nullptr) {
+    snapshot = read_options.snapshot->GetSequenceNumber();
+  }
+  return new FragmentedRangeTombstoneIterator(
+      fragmented_range_dels_, internal_comparator_, snapshot);
+}
+
+Status PMTableReader::Get(const ReadOptions& /*readOptions*/,
+                          const Slice& target, GetContext* get_context,
+                          const SliceTransform* /*prefix_extractor*/,
+                          bool /*skip_filters*/) {
+  size_t i = 0;
+  Status s = LowerBound(target, &i);
+  for (; s.ok() && i < num_entries_; i++) {
+    Slice key;
+    Slice value;
+    if (!GetEntry(i, &key, &value)) {
+      return Status::Corruption("bad record in PM table");
+    }
+    ParsedInternalKey parsed;
+    s = ParseInternalKey(key, &parsed, false /* log_err_key */);
+    bool matched = false;
+    if (s.ok() && !get_context->SaveValue(parsed, value, &matched,
+                                          dummy_cleanable_.get())) {
+      break;
+    }
+  }
+  return s;
+}
+
+uint64_t PMTableReader::ApproximateOffsetOf(const Slice& key,
+                                            TableReaderCaller /*caller*/) {
+  size_t i = 0;
+  if (!LowerBound(key, &i).ok() || i >= num_entries_) {
+    return data_size_;
+  }
+  return RecordOffset(i);
+}
+
+uint64_t PMTableReader::ApproximateSize(const Slice& start, const Slice& end,
+                                        TableReaderCaller caller) {
+  uint64_t start_offset = ApproximateOffsetOf(start, caller);
+  uint64_t end_offset = ApproximateOffsetOf(end, caller);
+  return end_offset > start_offset ? end_offset - start_offset : 0;
+}
+
+std::unordered_map<std::string, OptionTypeInfo> pm_table_type_info = {
+#ifndef ROCKSDB_LITE
+    {"index_interval",
+     {offsetof(struct PMTableOptions, index_interval), OptionType::kUInt32T,
+      OptionVerificationType::kNormal, OptionTypeFlags::kNone}},
+    {"max_level",
+     {offsetof(struct PMTableOptions, max_level), OptionType::kInt,
+      OptionVerificationType::kNormal, OptionTypeFlags::kNone}},
+#endif  // ROCKSDB_LITE
+};
+
+class PMTableFactory : public TableFactory {
+ public:
+  explicit PMTableFactory(const PMTableOptions& table_options)
+      : table_options_(table_options) {
+    if (table_options_.fallback_factory == nullptr) {
+      table_options_.fallback_factory.reset(NewBlockBasedTableFactory());
+    }
+    ConfigurableHelper::RegisterOptions(*this, &table_options_,
+                                        &pm_table_type_info);
+  }
+
+  static const char* kClassName() { return "PMTable"; }
+  const char* Name() const override { return kClassName(); }
+
+  using TableFactory::NewTableReader;
+  Status NewTableReader(
+      const ReadOptions& ro, const TableReaderOptions& table_reader_options,
+      std::unique_ptr<RandomAccessFileReader>&& file, uint64_t file_size,
+      std::unique_ptr<TableReader>* table,
+      bool prefetch_index_and_filter_in_cache = true) const override {
+    Footer footer;
+    Status s = ReadFooterFromFile(IOOptions(), file.get(), nullptr, file_size,
+                                  &footer);
+    if (!s.ok()) {
+      return s;
+    }
+    if (footer.table_magic_number() == kPMTableMagicNumber) {
+      return PMTableReader::Open(table_reader_options, std::move(file),
+                                 file_size, table);
+    }
+    return table_options_.fallback_factory->NewTableReader(
+        ro, table_reader_options, std::move(file), file_size, table,
+        prefetch_index_and_filter_in_cache);
+  }
+
+  TableBuilder* NewTableBuilder(
+      const TableBuilderOptions& table_builder_options,
+      uint32_t column_family_id, WritableFileWriter* file) const override {
+    int level = table_builder_options.level;
+    if (table_options_.max_level >= 0 &&
+        (level < 0 || level > table_options_.max_level)) {
+      return table_options_.fallback_factory->NewTableBuilder(
+          table_builder_options, column_family_id, file);
+    }
+    return new PMTableBuilder(table_builder_options, column_family_id, file,
+                              table_options_.index_interval);
+  }
+
+  Status ValidateOptions(const DBOptions& db_opts,
+                         const ColumnFamilyOptions& cf_opts) const override {
+    return table_options_.fallback_factory->ValidateOptions(db_opts, cf_opts);
+  }
+
+  std::string GetPrintableOptions() const override {
+    std::string ret;
+    const int kBufferSize = 200;
+    char buffer[kBufferSize];
+    snprintf(buffer, kBufferSize, "  index_interval: %u\n",
+             table_options_.index_interval);
+    ret.append(buffer);
+    snprintf(buffer, kBufferSize, "  max_level: %d\n",
+             table_options_.max_level);
+    ret.append(buffer);
+    snprintf(buffer, kBufferSize, "  fallback_factory: %s\n",
+             table_options_.fallback_factory->Name());
+    ret.append(buffer);
+    return ret;
+  }
+
+  bool IsDeleteRangeSupported() const override { return true; }
+
+ private:
+  PMTableOptions table_options_;
+};
+
+}  // namespace
+
+TableFactory* NewPMTableFactory(const PMTableOptions& options) {
+  return new PMTableFactory(options);
+}
+
+}  // namespace rocksdb
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "rocksdb/table.h"
+
+namespace rocksdb {
+
+struct PMTableOptions {
+  static const char* kName() { return "PMTableOptions"; }
+
+  // Every index_interval-th key of a table is sampled into the top-level
+  // index, which is searched by interpolation before the binary search over
+  // the sampled range. Only used with the bytewise comparator; 0 disables the
+  // top-level index and every lookup binary searches the whole key array.
+  uint32_t index_interval = 16;
+
+  // Files of levels up to max_level are written as PM tables, and files of
+  // deeper levels, or of an unknown level, with fallback_factory. Set this to
+  // ColumnFamilyOptions::first_path_max_level to use the PM table format only
+  // on the pmem tier. -1 writes every file as a PM table.
+  int max_level = -1;
+
+  // Writes the files that are not PM tables and reads every file that is not
+  // a PM table. Defaults to a block based table factory.
+  std::shared_ptr<TableFactory> fallback_factory;
+};
+
+// Returns a factory of tables laid out for byte addressable storage. A table
+// is a sequence of uncompressed records followed by a cache line aligned
+// array of fixed width record offsets in key order, and a sampled top-level
+// index of 8-byte key prefixes. Lookups search the offset array directly in
+// the file mapping and return keys and values in place, so Get and Seek never
+// allocate, copy or cache blocks.
+//
+// Tables are meant to be read through a mapping, e.g. from PMFileSystem
+// sst_paths with allow_mmap_reads set. A file whose reads are not served
+// from a mapping is read into memory once when it is opened.
+TableFactory* NewPMTableFactory(
+    const PMTableOptions& options = PMTableOptions());
+
+}  // namespace rocksdb
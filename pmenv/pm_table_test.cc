@@ -0,0 +1,185 @@
+// Tests for the PM table format, read through a mapping of regular files.
+
+#include "pmenv/pm_table.h"
+
+#include "file/file_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/db.h"
+#include "rocksdb/table_properties.h"
+#include "test_util/testharness.h"
+#include "util/string_util.h"
+
+namespace rocksdb {
+
+class PMTableTest : public testing::Test,
+                    public testing::WithParamInterface<bool> {
+ public:
+  PMTableTest() : env_(Env::Default()) {
+    dbname_ = test::PerThreadDBPath(env_, "pm_table_test");
+    EXPECT_OK(DestroyDir(env_, dbname_));
+  }
+
+  ~PMTableTest() override {
+    delete db_;
+    EXPECT_OK(DestroyDir(env_, dbname_));
+  }
+
+  Options CurrentOptions(const PMTableOptions& table_options) {
+    Options options;
+    options.create_if_missing = true;
+    options.allow_mmap_reads = GetParam();
+    options.disable_auto_compactions = true;
+    options.table_factory.reset(NewPMTableFactory(table_options));
+    return options;
+  }
+
+  void Reopen(const Options& options) {
+    delete db_;
+    db_ = nullptr;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  std::string Get(const std::string& key) {
+    std::string value;
+    Status s = db_->Get(ReadOptions(), key, &value);
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    }
+    EXPECT_OK(s);
+    return value;
+  }
+
+  // Number of table files that are PM tables, and of those that are not.
+  void CountTables(int* pm_tables, int* other_tables) {
+    *pm_tables = 0;
+    *other_tables = 0;
+    TablePropertiesCollection props;
+    ASSERT_OK(db_->GetPropertiesOfAllTables(&props));
+    for (const auto& p : props) {
+      if (p.second->user_collected_properties.count(
+              "rocksdb.pm.offset.width") > 0) {
+        (*pm_tables)++;
+      } else {
+        (*other_tables)++;
+      }
+    }
+  }
+
+  Env* env_;
+  std::string dbname_;
+  DB* db_ = nullptr;
+};
+
+TEST_P(PMTableTest, ReadWrite) {
+  PMTableOptions table_options;
+  table_options.index_interval = 4;
+  Options options = CurrentOptions(table_options);
+  Reopen(options);
+  for (int i = 0; i < 1000; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%06d", i);
+    ASSERT_OK(db_->Put(WriteOptions(), key, "v" + ToString(i)));
+  }
+  ASSERT_OK(db_->Delete(WriteOptions(), "key000007"));
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             "key000100", "key000200"));
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  // an older version of a key is shadowed by the newer table
+  ASSERT_OK(db_->Put(WriteOptions(), "key000010", "new"));
+  ASSERT_OK(db_->Flush(FlushOptions()));
+
+  for (int round = 0; round < 2; round++) {
+    int pm_tables = 0;
+    int other_tables = 0;
+    CountTables(&pm_tables, &other_tables);
+    ASSERT_EQ(2, pm_tables);
+    ASSERT_EQ(0, other_tables);
+
+    ASSERT_EQ("v0", Get("key000000"));
+    ASSERT_EQ("NOT_FOUND", Get("key000007"));
+    ASSERT_EQ("new", Get("key000010"));
+    ASSERT_EQ("NOT_FOUND", Get("key000150"));
+    ASSERT_EQ("v200", Get("key000200"));
+    ASSERT_EQ("v999", Get("key000999"));
+    ASSERT_EQ("NOT_FOUND", Get("key"));
+    ASSERT_EQ("NOT_FOUND", Get("key0010000"));
+    ASSERT_EQ("NOT_FOUND", Get("zzz"));
+
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(1000 - 1 - 100, count);
+    iter->Seek("key000099a");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("key000200", iter->key().ToString());
+    iter->Prev();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("key000099", iter->key().ToString());
+    iter->SeekForPrev("key000008");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("key000006", iter->key().ToString());
+    iter->SeekToLast();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("key000999", iter->key().ToString());
+    iter.reset();
+
+    Reopen(options);
+  }
+
+  // compaction reads and writes PM tables
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  int pm_tables = 0;
+  int other_tables = 0;
+  CountTables(&pm_tables, &other_tables);
+  ASSERT_EQ(1, pm_tables);
+  ASSERT_EQ(0, other_tables);
+  ASSERT_EQ("new", Get("key000010"));
+  ASSERT_EQ("NOT_FOUND", Get("key000150"));
+  ASSERT_EQ("v500", Get("key000500"));
+}
+
+TEST_P(PMTableTest, MaxLevelFallback) {
+  PMTableOptions table_options;
+  table_options.max_level = 0;
+  Options options = CurrentOptions(table_options);
+  Reopen(options);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), "key" + ToString(i), ToString(i)));
+  }
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  int pm_tables = 0;
+  int other_tables = 0;
+  CountTables(&pm_tables, &other_tables);
+  ASSERT_EQ(1, pm_tables);
+  ASSERT_EQ(0, other_tables);
+
+  // files compacted below max_level are written by the fallback factory and
+  // both formats are read side by side
+  CompactRangeOptions cro;
+  cro.change_level = true;
+  cro.target_level = 1;
+  cro.bottommost_level_compaction = BottommostLevelCompaction::kForce;
+  ASSERT_OK(db_->CompactRange(cro, nullptr, nullptr));
+  ASSERT_OK(db_->Put(WriteOptions(), "key5", "new"));
+  ASSERT_OK(db_->Flush(FlushOptions()));
+  CountTables(&pm_tables, &other_tables);
+  ASSERT_EQ(1, pm_tables);
+  ASSERT_EQ(1, other_tables);
+  Reopen(options);
+  ASSERT_EQ("new", Get("key5"));
+  ASSERT_EQ("50", Get("key50"));
+  ASSERT_EQ("NOT_FOUND", Get("key100"));
+}
+
+INSTANTIATE_TEST_CASE_P(PMTableTest, PMTableTest, ::testing::Bool());
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -80,6 +80,18 @@ void Mutex::Lock() {
 #endif
 }
 
+bool Mutex::TryLock() {
+  int result = pthread_mutex_trylock(&mu_);
+  if (result == EBUSY) {
+    return false;
+  }
+  PthreadCall("trylock", result);
+#ifndef NDEBUG
+  locked_ = true;
+#endif
+  return true;
+}
+
 void Mutex::Unlock() {
 #ifndef NDEBUG
   locked_ = false;
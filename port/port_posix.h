@@ -115,6 +115,8 @@ class Mutex {
   ~Mutex();
 
   void Lock();
+  // Locks the mutex if no thread holds it, and returns whether it did
+  bool TryLock();
   void Unlock();
   // this will assert if the mutex is not locked
   // it does NOT verify that mutex is held by a calling thread
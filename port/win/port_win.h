@@ -141,6 +141,16 @@ class Mutex {
 #endif
   }
 
+  bool TryLock() {
+    bool ret = mutex_.try_lock();
+#ifndef NDEBUG
+    if (ret) {
+      locked_ = true;
+    }
+#endif
+    return ret;
+  }
+
   void Unlock() {
 #ifndef NDEBUG
     locked_ = false;
@@ -2,6 +2,8 @@
 LIB_SOURCES =                                                   \
   cache/cache.cc                                                \
   cache/clock_cache.cc                                          \
+  cache/compressed_secondary_cache.cc                           \
+  cache/file_secondary_cache.cc                                 \
   cache/lru_cache.cc                                            \
   cache/sharded_cache.cc                                        \
   db/arena_wrapped_db_iter.cc                                   \
@@ -90,6 +92,8 @@ LIB_SOURCES =                                                   \
   env/io_posix.cc                                               \
   env/mock_env.cc                                               \
   pmenv/env_pm.cc												\
+  pmenv/pm_memtablerep.cc                                       \
+  pmenv/pm_table.cc                                             \
   file/delete_scheduler.cc                                      \
   file/file_prefetch_buffer.cc                                  \
   file/file_util.cc                                             \
@@ -111,6 +115,8 @@ LIB_SOURCES =                                                   \
   memtable/alloc_tracker.cc                                     \
   memtable/hash_linklist_rep.cc                                 \
   memtable/hash_skiplist_rep.cc                                 \
+  memtable/hash_vector_rep.cc                                   \
+  memtable/partitioned_skiplist_rep.cc                          \
   memtable/skiplistrep.cc                                       \
   memtable/vectorrep.cc                                         \
   memtable/write_buffer_manager.cc                              \
@@ -464,6 +470,9 @@ TEST_MAIN_SOURCES =                                                     \
   env/env_test.cc                                                       \
   env/io_posix_test.cc                                                  \
   env/mock_env_test.cc                                                  \
+  pmenv/env_pm_test.cc                                                  \
+  pmenv/pm_memtablerep_test.cc                                          \
+  pmenv/pm_table_test.cc                                                \
   file/delete_scheduler_test.cc                                         \
   file/prefetch_test.cc                                                 \
   file/random_access_file_reader_test.cc                                \
@@ -132,10 +132,25 @@ void DataBlockIter::NextOrReportImpl() {
   ParseNextDataKey<CheckAndDecodeEntry>();
 }
 
-void IndexBlockIter::NextImpl() { ParseNextIndexKey(); }
+void IndexBlockIter::NextImpl() {
+  if (decoded_index_ != nullptr) {
+    SetDecodedPosition(decoded_pos_ + 1);
+    return;
+  }
+  ParseNextIndexKey();
+}
 
 void IndexBlockIter::PrevImpl() {
   assert(Valid());
+  if (decoded_index_ != nullptr) {
+    if (decoded_pos_ == 0) {
+      current_ = restarts_;
+      restart_index_ = num_restarts_;
+    } else {
+      SetDecodedPosition(decoded_pos_ - 1);
+    }
+    return;
+  }
   // Scan backwards to a restart point before current_
   const uint32_t original = current_;
   while (GetRestartPoint(restart_index_) >= original) {
@@ -380,6 +395,10 @@ void IndexBlockIter::SeekImpl(const Slice& target) {
     seek_key = ExtractUserKey(target);
   }
   status_ = Status::OK();
+  if (decoded_index_ != nullptr) {
+    DecodedSeek(seek_key);
+    return;
+  }
   uint32_t index = 0;
   bool skip_linear_scan = false;
   bool ok = false;
@@ -453,6 +472,10 @@ void IndexBlockIter::SeekToFirstImpl() {
     return;
   }
   status_ = Status::OK();
+  if (decoded_index_ != nullptr) {
+    SetDecodedPosition(0);
+    return;
+  }
   SeekToRestartPoint(0);
   ParseNextIndexKey();
 }
@@ -472,6 +495,11 @@ void IndexBlockIter::SeekToLastImpl() {
     return;
   }
   status_ = Status::OK();
+  if (decoded_index_ != nullptr) {
+    // An empty index makes the position wrap around and the iterator invalid
+    SetDecodedPosition(decoded_index_->size() - 1);
+    return;
+  }
   SeekToRestartPoint(num_restarts_ - 1);
   while (ParseNextIndexKey() && NextEntryOffset() < restarts_) {
     // Keep skipping
@@ -635,6 +663,62 @@ void IndexBlockIter::DecodeCurrentValue(uint32_t shared) {
   }
 }
 
+void IndexBlockIter::SetDecodedPosition(uint32_t i) {
+  if (i >= decoded_index_->size()) {
+    current_ = restarts_;
+    restart_index_ = num_restarts_;
+    return;
+  }
+  decoded_pos_ = i;
+  current_ = decoded_index_->entry_offset(i);
+  raw_key_.SetKey(decoded_index_->key(i), false /* copy */);
+  // The decoded keys live as long as the block
+  key_pinned_ = true;
+  // Only keeps NextEntryOffset() right, value() returns decoded_value_
+  value_ = Slice(data_ + decoded_index_->entry_offset(i + 1), 0);
+  decoded_value_.handle = decoded_index_->handle(i);
+  if (have_first_key_) {
+    decoded_value_.first_internal_key =
+        Slice(data_ + decoded_index_->first_key_offset(i),
+              decoded_index_->first_key_size(i));
+  }
+}
+
+int IndexBlockIter::CompareDecodedKey(uint32_t i, uint64_t target_prefix,
+                                      const Slice& target) {
+  if (decoded_index_->use_key_prefixes()) {
+    uint64_t prefix = decoded_index_->key_prefix(i);
+    if (prefix != target_prefix) {
+      return prefix < target_prefix ? -1 : 1;
+    }
+  }
+  if (raw_key_.IsUserKey()) {
+    return ucmp().Compare(decoded_index_->key(i), target);
+  }
+  return icmp().Compare(decoded_index_->key(i), target);
+}
+
+void IndexBlockIter::DecodedSeek(const Slice& target) {
+  uint64_t target_prefix = 0;
+  if (decoded_index_->use_key_prefixes()) {
+    target_prefix = DecodedIndex::KeyPrefix(
+        raw_key_.IsUserKey() ? target : ExtractUserKey(target));
+  }
+  // The result is the first entry whose key is at least target, in
+  // [left, right]
+  uint32_t left = 0;
+  uint32_t right = decoded_index_->size();
+  while (left < right) {
+    uint32_t mid = left + (right - left) / 2;
+    if (CompareDecodedKey(mid, target_prefix, target) < 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  SetDecodedPosition(left);
+}
+
 template <class TValue>
 void BlockIter<TValue>::FindKeyAfterBinarySeek(const Slice& target,
                                                uint32_t index,
@@ -1024,10 +1108,17 @@ IndexBlockIter* Block::NewIndexIterator(
   } else {
     BlockPrefixIndex* prefix_index_ptr =
         total_order_seek ? nullptr : prefix_index;
+    // Hash lookups parse the block
+    const DecodedIndex* decoded_index =
+        prefix_index_ptr == nullptr && decoded_index_ != nullptr &&
+                decoded_index_->Matches(raw_ucmp, have_first_key,
+                                        key_includes_seq, value_is_full)
+            ? decoded_index_.get()
+            : nullptr;
     ret_iter->Initialize(raw_ucmp, data_, restart_offset_, num_restarts_,
                          global_seqno, prefix_index_ptr, have_first_key,
-                         key_includes_seq, value_is_full,
-                         block_contents_pinned);
+                         key_includes_seq, value_is_full, block_contents_pinned,
+                         decoded_index);
   }
 
   return ret_iter;
@@ -1043,7 +1134,81 @@ size_t Block::ApproximateMemoryUsage() const {
   if (read_amp_bitmap_) {
     usage += read_amp_bitmap_->ApproximateMemoryUsage();
   }
+  if (decoded_index_) {
+    usage += decoded_index_->ApproximateMemoryUsage();
+  }
   return usage;
 }
 
+void Block::DecodeIndex(const Comparator* raw_ucmp, bool have_first_key,
+                        bool key_includes_seq, bool value_is_full) {
+  if (decoded_index_ != nullptr || size_ < 2 * sizeof(uint32_t) ||
+      num_restarts_ == 0) {
+    return;
+  }
+  IndexBlockIter iter;
+  NewIndexIterator(raw_ucmp, kDisableGlobalSequenceNumber, &iter,
+                   nullptr /* stats */, true /* total_order_seek */,
+                   have_first_key, key_includes_seq, value_is_full);
+  std::unique_ptr<DecodedIndex> decoded_index(new DecodedIndex(
+      raw_ucmp, have_first_key, key_includes_seq, value_is_full));
+  uint32_t entry_offset = 0;
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    IndexValue value = iter.value();
+    uint32_t first_key_offset =
+        have_first_key
+            ? static_cast<uint32_t>(value.first_internal_key.data() - data_)
+            : 0;
+    decoded_index->Add(entry_offset, iter.key(), value, first_key_offset);
+    entry_offset = iter.NextEntryOffset();
+  }
+  if (!iter.status().ok()) {
+    // Iterators report the corruption when parsing the block
+    return;
+  }
+  decoded_index->Finish(entry_offset);
+  decoded_index_ = std::move(decoded_index);
+}
+
+void DecodedIndex::Add(uint32_t entry_offset, const Slice& key,
+                       const IndexValue& value, uint32_t first_key_offset) {
+  if (key_offsets_.empty()) {
+    key_offsets_.push_back(0);
+  }
+  if (use_key_prefixes_) {
+    key_prefixes_.push_back(
+        KeyPrefix(key_includes_seq_ ? ExtractUserKey(key) : key));
+  }
+  keys_.append(key.data(), key.size());
+  key_offsets_.push_back(static_cast<uint32_t>(keys_.size()));
+  handles_.push_back(value.handle);
+  if (have_first_key_) {
+    first_keys_.emplace_back(
+        first_key_offset,
+        static_cast<uint32_t>(value.first_internal_key.size()));
+  }
+  entry_offsets_.push_back(entry_offset);
+}
+
+void DecodedIndex::Finish(uint32_t end_offset) {
+  if (key_offsets_.empty()) {
+    key_offsets_.push_back(0);
+  }
+  entry_offsets_.push_back(end_offset);
+  key_prefixes_.shrink_to_fit();
+  keys_.shrink_to_fit();
+  key_offsets_.shrink_to_fit();
+  handles_.shrink_to_fit();
+  first_keys_.shrink_to_fit();
+  entry_offsets_.shrink_to_fit();
+}
+
+size_t DecodedIndex::ApproximateMemoryUsage() const {
+  return sizeof(*this) + key_prefixes_.capacity() * sizeof(uint64_t) +
+         keys_.capacity() + key_offsets_.capacity() * sizeof(uint32_t) +
+         handles_.capacity() * sizeof(BlockHandle) +
+         first_keys_.capacity() * sizeof(std::pair<uint32_t, uint32_t>) +
+         entry_offsets_.capacity() * sizeof(uint32_t);
+}
+
 }  // namespace ROCKSDB_NAMESPACE
@@ -10,12 +10,15 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "db/dbformat.h"
 #include "db/pinned_iterators_manager.h"
 #include "port/malloc.h"
+#include "rocksdb/comparator.h"
 #include "rocksdb/iterator.h"
 #include "rocksdb/options.h"
 #include "rocksdb/statistics.h"
@@ -136,6 +139,86 @@ class BlockReadAmpBitmap {
   uint32_t rnd_;
 };
 
+// The entries of an index block decoded into arrays, built by
+// Block::DecodeIndex(). An IndexBlockIter over a decoded block binary searches
+// the full keys, and for the bytewise comparator, fixed-width prefixes of the
+// user keys first, and reads the block handles from an array, instead of
+// parsing the delta encoded keys and values of the block.
+class DecodedIndex {
+ public:
+  DecodedIndex(const Comparator* raw_ucmp, bool have_first_key,
+               bool key_includes_seq, bool value_is_full)
+      : raw_ucmp_(raw_ucmp),
+        have_first_key_(have_first_key),
+        key_includes_seq_(key_includes_seq),
+        value_is_full_(value_is_full),
+        use_key_prefixes_(raw_ucmp == BytewiseComparator()) {}
+
+  // Whether the index was decoded for iterators with these parameters
+  bool Matches(const Comparator* raw_ucmp, bool have_first_key,
+               bool key_includes_seq, bool value_is_full) const {
+    return raw_ucmp == raw_ucmp_ && have_first_key == have_first_key_ &&
+           key_includes_seq == key_includes_seq_ &&
+           value_is_full == value_is_full_;
+  }
+
+  // Appends the entry at entry_offset in the block. first_key_offset is the
+  // offset of value.first_internal_key in the block, if the index has first
+  // keys.
+  void Add(uint32_t entry_offset, const Slice& key, const IndexValue& value,
+           uint32_t first_key_offset);
+  // Called after the last Add(), with the offset just past the last entry.
+  void Finish(uint32_t end_offset);
+
+  uint32_t size() const { return static_cast<uint32_t>(handles_.size()); }
+
+  bool use_key_prefixes() const { return use_key_prefixes_; }
+
+  // The first 8 bytes of a user key as a big endian integer, zero padded, so
+  // that the order of the prefixes of two keys is their bytewise order unless
+  // they are equal.
+  static uint64_t KeyPrefix(const Slice& user_key) {
+    uint64_t prefix = 0;
+    size_t n = std::min(user_key.size(), sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+      prefix |= static_cast<uint64_t>(static_cast<unsigned char>(user_key[i]))
+                << (56 - 8 * i);
+    }
+    return prefix;
+  }
+
+  uint64_t key_prefix(uint32_t i) const { return key_prefixes_[i]; }
+  Slice key(uint32_t i) const {
+    return Slice(keys_.data() + key_offsets_[i],
+                 key_offsets_[i + 1] - key_offsets_[i]);
+  }
+  const BlockHandle& handle(uint32_t i) const { return handles_[i]; }
+  // The first internal key of the i-th entry, as an offset and size in the
+  // block. Only set if the index has first keys.
+  uint32_t first_key_offset(uint32_t i) const { return first_keys_[i].first; }
+  uint32_t first_key_size(uint32_t i) const { return first_keys_[i].second; }
+  // Offset of the i-th entry in the block, or for i == size(), the offset
+  // just past the last entry
+  uint32_t entry_offset(uint32_t i) const { return entry_offsets_[i]; }
+
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  const Comparator* raw_ucmp_;
+  const bool have_first_key_;
+  const bool key_includes_seq_;
+  const bool value_is_full_;
+  const bool use_key_prefixes_;
+
+  std::vector<uint64_t> key_prefixes_;
+  // The keys of the entries, in key_offsets_[i]..key_offsets_[i + 1] of keys_
+  std::string keys_;
+  std::vector<uint32_t> key_offsets_;
+  std::vector<BlockHandle> handles_;
+  std::vector<std::pair<uint32_t, uint32_t>> first_keys_;
+  std::vector<uint32_t> entry_offsets_;
+};
+
 // This Block class is not for any old block: it is designed to hold only
 // uncompressed blocks containing sorted key-value pairs. It is thus
 // suitable for storing uncompressed data blocks, index blocks (including
@@ -216,6 +299,16 @@ class Block {
                                    bool block_contents_pinned = false,
                                    BlockPrefixIndex* prefix_index = nullptr);
 
+  // Decodes the entries of an index block into a DecodedIndex, which index
+  // iterators created with the same parameters then search. The memory of
+  // the DecodedIndex is included in ApproximateMemoryUsage(), so it must be
+  // called before the block is charged to a cache. Does nothing if the block
+  // is empty or corrupted.
+  void DecodeIndex(const Comparator* raw_ucmp, bool have_first_key,
+                   bool key_includes_seq, bool value_is_full);
+
+  bool HasDecodedIndex() const { return decoded_index_ != nullptr; }
+
   // Report an approximation of how much memory has been used.
   size_t ApproximateMemoryUsage() const;
 
@@ -227,6 +320,7 @@ class Block {
   uint32_t num_restarts_;
   std::unique_ptr<BlockReadAmpBitmap> read_amp_bitmap_;
   DataBlockHashIndex data_block_hash_index_;
+  std::unique_ptr<DecodedIndex> decoded_index_;
 };
 
 // A `BlockIter` iterates over the entries in a `Block`'s data buffer. The
@@ -593,7 +687,8 @@ class DataBlockIter final : public BlockIter<Slice> {
 
 class IndexBlockIter final : public BlockIter<IndexValue> {
  public:
-  IndexBlockIter() : BlockIter(), prefix_index_(nullptr) {}
+  IndexBlockIter()
+      : BlockIter(), prefix_index_(nullptr), decoded_index_(nullptr) {}
 
   // key_includes_seq, default true, means that the keys are in internal key
   // format.
@@ -603,7 +698,8 @@ class IndexBlockIter final : public BlockIter<IndexValue> {
                   uint32_t restarts, uint32_t num_restarts,
                   SequenceNumber global_seqno, BlockPrefixIndex* prefix_index,
                   bool have_first_key, bool key_includes_seq,
-                  bool value_is_full, bool block_contents_pinned) {
+                  bool value_is_full, bool block_contents_pinned,
+                  const DecodedIndex* decoded_index = nullptr) {
     InitializeBase(raw_ucmp, data, restarts, num_restarts,
                    kDisableGlobalSequenceNumber, block_contents_pinned);
     raw_key_.SetIsUserKey(!key_includes_seq);
@@ -615,6 +711,8 @@ class IndexBlockIter final : public BlockIter<IndexValue> {
     } else {
       global_seqno_state_.reset();
     }
+    // The decoded first keys don't have the global seqno
+    decoded_index_ = global_seqno_state_ == nullptr ? decoded_index : nullptr;
   }
 
   Slice user_key() const override {
@@ -624,7 +722,8 @@ class IndexBlockIter final : public BlockIter<IndexValue> {
 
   IndexValue value() const override {
     assert(Valid());
-    if (value_delta_encoded_ || global_seqno_state_ != nullptr) {
+    if (value_delta_encoded_ || global_seqno_state_ != nullptr ||
+        decoded_index_ != nullptr) {
       return decoded_value_;
     } else {
       IndexValue entry;
@@ -636,7 +735,10 @@ class IndexBlockIter final : public BlockIter<IndexValue> {
     }
   }
 
-  void Invalidate(Status s) { InvalidateBase(s); }
+  void Invalidate(Status s) {
+    InvalidateBase(s);
+    decoded_index_ = nullptr;
+  }
 
   bool IsValuePinned() const override {
     return global_seqno_state_ != nullptr ? false : BlockIter::IsValuePinned();
@@ -698,6 +800,19 @@ class IndexBlockIter final : public BlockIter<IndexValue> {
 
   std::unique_ptr<GlobalSeqnoState> global_seqno_state_;
 
+  // If not nullptr, the iterator moves over the entries of the decoded index
+  // instead of parsing the block, and decoded_pos_ is the current entry.
+  const DecodedIndex* decoded_index_;
+  uint32_t decoded_pos_ = 0;
+
+  // Positions the iterator at the i-th entry of decoded_index_, or makes it
+  // invalid if there is no such entry.
+  void SetDecodedPosition(uint32_t i);
+  // Binary searches decoded_index_ for the first entry at or after target.
+  void DecodedSeek(const Slice& target);
+  inline int CompareDecodedKey(uint32_t i, uint64_t target_prefix,
+                               const Slice& target);
+
   // Set *prefix_may_exist to false if no key possibly share the same prefix
   // as `target`. If not set, the result position should be the same as total
   // order Seek.
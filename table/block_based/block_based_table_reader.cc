@@ -90,6 +90,12 @@ class BlocklikeTraits<BlockContents> {
   static uint32_t GetNumRestarts(const BlockContents& /* contents */) {
     return 0;
   }
+
+  static Slice GetData(const BlockContents& contents) { return contents.data; }
+
+  static void PrepareForCache(BlockContents* /* contents */,
+                              BlockType /* block_type */,
+                              const BlockBasedTable::Rep& /* rep */) {}
 };
 
 template <>
@@ -106,6 +112,14 @@ class BlocklikeTraits<ParsedFullFilterBlock> {
   static uint32_t GetNumRestarts(const ParsedFullFilterBlock& /* block */) {
     return 0;
   }
+
+  static Slice GetData(const ParsedFullFilterBlock& block) {
+    return block.GetBlockContentsData();
+  }
+
+  static void PrepareForCache(ParsedFullFilterBlock* /* block */,
+                              BlockType /* block_type */,
+                              const BlockBasedTable::Rep& /* rep */) {}
 };
 
 template <>
@@ -120,6 +134,28 @@ class BlocklikeTraits<Block> {
   static uint32_t GetNumRestarts(const Block& block) {
     return block.NumRestarts();
   }
+
+  static Slice GetData(const Block& block) {
+    return Slice(block.data(), block.size());
+  }
+
+  // Decodes index blocks, and the top level index of partitioned filters,
+  // before they are charged to the block cache.
+  static void PrepareForCache(Block* block, BlockType block_type,
+                              const BlockBasedTable::Rep& rep) {
+    if (!rep.table_options.decode_index_blocks) {
+      return;
+    }
+    if (block_type == BlockType::kIndex) {
+      block->DecodeIndex(rep.internal_comparator.user_comparator(),
+                         rep.index_has_first_key, rep.index_key_includes_seq,
+                         rep.index_value_is_full);
+    } else if (block_type == BlockType::kFilter) {
+      block->DecodeIndex(rep.internal_comparator.user_comparator(),
+                         false /* have_first_key */,
+                         rep.index_key_includes_seq, rep.index_value_is_full);
+    }
+  }
 };
 
 template <>
@@ -137,6 +173,14 @@ class BlocklikeTraits<UncompressionDict> {
   static uint32_t GetNumRestarts(const UncompressionDict& /* dict */) {
     return 0;
   }
+
+  static Slice GetData(const UncompressionDict& dict) {
+    return dict.GetRawDict();
+  }
+
+  static void PrepareForCache(UncompressionDict* /* dict */,
+                              BlockType /* block_type */,
+                              const BlockBasedTable::Rep& /* rep */) {}
 };
 
 namespace {
@@ -180,6 +224,42 @@ void DeleteCachedEntry(const Slice& /*key*/, void* value) {
   delete entry;
 }
 
+// Callbacks that let the block cache save an entry to its secondary cache.
+// An entry is saved as its uncompressed block contents.
+template <typename TBlocklike>
+size_t SizeOfCachedEntry(void* obj) {
+  return BlocklikeTraits<TBlocklike>::GetData(*static_cast<TBlocklike*>(obj))
+      .size();
+}
+
+template <typename TBlocklike>
+Status SaveCachedEntryTo(void* from_obj, size_t from_offset, size_t length,
+                         void* out) {
+  Slice data =
+      BlocklikeTraits<TBlocklike>::GetData(*static_cast<TBlocklike*>(from_obj));
+  assert(from_offset + length <= data.size());
+  memcpy(out, data.data() + from_offset, length);
+  return Status::OK();
+}
+
+template <typename TBlocklike>
+const Cache::CacheItemHelper* GetCacheItemHelper() {
+  static const Cache::CacheItemHelper helper(&SizeOfCachedEntry<TBlocklike>,
+                                             &SaveCachedEntryTo<TBlocklike>,
+                                             &DeleteCachedEntry<TBlocklike>);
+  return &helper;
+}
+
+Cache::Priority GetCachePriority(const BlockBasedTableOptions& table_options,
+                                 BlockType block_type) {
+  return table_options.cache_index_and_filter_blocks_with_high_priority &&
+                 (block_type == BlockType::kFilter ||
+                  block_type == BlockType::kCompressionDictionary ||
+                  block_type == BlockType::kIndex)
+             ? Cache::Priority::HIGH
+             : Cache::Priority::LOW;
+}
+
 // Release the cached entry and decrement its ref count.
 // Do not force erase
 void ReleaseCachedEntry(void* arg, void* h) {
@@ -424,8 +504,11 @@ void BlockBasedTable::UpdateCacheInsertionMetrics(BlockType block_type,
 
 Cache::Handle* BlockBasedTable::GetEntryFromCache(
     Cache* block_cache, const Slice& key, BlockType block_type,
-    GetContext* get_context) const {
-  auto cache_handle = block_cache->Lookup(key, rep_->ioptions.statistics);
+    GetContext* get_context, const Cache::CacheItemHelper* cache_helper,
+    const Cache::CreateCallback& create_cb, Cache::Priority priority) const {
+  auto cache_handle =
+      block_cache->Lookup(key, cache_helper, create_cb, priority,
+                          true /* wait */, rep_->ioptions.statistics);
 
   if (cache_handle != nullptr) {
     UpdateCacheHitMetrics(block_type, get_context,
@@ -1183,10 +1266,33 @@ Status BlockBasedTable::GetDataBlockFromCache(
   BlockContents* compressed_block = nullptr;
   Cache::Handle* block_cache_compressed_handle = nullptr;
 
+  const Cache::CacheItemHelper* cache_helper = GetCacheItemHelper<TBlocklike>();
+
   // Lookup uncompressed cache first
   if (block_cache != nullptr) {
-    auto cache_handle = GetEntryFromCache(block_cache, block_cache_key,
-                                          block_type, get_context);
+    // Rebuilds an entry saved by SaveCachedEntryTo() from a secondary cache.
+    // The captures fit in the small object buffer of std::function.
+    Cache::CreateCallback create_cb = [this, block_type](void* buf, size_t size,
+                                                         void** out_obj,
+                                                         size_t* charge) {
+      CacheAllocationPtr allocation =
+          AllocateBlock(size, GetMemoryAllocator(rep_->table_options));
+      memcpy(allocation.get(), buf, size);
+      TBlocklike* obj = BlocklikeTraits<TBlocklike>::Create(
+          BlockContents(std::move(allocation), size),
+          block_type == BlockType::kData
+              ? rep_->table_options.read_amp_bytes_per_bit
+              : 0,
+          rep_->ioptions.statistics, rep_->blocks_definitely_zstd_compressed,
+          rep_->table_options.filter_policy.get());
+      BlocklikeTraits<TBlocklike>::PrepareForCache(obj, block_type, *rep_);
+      *out_obj = obj;
+      *charge = obj->ApproximateMemoryUsage();
+      return Status::OK();
+    };
+    auto cache_handle = GetEntryFromCache(
+        block_cache, block_cache_key, block_type, get_context, cache_helper,
+        create_cb, GetCachePriority(rep_->table_options, block_type));
     if (cache_handle != nullptr) {
       block->SetCachedValue(
           reinterpret_cast<TBlocklike*>(block_cache->Value(cache_handle)),
@@ -1241,10 +1347,12 @@ Status BlockBasedTable::GetDataBlockFromCache(
 
     if (block_cache != nullptr && block_holder->own_bytes() &&
         read_options.fill_cache) {
+      BlocklikeTraits<TBlocklike>::PrepareForCache(block_holder.get(),
+                                                   block_type, *rep_);
       size_t charge = block_holder->ApproximateMemoryUsage();
       Cache::Handle* cache_handle = nullptr;
-      s = block_cache->Insert(block_cache_key, block_holder.get(), charge,
-                              &DeleteCachedEntry<TBlocklike>, &cache_handle);
+      s = block_cache->Insert(block_cache_key, block_holder.get(),
+                              cache_helper, charge, &cache_handle);
       if (s.ok()) {
         assert(cache_handle != nullptr);
         block->SetCachedValue(block_holder.release(), block_cache,
@@ -1281,12 +1389,7 @@ Status BlockBasedTable::PutDataBlockToCache(
           ? rep_->table_options.read_amp_bytes_per_bit
           : 0;
   const Cache::Priority priority =
-      rep_->table_options.cache_index_and_filter_blocks_with_high_priority &&
-              (block_type == BlockType::kFilter ||
-               block_type == BlockType::kCompressionDictionary ||
-               block_type == BlockType::kIndex)
-          ? Cache::Priority::HIGH
-          : Cache::Priority::LOW;
+      GetCachePriority(rep_->table_options, block_type);
   assert(cached_block);
   assert(cached_block->IsEmpty());
 
@@ -1346,11 +1449,13 @@ Status BlockBasedTable::PutDataBlockToCache(
 
   // insert into uncompressed block cache
   if (block_cache != nullptr && block_holder->own_bytes()) {
+    BlocklikeTraits<TBlocklike>::PrepareForCache(block_holder.get(),
+                                                 block_type, *rep_);
     size_t charge = block_holder->ApproximateMemoryUsage();
     Cache::Handle* cache_handle = nullptr;
-    s = block_cache->Insert(block_cache_key, block_holder.get(), charge,
-                            &DeleteCachedEntry<TBlocklike>, &cache_handle,
-                            priority);
+    s = block_cache->Insert(block_cache_key, block_holder.get(),
+                            GetCacheItemHelper<TBlocklike>(), charge,
+                            &cache_handle, priority);
     if (s.ok()) {
       assert(cache_handle != nullptr);
       cached_block->SetCachedValue(block_holder.release(), block_cache,
@@ -268,9 +268,14 @@ class BlockBasedTable : public TableReader {
   void UpdateCacheInsertionMetrics(BlockType block_type,
                                    GetContext* get_context, size_t usage,
                                    bool redundant) const;
+  // On a miss, the block cache may rebuild the entry from its secondary
+  // cache with create_cb.
   Cache::Handle* GetEntryFromCache(Cache* block_cache, const Slice& key,
                                    BlockType block_type,
-                                   GetContext* get_context) const;
+                                   GetContext* get_context,
+                                   const Cache::CacheItemHelper* cache_helper,
+                                   const Cache::CreateCallback& create_cb,
+                                   Cache::Priority priority) const;
 
   // Either Block::NewDataIterator() or Block::NewIndexIterator().
   template <typename TBlockIter>
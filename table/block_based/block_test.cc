@@ -609,6 +609,126 @@ TEST_P(IndexBlockTest, IndexValueEncodingTest) {
   delete iter;
 }
 
+TEST_P(IndexBlockTest, DecodedIndexTest) {
+  Random rnd(301);
+  Options options = Options();
+
+  std::vector<std::string> separators;
+  std::vector<BlockHandle> block_handles;
+  std::vector<std::string> first_keys;
+  BlockBuilder builder(16, true /* use_delta_encoding */,
+                       useValueDeltaEncoding());
+  int num_records = 100;
+
+  GenerateRandomIndexEntries(&separators, &block_handles, &first_keys,
+                             num_records);
+  BlockHandle last_encoded_handle;
+  for (int i = 0; i < num_records; i++) {
+    IndexValue entry(block_handles[i], first_keys[i]);
+    std::string encoded_entry;
+    std::string delta_encoded_entry;
+    entry.EncodeTo(&encoded_entry, includeFirstKey(), nullptr);
+    if (useValueDeltaEncoding() && i > 0) {
+      entry.EncodeTo(&delta_encoded_entry, includeFirstKey(),
+                     &last_encoded_handle);
+    }
+    last_encoded_handle = entry.handle;
+    const Slice delta_encoded_entry_slice(delta_encoded_entry);
+    builder.Add(separators[i], encoded_entry, &delta_encoded_entry_slice);
+  }
+  Slice rawblock = builder.Finish();
+
+  BlockContents contents;
+  contents.data = rawblock;
+  // On the heap, as ApproximateMemoryUsage() measures the allocation
+  std::unique_ptr<Block> reader(new Block(std::move(contents)));
+  BlockContents decoded_contents;
+  decoded_contents.data = rawblock;
+  std::unique_ptr<Block> decoded_reader(
+      new Block(std::move(decoded_contents)));
+
+  const bool kTotalOrderSeek = true;
+  const bool kIncludesSeq = true;
+  const bool kValueIsFull = !useValueDeltaEncoding();
+  Statistics *kNullStats = nullptr;
+  decoded_reader->DecodeIndex(options.comparator, includeFirstKey(),
+                              kIncludesSeq, kValueIsFull);
+  ASSERT_TRUE(decoded_reader->HasDecodedIndex());
+  ASSERT_GT(decoded_reader->ApproximateMemoryUsage(),
+            reader->ApproximateMemoryUsage());
+
+  IndexBlockIter iter;
+  IndexBlockIter decoded_iter;
+  reader->NewIndexIterator(options.comparator, kDisableGlobalSequenceNumber,
+                           &iter, kNullStats, kTotalOrderSeek,
+                           includeFirstKey(), kIncludesSeq, kValueIsFull);
+  decoded_reader->NewIndexIterator(
+      options.comparator, kDisableGlobalSequenceNumber, &decoded_iter,
+      kNullStats, kTotalOrderSeek, includeFirstKey(), kIncludesSeq,
+      kValueIsFull, true /* block_contents_pinned */);
+  auto check_same = [&]() {
+    ASSERT_EQ(iter.Valid(), decoded_iter.Valid());
+    if (!iter.Valid()) {
+      return;
+    }
+    ASSERT_EQ(iter.key(), decoded_iter.key());
+    // The decoded keys live as long as the block
+    ASSERT_TRUE(decoded_iter.IsKeyPinned());
+    IndexValue v = iter.value();
+    IndexValue decoded_v = decoded_iter.value();
+    ASSERT_EQ(v.handle.offset(), decoded_v.handle.offset());
+    ASSERT_EQ(v.handle.size(), decoded_v.handle.size());
+    ASSERT_EQ(v.first_internal_key, decoded_v.first_internal_key);
+  };
+
+  // Both directions
+  iter.SeekToFirst();
+  decoded_iter.SeekToFirst();
+  for (int i = 0; i <= num_records; i++) {
+    check_same();
+    iter.Next();
+    decoded_iter.Next();
+  }
+  iter.SeekToLast();
+  decoded_iter.SeekToLast();
+  for (int i = 0; i <= num_records; i++) {
+    check_same();
+    if (iter.Valid()) {
+      iter.Prev();
+      decoded_iter.Prev();
+    }
+  }
+
+  // Existing keys and keys between them, followed by a few Next() and Prev()
+  for (int i = 0; i < num_records * 4; i++) {
+    std::string target = i % 2 == 0 ? separators[rnd.Uniform(num_records)]
+                                     : test::RandomKey(&rnd, 12);
+    iter.Seek(target);
+    decoded_iter.Seek(target);
+    check_same();
+    for (int j = 0; j < 3 && iter.Valid(); j++) {
+      if (i % 4 < 2) {
+        iter.Next();
+        decoded_iter.Next();
+      } else {
+        iter.Prev();
+        decoded_iter.Prev();
+      }
+      check_same();
+    }
+  }
+
+  // An iterator with other parameters parses the block
+  IndexBlockIter other_iter;
+  decoded_reader->NewIndexIterator(
+      ReverseBytewiseComparator(), kDisableGlobalSequenceNumber, &other_iter,
+      kNullStats, kTotalOrderSeek, includeFirstKey(), kIncludesSeq,
+      kValueIsFull);
+  other_iter.SeekToFirst();
+  ASSERT_TRUE(other_iter.Valid());
+  ASSERT_EQ(separators[0], other_iter.key().ToString());
+}
+
 INSTANTIATE_TEST_CASE_P(P, IndexBlockTest,
                         ::testing::Values(std::make_tuple(false, false),
                                           std::make_tuple(false, true),
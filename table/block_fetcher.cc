@@ -101,7 +101,12 @@ inline bool BlockFetcher::TryGetCompressedBlockFromPersistentCache() {
 
 inline void BlockFetcher::PrepareBufferForBlockFromFile() {
   // cache miss read from device
-  if ((do_uncompress_ || ioptions_.allow_mmap_reads) &&
+  if (file_->use_mmap_reads()) {
+    // The file returns slices into its mapping and never writes to scratch,
+    // so no buffer is needed. Unless the block has to be uncompressed,
+    // `GetBlockContents()` then references the mapped bytes in place.
+    used_buf_ = nullptr;
+  } else if ((do_uncompress_ || ioptions_.allow_mmap_reads) &&
       block_size_with_trailer_ < kDefaultStackBufferSize) {
     // If we've got a small enough hunk of data, read it in to the
     // trivially allocated stack buffer instead of needing a full malloc()
@@ -159,6 +164,7 @@ inline void BlockFetcher::CopyBufferToHeapBuf() {
   assert(used_buf_ != heap_buf_.get());
   heap_buf_ = AllocateBlock(block_size_with_trailer_, memory_allocator_);
   memcpy(heap_buf_.get(), used_buf_, block_size_with_trailer_);
+  PERF_COUNTER_ADD(block_read_copy_byte, block_size_with_trailer_);
 #ifndef NDEBUG
   num_heap_buf_memcpy_++;
 #endif
@@ -169,6 +175,7 @@ inline void BlockFetcher::CopyBufferToCompressedBuf() {
   compressed_buf_ = AllocateBlock(block_size_with_trailer_,
                                   memory_allocator_compressed_);
   memcpy(compressed_buf_.get(), used_buf_, block_size_with_trailer_);
+  PERF_COUNTER_ADD(block_read_copy_byte, block_size_with_trailer_);
 #ifndef NDEBUG
   num_compressed_buf_memcpy_++;
 #endif
@@ -277,6 +284,9 @@ Status BlockFetcher::ReadBlockContents() {
     }
 
     PERF_COUNTER_ADD(block_read_byte, block_size_with_trailer_);
+    if (used_buf_ != nullptr && slice_.data() == used_buf_) {
+      PERF_COUNTER_ADD(block_read_copy_byte, slice_.size());
+    }
     if (!status_.ok()) {
       return status_;
     }
@@ -307,6 +317,7 @@ Status BlockFetcher::ReadBlockContents() {
     status_ = UncompressBlockContents(info, slice_.data(), block_size_,
                                       contents_, footer_.version(), ioptions_,
                                       memory_allocator_);
+    PERF_COUNTER_ADD(block_read_copy_byte, contents_->data.size());
 #ifndef NDEBUG
     num_heap_buf_memcpy_++;
 #endif
@@ -87,8 +87,10 @@ class BlockFetcherTest : public testing::Test {
   }
 
   // Creates a table with kv pairs (i, i) where i ranges from 0 to 9, inclusive.
+  // Each value is padded with value_padding extra bytes.
   void CreateTable(const std::string& table_name,
-                   const CompressionType& compression_type) {
+                   const CompressionType& compression_type,
+                   size_t value_padding = 0) {
     std::unique_ptr<WritableFileWriter> writer;
     NewFileWriter(table_name, &writer);
 
@@ -110,6 +112,7 @@ class BlockFetcherTest : public testing::Test {
       std::string key = ToInternalKey(std::to_string(i));
       // Append "00000000" to string value to enhance compression ratio
       std::string value = "00000000" + std::to_string(i);
+      value.append(value_padding, '0');
       table_builder->Add(key, value);
     }
     ASSERT_OK(table_builder->Finish());
@@ -149,7 +152,8 @@ class BlockFetcherTest : public testing::Test {
   // Bufferr allocation and memory copy statistics are expected.
   void TestFetchDataBlock(
       const std::string& table_name_prefix, bool compressed, bool do_uncompress,
-      std::array<TestStats, NumModes> expected_stats_by_mode) {
+      std::array<TestStats, NumModes> expected_stats_by_mode,
+      size_t value_padding = 0) {
     for (CompressionType compression_type : GetSupportedCompressions()) {
       bool do_compress = compression_type != kNoCompression;
       if (compressed != do_compress) continue;
@@ -157,7 +161,7 @@ class BlockFetcherTest : public testing::Test {
           CompressionTypeToString(compression_type);
 
       std::string table_name = table_name_prefix + compression_type_str;
-      CreateTable(table_name, compression_type);
+      CreateTable(table_name, compression_type, value_padding);
 
       CompressionType expected_compression_type_after_fetch =
           (compressed && !do_uncompress) ? compression_type : kNoCompression;
@@ -446,6 +450,42 @@ TEST_F(BlockFetcherTest, FetchUncompressedDataBlock) {
                      expected_stats_by_mode);
 }
 
+// Data blocks are not compressed and larger than the stack buffer,
+// fetch data block under direct IO, mmap IO, and non-direct IO.
+// Expects:
+// 1. in non-direct IO mode, allocate a heap buffer and read the block into it;
+// 2. in mmap IO mode, allocate nothing and reference the mapped block;
+// 3. in direct IO mode, allocate a heap buffer and memcpy from the
+//    direct IO buffer to the heap buffer.
+TEST_F(BlockFetcherTest, FetchLargeUncompressedDataBlock) {
+  TestStats expected_non_mmap_stats = {
+      {
+          0 /* num_stack_buf_memcpy */,
+          1 /* num_heap_buf_memcpy */,
+          0 /* num_compressed_buf_memcpy */,
+      },
+      {
+          1 /* num_heap_buf_allocations */,
+          0 /* num_compressed_buf_allocations */,
+      }};
+  TestStats expected_mmap_stats = {{
+                                       0 /* num_stack_buf_memcpy */,
+                                       0 /* num_heap_buf_memcpy */,
+                                       0 /* num_compressed_buf_memcpy */,
+                                   },
+                                   {
+                                       0 /* num_heap_buf_allocations */,
+                                       0 /* num_compressed_buf_allocations */,
+                                   }};
+  std::array<TestStats, NumModes> expected_stats_by_mode{{
+      expected_non_mmap_stats /* kBufferedRead */,
+      expected_mmap_stats /* kBufferedMmap */,
+      expected_non_mmap_stats /* kDirectRead */,
+  }};
+  TestFetchDataBlock("FetchLargeUncompressedDataBlock", false, false,
+                     expected_stats_by_mode, 8000 /* value_padding */);
+}
+
 // Data blocks are compressed,
 // fetch data block under both direct IO and non-direct IO,
 // but do not uncompress.
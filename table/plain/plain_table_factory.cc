@@ -203,6 +203,26 @@ Status GetMemTableRepFactoryFromString(
     } else if (1 == len) {
       mem_factory = new VectorRepFactory();
     }
+  } else if (opts_list[0] == "partitioned_skip_list" ||
+             opts_list[0] == "PartitionedSkipListRepFactory") {
+    // Expecting format
+    // partitioned_skip_list:<num_partitions>
+    if (2 == len) {
+      size_t num_partitions = ParseSizeT(opts_list[1]);
+      mem_factory = NewPartitionedSkipListRepFactory(num_partitions);
+    } else if (1 == len) {
+      mem_factory = NewPartitionedSkipListRepFactory();
+    }
+  } else if (opts_list[0] == "hash_vector" ||
+             opts_list[0] == "HashVectorRepFactory") {
+    // Expecting format
+    // hash_vector:<hash_bucket_count>
+    if (2 == len) {
+      size_t hash_bucket_count = ParseSizeT(opts_list[1]);
+      mem_factory = NewHashVectorRepFactory(hash_bucket_count);
+    } else if (1 == len) {
+      mem_factory = NewHashVectorRepFactory();
+    }
   } else if (opts_list[0] == "cuckoo") {
     return Status::NotSupported(
         "cuckoo hash memtable is not supported anymore.");
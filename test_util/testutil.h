@@ -188,7 +188,8 @@ class StringSink : public FSWritableFile {
       : FSWritableFile(),
         contents_(""),
         reader_contents_(reader_contents),
-        last_flush_(0) {
+        last_flush_(0),
+        reserved_(0) {
     if (reader_contents_ != nullptr) {
       *reader_contents_ = Slice(contents_.data(), 0);
     }
@@ -226,6 +227,20 @@ class StringSink : public FSWritableFile {
     contents_.append(slice.data(), slice.size());
     return IOStatus::OK();
   }
+  IOStatus ReserveAppend(size_t n, char** buf, const IOOptions& /*opts*/,
+                         IODebugContext* /*dbg*/) override {
+    reserved_ = n;
+    contents_.resize(contents_.size() + n);
+    *buf = &contents_[contents_.size() - n];
+    return IOStatus::OK();
+  }
+  IOStatus CommitReserved(size_t n, const IOOptions& /*opts*/,
+                          IODebugContext* /*dbg*/) override {
+    assert(n == reserved_);
+    (void)n;
+    reserved_ = 0;
+    return IOStatus::OK();
+  }
   void Drop(size_t bytes) {
     if (reader_contents_ != nullptr) {
       contents_.resize(contents_.size() - bytes);
@@ -238,6 +253,7 @@ class StringSink : public FSWritableFile {
  private:
   Slice* reader_contents_;
   size_t last_flush_;
+  size_t reserved_;
 };
 
 // A wrapper around a StringSink to give it a RandomRWFile interface
@@ -51,6 +51,7 @@
 #include "rocksdb/perf_context.h"
 #include "rocksdb/persistent_cache.h"
 #include "rocksdb/rate_limiter.h"
+#include "rocksdb/secondary_cache.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/stats_history.h"
@@ -199,7 +200,13 @@ DEFINE_string(
     "\trandomreplacekeys     -- randomly replaces N keys by deleting "
     "the old version and putting the new version\n\n"
     "\ttimeseries            -- 1 writer generates time series data "
-    "and multiple readers doing random reads on id\n\n"
+    "and multiple readers doing random reads on id\n"
+    "\tpmwalsync             -- write N values in random key order with sync, "
+    "then report the p50/p99/p99.9 write latency and whether each WAL file "
+    "is on real pmem\n"
+    "\tpmreadrandom          -- read N times in random order, then report "
+    "the block bytes read and copied and the value bytes copied per Get, and "
+    "whether each table file is on real pmem\n\n"
     "Meta operations:\n"
     "\tcompact     -- Compact the entire DB; If multiple, randomly choose one\n"
     "\tcompactall  -- Compact the entire DB\n"
@@ -209,6 +216,10 @@ DEFINE_string(
     "\twaitforcompaction - pause until compaction is (probably) done\n"
 #endif
     "\tflush - flush the memtable\n"
+#ifndef ROCKSDB_LITE
+    "\tpmrecovery  -- reopen the DB and report the time taken to recover "
+    "its WAL files\n"
+#endif
     "\tstats       -- Print DB stats\n"
     "\tresetstats  -- Reset DB stats\n"
     "\tlevelstats  -- Print the number of files and bytes per level\n"
@@ -342,6 +353,16 @@ DEFINE_int64(db_write_buffer_size,
 DEFINE_bool(cost_write_buffer_to_cache, false,
             "The usage of memtable is costed to the block cache");
 
+DEFINE_string(write_buffer_flush_policy, "",
+              "The memtable to flush when --db_write_buffer_size is full, "
+              "among the memtables of all the DBs of --num_multi_db: oldest, "
+              "largest, tombstone_density or least_l0_overlap. When empty, "
+              "each DB flushes its own oldest memtable.");
+
+DEFINE_bool(write_buffer_manager_allow_stall, false,
+            "Stall the writes to the DBs using more than their share of "
+            "--db_write_buffer_size while it is full");
+
 DEFINE_int64(arena_block_size, ROCKSDB_NAMESPACE::Options().arena_block_size,
              "The size, in bytes, of one block in arena memory allocation.");
 
@@ -474,6 +495,35 @@ DEFINE_double(cache_high_pri_pool_ratio, 0.0,
 DEFINE_bool(use_clock_cache, false,
             "Replace default LRU block cache with clock cache.");
 
+DEFINE_int64(secondary_cache_size, 0,
+             "Number of bytes of the secondary cache below the LRU block "
+             "cache. 0 disables the secondary cache.");
+
+DEFINE_string(secondary_cache_type, "compressed",
+              "Type of the secondary cache: \"compressed\" keeps the blocks "
+              "compressed in memory, \"file\" keeps them in files under "
+              "--secondary_cache_path.");
+
+DEFINE_string(secondary_cache_path, "",
+              "Directory of the files of the \"file\" secondary cache.");
+
+DEFINE_bool(cache_admission_filter, false,
+            "Only let an insertion into a full LRU block cache evict entries "
+            "if the new entry was looked up more often than them recently.");
+
+DEFINE_bool(cache_adaptive_shard_capacity, false,
+            "Move LRU block cache capacity towards the shards that miss the "
+            "most lookups.");
+
+DEFINE_bool(cache_shard_bits_from_cores, false,
+            "If --cache_numshardbits is negative, derive the number of LRU "
+            "block cache shards from the number of cores.");
+
+DEFINE_bool(cache_shard_stats, false,
+            "Count the hits, misses and lock waits of every LRU block cache "
+            "shard, and print them with the capacity and usage of the shards "
+            "at the end of the benchmarks.");
+
 DEFINE_int64(simcache_size, -1,
              "Number of bytes to use as a simcache of "
              "uncompressed data. Nagative value disables simcache.");
@@ -491,6 +541,11 @@ DEFINE_bool(partition_index, false, "Partition index blocks");
 
 DEFINE_bool(index_with_first_key, false, "Include first key in the index");
 
+DEFINE_bool(decode_index_blocks,
+            ROCKSDB_NAMESPACE::BlockBasedTableOptions().decode_index_blocks,
+            "Decode index blocks and partitions into arrays when they are "
+            "inserted into the block cache");
+
 DEFINE_bool(
     optimize_filters_for_memory,
     ROCKSDB_NAMESPACE::BlockBasedTableOptions().optimize_filters_for_memory,
@@ -1094,6 +1149,11 @@ DEFINE_uint64(delayed_write_rate, 8388608u,
               "Limited bytes allowed to DB when soft_rate_limit or "
               "level0_slowdown_writes_trigger triggers");
 
+DEFINE_bool(adaptive_write_stall,
+            ROCKSDB_NAMESPACE::Options().adaptive_write_stall,
+            "Set the delayed write rate with a feedback controller instead of "
+            "fixed slowdown ratios");
+
 DEFINE_bool(enable_pipelined_write, true,
             "Allow WAL and memtable writes to be pipelined");
 
@@ -1105,6 +1165,11 @@ DEFINE_bool(
 DEFINE_bool(allow_concurrent_memtable_write, true,
             "Allow multi-writers to update mem tables in parallel.");
 
+DEFINE_int32(batch_insert_threads,
+             ROCKSDB_NAMESPACE::Options().batch_insert_threads,
+             "Maximum number of threads that insert a single large batch into "
+             "the memtables, with --allow_concurrent_memtable_write.");
+
 DEFINE_bool(inplace_update_support,
             ROCKSDB_NAMESPACE::Options().inplace_update_support,
             "Support in-place memtable update for smaller or same-size values");
@@ -1113,6 +1178,11 @@ DEFINE_uint64(inplace_update_num_locks,
               ROCKSDB_NAMESPACE::Options().inplace_update_num_locks,
               "Number of RW locks to protect in-place memtable updates");
 
+DEFINE_uint64(memtable_hot_key_slots,
+              ROCKSDB_NAMESPACE::Options().memtable_hot_key_slots,
+              "Number of slots of the memtable hot key table, which coalesces "
+              "puts of the same key by a write group. 0 disables it.");
+
 DEFINE_bool(enable_write_thread_adaptive_yield, true,
             "Use a yielding spin loop for brief writer thread waits.");
 
@@ -1367,6 +1437,8 @@ enum RepFactory {
   kPrefixHash,
   kVectorRep,
   kHashLinkedList,
+  kPartitionedSkipList,
+  kHashVector,
 };
 
 static enum RepFactory StringToRepFactory(const char* ctype) {
@@ -1380,6 +1452,10 @@ static enum RepFactory StringToRepFactory(const char* ctype) {
     return kVectorRep;
   else if (!strcasecmp(ctype, "hash_linkedlist"))
     return kHashLinkedList;
+  else if (!strcasecmp(ctype, "partitioned_skip_list"))
+    return kPartitionedSkipList;
+  else if (!strcasecmp(ctype, "hash_vector"))
+    return kHashVector;
 
   fprintf(stdout, "Cannot parse memreptable %s\n", ctype);
   return kSkipList;
@@ -1388,6 +1464,9 @@ static enum RepFactory StringToRepFactory(const char* ctype) {
 static enum RepFactory FLAGS_rep_factory;
 DEFINE_string(memtablerep, "skip_list", "");
 DEFINE_int64(hash_bucket_count, 1024 * 1024, "hash bucket count");
+DEFINE_int64(memtable_partitions, 16,
+             "Maximum number of key ranges of a partitioned_skip_list "
+             "memtable");
 DEFINE_bool(use_plain_table, false, "if use plain table "
             "instead of block-based table format");
 DEFINE_bool(use_cuckoo_table, false, "if use cuckoo table format");
@@ -2449,6 +2528,8 @@ class Benchmark {
   bool report_file_operations_;
   bool use_blob_db_;  // Stacked BlobDB
   std::vector<std::string> keys_;
+  // Latency in nanoseconds of the writes of pmwalsync, from all threads
+  HistogramImpl pm_sync_hist_;
 
   class ErrorHandlerListener : public EventListener {
    public:
@@ -2584,6 +2665,12 @@ class Benchmark {
       case kHashLinkedList:
         fprintf(stdout, "Memtablerep: hash_linkedlist\n");
         break;
+      case kPartitionedSkipList:
+        fprintf(stdout, "Memtablerep: partitioned_skip_list\n");
+        break;
+      case kHashVector:
+        fprintf(stdout, "Memtablerep: hash_vector\n");
+        break;
     }
     fprintf(stdout, "Perf Level: %d\n", FLAGS_perf_level);
 
@@ -2748,7 +2835,37 @@ class Benchmark {
     const char* Name() const override { return "KeepFilter"; }
   };
 
-  std::shared_ptr<Cache> NewCache(int64_t capacity) {
+  static std::shared_ptr<SecondaryCache> NewSecondaryCache() {
+    if (FLAGS_secondary_cache_size <= 0) {
+      return nullptr;
+    }
+    if (FLAGS_secondary_cache_type == "compressed") {
+      CompressedSecondaryCacheOptions opts;
+      opts.capacity = static_cast<size_t>(FLAGS_secondary_cache_size);
+      opts.num_shard_bits = FLAGS_cache_numshardbits;
+      return NewCompressedSecondaryCache(opts);
+    } else if (FLAGS_secondary_cache_type == "file") {
+      FileSecondaryCacheOptions opts;
+      opts.path = FLAGS_secondary_cache_path;
+      opts.capacity = static_cast<uint64_t>(FLAGS_secondary_cache_size);
+      opts.fs = FLAGS_env->GetFileSystem();
+      std::shared_ptr<SecondaryCache> secondary_cache;
+      Status s = NewFileSecondaryCache(opts, &secondary_cache);
+      if (!s.ok()) {
+        fprintf(stderr, "Cannot open the file secondary cache: %s\n",
+                s.ToString().c_str());
+        exit(1);
+      }
+      return secondary_cache;
+    }
+    fprintf(stderr, "Unknown secondary cache type: %s\n",
+            FLAGS_secondary_cache_type.c_str());
+    exit(1);
+  }
+
+  // The secondary cache is only set up below the uncompressed block cache
+  std::shared_ptr<Cache> NewCache(int64_t capacity,
+                                  bool with_secondary_cache = false) {
     if (capacity <= 0) {
       return nullptr;
     }
@@ -2761,28 +2878,32 @@ class Benchmark {
       }
       return cache;
     } else {
+      LRUCacheOptions opts(
+          static_cast<size_t>(capacity), FLAGS_cache_numshardbits,
+          false /*strict_capacity_limit*/, FLAGS_cache_high_pri_pool_ratio);
       if (FLAGS_use_cache_memkind_kmem_allocator) {
 #ifdef MEMKIND
-        return NewLRUCache(
-            static_cast<size_t>(capacity), FLAGS_cache_numshardbits,
-            false /*strict_capacity_limit*/, FLAGS_cache_high_pri_pool_ratio,
-            std::make_shared<MemkindKmemAllocator>());
-
+        opts.memory_allocator = std::make_shared<MemkindKmemAllocator>();
 #else
         fprintf(stderr, "Memkind library is not linked with the binary.");
         exit(1);
 #endif
-      } else {
-        return NewLRUCache(
-            static_cast<size_t>(capacity), FLAGS_cache_numshardbits,
-            false /*strict_capacity_limit*/, FLAGS_cache_high_pri_pool_ratio);
       }
+      if (with_secondary_cache) {
+        opts.secondary_cache = NewSecondaryCache();
+      }
+      opts.use_admission_filter = FLAGS_cache_admission_filter;
+      opts.admission_statistics = dbstats;
+      opts.adaptive_shard_capacity = FLAGS_cache_adaptive_shard_capacity;
+      opts.shard_bits_from_cores = FLAGS_cache_shard_bits_from_cores;
+      opts.track_shard_stats = FLAGS_cache_shard_stats;
+      return NewLRUCache(opts);
     }
   }
 
  public:
   Benchmark()
-      : cache_(NewCache(FLAGS_cache_size)),
+      : cache_(NewCache(FLAGS_cache_size, true /* with_secondary_cache */)),
         compressed_cache_(NewCache(FLAGS_compressed_cache_size)),
         filter_policy_(
             FLAGS_use_ribbon_filter
@@ -3302,6 +3423,23 @@ class Benchmark {
         method = &Benchmark::Replay;
       } else if (name == "getmergeoperands") {
         method = &Benchmark::GetMergeOperands;
+      } else if (name == "pmwalsync") {
+        if (FLAGS_disable_wal) {
+          fprintf(stderr, "pmwalsync cannot run with --disable_wal\n");
+          ErrorExit();
+        }
+        fresh_db = true;
+        write_options_.sync = true;
+        pm_sync_hist_.Clear();
+        method = &Benchmark::PMWalSync;
+        post_process_method = &Benchmark::PMWalSyncReport;
+      } else if (name == "pmreadrandom") {
+        method = &Benchmark::PMReadRandom;
+        post_process_method = &Benchmark::PMReadRandomReport;
+#ifndef ROCKSDB_LITE
+      } else if (name == "pmrecovery") {
+        PMRecovery();
+#endif  // ROCKSDB_LITE
       } else if (!name.empty()) {  // No error message for empty name
         fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
         ErrorExit();
@@ -3457,6 +3595,20 @@ class Benchmark {
           stdout, "SIMULATOR CACHE STATISTICS:\n%s\n",
           static_cast_with_check<SimCache>(cache_.get())->ToString().c_str());
     }
+    if (FLAGS_cache_shard_stats && cache_ != nullptr) {
+      std::vector<CacheShardStats> shard_stats;
+      cache_->GetShardStats(&shard_stats);
+      fprintf(stdout, "BLOCK CACHE SHARD STATISTICS:\n");
+      for (size_t s = 0; s < shard_stats.size(); s++) {
+        const CacheShardStats& stats = shard_stats[s];
+        fprintf(stdout,
+                "shard %" ROCKSDB_PRIszt " capacity %" ROCKSDB_PRIszt
+                " usage %" ROCKSDB_PRIszt " hits %" PRIu64 " misses %" PRIu64
+                " lock waits %" PRIu64 "\n",
+                s, stats.capacity, stats.usage, stats.hits, stats.misses,
+                stats.lock_waits);
+      }
+    }
 
 #ifndef ROCKSDB_LITE
     if (FLAGS_use_secondary_db) {
@@ -3748,8 +3900,23 @@ class Benchmark {
     options.env = FLAGS_env;
     options.max_open_files = FLAGS_open_files;
     if (FLAGS_cost_write_buffer_to_cache || FLAGS_db_write_buffer_size != 0) {
-      options.write_buffer_manager.reset(
-          new WriteBufferManager(FLAGS_db_write_buffer_size, cache_));
+      std::shared_ptr<WriteBufferFlushPolicy> flush_policy;
+      if (FLAGS_write_buffer_flush_policy == "oldest") {
+        flush_policy = NewOldestMemTableFlushPolicy();
+      } else if (FLAGS_write_buffer_flush_policy == "largest") {
+        flush_policy = NewLargestMemTableFlushPolicy();
+      } else if (FLAGS_write_buffer_flush_policy == "tombstone_density") {
+        flush_policy = NewTombstoneDensityFlushPolicy();
+      } else if (FLAGS_write_buffer_flush_policy == "least_l0_overlap") {
+        flush_policy = NewLeastLevel0OverlapFlushPolicy();
+      } else if (!FLAGS_write_buffer_flush_policy.empty()) {
+        fprintf(stderr, "Unknown write buffer flush policy %s\n",
+                FLAGS_write_buffer_flush_policy.c_str());
+        exit(1);
+      }
+      options.write_buffer_manager.reset(new WriteBufferManager(
+          FLAGS_db_write_buffer_size, cache_, flush_policy,
+          FLAGS_write_buffer_manager_allow_stall));
     }
     options.arena_block_size = FLAGS_arena_block_size;
     options.write_buffer_size = FLAGS_write_buffer_size;
@@ -3841,6 +4008,14 @@ class Benchmark {
           new VectorRepFactory
         );
         break;
+      case kPartitionedSkipList:
+        options.memtable_factory.reset(NewPartitionedSkipListRepFactory(
+            static_cast<size_t>(FLAGS_memtable_partitions)));
+        break;
+      case kHashVector:
+        options.memtable_factory.reset(
+            NewHashVectorRepFactory(FLAGS_hash_bucket_count));
+        break;
 #else
       default:
         fprintf(stderr, "Only skip list is supported in lite mode\n");
@@ -3923,6 +4098,7 @@ class Benchmark {
         block_based_options.index_type =
             BlockBasedTableOptions::kBinarySearchWithFirstKey;
       }
+      block_based_options.decode_index_blocks = FLAGS_decode_index_blocks;
       BlockBasedTableOptions::IndexShorteningMode index_shortening =
           block_based_options.index_shortening;
       switch (FLAGS_index_shortening_mode) {
@@ -4061,10 +4237,13 @@ class Benchmark {
     options.hard_pending_compaction_bytes_limit =
         FLAGS_hard_pending_compaction_bytes_limit;
     options.delayed_write_rate = FLAGS_delayed_write_rate;
+    options.adaptive_write_stall = FLAGS_adaptive_write_stall;
     options.allow_concurrent_memtable_write =
         FLAGS_allow_concurrent_memtable_write;
+    options.batch_insert_threads = FLAGS_batch_insert_threads;
     options.inplace_update_support = FLAGS_inplace_update_support;
     options.inplace_update_num_locks = FLAGS_inplace_update_num_locks;
+    options.memtable_hot_key_slots = FLAGS_memtable_hot_key_slots;
     options.enable_write_thread_adaptive_yield =
         FLAGS_enable_write_thread_adaptive_yield;
     options.enable_pipelined_write = FLAGS_enable_pipelined_write;
@@ -7461,6 +7640,189 @@ class Benchmark {
     fprintf(stdout, "flush memtable\n");
   }
 
+#ifndef ROCKSDB_LITE
+  // Prints for every live WAL file, or every live table file, whether it is
+  // on real persistent memory.
+  void PrintFilesOnPmem(bool wal_files) {
+    if (db_.db == nullptr) {
+      return;
+    }
+    std::vector<std::string> fnames;
+    Status s;
+    if (wal_files) {
+      VectorLogPtr logs;
+      s = db_.db->GetSortedWalFiles(logs);
+      std::string wal_dir = db_.db->GetOptions().wal_dir;
+      if (wal_dir.empty()) {
+        wal_dir = db_.db->GetName();
+      }
+      for (const auto& log : logs) {
+        if (log->Type() == kAliveLogFile) {
+          fnames.push_back(wal_dir + log->PathName());
+        }
+      }
+    } else {
+      std::vector<LiveFileMetaData> metadata;
+      db_.db->GetLiveFilesMetaData(&metadata);
+      for (const auto& file : metadata) {
+        fnames.push_back(file.db_path + file.name);
+      }
+    }
+    if (!s.ok()) {
+      fprintf(stderr, "Listing files failed: %s\n", s.ToString().c_str());
+      return;
+    }
+    for (const auto& fname : fnames) {
+      bool is_pmem = false;
+      s = IsFileOnPmem(fname, &is_pmem);
+      fprintf(stdout, "%s: is_pmem %s\n", fname.c_str(),
+              s.ok() ? (is_pmem ? "1" : "0") : s.ToString().c_str());
+    }
+  }
+
+  // Closes and reopens the DB, timing the recovery of its live WAL files.
+  void PMRecovery() {
+    if (db_.db == nullptr) {
+      fprintf(stderr, "pmrecovery needs an open DB\n");
+      ErrorExit();
+    }
+    VectorLogPtr logs;
+    Status s = db_.db->GetSortedWalFiles(logs);
+    if (!s.ok()) {
+      fprintf(stderr, "GetSortedWalFiles failed: %s\n", s.ToString().c_str());
+      ErrorExit();
+    }
+    uint64_t wal_bytes = 0;
+    for (const auto& log : logs) {
+      if (log->Type() == kAliveLogFile) {
+        wal_bytes += log->SizeFileBytes();
+      }
+    }
+    PrintFilesOnPmem(true /* wal_files */);
+
+    db_.DeleteDBs();
+    uint64_t start = FLAGS_env->NowMicros();
+    Open(&open_options_);
+    double seconds = (FLAGS_env->NowMicros() - start) * 1e-6;
+    double mb = wal_bytes / 1048576.0;
+    fprintf(stdout,
+            "%-12s : recovered %.1f MB of WAL in %.3f seconds, %.1f MB/s\n",
+            "pmrecovery", mb, seconds, seconds > 0 ? mb / seconds : 0.0);
+  }
+#endif  // ROCKSDB_LITE
+
+  // Writes batches of random keys with write_options_.sync set and times
+  // every write. With a single thread each write is a write group of its own,
+  // so the latencies are those of appending and syncing one group to the WAL.
+  void PMWalSync(ThreadState* thread) {
+    RandomGenerator gen;
+    WriteBatch batch;
+    std::unique_ptr<const char[]> key_guard;
+    Slice key = AllocateKey(&key_guard);
+    HistogramImpl hist;
+    int64_t bytes = 0;
+    Duration duration(FLAGS_duration, writes_ == 0 ? num_ : writes_);
+    while (!duration.Done(entries_per_batch_)) {
+      DBWithColumnFamilies* db_with_cfh = SelectDBWithCfh(thread);
+      batch.Clear();
+      Status s;
+      for (int64_t j = 0; s.ok() && j < entries_per_batch_; j++) {
+        GenerateKeyFromInt(GetRandomKey(&thread->rand), FLAGS_num, &key);
+        Slice val = gen.Generate();
+        s = batch.Put(key, val);
+        bytes += key.size() + val.size();
+      }
+      if (s.ok()) {
+        uint64_t start = FLAGS_env->NowNanos();
+        s = db_with_cfh->db->Write(write_options_, &batch);
+        hist.Add(FLAGS_env->NowNanos() - start);
+      }
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        ErrorExit();
+      }
+      thread->stats.FinishedOps(db_with_cfh, db_with_cfh->db,
+                                entries_per_batch_, kWrite);
+    }
+    thread->stats.AddBytes(bytes);
+    pm_sync_hist_.Merge(hist);
+  }
+
+  void PMWalSyncReport() {
+    fprintf(stdout,
+            "%-12s : synced write latency p50 %.1f p99 %.1f p99.9 %.1f "
+            "micros over %" PRIu64 " writes\n",
+            "pmwalsync", pm_sync_hist_.Percentile(50) / 1e3,
+            pm_sync_hist_.Percentile(99) / 1e3,
+            pm_sync_hist_.Percentile(99.9) / 1e3, pm_sync_hist_.num());
+    if (dbstats) {
+      // Sync() of the WAL alone, once per write group
+      fprintf(stdout, "WAL sync micros per write group:\n%s\n",
+              dbstats->getHistogramString(WAL_FILE_SYNC_MICROS).c_str());
+    }
+#ifndef ROCKSDB_LITE
+    PrintFilesOnPmem(true /* wal_files */);
+#endif  // ROCKSDB_LITE
+  }
+
+  // Reads random keys like readrandom and reports how many bytes every Get
+  // copied on its way, which reads served from a pmem mapping avoid.
+  void PMReadRandom(ThreadState* thread) {
+    ReadOptions options(FLAGS_verify_checksum, true);
+    std::unique_ptr<const char[]> key_guard;
+    Slice key = AllocateKey(&key_guard);
+    PinnableSlice value;
+    int64_t read = 0;
+    int64_t found = 0;
+    int64_t bytes = 0;
+    uint64_t value_copy_bytes = 0;
+    PerfLevel prev_perf_level = GetPerfLevel();
+    if (prev_perf_level < PerfLevel::kEnableCount) {
+      SetPerfLevel(PerfLevel::kEnableCount);
+    }
+    get_perf_context()->Reset();
+
+    Duration duration(FLAGS_duration, reads_);
+    while (!duration.Done(1)) {
+      DBWithColumnFamilies* db_with_cfh = SelectDBWithCfh(thread);
+      GenerateKeyFromInt(GetRandomKey(&thread->rand), FLAGS_num, &key);
+      read++;
+      value.Reset();
+      Status s = db_with_cfh->db->Get(
+          options, db_with_cfh->db->DefaultColumnFamily(), key, &value);
+      if (s.ok()) {
+        found++;
+        bytes += key.size() + value.size();
+        if (!value.IsPinned()) {
+          value_copy_bytes += value.size();
+        }
+      } else if (!s.IsNotFound()) {
+        fprintf(stderr, "Get returned an error: %s\n", s.ToString().c_str());
+        abort();
+      }
+      thread->stats.FinishedOps(db_with_cfh, db_with_cfh->db, 1, kRead);
+    }
+
+    const PerfContext* perf = get_perf_context();
+    double gets = read > 0 ? static_cast<double>(read) : 1.0;
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "(%" PRId64 " of %" PRId64
+             " found) per Get: %.1f block bytes read, %.1f block bytes "
+             "copied, %.1f value bytes copied\n",
+             found, read, perf->block_read_byte / gets,
+             perf->block_read_copy_byte / gets, value_copy_bytes / gets);
+    SetPerfLevel(prev_perf_level);
+    thread->stats.AddBytes(bytes);
+    thread->stats.AddMessage(msg);
+  }
+
+  void PMReadRandomReport() {
+#ifndef ROCKSDB_LITE
+    PrintFilesOnPmem(false /* wal_files */);
+#endif  // ROCKSDB_LITE
+  }
+
   void ResetStats() {
     if (db_.db != nullptr) {
       db_.db->ResetStats();
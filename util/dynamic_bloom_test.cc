@@ -120,6 +120,40 @@ static uint32_t NextNum(uint32_t num) {
   return num;
 }
 
+TEST_F(DynamicBloomTest, BatchedMayContain) {
+  KeyMaker km;
+  for (uint32_t num_probes : {2, 4, 6, 8, 10}) {
+    Arena arena;
+    const uint32_t num = 1000;
+    DynamicBloom bloom(&arena, num * 6, num_probes);
+    for (uint64_t i = 0; i < num; i++) {
+      bloom.Add(km.Nonseq(i));
+    }
+    // Batches of every size, mixing added keys and keys probably not added
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; i < 2 * num; i++) {
+      keys.push_back(km.Nonseq(i % 2 == 0 ? i / 2 : i + 1000000000).ToString());
+    }
+    size_t pos = 0;
+    for (int batch = 1; pos + batch <= keys.size();
+         pos += batch, batch = batch % MultiGetContext::MAX_BATCH_SIZE + 1) {
+      std::vector<Slice> slices(keys.begin() + pos, keys.begin() + pos + batch);
+      std::vector<Slice*> key_ptrs;
+      for (auto& slice : slices) {
+        key_ptrs.push_back(&slice);
+      }
+      std::array<bool, MultiGetContext::MAX_BATCH_SIZE> may_match;
+      bloom.MayContain(batch, key_ptrs.data(), may_match.data());
+      for (int i = 0; i < batch; i++) {
+        ASSERT_EQ(bloom.MayContain(slices[i]), may_match[i]);
+        if ((pos + i) % 2 == 0) {
+          ASSERT_TRUE(may_match[i]);
+        }
+      }
+    }
+  }
+}
+
 TEST_F(DynamicBloomTest, VaryingLengths) {
   KeyMaker km;
 
@@ -213,6 +247,29 @@ TEST_F(DynamicBloomTest, perf) {
     assert(count > 0);
     fprintf(stderr, "dynamic bloom, avg query latency %3g\n",
             static_cast<double>(elapsed) / count);
+
+    const int kBatchSize = MultiGetContext::MAX_BATCH_SIZE;
+    std::vector<uint64_t> batch_keys(kBatchSize);
+    std::vector<Slice> batch_slices(kBatchSize);
+    std::vector<Slice*> batch_key_ptrs(kBatchSize);
+    std::array<bool, MultiGetContext::MAX_BATCH_SIZE> may_match;
+    count = 0;
+    timer.Start();
+    for (uint64_t i = 1; i + kBatchSize <= num_keys + 1; i += kBatchSize) {
+      for (int j = 0; j < kBatchSize; ++j) {
+        batch_keys[j] = i + j;
+        batch_slices[j] = Slice(reinterpret_cast<char *>(&batch_keys[j]),
+                                sizeof(batch_keys[j]));
+        batch_key_ptrs[j] = &batch_slices[j];
+      }
+      std_bloom.MayContain(kBatchSize, batch_key_ptrs.data(), may_match.data());
+      count += static_cast<uint32_t>(
+          std::count(may_match.begin(), may_match.end(), true));
+    }
+    elapsed = timer.ElapsedNanos();
+    ASSERT_EQ(count, num_keys);
+    fprintf(stderr, "dynamic bloom, avg batched query latency %3g\n",
+            static_cast<double>(elapsed) / count);
   }
 }
 
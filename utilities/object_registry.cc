@@ -7,6 +7,9 @@
 
 #include "logging/logging.h"
 #include "rocksdb/env.h"
+#ifdef ROCKSDB_PMEM
+#include "pmenv/env_pm.h"
+#endif  // ROCKSDB_PMEM
 
 namespace ROCKSDB_NAMESPACE {
 #ifndef ROCKSDB_LITE
@@ -46,11 +49,21 @@ void ObjectLibrary::Dump(Logger *logger) const {
   ROCKS_LOG_HEADER(logger, "\n");
 }
 
+// Registers the factories that are part of the library itself. They are
+// registered here rather than by static initializers in their own files,
+// which a static link may drop.
+static std::shared_ptr<ObjectLibrary> NewBuiltinLibrary() {
+  std::shared_ptr<ObjectLibrary> library = std::make_shared<ObjectLibrary>();
+#ifdef ROCKSDB_PMEM
+  RegisterPMFileSystem(*library);
+#endif  // ROCKSDB_PMEM
+  return library;
+}
+
 // Returns the Default singleton instance of the ObjectLibrary
 // This instance will contain most of the "standard" registered objects
 std::shared_ptr<ObjectLibrary> &ObjectLibrary::Default() {
-  static std::shared_ptr<ObjectLibrary> instance =
-      std::make_shared<ObjectLibrary>();
+  static std::shared_ptr<ObjectLibrary> instance = NewBuiltinLibrary();
   return instance;
 }
 